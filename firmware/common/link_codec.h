@@ -0,0 +1,349 @@
+/**
+ * @file link_codec.h
+ * @brief Player↔display UART framing (protocol v1 and v2), shared by both
+ *        firmwares.  Header-only: framing, CRC, parser and link counters.
+ *
+ * v1 frame – one command per frame:
+ *   [MAGIC "ROGEL202"][CMD][LEN][payload ≤ 128][XOR of CMD, LEN, payload]
+ *
+ * v2 frame – several sub-messages per frame:
+ *   [0xA5 0x5A]   sync word
+ *   [LEN]         bytes from SEQ to the end of the last sub-message (2..255)
+ *   [SEQ]         sender's frame counter (wraps at 256)
+ *   [ACK]         SEQ of the last frame received from the peer
+ *   sub-messages  [CMD][LEN][payload ≤ 128] …  (v1 command ids and payloads)
+ *   [CRC16 LE]    CRC-16/CCITT-FALSE over LEN … last sub-message
+ *
+ * A command costs 11 bytes of v1 framing but 2 bytes inside a v2 frame
+ * (plus 7 per frame), and the CRC catches the burst errors an XOR misses.
+ * SEQ lets the receiver count lost frames; ACK lets a sender match a reply
+ * to the frame it answers.
+ *
+ * Both framings are told apart by their first byte, so one parser accepts
+ * either at any time.  The link starts in v1; CMD_LINK_HELLO (see
+ * uart_master.h / uart_comm.h) switches it to v2.
+ */
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Highest link version this build speaks: 2 = v2 framing, 3 = v2 framing
+ * plus the CMD_STATE_DELTA state stream, 4 = plus the CMD_LINK_BAUD rate
+ * handshake. */
+#define LINK_VERSION         4
+
+#define LINK_V1_MAGIC_LEN    8
+#define LINK_V2_SYNC0        0xA5u
+#define LINK_V2_SYNC1        0x5Au
+#define LINK_MAX_PAYLOAD     128      /* per command, both framings */
+#define LINK_V2_MAX_BODY     255      /* SEQ + ACK + sub-messages */
+#define LINK_V2_OVERHEAD     7        /* sync, LEN, SEQ, ACK, CRC */
+#define LINK_MAX_FRAME       (3 + LINK_V2_MAX_BODY + 2)
+
+static const uint8_t LINK_V1_MAGIC[LINK_V1_MAGIC_LEN] = {
+    0x52, 0x4F, 0x47, 0x45, 0x4C, 0x32, 0x30, 0x32    /* "ROGEL202" */
+};
+
+/* ── CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), one lookup per byte ── */
+
+static const uint16_t LINK_CRC16_TABLE[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+    0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+    0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+    0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+    0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+    0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+    0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+    0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+    0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+    0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+    0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+    0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+    0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+    0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0,
+};
+
+#define LINK_CRC16_INIT  0xFFFFu
+
+static inline uint16_t link_crc16(uint16_t crc, const uint8_t *p, size_t n)
+{
+    while (n--) crc = (uint16_t)((crc << 8) ^ LINK_CRC16_TABLE[((crc >> 8) ^ *p++) & 0xFFu]);
+    return crc;
+}
+
+/* ── Link counters ──────────────────────────────────────────────────────── */
+
+typedef struct {
+    uint32_t tx_frames;
+    uint32_t tx_bytes;     /**< on the wire, framing included            */
+    uint32_t tx_payload;   /**< command payload bytes (the useful part)  */
+    uint32_t rx_frames;    /**< good frames                              */
+    uint32_t rx_bytes;
+    uint32_t rx_payload;
+    uint32_t rx_bad;       /**< checksum / CRC failures                  */
+    uint32_t rx_malformed; /**< bad LEN or sub-message layout            */
+    uint32_t rx_noise;     /**< bytes skipped while looking for a frame  */
+    uint32_t rx_lost;      /**< frames missing from the peer's SEQ       */
+    uint32_t rx_reads;     /**< driver reads (receiver wake-ups)         */
+    uint32_t rx_overflow;  /**< RX FIFO / ring buffer overflows          */
+    uint32_t no_reply;     /**< requests the peer never acknowledged     */
+} link_stats_t;
+
+/** Payload bytes per wire byte sent, in percent (0 before any traffic). */
+static inline uint32_t link_tx_efficiency_pct(const link_stats_t *st)
+{
+    return st->tx_bytes ? (uint32_t)((uint64_t)st->tx_payload * 100u / st->tx_bytes) : 0u;
+}
+
+/** Good-frame bytes received per driver read (0 before any traffic). */
+static inline uint32_t link_rx_bytes_per_read(const link_stats_t *st)
+{
+    return st->rx_reads ? st->rx_bytes / st->rx_reads : 0u;
+}
+
+/* ── Encoding ───────────────────────────────────────────────────────────── */
+
+/** Encode one v1 frame into @p out (≥ 11 + @p len bytes); returns its size. */
+static inline uint16_t link_v1_encode(uint8_t *out, uint8_t cmd, const uint8_t *payload, uint8_t len)
+{
+    uint8_t x = cmd ^ len;
+    memcpy(out, LINK_V1_MAGIC, LINK_V1_MAGIC_LEN);
+    out[8] = cmd;
+    out[9] = len;
+    for (uint8_t i = 0; i < len; i++) {
+        out[10 + i] = payload[i];
+        x ^= payload[i];
+    }
+    out[10 + len] = x;
+    return (uint16_t)(11u + len);
+}
+
+/** A v2 frame being assembled. */
+typedef struct {
+    uint8_t  buf[LINK_MAX_FRAME];
+    uint16_t len;          /**< bytes used, CRC excluded */
+    uint16_t payload;      /**< payload bytes of the sub-messages */
+    uint8_t  subs;
+} link_frame_t;
+
+static inline void link_frame_begin(link_frame_t *f)
+{
+    f->len     = 5;        /* sync, LEN, SEQ, ACK */
+    f->payload = 0;
+    f->subs    = 0;
+}
+
+/** Room left for one more sub-message's payload (-1: none fits). */
+static inline int link_frame_room(const link_frame_t *f)
+{
+    int room = (3 + LINK_V2_MAX_BODY) - (int)f->len - 2;
+    return room > LINK_MAX_PAYLOAD ? LINK_MAX_PAYLOAD : room;
+}
+
+/** Append a sub-message; false if it does not fit (frame unchanged). */
+static inline bool link_frame_add(link_frame_t *f, uint8_t cmd, const uint8_t *payload, uint8_t len)
+{
+    if ((int)len > link_frame_room(f)) return false;
+    f->buf[f->len++] = cmd;
+    f->buf[f->len++] = len;
+    if (len) memcpy(&f->buf[f->len], payload, len);
+    f->len     = (uint16_t)(f->len + len);
+    f->payload = (uint16_t)(f->payload + len);
+    f->subs++;
+    return true;
+}
+
+/** Write header and CRC; returns the frame size (f->buf holds the frame). */
+static inline uint16_t link_frame_finish(link_frame_t *f, uint8_t seq, uint8_t ack)
+{
+    f->buf[0] = LINK_V2_SYNC0;
+    f->buf[1] = LINK_V2_SYNC1;
+    f->buf[2] = (uint8_t)(f->len - 3);
+    f->buf[3] = seq;
+    f->buf[4] = ack;
+    uint16_t crc = link_crc16(LINK_CRC16_INIT, &f->buf[2], (size_t)(f->len - 2));
+    f->buf[f->len]     = (uint8_t)(crc & 0xFFu);
+    f->buf[f->len + 1] = (uint8_t)(crc >> 8);
+    return (uint16_t)(f->len + 2);
+}
+
+/* ── Parsing ────────────────────────────────────────────────────────────── */
+
+enum {
+    LINK_RX_NONE = 0,      /**< frame not complete yet */
+    LINK_RX_V1,            /**< p->cmd, p->buf[0..len) is the payload */
+    LINK_RX_V2,            /**< p->seq, p->ack; link_next_sub() walks it */
+};
+
+typedef struct {
+    uint8_t  state;
+    uint8_t  idx;
+    uint8_t  len;
+    uint8_t  cmd;          /**< v1 command */
+    uint8_t  seq, ack;     /**< v2 header  */
+    uint8_t  sum;          /**< v1 XOR     */
+    uint16_t crc;          /**< v2 CRC     */
+    uint8_t  crc_lo;
+    bool     have_seq;     /**< peer SEQ seen (for rx_lost) */
+    uint8_t  last_seq;
+    uint8_t  buf[LINK_V2_MAX_BODY];
+} link_parser_t;
+
+#define LINK_PARSER_INIT  { 0, 0, 0, 0, 0, 0, 0, 0, 0, false, 0, { 0 } }
+
+enum {
+    LINK_PS_IDLE = 0, LINK_PS_MAGIC, LINK_PS_CMD, LINK_PS_LEN1, LINK_PS_PAYLOAD1, LINK_PS_SUM,
+    LINK_PS_SYNC1, LINK_PS_LEN2, LINK_PS_BODY2, LINK_PS_CRC_LO, LINK_PS_CRC_HI,
+};
+
+/** Drop a partly received frame (after an overflow or a baud change). */
+static inline void link_parser_reset(link_parser_t *p)
+{
+    p->state = LINK_PS_IDLE;
+}
+
+/** Start of a frame at @p b, or back to idle (counting the byte as noise). */
+static inline void link_parser_start(link_parser_t *p, uint8_t b, link_stats_t *st)
+{
+    if (b == LINK_V1_MAGIC[0])   { p->state = LINK_PS_MAGIC; p->idx = 1; }
+    else if (b == LINK_V2_SYNC0) { p->state = LINK_PS_SYNC1; }
+    else                         { p->state = LINK_PS_IDLE; st->rx_noise++; }
+}
+
+/**
+ * @brief Feed one received byte.
+ * @return LINK_RX_V1 / LINK_RX_V2 when it completed a good frame.
+ */
+static inline int link_parser_feed(link_parser_t *p, uint8_t b, link_stats_t *st)
+{
+    switch (p->state) {
+    case LINK_PS_IDLE:
+        link_parser_start(p, b, st);
+        return LINK_RX_NONE;
+
+    /* v1 */
+    case LINK_PS_MAGIC:
+        if (b == LINK_V1_MAGIC[p->idx]) {
+            if (++p->idx == LINK_V1_MAGIC_LEN) p->state = LINK_PS_CMD;
+        } else {
+            st->rx_noise += p->idx;
+            link_parser_start(p, b, st);
+        }
+        return LINK_RX_NONE;
+    case LINK_PS_CMD:
+        p->cmd   = b;
+        p->sum   = b;
+        p->state = LINK_PS_LEN1;
+        return LINK_RX_NONE;
+    case LINK_PS_LEN1:
+        p->len  = b;
+        p->sum ^= b;
+        p->idx  = 0;
+        if (b > LINK_MAX_PAYLOAD) { st->rx_malformed++; p->state = LINK_PS_IDLE; }
+        else p->state = b ? LINK_PS_PAYLOAD1 : LINK_PS_SUM;
+        return LINK_RX_NONE;
+    case LINK_PS_PAYLOAD1:
+        p->buf[p->idx++] = b;
+        p->sum ^= b;
+        if (p->idx >= p->len) p->state = LINK_PS_SUM;
+        return LINK_RX_NONE;
+    case LINK_PS_SUM:
+        p->state = LINK_PS_IDLE;
+        if (b != p->sum) { st->rx_bad++; return LINK_RX_NONE; }
+        st->rx_frames++;
+        st->rx_bytes   += 11u + p->len;
+        st->rx_payload += p->len;
+        return LINK_RX_V1;
+
+    /* v2 */
+    case LINK_PS_SYNC1:
+        if (b == LINK_V2_SYNC1) p->state = LINK_PS_LEN2;
+        else { st->rx_noise++; link_parser_start(p, b, st); }
+        return LINK_RX_NONE;
+    case LINK_PS_LEN2:
+        if (b < 2) { st->rx_malformed++; p->state = LINK_PS_IDLE; return LINK_RX_NONE; }
+        p->len   = b;
+        p->idx   = 0;
+        p->crc   = link_crc16(LINK_CRC16_INIT, &b, 1);
+        p->state = LINK_PS_BODY2;
+        return LINK_RX_NONE;
+    case LINK_PS_BODY2:
+        p->buf[p->idx++] = b;
+        if (p->idx >= p->len) {
+            p->crc   = link_crc16(p->crc, p->buf, p->len);
+            p->state = LINK_PS_CRC_LO;
+        }
+        return LINK_RX_NONE;
+    case LINK_PS_CRC_LO:
+        p->crc_lo = b;
+        p->state  = LINK_PS_CRC_HI;
+        return LINK_RX_NONE;
+    case LINK_PS_CRC_HI:
+        p->state = LINK_PS_IDLE;
+        if ((uint16_t)(p->crc_lo | ((uint16_t)b << 8)) != p->crc) { st->rx_bad++; return LINK_RX_NONE; }
+        p->seq = p->buf[0];
+        p->ack = p->buf[1];
+        if (p->have_seq) {
+            uint8_t gap = (uint8_t)(p->seq - p->last_seq - 1u);
+            if (gap < 128u) st->rx_lost += gap;      /* else a restart or reorder */
+        }
+        p->have_seq = true;
+        p->last_seq = p->seq;
+        st->rx_frames++;
+        st->rx_bytes += (uint32_t)LINK_V2_OVERHEAD - 2u + p->len;
+        return LINK_RX_V2;
+
+    default:
+        p->state = LINK_PS_IDLE;
+        return LINK_RX_NONE;
+    }
+}
+
+/**
+ * @brief Next sub-message of the v2 frame in @p p, starting at *@p pos
+ *        (initialise to 0).  false at the end, or on a truncated
+ *        sub-message (counted as malformed).
+ */
+static inline bool link_next_sub(const link_parser_t *p, uint16_t *pos, link_stats_t *st,
+                                 uint8_t *cmd, const uint8_t **payload, uint8_t *len)
+{
+    uint16_t at = (uint16_t)(*pos + 2u);      /* skip SEQ, ACK */
+    if (at >= p->len) return false;
+    if (at + 2u > p->len || at + 2u + p->buf[at + 1] > p->len) {
+        st->rx_malformed++;
+        return false;
+    }
+    *cmd     = p->buf[at];
+    *len     = p->buf[at + 1];
+    *payload = &p->buf[at + 2];
+    *pos     = (uint16_t)(*pos + 2u + *len);
+    st->rx_payload += *len;
+    return true;
+}
+
+#ifdef __cplusplus
+}
+#endif
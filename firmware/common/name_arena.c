@@ -0,0 +1,143 @@
+/**
+ * @file name_arena.c
+ * @brief Compact song-name store – see name_arena.h.
+ */
+
+#include "name_arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_heap_caps.h"
+/* PSRAM first, internal RAM when there is none (or it is full). */
+#define ARENA_REALLOC(p, n) \
+    heap_caps_realloc_prefer((p), (n), 2, MALLOC_CAP_SPIRAM, MALLOC_CAP_DEFAULT)
+#else
+#define ARENA_REALLOC(p, n) realloc((p), (n))
+#endif
+
+#define ARENA_BLOB_MIN   1024u
+#define ARENA_SLOTS_MIN  64u
+
+void name_arena_free(name_arena_t *a)
+{
+    free(a->blob);
+    free(a->off);
+    free(a->order);
+    memset(a, 0, sizeof(*a));
+}
+
+void name_arena_clear(name_arena_t *a)
+{
+    a->used   = 0;
+    a->count  = 0;
+    a->sorted = false;
+}
+
+static bool grow_slots(name_arena_t *a)
+{
+    if (a->cap >= NAME_ARENA_MAX) return false;
+    uint32_t cap = a->cap ? (uint32_t)a->cap * 2u : ARENA_SLOTS_MIN;
+    if (cap > NAME_ARENA_MAX) cap = NAME_ARENA_MAX;
+
+    uint32_t *off = (uint32_t *)ARENA_REALLOC(a->off, cap * sizeof(*off));
+    if (!off) return false;
+    a->off = off;
+    uint16_t *order = (uint16_t *)ARENA_REALLOC(a->order, cap * sizeof(*order));
+    if (!order) return false;
+    a->order = order;
+    a->cap   = (uint16_t)cap;
+    return true;
+}
+
+static bool grow_blob(name_arena_t *a, uint32_t need)
+{
+    uint32_t cap = a->blob_cap ? a->blob_cap : ARENA_BLOB_MIN;
+    while (cap < need) cap *= 2u;
+    char *blob = (char *)ARENA_REALLOC(a->blob, cap);
+    if (!blob) return false;
+    a->blob     = blob;
+    a->blob_cap = cap;
+    return true;
+}
+
+int32_t name_arena_add(name_arena_t *a, const char *name, size_t len)
+{
+    const char *nul = (const char *)memchr(name, '\0', len);
+    if (nul) len = (size_t)(nul - name);
+    if (a->count >= NAME_ARENA_MAX) return -1;
+    if (a->count == a->cap && !grow_slots(a)) return -1;
+    uint32_t need = a->used + (uint32_t)len + 1u;
+    if (need > a->blob_cap && !grow_blob(a, need)) return -1;
+
+    memcpy(a->blob + a->used, name, len);
+    a->blob[a->used + len] = '\0';
+    a->off[a->count] = a->used;
+    a->used   = need;
+    a->sorted = false;
+    return a->count++;
+}
+
+const char *name_arena_get(const name_arena_t *a, uint16_t i)
+{
+    return (i < a->count) ? a->blob + a->off[i] : "";
+}
+
+int name_arena_cmp(const char *x, const char *y)
+{
+    int c = strcasecmp(x, y);
+    return c ? c : strcmp(x, y);
+}
+
+void name_arena_sort(name_arena_t *a)
+{
+    uint16_t *o = a->order;
+    for (uint16_t i = 0; i < a->count; i++) o[i] = i;
+
+    /* Shell sort (Ciura gaps): no recursion and no qsort context needed. */
+    static const uint16_t gaps[] = { 1750, 701, 301, 132, 57, 23, 10, 4, 1 };
+    for (size_t g = 0; g < sizeof(gaps) / sizeof(gaps[0]); g++) {
+        uint32_t gap = gaps[g];
+        for (uint32_t i = gap; i < a->count; i++) {
+            uint16_t    v  = o[i];
+            const char *vn = a->blob + a->off[v];
+            uint32_t    j  = i;
+            for (; j >= gap && name_arena_cmp(a->blob + a->off[o[j - gap]], vn) > 0; j -= gap) {
+                o[j] = o[j - gap];
+            }
+            o[j] = v;
+        }
+    }
+    a->sorted = true;
+}
+
+uint16_t name_arena_sorted(const name_arena_t *a, uint16_t pos)
+{
+    return (a->sorted && pos < a->count) ? a->order[pos] : pos;
+}
+
+int32_t name_arena_find_pos(const name_arena_t *a, const char *name)
+{
+    if (!a->sorted) return -1;
+    uint32_t lo = 0, hi = a->count;
+    while (lo < hi) {                       /* first position not below name */
+        uint32_t mid = (lo + hi) / 2u;
+        if (strcasecmp(a->blob + a->off[a->order[mid]], name) < 0) lo = mid + 1u;
+        else                                                       hi = mid;
+    }
+    if (lo < a->count && strcasecmp(a->blob + a->off[a->order[lo]], name) == 0) return (int32_t)lo;
+    return -1;
+}
+
+int32_t name_arena_find(const name_arena_t *a, const char *name)
+{
+    int32_t pos = name_arena_find_pos(a, name);
+    return (pos < 0) ? -1 : (int32_t)a->order[pos];
+}
+
+size_t name_arena_bytes(const name_arena_t *a)
+{
+    return (size_t)a->blob_cap + (size_t)a->cap * (sizeof(uint32_t) + sizeof(uint16_t));
+}
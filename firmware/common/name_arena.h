@@ -0,0 +1,79 @@
+/**
+ * @file name_arena.h
+ * @brief Compact song-name store shared by the player and display firmware.
+ *
+ * Names are packed back to back, NUL-terminated, in one UTF-8 blob; name i
+ * is found through an offset table.  Memory grows with the names actually
+ * stored (one blob byte per character plus 4 bytes of offset and 2 bytes
+ * of sort order per name) instead of a fixed slot per song, and both
+ * buffers prefer PSRAM on the ESP32-S3.
+ *
+ * name_arena_sort() builds a permutation in case-insensitive name order, so
+ * the list can be shown alphabetically and names looked up by bisection.
+ * Adding a name invalidates the order until the next sort.
+ *
+ * Plain C without FreeRTOS dependencies; the caller serialises access.
+ */
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NAME_ARENA_MAX   0xFFFFu   /* names per arena (16-bit index) */
+
+typedef struct {
+    char     *blob;       /**< packed NUL-terminated names            */
+    uint32_t *off;        /**< off[i]: start of name i in blob        */
+    uint16_t *order;      /**< name indices in name order (sorted)    */
+    uint32_t  used;       /**< blob bytes in use                      */
+    uint32_t  blob_cap;
+    uint16_t  count;
+    uint16_t  cap;        /**< slots in off[] and order[]             */
+    bool      sorted;     /**< order[] is valid                       */
+} name_arena_t;
+
+#define NAME_ARENA_INIT  { NULL, NULL, NULL, 0, 0, 0, 0, false }
+
+/** @brief Release both buffers; the arena is empty afterwards. */
+void name_arena_free(name_arena_t *a);
+
+/** @brief Forget all names but keep the buffers for reuse. */
+void name_arena_clear(name_arena_t *a);
+
+/**
+ * @brief Append the first @p len bytes of @p name (cut at a NUL).
+ * @return index of the new name, -1 when out of memory or full.
+ */
+int32_t name_arena_add(name_arena_t *a, const char *name, size_t len);
+
+/** @brief Name @p i, or "" when out of range. */
+const char *name_arena_get(const name_arena_t *a, uint16_t i);
+
+/** @brief The list order: ASCII case-insensitive, then bytewise (<0, 0, >0). */
+int name_arena_cmp(const char *x, const char *y);
+
+/** @brief Sort order[] by name_arena_cmp(). */
+void name_arena_sort(name_arena_t *a);
+
+/** @brief Index of the name at sorted position @p pos (@p pos if unsorted). */
+uint16_t name_arena_sorted(const name_arena_t *a, uint16_t pos);
+
+/**
+ * @brief Sorted position of the first name equal to @p name ignoring ASCII
+ *        case (FAT file-name semantics), or -1.  Requires name_arena_sort().
+ */
+int32_t name_arena_find_pos(const name_arena_t *a, const char *name);
+
+/** @brief Index of that name, or -1.  Requires name_arena_sort(). */
+int32_t name_arena_find(const name_arena_t *a, const char *name);
+
+/** @brief Heap bytes held by the arena. */
+size_t name_arena_bytes(const name_arena_t *a);
+
+#ifdef __cplusplus
+}
+#endif
@@ -20,6 +20,7 @@
 #include "lvgl.h"
 
 #include "sunton_esp32_8048s050c.h"
+#include "uart_comm.h"
 
 const esp_lcd_rgb_panel_config_t panel_config = {
     .data_width = 16,
@@ -240,6 +241,7 @@ static void touchpad_read(lv_indev_t *indev, lv_indev_data_t *data)
     {
         data->state = LV_INDEV_STATE_RELEASED;
     }
+    uart_comm_update_touch(touchpad_cnt > 0, data->point.x, data->point.y);
 }
 
 static esp_lcd_touch_handle_t touch_init(i2c_master_bus_handle_t i2c_master)
@@ -2,29 +2,43 @@
  * @file uart_comm.c
  * @brief UART communication layer – state-machine parser + FreeRTOS task.
  *
- * Packet format (all multi-byte fields are little-endian):
- *   [MAGIC 8B][CMD 1B][LEN 1B][PAYLOAD LEN*B][CHECKSUM 1B]
- *
- * Checksum = XOR of (CMD ^ LEN ^ payload[0] ^ ... ^ payload[LEN-1])
+ * Frames are parsed by the shared link_codec parser (v1 and v2, see
+ * uart_comm.h); every command of a frame goes through handle_packet().
  *
  * CMD_SET_STATE (0x01) payload layout:
  *   [is_playing:u8][volume:u8][tempo:u8][song_name:char[0..MAX_SONG_NAME_LEN-1]]
  *
- * CMD_SYNC (0x02) has no payload (LEN = 0).  Both CMD_SYNC and CMD_SET_STATE
- * elicit a CMD_ACK (0xFF) response from the display.  Extended ACK payload:
+ * CMD_STATE_DELTA (0x19) carries only changed fields (see uart_comm.h).
+ *
+ * CMD_SYNC (0x02) has no payload (LEN = 0).  CMD_SYNC, CMD_SET_STATE and
+ * CMD_STATE_DELTA elicit a CMD_ACK (0xFF) response from the display.
+ * Extended ACK payload:
  *   [touch_active:u8][touch_x:i16_le][touch_y:i16_le][cmd_count:u8]
  *   Followed by cmd_count sub-commands, each: [cmd_id:u8][param_len:u8][params:...]
  *
- * The display NEVER sends unsolicited packets.  All Display->Host commands
- * are queued via enqueue_pending_cmd() and flushed in the next ACK response.
+ * Display->Host commands go through enqueue_pending_cmd().  Ordinary ones
+ * wait for the next ACK response, one response per received frame even
+ * when a v2 frame carries both CMD_SET_STATE and CMD_SYNC.  On a v2 link an
+ * urgent command is not held back: it flushes the queue at once from the
+ * calling task (send_urgent()); s_tx_mutex keeps the two senders' frames
+ * and SEQs apart.
+ *
+ * The song list arrives as CMD_LIST_INFO / CMD_LIST_PAGE / CMD_LIST_DELTA
+ * (see uart_comm.h); ui_songlist keeps the window and asks for pages.
+ *
+ * CMD_LINK_BAUD proposals are accepted once their frame has been answered,
+ * so the poll response still leaves at the old rate; the switch follows
+ * right after the ACCEPT (switch_baud()).  CMD_LINK_TEST is echoed at once.
  */
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
 #include "freertos/semphr.h"
 #include "driver/uart.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include <string.h>
 
 #include "uart_comm.h"
@@ -48,15 +62,24 @@ static SemaphoreHandle_t s_state_mutex = NULL;
 static uint8_t  s_was_playing  = 0;
 static uint16_t s_prev_song_id = 0;
 
-/* ---------- CMD_SONG_LIST accumulation ----------------------------------- */
+/* Our millisecond clock minus the player's, from CMD_STATE_DELTA stamps: the
+ * lowest seen since the last full state (the least delayed frame). */
+static uint32_t s_clock_off_ms = 0;
+static bool     s_clock_valid  = false;
+
+/* ---------- CMD_LIST_PAGE accumulation ----------------------------------- */
 
 /**
- * Multiple CMD_SONG_LIST packets may arrive before the end-of-list terminator.
- * We accumulate all chunks here and only forward the merged buffer to the UI
- * once the terminator (song_id == 0, name == '\0') is detected.
+ * A CMD_LIST_PAGE_REQ is answered by several CMD_LIST_PAGE packets covering
+ * consecutive positions.  Entries are parsed as they arrive into a batch
+ * (names in a PSRAM arena), which is handed to the UI with the last packet.
+ * A packet that does not continue the staged reply (other start or list
+ * version) starts a new one; the UI re-requests anything that never
+ * completes.  The host never splits an entry across packets.
  */
-static uint8_t  s_songlist_buf[SONGLIST_BUF_SIZE];
-static uint16_t s_songlist_len = 0;
+static ui_songlist_batch_t *s_page_batch   = NULL;
+static uint16_t             s_page_start   = 0;
+static uint32_t             s_page_version = 0;
 
 /* ---------- Touch state -------------------------------------------------- */
 
@@ -69,13 +92,15 @@ static portMUX_TYPE  s_touch_mux    = portMUX_INITIALIZER_UNLOCKED;
 static volatile bool    s_touch_active = false;
 static volatile int16_t s_touch_x      = 0;
 static volatile int16_t s_touch_y      = 0;
+static int64_t          s_touch_edge_us = 0;  /* last press / release */
 
 /* ---------- Pending command queue ---------------------------------------- */
 
 /**
- * All Display->Host commands are queued here instead of being sent
- * immediately.  They are flushed in send_response(), which is called
- * whenever CMD_SET_STATE or CMD_SYNC is received from the player.
+ * Display->Host commands are queued here.  Ordinary ones are flushed in
+ * send_response(), which is called whenever CMD_SET_STATE or CMD_SYNC is
+ * received from the player; on a v2 link urgent ones (is_urgent()) go out
+ * at once through send_urgent().
  *
  * Access to the queue is protected by a spinlock so it can be safely
  * written from the LVGL task (Core 1) and read from the UART task (Core 0).
@@ -84,6 +109,7 @@ static volatile int16_t s_touch_y      = 0;
 #define PENDING_CMD_MAX_PARAMS 12  /* large enough for SET_SONG_SETTINGS (10 B) */
 
 typedef struct {
+    int64_t t_us;       /* touch edge (or enqueue) time, for the latency */
     uint8_t cmd_id;
     uint8_t param_len;
     uint8_t params[PENDING_CMD_MAX_PARAMS];
@@ -93,21 +119,56 @@ static pending_cmd_t s_pending_queue[PENDING_QUEUE_SLOTS];
 static uint8_t       s_pending_count = 0;
 static portMUX_TYPE  s_queue_mux     = portMUX_INITIALIZER_UNLOCKED;
 
-/* ---------- Parser state machine ----------------------------------------- */
+/* ---------- Link state --------------------------------------------------- */
+
+/** Framing and SEQ of the frame being handled; the response mirrors them. */
+static volatile uint8_t s_rx_ver   = 1;
+static uint8_t      s_rx_seq      = 0;
+static uint8_t      s_tx_seq      = 0;
+static bool         s_resp_due    = false;  /* frame asked for a CMD_ACK  */
+static link_stats_t s_link_stats;
+static SemaphoreHandle_t s_tx_mutex = NULL;  /* UART task vs. send_urgent() */
 
-typedef enum {
-    PARSER_STATE_MAGIC,     /* Matching magic header byte-by-byte */
-    PARSER_STATE_CMD,       /* Reading command byte                */
-    PARSER_STATE_LEN,       /* Reading payload length byte         */
-    PARSER_STATE_PAYLOAD,   /* Accumulating payload bytes          */
-    PARSER_STATE_CHECKSUM,  /* Reading and verifying checksum      */
-} parser_state_t;
+/* Touch→UART latency of urgent commands since the last link log */
+static uint32_t     s_lat_n       = 0;
+static uint64_t     s_lat_sum_us  = 0;
+static uint32_t     s_lat_max_us  = 0;
+
+/* Link rate (uart_comm.h): in use, last committed, a proposal waiting for
+ * its frame to be answered, and the times of the switch and last good frame */
+static uint32_t     s_baud        = UART_COMM_BAUD_RATE;
+static uint32_t     s_baud_kept   = UART_COMM_BAUD_RATE;
+static uint32_t     s_baud_next   = 0;
+static bool         s_baud_trial  = false;
+static TickType_t   s_baud_set    = 0;
+static TickType_t   s_last_good   = 0;
+
+/* Receive side: uart_task sleeps on the driver's event queue */
+static QueueHandle_t s_rx_events  = NULL;
+static link_parser_t s_parser     = LINK_PARSER_INIT;
+
+#define LINK_STATS_LOG_MS  60000
 
 /* ---------- Forward declarations ----------------------------------------- */
 static void uart_task(void *arg);
 static void handle_packet(uint8_t cmd, const uint8_t *payload, uint8_t len);
 static void enqueue_pending_cmd(uint8_t cmd_id, const uint8_t *params, uint8_t param_len);
 static void send_response(void);
+static void send_urgent(void);
+static void send_now(uint8_t cmd, const uint8_t *payload, uint8_t len);
+
+static inline void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint32_t get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
 
 /* =========================================================================
  * Public API
@@ -212,11 +273,23 @@ void uart_comm_send_set_song_settings(uint16_t song_id,
              song_id, flags, fixed_speed_x100, dimmer_max, dimmer_min, dimmer_rps_ref_x10, dimmer_holdoff_s, dimmer_fadein_s, pitch_influence_pct);
 }
 
+void uart_comm_send_list_page_req(uint16_t start, uint8_t count)
+{
+    uint8_t params[3];
+    params[0] = (uint8_t)(start & 0xFF);
+    params[1] = (uint8_t)(start >> 8);
+    params[2] = count;
+    enqueue_pending_cmd(CMD_LIST_PAGE_REQ, params, 3);
+    ESP_LOGD(TAG, "CMD_LIST_PAGE_REQ queued: start=%u count=%u", start, count);
+}
+
 void uart_comm_init(void)
 {
     /* Create state mutex before the task can use it */
     s_state_mutex = xSemaphoreCreateMutex();
     configASSERT(s_state_mutex != NULL);
+    s_tx_mutex = xSemaphoreCreateMutex();
+    configASSERT(s_tx_mutex != NULL);
 
     const uart_config_t uart_cfg = {
         .baud_rate  = UART_COMM_BAUD_RATE,
@@ -229,11 +302,14 @@ void uart_comm_init(void)
 
     ESP_ERROR_CHECK(uart_driver_install(UART_COMM_PORT,
                                         UART_COMM_RX_BUF_SIZE, 0,
-                                        0, NULL, 0));
+                                        UART_COMM_EVENT_QUEUE, &s_rx_events, 0));
     ESP_ERROR_CHECK(uart_param_config(UART_COMM_PORT, &uart_cfg));
     ESP_ERROR_CHECK(uart_set_pin(UART_COMM_PORT,
                                  UART_COMM_TX_PIN, UART_COMM_RX_PIN,
                                  UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE));
+    /* Wake per FIFO block or once the line idles after a frame, not per byte */
+    ESP_ERROR_CHECK(uart_set_rx_full_threshold(UART_COMM_PORT, UART_COMM_RX_FULL));
+    ESP_ERROR_CHECK(uart_set_rx_timeout(UART_COMM_PORT, UART_COMM_RX_IDLE));
 
     ESP_LOGI(TAG, "UART%d initialised at %d baud (TX=%d, RX=%d)",
              UART_COMM_PORT, UART_COMM_BAUD_RATE,
@@ -248,7 +324,7 @@ void uart_comm_init(void)
     configASSERT(ret == pdPASS);
 
     /* Queue CMD_DISPLAY_READY so the player knows the display has (re)started
-     * and should resend the song list.  It will be delivered in the first
+     * and should announce the song list again.  It will be delivered in the first
      * CMD_ACK response (to CMD_SYNC or CMD_SET_STATE). */
     enqueue_pending_cmd(CMD_DISPLAY_READY, NULL, 0);
     ESP_LOGI(TAG, "CMD_DISPLAY_READY queued");
@@ -256,7 +332,9 @@ void uart_comm_init(void)
 
 void uart_comm_update_touch(bool active, int16_t x, int16_t y)
 {
+    int64_t now = esp_timer_get_time();
     taskENTER_CRITICAL(&s_touch_mux);
+    if (active != s_touch_active) s_touch_edge_us = now;
     s_touch_active = active;
     if (active) {
         s_touch_x = x;
@@ -269,95 +347,209 @@ void uart_comm_update_touch(bool active, int16_t x, int16_t y)
  * UART task – runs on Core 0
  * ========================================================================= */
 
-static void uart_task(void *arg)
+/* Log and restart the touch→UART latency figures */
+static void log_latency(void)
 {
-    parser_state_t state      = PARSER_STATE_MAGIC;
-    uint8_t        magic_idx  = 0;
-    uint8_t        cmd        = 0;
-    uint8_t        len        = 0;
-    uint8_t        payload[MAX_PAYLOAD_LEN];
-    uint8_t        payload_idx = 0;
-    uint8_t        checksum   = 0;
-    uint8_t        byte;
+    xSemaphoreTake(s_tx_mutex, portMAX_DELAY);
+    uint32_t n   = s_lat_n;
+    uint64_t sum = s_lat_sum_us;
+    uint32_t max = s_lat_max_us;
+    s_lat_n = 0;
+    s_lat_sum_us = 0;
+    s_lat_max_us = 0;
+    xSemaphoreGive(s_tx_mutex);
+    if (n == 0) return;
+    ESP_LOGI(TAG, "Touch->UART (%s): %lu cmds, avg %lu us, max %lu us",
+             (UART_COMM_URGENT && s_rx_ver >= 2) ? "urgent" : "poll",
+             (unsigned long)n, (unsigned long)(sum / n), (unsigned long)max);
+}
 
-    ESP_LOGI(TAG, "UART task started on core %d", xPortGetCoreID());
+/* Move to @p baud once our last frame has left.  Whatever is still buffered
+ * came at the old rate.  UART task only. */
+static void switch_baud(uint32_t baud)
+{
+    xSemaphoreTake(s_tx_mutex, portMAX_DELAY);
+    uart_wait_tx_done(UART_COMM_PORT, pdMS_TO_TICKS(20));
+    uart_set_baudrate(UART_COMM_PORT, baud);
+    xSemaphoreGive(s_tx_mutex);
+    uart_flush_input(UART_COMM_PORT);
+    xQueueReset(s_rx_events);
+    link_parser_reset(&s_parser);
+    s_baud      = baud;
+    s_baud_set  = xTaskGetTickCount();
+    s_last_good = s_baud_set;
+}
 
-    while (1) {
-        /* Block up to 100 ms waiting for a byte */
-        if (uart_read_bytes(UART_COMM_PORT, &byte, 1, pdMS_TO_TICKS(100)) != 1) {
-            continue; /* Timeout – nothing received, keep polling */
-        }
-
-        switch (state) {
-
-        /* ---- Magic header matching ------------------------------------ */
-        case PARSER_STATE_MAGIC:
-            if (byte == UART_MAGIC_BYTES[magic_idx]) {
-                magic_idx++;
-                if (magic_idx == sizeof(UART_MAGIC_BYTES)) {
-                    magic_idx = 0;
-                    state = PARSER_STATE_CMD;
-                    ESP_LOGD(TAG, "Magic header matched");
-                }
-            } else {
-                /*
-                 * Partial-match recovery: if the mismatched byte equals the
-                 * first magic byte, count it as the new start of the header.
-                 */
-                magic_idx = (byte == UART_MAGIC_BYTES[0]) ? 1 : 0;
+/* Accept the proposed rate at the current one, then take it on trial */
+static void accept_baud(uint32_t baud)
+{
+    uint8_t buf[5];
+    buf[0] = BAUD_OP_ACCEPT;
+    put_u32(&buf[1], baud);
+    send_now(CMD_LINK_BAUD, buf, sizeof(buf));
+    ESP_LOGI(TAG, "Link rate: %lu -> %lu baud (trial)", (unsigned long)s_baud, (unsigned long)baud);
+    switch_baud(baud);
+    s_baud_trial = true;
+}
+
+/* Give up a rate the player did not commit, or one nothing arrives at */
+static void baud_upkeep(void)
+{
+    TickType_t now = xTaskGetTickCount();
+    if (s_baud_trial && (now - s_baud_set) >= pdMS_TO_TICKS(UART_COMM_BAUD_TRIAL_MS)) {
+        ESP_LOGW(TAG, "Link rate %lu baud not committed – back to %lu",
+                 (unsigned long)s_baud, (unsigned long)s_baud_kept);
+        s_baud_trial = false;
+        switch_baud(s_baud_kept);
+    } else if (s_baud != UART_COMM_BAUD_RATE &&
+               (now - s_last_good) >= pdMS_TO_TICKS(UART_COMM_BAUD_LOSS_MS)) {
+        ESP_LOGW(TAG, "Nothing received for %d ms at %lu baud – back to %d",
+                 UART_COMM_BAUD_LOSS_MS, (unsigned long)s_baud, UART_COMM_BAUD_RATE);
+        s_baud_trial = false;
+        s_baud_kept  = UART_COMM_BAUD_RATE;
+        switch_baud(UART_COMM_BAUD_RATE);
+    }
+}
+
+/* Run the parser over one received chunk and answer each complete frame */
+static void rx_chunk(const uint8_t *buf, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        uint32_t bad = s_link_stats.rx_bad;
+        switch (link_parser_feed(&s_parser, buf[i], &s_link_stats)) {
+
+        case LINK_RX_V1:
+            s_rx_ver    = 1;
+            s_last_good = xTaskGetTickCount();
+            handle_packet(s_parser.cmd, s_parser.buf, s_parser.len);
+            break;
+
+        case LINK_RX_V2: {
+            s_rx_ver    = 2;
+            s_rx_seq    = s_parser.seq;
+            s_last_good = xTaskGetTickCount();
+            uint16_t       pos = 0;
+            uint8_t        cmd, len;
+            const uint8_t *payload;
+            while (link_next_sub(&s_parser, &pos, &s_link_stats, &cmd, &payload, &len)) {
+                handle_packet(cmd, payload, len);
             }
             break;
+        }
 
-        /* ---- Command byte -------------------------------------------- */
-        case PARSER_STATE_CMD:
-            cmd      = byte;
-            checksum = byte; /* Checksum accumulator starts with CMD */
-            state    = PARSER_STATE_LEN;
+        default:
+            if (s_link_stats.rx_bad != bad) {
+                ESP_LOGW(TAG, "Frame check failed – discarded (%lu so far)",
+                         (unsigned long)s_link_stats.rx_bad);
+            }
             break;
+        }
 
-        /* ---- Payload length ------------------------------------------ */
-        case PARSER_STATE_LEN:
-            len       = byte;
-            checksum ^= byte;
-            payload_idx = 0;
+        /* Send poll response – flushes any queued Display->Host commands */
+        if (s_resp_due) {
+            s_resp_due = false;
+            send_response();
+        }
+        if (s_baud_next) {
+            uint32_t baud = s_baud_next;
+            s_baud_next = 0;
+            accept_baud(baud);
+        }
+    }
+}
 
-            if (len == 0) {
-                state = PARSER_STATE_CHECKSUM;
-            } else if (len <= MAX_PAYLOAD_LEN) {
-                state = PARSER_STATE_PAYLOAD;
-            } else {
-                ESP_LOGW(TAG, "Payload length %u exceeds MAX_PAYLOAD_LEN, discarding packet", len);
-                state = PARSER_STATE_MAGIC;
+static void uart_task(void *arg)
+{
+    static uint8_t chunk[UART_COMM_RX_CHUNK];
+    uart_event_t   ev;
+    TickType_t     last_log = xTaskGetTickCount();
+
+    ESP_LOGI(TAG, "UART task started on core %d", xPortGetCoreID());
+
+    while (1) {
+        if ((xTaskGetTickCount() - last_log) >= pdMS_TO_TICKS(LINK_STATS_LOG_MS)) {
+            last_log = xTaskGetTickCount();
+            const link_stats_t *st = &s_link_stats;
+            ESP_LOGI(TAG, "Link v%u at %lu baud: rx %lu frames (bad %lu, malformed %lu, lost %lu, noise %lu B), "
+                     "%lu B/read, %lu overflows, tx %lu frames, %lu%% payload",
+                     s_rx_ver, (unsigned long)s_baud, (unsigned long)st->rx_frames, (unsigned long)st->rx_bad,
+                     (unsigned long)st->rx_malformed, (unsigned long)st->rx_lost,
+                     (unsigned long)st->rx_noise, (unsigned long)link_rx_bytes_per_read(st),
+                     (unsigned long)st->rx_overflow, (unsigned long)st->tx_frames,
+                     (unsigned long)link_tx_efficiency_pct(st));
+            log_latency();
+        }
+        baud_upkeep();
+
+        /* Sleep until the driver reports data (FIFO threshold or idle line) */
+        if (xQueueReceive(s_rx_events, &ev, pdMS_TO_TICKS(100)) != pdTRUE) {
+            continue; /* Timeout – nothing received */
+        }
+
+        switch (ev.type) {
+
+        case UART_DATA: {
+            /* Take everything buffered; events for bytes already read find
+             * nothing left and cost one queue receive */
+            size_t avail = 0;
+            uart_get_buffered_data_len(UART_COMM_PORT, &avail);
+            while (avail > 0) {
+                int n = uart_read_bytes(UART_COMM_PORT, chunk,
+                                        avail < sizeof(chunk) ? avail : sizeof(chunk), 0);
+                if (n <= 0) break;
+                s_link_stats.rx_reads++;
+                rx_chunk(chunk, (size_t)n);
+                avail -= (size_t)n;
             }
             break;
+        }
 
-        /* ---- Payload bytes ------------------------------------------- */
-        case PARSER_STATE_PAYLOAD:
-            payload[payload_idx++] = byte;
-            checksum ^= byte;
-            if (payload_idx >= len) {
-                state = PARSER_STATE_CHECKSUM;
-            }
+        case UART_FIFO_OVF:
+        case UART_BUFFER_FULL:
+            /* Bytes were dropped, so the buffered rest is mid-frame */
+            s_link_stats.rx_overflow++;
+            ESP_LOGW(TAG, "RX overflow – input flushed (%lu so far)",
+                     (unsigned long)s_link_stats.rx_overflow);
+            uart_flush_input(UART_COMM_PORT);
+            xQueueReset(s_rx_events);
+            link_parser_reset(&s_parser);
             break;
 
-        /* ---- Checksum verification ------------------------------------ */
-        case PARSER_STATE_CHECKSUM:
-            if (byte == checksum) {
-                handle_packet(cmd, payload, len);
-            } else {
-                ESP_LOGW(TAG, "Checksum mismatch: expected 0x%02X, got 0x%02X – packet discarded",
-                         checksum, byte);
-            }
-            state = PARSER_STATE_MAGIC; /* Always reset for next packet */
+        case UART_FRAME_ERR:
+        case UART_PARITY_ERR:
+            s_link_stats.rx_bad++;
             break;
 
         default:
-            state = PARSER_STATE_MAGIC;
             break;
         }
     }
 }
 
+/* =========================================================================
+ * Player state → views
+ * ========================================================================= */
+
+static void publish_flags(uint8_t flags)
+{
+    ui_player_update_speed_locked_async(!!(flags & STATE_FLAG_SPEED_LOCKED));
+    ui_songlist_update_bt_enabled_async(!!(flags & STATE_FLAG_BT_ON));
+    ui_songlist_update_wifi_enabled_async(!!(flags & STATE_FLAG_WIFI_ON));
+}
+
+/* Trigger view transitions on play/stop edges, or when the song changes */
+static void publish_play_state(uint8_t is_playing, uint16_t song_id, const char *song_name)
+{
+    bool song_changed = (song_id != 0 && song_id != s_prev_song_id);
+    if (is_playing && (!s_was_playing || song_changed)) {
+        ui_player_show_async(song_name, song_id);
+    } else if (!is_playing && s_was_playing) {
+        ui_player_hide_async();
+    }
+    s_was_playing  = is_playing;
+    s_prev_song_id = song_id;
+}
+
 /* =========================================================================
  * Packet dispatcher
  * ========================================================================= */
@@ -432,90 +624,239 @@ static void handle_packet(uint8_t cmd, const uint8_t *payload, uint8_t len)
         memcpy(g_player_state.song_name, song_name_snap, MAX_SONG_NAME_LEN);
         xSemaphoreGive(s_state_mutex);
 
-        ui_player_update_speed_locked_async(!!(flags_byte & 0x01u));
-        ui_songlist_update_bt_enabled_async(!!(flags_byte & 0x02u));
-        ui_songlist_update_wifi_enabled_async(!!(flags_byte & 0x04u));
+        publish_flags(flags_byte);
 
         ESP_LOGD(TAG, "State: song='%s'  vol=%u  tempo=%u  playing=%u  pos=%u%%  dur=%us",
                  song_name_snap, g_player_state.volume, g_player_state.tempo,
                  new_is_playing, position_pct, duration_s);
 
-        /* Trigger view transitions on play/stop edges, or when the song changes */
-        bool song_changed = (song_id != 0 && song_id != s_prev_song_id);
-        if (new_is_playing && (!s_was_playing || song_changed)) {
-            ui_player_show_async(song_name_snap, song_id);
-        } else if (!new_is_playing && s_was_playing) {
-            ui_player_hide_async();
-        }
-        s_was_playing  = new_is_playing;
-        s_prev_song_id = song_id;
+        publish_play_state(new_is_playing, song_id, song_name_snap);
 
         /* Forward live progress to the UI every tick while playing */
         if (new_is_playing) {
             ui_player_update_progress_async(position_pct, duration_s);
         }
 
-        /* Send poll response – flushes any queued Display->Host commands */
-        send_response();
+        s_resp_due = true;   /* poll response once the frame is handled */
+        break;
+    }
+
+    /* ------------------------------------------------------------------ */
+    case CMD_STATE_DELTA: {
+        /* Payload: [mask:u16] then the fields of the set bits (uart_comm.h) */
+        uint16_t mask = (len >= 2) ? (uint16_t)(payload[0] | (payload[1] << 8)) : 0;
+        uint8_t  need = 2;
+        if (mask & STATE_FIELD_PLAYING)  need += 1;
+        if (mask & STATE_FIELD_VOLUME)   need += 1;
+        if (mask & STATE_FIELD_TEMPO)    need += 1;
+        if (mask & STATE_FIELD_FLAGS)    need += 1;
+        if (mask & STATE_FIELD_DURATION) need += 4;
+        if (mask & STATE_FIELD_POSITION) need += 10;
+        if (mask & STATE_FIELD_SONG)     need += 2;
+        if (len < need) {
+            ESP_LOGW(TAG, "CMD_STATE_DELTA: %u bytes, mask 0x%04X needs %u", len, mask, need);
+            break;
+        }
+
+        int64_t now_us = esp_timer_get_time();
+        uint8_t p      = 2;
+        music_player_state_t snap;
+
+        xSemaphoreTake(s_state_mutex, portMAX_DELAY);
+        music_player_state_t *st = &g_player_state;
+        if (mask & STATE_FIELD_PLAYING) st->is_playing = payload[p++];
+        if (mask & STATE_FIELD_VOLUME)  st->volume     = payload[p++];
+        if (mask & STATE_FIELD_TEMPO)   st->tempo      = payload[p++];
+        if (mask & STATE_FIELD_FLAGS)   st->flags      = payload[p++];
+        if (mask & STATE_FIELD_DURATION) {
+            st->duration_ms = get_u32(&payload[p]);
+            p += 4;
+        }
+        if (mask & STATE_FIELD_POSITION) {
+            uint32_t stamp  = get_u32(&payload[p]);
+            st->position_ms = get_u32(&payload[p + 4]);
+            st->rate_x1000  = (uint16_t)(payload[p + 8] | (payload[p + 9] << 8));
+            p += 10;
+            /* Place the sample on our clock: a frame that arrived quicker
+             * than any before shows a lower offset. */
+            uint32_t off = (uint32_t)(now_us / 1000) - stamp;
+            if ((mask & STATE_FIELD_FULL) || !s_clock_valid ||
+                (int32_t)(off - s_clock_off_ms) < 0) {
+                s_clock_off_ms = off;
+                s_clock_valid  = true;
+            }
+            st->position_us = now_us - (int64_t)(int32_t)(off - s_clock_off_ms) * 1000;
+        }
+        if (mask & STATE_FIELD_SONG) {
+            st->song_id = (uint16_t)(payload[p] | (payload[p + 1] << 8));
+            p += 2;
+            uint8_t name_len = (uint8_t)(len - p);
+            if (name_len >= MAX_SONG_NAME_LEN) name_len = MAX_SONG_NAME_LEN - 1;
+            memcpy(st->song_name, &payload[p], name_len);
+            st->song_name[name_len] = '\0';
+        }
+        /* Keep the CMD_SET_STATE view of the state current as well */
+        st->position_pct = st->duration_ms
+            ? (uint8_t)((uint64_t)st->position_ms * 100u / st->duration_ms) : 0;
+        st->duration_s   = st->rate_x1000 ? (uint16_t)(st->duration_ms / st->rate_x1000) : 0;
+        snap = *st;
+        xSemaphoreGive(s_state_mutex);
+
+        if (mask & STATE_FIELD_FLAGS) publish_flags(snap.flags);
+        if (mask & (STATE_FIELD_PLAYING | STATE_FIELD_SONG)) {
+            publish_play_state(snap.is_playing, snap.song_id, snap.song_name);
+        }
+        if (snap.is_playing && (mask & (STATE_FIELD_PLAYING | STATE_FIELD_FLAGS |
+                                        STATE_FIELD_DURATION | STATE_FIELD_POSITION |
+                                        STATE_FIELD_SONG))) {
+            ui_player_update_position_async(snap.position_ms, snap.duration_ms, snap.rate_x1000,
+                                            !(snap.flags & STATE_FLAG_PAUSED), snap.position_us);
+        }
+        ESP_LOGD(TAG, "State delta 0x%04X: playing=%u pos=%lu/%lu ms rate=%u",
+                 mask, snap.is_playing, (unsigned long)snap.position_ms,
+                 (unsigned long)snap.duration_ms, snap.rate_x1000);
+
+        s_resp_due = true;   /* poll response once the frame is handled */
         break;
     }
 
     /* ------------------------------------------------------------------ */
     case CMD_SYNC:
         ESP_LOGD(TAG, "CMD_SYNC received – sending response");
-        send_response();
+        s_resp_due = true;
+        break;
+
+    /* ------------------------------------------------------------------ */
+    case CMD_LINK_HELLO: {
+        /* Payload: [version:u8] – the player's highest framing; answer ours */
+        uint8_t ver = LINK_VERSION;
+        ESP_LOGI(TAG, "CMD_LINK_HELLO: player speaks v%u", len ? payload[0] : 1u);
+        enqueue_pending_cmd(CMD_LINK_HELLO, &ver, 1);
+        break;
+    }
+
+    /* ------------------------------------------------------------------ */
+    case CMD_LINK_BAUD: {
+        /* Payload: [op:u8][baud:u32]; PROPOSE is accepted after the frame */
+        if (len < 5) {
+            ESP_LOGW(TAG, "CMD_LINK_BAUD: payload too short (%u)", len);
+            break;
+        }
+        uint32_t baud = get_u32(&payload[1]);
+        if (payload[0] == BAUD_OP_PROPOSE) {
+            if (s_rx_ver >= 2 && baud >= UART_COMM_BAUD_RATE && baud <= UART_COMM_BAUD_MAX) {
+                s_baud_next = baud;
+            } else {
+                ESP_LOGW(TAG, "CMD_LINK_BAUD: %lu baud refused", (unsigned long)baud);
+            }
+        } else if (payload[0] == BAUD_OP_COMMIT && s_baud_trial && baud == s_baud) {
+            s_baud_trial = false;
+            s_baud_kept  = baud;
+            ESP_LOGI(TAG, "Link rate %lu baud committed", (unsigned long)baud);
+        }
+        break;
+    }
+
+    /* ------------------------------------------------------------------ */
+    case CMD_LINK_TEST:
+        /* Rate test: back to the player byte for byte */
+        send_now(CMD_LINK_TEST, payload, len);
+        break;
+
+    /* ------------------------------------------------------------------ */
+    case CMD_LIST_INFO: {
+        /* Payload: [version:u32][count:u16] */
+        if (len < 6) {
+            ESP_LOGW(TAG, "CMD_LIST_INFO: payload too short (%u)", len);
+            break;
+        }
+        uint32_t version = get_u32(payload);
+        uint16_t count   = (uint16_t)payload[4] | ((uint16_t)payload[5] << 8);
+        ESP_LOGD(TAG, "CMD_LIST_INFO: version=%lu count=%u", (unsigned long)version, count);
+        ui_songlist_list_info_async(version, count);
         break;
+    }
 
     /* ------------------------------------------------------------------ */
-    case CMD_SONG_LIST: {
+    case CMD_LIST_PAGE: {
         /*
-         * Payload: packed null-terminated song entries.
-         * Each entry: [id_lo:u8][id_hi:u8][name:char...]['\0']
-         * Terminator: song_id == 0 followed by '\0' name byte.
-         *
-         * The host may split the list across several CMD_SONG_LIST packets.
-         * Accumulate chunks until the terminator is found, then hand the
-         * merged buffer to the UI layer in one call.
+         * Payload: [version:u32][total:u16][start:u16][flags:u8]
+         * then packed entries [id_lo:u8][id_hi:u8][name:char...]['\0'].
+         * flags bit0 marks the last packet of the reply.
          */
-        ESP_LOGI(TAG, "CMD_SONG_LIST chunk received (%u bytes, accumulated=%u)",
-                 len, s_songlist_len);
-
-        /* Guard against buffer overflow – discard and restart on overflow */
-        if ((uint32_t)s_songlist_len + len > SONGLIST_BUF_SIZE) {
-            ESP_LOGW(TAG, "CMD_SONG_LIST: accumulation buffer overflow – discarding");
-            s_songlist_len = 0;
+        if (len < 9) {
+            ESP_LOGW(TAG, "CMD_LIST_PAGE: payload too short (%u)", len);
+            break;
         }
-        if (len > 0) {
-            memcpy(s_songlist_buf + s_songlist_len, payload, len);
-            s_songlist_len += len;
+        uint32_t version = get_u32(payload);
+        uint16_t total   = (uint16_t)payload[4] | ((uint16_t)payload[5] << 8);
+        uint16_t start   = (uint16_t)payload[6] | ((uint16_t)payload[7] << 8);
+        bool     last    = (payload[8] & 0x01) != 0;
+
+        bool continues = s_page_batch && version == s_page_version &&
+                         start == (uint16_t)(s_page_start + s_page_batch->names.count);
+        if (!continues) {
+            ui_songlist_batch_free(s_page_batch);
+            s_page_batch   = ui_songlist_batch_new();
+            s_page_start   = start;
+            s_page_version = version;
+            if (!s_page_batch) {
+                ESP_LOGE(TAG, "CMD_LIST_PAGE: out of memory");
+                break;
+            }
         }
 
-        /* Scan accumulated data for the end-of-list terminator:
-         * entry with song_id == 0 immediately followed by a '\0' name byte. */
-        bool found_terminator = false;
-        const uint8_t *scan     = s_songlist_buf;
-        const uint8_t *scan_end = s_songlist_buf + s_songlist_len;
+        const uint8_t *scan     = payload + 9;
+        const uint8_t *scan_end = payload + len;
         while (scan + 2 <= scan_end) {
             uint16_t sid = (uint16_t)scan[0] | ((uint16_t)scan[1] << 8);
             scan += 2;
-            /* Accept terminator whether it carries an empty name byte or not */
-            if (sid == 0 && (scan >= scan_end || *scan == '\0')) {
-                found_terminator = true;
+            const uint8_t *name = scan;
+            while (scan < scan_end && *scan != '\0') scan++;
+            if (scan >= scan_end) {
+                ESP_LOGW(TAG, "CMD_LIST_PAGE: entry split across packets – dropped");
                 break;
             }
-            /* Skip past the null-terminated song name */
-            while (scan < scan_end && *scan != '\0') scan++;
-            if (scan < scan_end) scan++; /* consume '\0' */
+            if (!ui_songlist_batch_add(s_page_batch, sid, (const char *)name,
+                                       (size_t)(scan - name))) {
+                ESP_LOGW(TAG, "CMD_LIST_PAGE: out of memory – page truncated");
+            }
+            scan++; /* consume '\0' */
         }
 
-        if (found_terminator) {
-            ESP_LOGI(TAG, "CMD_SONG_LIST complete: %u bytes total", s_songlist_len);
-            ui_songlist_update_async(s_songlist_buf, s_songlist_len);
-            s_songlist_len = 0; /* reset for next list transfer */
+        if (last) {
+            ESP_LOGD(TAG, "CMD_LIST_PAGE complete: v%lu %u..%u of %u",
+                     (unsigned long)version, s_page_start,
+                     s_page_start + s_page_batch->names.count, total);
+            ui_songlist_page_async(s_page_batch, version, total, s_page_start);  /* UI owns it now */
+            s_page_batch = NULL;
         }
         break;
     }
 
+    /* ------------------------------------------------------------------ */
+    case CMD_LIST_DELTA: {
+        /* Payload: [version:u32][op:u8][id:u16][name\0] + [old_name\0] for RENAME */
+        if (len < 8) {
+            ESP_LOGW(TAG, "CMD_LIST_DELTA: payload too short (%u)", len);
+            break;
+        }
+        uint32_t    version  = get_u32(payload);
+        uint8_t     op       = payload[4];
+        uint16_t    sid      = (uint16_t)payload[5] | ((uint16_t)payload[6] << 8);
+        const char *name     = (const char *)payload + 7;
+        size_t      name_len = strnlen(name, (size_t)(len - 7));
+        const char *old_name = "";
+        size_t      old_len  = 0;
+        if (7u + name_len < len) {
+            old_name = name + name_len + 1;
+            old_len  = strnlen(old_name, (size_t)(len - 8 - name_len));
+        }
+        ESP_LOGD(TAG, "CMD_LIST_DELTA: v%lu op=%u id=%u", (unsigned long)version, op, sid);
+        ui_songlist_delta_async(version, op, sid, name, name_len, old_name, old_len);
+        break;
+    }
+
     /* ------------------------------------------------------------------ */
     case CMD_ENCODER_MOVE:
         /*
@@ -606,18 +947,54 @@ static void handle_packet(uint8_t cmd, const uint8_t *payload, uint8_t len)
  * Pending command queue helper
  * ========================================================================= */
 
+/* Commands the user waits on; sent without waiting for a poll */
+static bool is_urgent(uint8_t cmd_id)
+{
+    switch (cmd_id) {
+    case CMD_PLAY_SONG:
+    case CMD_STOP_SONG:
+    case CMD_PAUSE:
+    case CMD_RESUME:
+    case CMD_SEEK:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/* Account one sent command; caller holds s_tx_mutex */
+static void note_sent(const pending_cmd_t *c, int64_t now)
+{
+    if (!is_urgent(c->cmd_id)) return;
+    uint32_t us = (uint32_t)(now - c->t_us);
+    s_lat_n++;
+    s_lat_sum_us += us;
+    if (us > s_lat_max_us) s_lat_max_us = us;
+}
+
 /**
  * Atomically push one command onto the pending queue.
- * Safe to call from any task or interrupt context.
+ * Safe to call from any task; urgent commands may send from the calling
+ * task, so they must not be queued from an interrupt.
  * If the queue is full the command is silently dropped.
  */
 static void enqueue_pending_cmd(uint8_t cmd_id, const uint8_t *params, uint8_t param_len)
 {
     if (param_len > PENDING_CMD_MAX_PARAMS) param_len = PENDING_CMD_MAX_PARAMS;
+
+    /* A command caused by a touch counts from the touch edge */
+    int64_t now = esp_timer_get_time();
+    int64_t edge;
+    taskENTER_CRITICAL(&s_touch_mux);
+    edge = s_touch_edge_us;
+    taskEXIT_CRITICAL(&s_touch_mux);
+    if (edge == 0 || now - edge > UART_COMM_TOUCH_WINDOW_MS * 1000LL) edge = now;
+
     bool dropped = false;
     taskENTER_CRITICAL(&s_queue_mux);
     if (s_pending_count < PENDING_QUEUE_SLOTS) {
         pending_cmd_t *slot = &s_pending_queue[s_pending_count++];
+        slot->t_us      = edge;
         slot->cmd_id    = cmd_id;
         slot->param_len = param_len;
         if (param_len > 0 && params != NULL) {
@@ -629,6 +1006,8 @@ static void enqueue_pending_cmd(uint8_t cmd_id, const uint8_t *params, uint8_t p
     taskEXIT_CRITICAL(&s_queue_mux);
     if (dropped) {
         ESP_LOGW(TAG, "Pending queue full – cmd 0x%02X dropped", cmd_id);
+    } else if (UART_COMM_URGENT && s_rx_ver >= 2 && is_urgent(cmd_id)) {
+        send_urgent();
     }
 }
 
@@ -636,12 +1015,25 @@ static void enqueue_pending_cmd(uint8_t cmd_id, const uint8_t *params, uint8_t p
  * Response sender (CMD_ACK with queued sub-commands)
  * ========================================================================= */
 
+/* Finish and write a v2 frame; caller holds s_tx_mutex */
+static void write_frame_locked(link_frame_t *frame)
+{
+    uint16_t n = link_frame_finish(frame, s_tx_seq++, s_rx_seq);
+    uart_write_bytes(UART_COMM_PORT, frame->buf, n);
+    s_link_stats.tx_frames++;
+    s_link_stats.tx_bytes   += n;
+    s_link_stats.tx_payload += frame->payload;
+}
+
 /**
  * Build and transmit a CMD_ACK (0xFF) packet carrying the current touch state
- * and any queued Display->Host commands.  Called from handle_packet() on
- * CMD_SET_STATE and CMD_SYNC receipt; never called from any other context.
+ * and any queued Display->Host commands.  Called from the UART task after a
+ * frame with CMD_SET_STATE or CMD_SYNC; never called from any other context.
  *
- * Extended payload layout:
+ * v2: one frame with ACK = the SEQ it answers, holding CMD_ACK with the five
+ * touch bytes and then every queued command as a sub-message of its own.
+ *
+ * v1 extended payload layout:
  *   [0]     touch_active : uint8_t
  *   [1..2]  touch_x      : int16_t  LE
  *   [3..4]  touch_y      : int16_t  LE
@@ -662,6 +1054,8 @@ static void send_response(void)
     touch_y      = s_touch_y;
     taskEXIT_CRITICAL(&s_touch_mux);
 
+    xSemaphoreTake(s_tx_mutex, portMAX_DELAY);
+
     /* Atomically drain the pending command queue */
     uint8_t       count;
     pending_cmd_t cmds[PENDING_QUEUE_SLOTS];
@@ -671,7 +1065,6 @@ static void send_response(void)
     s_pending_count = 0;
     taskEXIT_CRITICAL(&s_queue_mux);
 
-    /* Build payload */
     uint8_t payload[MAX_PAYLOAD_LEN];
     uint8_t pos = 0;
 
@@ -681,41 +1074,95 @@ static void send_response(void)
     payload[pos++] = (uint8_t)( touch_y       & 0xFF);
     payload[pos++] = (uint8_t)((touch_y >> 8) & 0xFF);
 
-    uint8_t count_idx = pos;   /* will be patched if truncation occurs */
-    payload[pos++]    = count;
-
     uint8_t sent = 0;
-    for (uint8_t i = 0; i < count; i++) {
-        uint8_t needed = 2u + cmds[i].param_len;
-        if (pos + needed > MAX_PAYLOAD_LEN) {
-            ESP_LOGW(TAG, "Response payload full – %u/%u sub-commands sent", sent, count);
-            payload[count_idx] = sent;
-            break;
+    int64_t now  = esp_timer_get_time();
+    if (s_rx_ver >= 2) {
+        static link_frame_t frame;
+        link_frame_begin(&frame);
+        link_frame_add(&frame, CMD_ACK, payload, pos);
+        for (uint8_t i = 0; i < count; i++) {
+            if (!link_frame_add(&frame, cmds[i].cmd_id, cmds[i].params, cmds[i].param_len)) {
+                ESP_LOGW(TAG, "Response frame full – %u/%u sub-commands sent", sent, count);
+                break;
+            }
+            note_sent(&cmds[i], now);
+            sent++;
         }
-        payload[pos++] = cmds[i].cmd_id;
-        payload[pos++] = cmds[i].param_len;
-        if (cmds[i].param_len > 0) {
-            memcpy(&payload[pos], cmds[i].params, cmds[i].param_len);
-            pos += cmds[i].param_len;
+        write_frame_locked(&frame);
+    } else {
+        uint8_t count_idx = pos;   /* will be patched if truncation occurs */
+        payload[pos++]    = count;
+
+        for (uint8_t i = 0; i < count; i++) {
+            uint8_t needed = 2u + cmds[i].param_len;
+            if (pos + needed > MAX_PAYLOAD_LEN) {
+                ESP_LOGW(TAG, "Response payload full – %u/%u sub-commands sent", sent, count);
+                break;
+            }
+            payload[pos++] = cmds[i].cmd_id;
+            payload[pos++] = cmds[i].param_len;
+            if (cmds[i].param_len > 0) {
+                memcpy(&payload[pos], cmds[i].params, cmds[i].param_len);
+                pos += cmds[i].param_len;
+            }
+            note_sent(&cmds[i], now);
+            sent++;
         }
-        sent++;
+        payload[count_idx] = sent;
+
+        uint8_t  pkt[LINK_V1_MAGIC_LEN + 3 + MAX_PAYLOAD_LEN];
+        uint16_t n = link_v1_encode(pkt, CMD_ACK, payload, pos);
+        uart_write_bytes(UART_COMM_PORT, pkt, n);
+        s_link_stats.tx_frames++;
+        s_link_stats.tx_bytes   += n;
+        s_link_stats.tx_payload += pos;
     }
-    payload[count_idx] = sent;
+    xSemaphoreGive(s_tx_mutex);
 
-    /* Compute checksum: CMD ^ LEN ^ payload[0..pos-1] */
-    uint8_t checksum = CMD_ACK ^ pos;
-    for (uint8_t i = 0; i < pos; i++) checksum ^= payload[i];
+    ESP_LOGD(TAG, "Response sent: touch=%d x=%d y=%d cmds=%u",
+             touch_active, touch_x, touch_y, sent);
+}
 
-    /* Assemble and transmit */
-    uint8_t pkt[8 + 2 + MAX_PAYLOAD_LEN + 1];
-    memcpy(&pkt[0], UART_MAGIC_BYTES, 8);
-    pkt[8] = CMD_ACK;
-    pkt[9] = pos;
-    memcpy(&pkt[10], payload, pos);
-    pkt[10 + pos] = checksum;
+/**
+ * Send every queued command now, in a v2 frame without CMD_ACK, from the
+ * task that queued an urgent one (normally LVGL).  ACK repeats the last SEQ
+ * received; the player ignores it, as replies are recognised by CMD_ACK.
+ */
+static void send_urgent(void)
+{
+    xSemaphoreTake(s_tx_mutex, portMAX_DELAY);
+
+    uint8_t       count;
+    pending_cmd_t cmds[PENDING_QUEUE_SLOTS];
+    taskENTER_CRITICAL(&s_queue_mux);
+    count           = s_pending_count;
+    memcpy(cmds, s_pending_queue, count * sizeof(pending_cmd_t));
+    s_pending_count = 0;
+    taskEXIT_CRITICAL(&s_queue_mux);
 
-    uart_write_bytes(UART_COMM_PORT, pkt, (size_t)(11u + pos));
+    if (count > 0) {   /* else a response took them first */
+        static link_frame_t frame;
+        int64_t now = esp_timer_get_time();
+        link_frame_begin(&frame);
+        for (uint8_t i = 0; i < count; i++) {
+            link_frame_add(&frame, cmds[i].cmd_id, cmds[i].params, cmds[i].param_len);
+            note_sent(&cmds[i], now);
+        }
+        write_frame_locked(&frame);
+    }
+    xSemaphoreGive(s_tx_mutex);
+}
 
-    ESP_LOGD(TAG, "Response sent: touch=%d x=%d y=%d cmds=%u",
-             touch_active, touch_x, touch_y, sent);
+/**
+ * Send one link-control command at once in a v2 frame of its own (rate
+ * handshake and test echoes), outside the queue and its parameter limit.
+ */
+static void send_now(uint8_t cmd, const uint8_t *payload, uint8_t len)
+{
+    static link_frame_t frame;
+    xSemaphoreTake(s_tx_mutex, portMAX_DELAY);
+    link_frame_begin(&frame);
+    link_frame_add(&frame, cmd, payload, len);
+    write_frame_locked(&frame);
+    xSemaphoreGive(s_tx_mutex);
 }
@@ -2,17 +2,44 @@
  * @file uart_comm.h
  * @brief UART communication layer for the music-player display firmware.
  *
- * Packet format (all fields little-endian where multi-byte):
- *   [MAGIC: 8 bytes "ROGEL202"][CMD: 1 byte][LEN: 1 byte][PAYLOAD: LEN bytes][CHECKSUM: 1 byte]
+ * Framing (all fields little-endian where multi-byte) is shared with the
+ * player firmware, see firmware/common/link_codec.h:
+ *   v1  [MAGIC "ROGEL202"][CMD][LEN][PAYLOAD][XOR checksum] – one command
+ *   v2  [A5 5A][LEN][SEQ][ACK]{[CMD][LEN][PAYLOAD]}…[CRC16] – several commands
  *
- * Checksum = XOR of CMD ^ LEN ^ payload[0] ^ ... ^ payload[LEN-1]
+ * Both are accepted at any time.  The player switches to v2 after this
+ * display answers its CMD_LINK_HELLO; every response goes out in the
+ * framing of the frame it answers, with ACK = that frame's SEQ.
+ *
+ * Player state
+ * ------------
+ * This display answers CMD_LINK_HELLO with link version 4, so the player
+ * sends CMD_STATE_DELTA holding only the changed fields (all of them now
+ * and then, STATE_FIELD_FULL) instead of the full CMD_SET_STATE.  The
+ * position comes as (player stamp, song ms, rate) and the player view
+ * extrapolates it every frame; both commands ask for a CMD_ACK.
+ *
+ * Link rate
+ * ---------
+ * Both ends start at UART_COMM_BAUD_RATE.  A link v4 player proposes faster
+ * rates with CMD_LINK_BAUD; this display answers ACCEPT at the current rate,
+ * then switches, and echoes the player's CMD_LINK_TEST frames.  Without a
+ * COMMIT within UART_COMM_BAUD_TRIAL_MS it returns to the last committed
+ * rate; when it hears no good frame for UART_COMM_BAUD_LOSS_MS away from
+ * UART_COMM_BAUD_RATE it returns there, where the player looks for it too.
  *
  * Poll-response protocol (Display → Host direction)
  * -------------------------------------------------
- * The display NEVER sends unsolicited packets to the player.  Instead, all
  * Display→Host commands are queued internally and flushed in a CMD_ACK
  * response each time CMD_SET_STATE or CMD_SYNC is received from the player.
  *
+ * Urgent commands (play, stop, pause, resume, seek) do not wait for that
+ * poll on a v2 link: they leave at once in a frame of their own, without
+ * CMD_ACK (UART_COMM_URGENT).  The two directions have separate wires and
+ * each frame is written whole, so such a frame cannot collide with a
+ * player frame; the player takes a reply only from CMD_ACK.  On a v1 link
+ * everything waits for the poll, as older player firmware expects.
+ *
  * Extended CMD_ACK payload layout:
  *   [0]     touch_active : uint8_t
  *   [1..2]  touch_x      : int16_t  LE
@@ -22,11 +49,21 @@
  *     [n]   cmd_id       : uint8_t
  *     [n+1] param_len    : uint8_t
  *     [n+2..n+1+param_len] params
+ *
+ * Song list
+ * ---------
+ * The display keeps only the window of the name-ordered list it shows.
+ * CMD_LIST_INFO announces the list version and length; when the version
+ * differs from the window's, the display asks for its window with
+ * CMD_LIST_PAGE_REQ and receives it as CMD_LIST_PAGE packets.  Every later
+ * change arrives as one CMD_LIST_DELTA carrying the version it produces; a
+ * gap in the versions makes the display ask for its window again.
  */
 #pragma once
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "link_codec.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -38,27 +75,29 @@ extern "C" {
 #define UART_COMM_RX_PIN        GPIO_NUM_44
 #define UART_COMM_BAUD_RATE     921600
 #define UART_COMM_RX_BUF_SIZE   (2048)
+#define UART_COMM_EVENT_QUEUE   16      /* driver events (UART_DATA, overflow) */
+#define UART_COMM_RX_FULL       64      /* RX FIFO bytes that wake the task    */
+#define UART_COMM_RX_IDLE       3       /* idle byte times that wake it early  */
+#define UART_COMM_RX_CHUNK      256     /* bytes parsed per read               */
+#define UART_COMM_BAUD_MAX      5000000 /* highest rate CMD_LINK_BAUD may set  */
+#define UART_COMM_BAUD_TRIAL_MS 1000    /* no COMMIT this long: previous rate  */
+#define UART_COMM_BAUD_LOSS_MS  1500    /* silence this long: UART_COMM_BAUD_RATE */
 
-/* ---------- Protocol constants ---------- */
+/* ---------- Display → Host latency ---------- */
+#define UART_COMM_URGENT        1       /* urgent commands skip the poll; 0 = A/B */
+#define UART_COMM_TOUCH_WINDOW_MS 250   /* touch edge this recent starts a latency */
 
-/* 64-bit magic header "ROGEL202" (0x524F47454C323032), transmitted MSB-first */
-static const uint8_t UART_MAGIC_BYTES[8] = {
-    0x52, 0x4F, 0x47, 0x45, 0x4C, 0x32, 0x30, 0x32
-};
+/* ---------- Protocol constants ---------- */
 
-#define MAX_PAYLOAD_LEN         128
+#define MAX_PAYLOAD_LEN         LINK_MAX_PAYLOAD
 /* UTF-8 expansion: each Latin-1 byte can become 2 UTF-8 bytes, so keep
  * double the raw name length as headroom. */
 #define MAX_SONG_NAME_LEN       128
 
-/* Accumulation buffer for multi-packet CMD_SONG_LIST merging.
- * Sized for SONGLIST_MAX_SONGS (64) × max entry = 64 × (2+64+1) + 3 terminator. */
-#define SONGLIST_BUF_SIZE       4352
-
 /* Command IDs */
 #define CMD_SET_STATE   0x01    /* Host → Display: update player state          */
 #define CMD_SYNC        0x02    /* Host → Display: request sync / ACK           */
-#define CMD_SONG_LIST   0x03    /* Host → Display: batch song-list update       */
+/*      0x03 was CMD_SONG_LIST (whole list push), replaced by CMD_LIST_*    */
 #define CMD_ENCODER_MOVE 0x04   /* Host → Display: encoder rotation delta       */
 #define CMD_ENCODER_BTN 0x05    /* Host → Display: encoder button pressed       */
 #define CMD_PLAY_SONG   0x06    /* Display → Host: user selected a song         */
@@ -75,8 +114,42 @@ static const uint8_t UART_MAGIC_BYTES[8] = {
 #define CMD_SONG_SETTINGS       0x11  /* Host -> Display: current settings for a song       */
 #define CMD_SET_SONG_SETTINGS   0x12  /* Display -> Host: write new settings for a song     */
 #define CMD_BT_CTRL             0x13  /* Display -> Host: enable (1) / disable (0) BLE module */
+#define CMD_LIST_INFO           0x14  /* Host -> Display: song list version + length        */
+#define CMD_LIST_PAGE_REQ       0x15  /* Display -> Host: names for a window of the list    */
+#define CMD_LIST_PAGE           0x16  /* Host -> Display: part of that window               */
+#define CMD_LIST_DELTA          0x17  /* Host -> Display: one song added/removed/renamed    */
+#define CMD_LINK_HELLO          0x18  /* Both: highest link version spoken (1 byte)         */
+#define CMD_STATE_DELTA         0x19  /* Host -> Display: changed state fields (link v3)    */
+#define CMD_LINK_BAUD           0x1A  /* Both: link rate handshake (link v4)                */
+#define CMD_LINK_TEST           0x1B  /* Both: rate test pattern, echoed as received        */
 #define CMD_ACK                 0xFF  /* Display -> Host: sync acknowledgement              */
 
+/* CMD_LINK_BAUD: [op:u8][baud:u32] */
+#define BAUD_OP_PROPOSE         1     /* Host -> Display: switch to baud          */
+#define BAUD_OP_ACCEPT          2     /* Display -> Host: switching after this    */
+#define BAUD_OP_COMMIT          3     /* Host -> Display: test passed, keep it    */
+
+/* CMD_LIST_DELTA op */
+#define LIST_OP_ADD             1     /* id is new (always the highest id)        */
+#define LIST_OP_REMOVE          2     /* id removed; higher ids move down by one  */
+#define LIST_OP_RENAME          3     /* id renamed; payload also has the old name */
+
+/* CMD_STATE_DELTA: [mask:u16] then the fields of the set bits, in bit order */
+#define STATE_FIELD_PLAYING     0x0001u  /* u8  is_playing                        */
+#define STATE_FIELD_VOLUME      0x0002u  /* u8  volume                            */
+#define STATE_FIELD_TEMPO       0x0004u  /* u8  tempo                             */
+#define STATE_FIELD_FLAGS       0x0008u  /* u8  STATE_FLAG_*                      */
+#define STATE_FIELD_DURATION    0x0010u  /* u32 song length [ms] at 1.0x          */
+#define STATE_FIELD_POSITION    0x0020u  /* u32 player stamp [ms], u32 song ms, u16 rate x1000 */
+#define STATE_FIELD_SONG        0x0040u  /* u16 song id, name to the end          */
+#define STATE_FIELD_FULL        0x8000u  /* every field is present                */
+
+/* Player state flags (CMD_SET_STATE [6] and STATE_FIELD_FLAGS) */
+#define STATE_FLAG_SPEED_LOCKED 0x01u
+#define STATE_FLAG_BT_ON        0x02u
+#define STATE_FLAG_WIFI_ON      0x04u
+#define STATE_FLAG_PAUSED       0x08u    /* position is not advancing */
+
 /* ---------- Global system state ---------- */
 typedef struct {
     uint16_t song_id;                        /* 1-based; 0 = no song    */
@@ -86,7 +159,11 @@ typedef struct {
     uint8_t  tempo;                         /* 0–100 (50 = 1.0× speed) */
     uint8_t  position_pct;                  /* playback progress 0–100 % */
     uint16_t duration_s;                    /* speed-adjusted total length in seconds */
-    uint8_t  flags;                         /* bit 0 = speed_locked */
+    uint8_t  flags;                         /* STATE_FLAG_* */
+    uint32_t duration_ms;                   /* CMD_STATE_DELTA: length at 1.0x */
+    uint32_t position_ms;                   /* song ms at position_us */
+    int64_t  position_us;                   /* local esp_timer time of position_ms */
+    uint16_t rate_x1000;                    /* song ms per 1000 ms while advancing */
 } music_player_state_t;
 
 /** Shared player state – read by the UI, written by the UART task. */
@@ -95,7 +172,7 @@ extern music_player_state_t g_player_state;
 /* ---------- Public API ---------- */
 
 /**
- * @brief Initialise UART1 at 921600 baud and start the UART task on Core 0.
+ * @brief Initialise UART1 at UART_COMM_BAUD_RATE and start the UART task on Core 0.
  *        Must be called after the LVGL / BSP initialisation is complete.
  */
 void uart_comm_init(void);
@@ -164,28 +241,36 @@ void uart_comm_send_set_song_settings(uint16_t song_id,
                                       uint8_t  pitch_influence_pct);
 
 /**
- * @brief Enqueue CMD_PLAY_SONG to be sent on the next poll response.
+ * @brief Enqueue CMD_LIST_PAGE_REQ for list positions
+ *        [@p start, @p start + @p count).  The reply is delivered via
+ *        ui_songlist_page_async().
+ */
+void uart_comm_send_list_page_req(uint16_t start, uint8_t count);
+
+/**
+ * @brief Send CMD_PLAY_SONG.  Urgent: on a v2 link it goes out at once,
+ *        otherwise with the next poll response.
  * @param song_id  1-based song index.
  */
 void uart_comm_send_play_song(uint16_t song_id);
 
 /**
- * @brief Enqueue CMD_STOP_SONG to be sent on the next poll response.
+ * @brief Send CMD_STOP_SONG (urgent).
  */
 void uart_comm_send_stop(void);
 
 /**
- * @brief Enqueue CMD_PAUSE to be sent on the next poll response.
+ * @brief Send CMD_PAUSE (urgent).
  */
 void uart_comm_send_pause(void);
 
 /**
- * @brief Enqueue CMD_RESUME to be sent on the next poll response.
+ * @brief Send CMD_RESUME (urgent).
  */
 void uart_comm_send_resume(void);
 
 /**
- * @brief Enqueue CMD_SEEK to be sent on the next poll response.
+ * @brief Send CMD_SEEK (urgent).
  * @param pct  Seek target 0–100 %.
  */
 void uart_comm_send_seek(uint8_t pct);
@@ -195,7 +280,9 @@ void uart_comm_send_seek(uint8_t pct);
  *
  * Call this from the LVGL indev read callback each time touch data is
  * obtained, so the UART task always has up-to-date touch information
- * without needing to acquire the LVGL lock.
+ * without needing to acquire the LVGL lock.  Press and release edges also
+ * time-stamp the commands they cause, for the touch→UART latency figures
+ * in the periodic link log.
  *
  * @param active  true if the touchscreen is currently pressed.
  * @param x       Touch X co-ordinate (ignored when active == false).
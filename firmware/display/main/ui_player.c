@@ -15,6 +15,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include <string.h>
 #include <stdlib.h>
 
@@ -38,6 +39,7 @@ static const char *TAG = "ui_player";
 #define PROGRESS_Y       130    /* progress bar top edge                    */
 #define PROGRESS_H       44     /* progress bar height                      */
 #define PROGRESS_PAD_X   30     /* horizontal padding inside left panel     */
+#define PROGRESS_RANGE   1000   /* bar steps: finer than one pixel          */
 #define STOP_Y           370    /* button row top edge                      */
 #define STOP_W           110    /* icon-only STOP button width              */
 #define STOP_H           80     /* button height (shared)                   */
@@ -117,6 +119,16 @@ static uint8_t   s_locked_spd_max_x10 = 20;
 /* Indeterminate progress animation */
 static bool      s_prog_anim_active = false;
 
+/* Extrapolated position (CMD_STATE_DELTA), drawn by s_pos_timer */
+static lv_timer_t *s_pos_timer    = NULL;
+static bool      s_pos_valid      = false;
+static bool      s_pos_running    = false;   /* false while paused        */
+static uint32_t  s_pos_ms         = 0;       /* song ms at s_pos_us       */
+static uint32_t  s_pos_dur_ms     = 0;
+static uint16_t  s_pos_rate       = 1000;    /* song ms per 1000 ms       */
+static int64_t   s_pos_us         = 0;
+static uint32_t  s_time_lbl_key   = UINT32_MAX;  /* elapsed/total on show */
+
 /* =========================================================================
  * Internal helpers
  * ========================================================================= */
@@ -134,6 +146,41 @@ static void stop_progress_anim(void)
     s_prog_anim_active = false;
 }
 
+/** Helper: "elapsed / total" label, only rewritten when a second changes. */
+static void set_time_label(uint16_t elapsed_s, uint16_t total_s)
+{
+    uint32_t key = ((uint32_t)elapsed_s << 16) | total_s;
+    if (!s_time_lbl || key == s_time_lbl_key) return;
+    s_time_lbl_key = key;
+    char buf[24];
+    snprintf(buf, sizeof(buf), "%u:%02u / %u:%02u",
+             elapsed_s / 60, elapsed_s % 60,
+             total_s   / 60, total_s   % 60);
+    lv_label_set_text(s_time_lbl, buf);
+}
+
+/** Timer: draw the position extrapolated from the last sample. */
+static void pos_timer_cb(lv_timer_t *t)
+{
+    (void)t;
+    if (!s_pos_valid || lv_screen_active() != s_screen) return;
+
+    uint32_t pos = s_pos_ms;
+    if (s_pos_running) {
+        int64_t dt_us = esp_timer_get_time() - s_pos_us;
+        if (dt_us > 0) pos += (uint32_t)((uint64_t)dt_us * s_pos_rate / 1000000u);
+    }
+    if (pos > s_pos_dur_ms) pos = s_pos_dur_ms;
+
+    if (s_progress_bar && s_pos_dur_ms > 0) {
+        lv_bar_set_value(s_progress_bar,
+                         (int32_t)((uint64_t)pos * PROGRESS_RANGE / s_pos_dur_ms), LV_ANIM_OFF);
+    }
+    /* Speed-adjusted seconds, like CMD_SET_STATE's duration_s */
+    uint16_t rate = s_pos_rate ? s_pos_rate : 1000;
+    set_time_label((uint16_t)(pos / rate), (uint16_t)(s_pos_dur_ms / rate));
+}
+
 /** Helper: create one vertical indicator column on the right panel. */
 static void create_indicator_col(lv_obj_t *parent,
                                  uint8_t col_idx,
@@ -218,7 +265,12 @@ static void on_progress_clicked(lv_event_t *e)
         lv_anim_delete(s_progress_bar, prog_anim_exec_cb);
         s_prog_anim_active = false;
     }
-    lv_bar_set_value(s_progress_bar, pct, LV_ANIM_OFF);
+    lv_bar_set_value(s_progress_bar, pct * PROGRESS_RANGE / 100, LV_ANIM_OFF);
+    if (s_pos_valid) {
+        /* Extrapolate from the target until the player's position arrives */
+        s_pos_ms = (uint32_t)((uint64_t)s_pos_dur_ms * pct / 100);
+        s_pos_us = esp_timer_get_time();
+    }
 
     uart_comm_send_seek(pct);
 }
@@ -313,7 +365,7 @@ void ui_player_create(void)
     lv_obj_set_size(s_progress_bar,
                     SPLIT_X - 2 * PROGRESS_PAD_X, PROGRESS_H);
     lv_obj_set_pos(s_progress_bar, PROGRESS_PAD_X, PROGRESS_Y);
-    lv_bar_set_range(s_progress_bar, 0, 100);
+    lv_bar_set_range(s_progress_bar, 0, PROGRESS_RANGE);
     lv_bar_set_value(s_progress_bar, 0, LV_ANIM_OFF);
 
     lv_obj_set_style_bg_color(s_progress_bar, lv_color_hex(COLOR_BAR_TRACK),
@@ -340,6 +392,8 @@ void ui_player_create(void)
     lv_obj_set_style_text_align(s_time_lbl, LV_TEXT_ALIGN_RIGHT, 0);
     lv_obj_set_pos(s_time_lbl, PROGRESS_PAD_X, TIME_LABEL_Y);
 
+    s_pos_timer = lv_timer_create(pos_timer_cb, UI_PLAYER_POS_FRAME_MS, NULL);
+
     /* Loop indicator label – shown when the current song has loop enabled -- */
     s_loop_lbl = lv_label_create(left);
     lv_label_set_text(s_loop_lbl, LV_SYMBOL_REFRESH "  LOOP");
@@ -530,10 +584,11 @@ static void async_cb_show(void *user_data)
     snprintf(title_buf, sizeof(title_buf), LV_SYMBOL_AUDIO "  %s", display_name);
     lv_label_set_text(s_title_lbl, title_buf);
 
-    /* Reset progress – real data arrives immediately via update_progress_async */
+    /* Reset progress – real data arrives immediately via update_progress_async
+     * (or the position timer redraws it) */
     stop_progress_anim();
     if (s_progress_bar) lv_bar_set_value(s_progress_bar, 0, LV_ANIM_OFF);
-    if (s_time_lbl)     lv_label_set_text(s_time_lbl, "0:00 / 0:00");
+    set_time_label(0, 0);
 
     /* Update next-song label */
     if (s_next_song_lbl) {
@@ -571,8 +626,9 @@ static void async_cb_hide(void *user_data)
         lv_obj_add_flag(s_tmp_live_bar, LV_OBJ_FLAG_HIDDEN);
     }
     stop_progress_anim();
+    s_pos_valid = false;
     if (s_progress_bar) lv_bar_set_value(s_progress_bar, 0, LV_ANIM_OFF);
-    if (s_time_lbl)     lv_label_set_text(s_time_lbl, "0:00 / 0:00");
+    set_time_label(0, 0);
     if (s_next_song_lbl) lv_label_set_text(s_next_song_lbl, "");
     ui_songlist_show();
 }
@@ -636,18 +692,36 @@ static void async_cb_update_progress(void *user_data)
 
     /* Stop indeterminate animation if still running from a previous session */
     stop_progress_anim();
+    s_pos_valid = false;
 
     if (s_progress_bar) {
-        lv_bar_set_value(s_progress_bar, p->pct, LV_ANIM_OFF);
-    }
-    if (s_time_lbl) {
-        uint16_t elapsed_s = (uint16_t)((uint32_t)p->dur_s * p->pct / 100);
-        char buf[24];
-        snprintf(buf, sizeof(buf), "%u:%02u / %u:%02u",
-                 elapsed_s / 60, elapsed_s % 60,
-                 p->dur_s  / 60, p->dur_s  % 60);
-        lv_label_set_text(s_time_lbl, buf);
+        lv_bar_set_value(s_progress_bar, p->pct * PROGRESS_RANGE / 100, LV_ANIM_OFF);
     }
+    set_time_label((uint16_t)((uint32_t)p->dur_s * p->pct / 100), p->dur_s);
+
+    free(p);
+}
+
+typedef struct {
+    uint32_t pos_ms;
+    uint32_t dur_ms;
+    int64_t  sample_us;
+    uint16_t rate_x1000;
+    bool     running;
+} async_position_payload_t;
+
+static void async_cb_update_position(void *user_data)
+{
+    async_position_payload_t *p = (async_position_payload_t *)user_data;
+
+    stop_progress_anim();
+    s_pos_ms      = p->pos_ms;
+    s_pos_dur_ms  = p->dur_ms;
+    s_pos_us      = p->sample_us;
+    s_pos_rate    = p->rate_x1000;
+    s_pos_running = p->running;
+    s_pos_valid   = true;
+    pos_timer_cb(s_pos_timer);
 
     free(p);
 }
@@ -713,6 +787,24 @@ void ui_player_update_progress_async(uint8_t position_pct, uint16_t duration_s)
     lv_unlock();
 }
 
+void ui_player_update_position_async(uint32_t position_ms, uint32_t duration_ms,
+                                     uint16_t rate_x1000, bool running, int64_t sample_us)
+{
+    if (!s_screen) return;
+
+    async_position_payload_t *p = malloc(sizeof(async_position_payload_t));
+    if (!p) { ESP_LOGE(TAG, "OOM in update_position_async"); return; }
+
+    p->pos_ms     = position_ms;
+    p->dur_ms     = duration_ms;
+    p->sample_us  = sample_us;
+    p->rate_x1000 = rate_x1000;
+    p->running    = running;
+    lv_lock();
+    lv_async_call(async_cb_update_position, p);
+    lv_unlock();
+}
+
 /* =========================================================================
  * Song-settings delivery – async bridge + callback
  * ========================================================================= */
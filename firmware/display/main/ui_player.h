@@ -29,6 +29,8 @@
 extern "C" {
 #endif
 
+#define UI_PLAYER_POS_FRAME_MS  33   /* extrapolated position redraw (~30 fps) */
+
 /* ---------- Lifecycle ----------------------------------------------------- */
 
 /**
@@ -77,6 +79,24 @@ void ui_player_update_potis_async(uint8_t volume, uint8_t tempo, uint8_t live_te
  */
 void ui_player_update_progress_async(uint8_t position_pct, uint16_t duration_s);
 
+/**
+ * @brief Start extrapolating the position from a CMD_STATE_DELTA sample.
+ *        The view redraws the progress bar and time label every
+ *        UI_PLAYER_POS_FRAME_MS from it until the next sample, hide, or
+ *        ui_player_update_progress_async().
+ *        Safe to call from any task / core.
+ *
+ * @param position_ms  Song time at @p sample_us.
+ * @param duration_ms  Song length at 1.0x.
+ * @param rate_x1000   Song ms per 1000 ms; also scales the time label to
+ *                     the speed-adjusted times ui_player_update_progress_async()
+ *                     shows.
+ * @param running      false while paused: the position stands still.
+ * @param sample_us    esp_timer time the sample belongs to.
+ */
+void ui_player_update_position_async(uint32_t position_ms, uint32_t duration_ms,
+                                     uint16_t rate_x1000, bool running, int64_t sample_us);
+
 /**
  * @brief Deliver song-settings to the player view.
  *        Updates the Loop and 1.0x indicator labels and the fixed-speed
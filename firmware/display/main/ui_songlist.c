@@ -10,12 +10,17 @@
  *   so no extra locking is needed there.
  * - All Display->Host commands are queued via uart_comm_send_*() and flushed
  *   in the next CMD_ACK response; no direct uart_write_bytes() calls are made.
+ * - Only a window of the player's song list is held (see ui_songlist.h).  It
+ *   is reloaded with CMD_LIST_PAGE_REQ when CMD_LIST_INFO shows another list
+ *   version or a CMD_LIST_DELTA skips one, and edited in place otherwise.
  */
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_heap_caps.h"
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
 
 #include "lvgl.h"
@@ -26,11 +31,6 @@ static const char *TAG = "ui_songlist";
 
 /* ---------- Internal state ----------------------------------------------- */
 
-typedef struct {
-    uint16_t id;
-    char     name[MAX_SONG_NAME_LEN];
-} song_entry_t;
-
 /* Per-song settings cache – populated on first gear-tap via CMD_SONG_SETTINGS */
 typedef struct {
     bool    valid;               /* true once player has responded                */
@@ -44,11 +44,25 @@ typedef struct {
     uint8_t pitch_influence_pct; /* 0-100: 0=time-stretch, 100=tape effect        */
 } song_settings_cache_t;
 
-static song_entry_t         s_songs[SONGLIST_MAX_SONGS];
-static song_settings_cache_t s_settings[SONGLIST_MAX_SONGS];
-static uint8_t      s_song_count = 0;
+static ui_songlist_batch_t  *s_songs    = NULL;  /* window (owned), from s_win_base */
+static song_settings_cache_t *s_settings = NULL;  /* indexed by song_id - 1          */
+static uint16_t     s_settings_cap = 0;
+static uint16_t     s_song_count = 0;   /* songs in the window                 */
+static uint16_t     s_win_base   = 0;   /* list position of the window's first */
+static uint16_t     s_list_total = 0;   /* songs in the player's list          */
+static uint32_t     s_list_version = 0; /* list version the window matches     */
+static bool         s_list_valid = false;
+static bool         s_req_pending = false; /* CMD_LIST_PAGE_REQ awaiting reply */
+static uint16_t     s_req_start  = 0;
+static uint32_t     s_req_tick   = 0;
+static uint16_t     s_focus_pos  = 0;   /* list position to focus after a page */
+static uint16_t     s_row_count  = 0;   /* list buttons incl. "more" rows      */
+static uint16_t     s_row_first  = 0;   /* button index of the first song      */
 static int16_t      s_focused_idx = 0;  /* currently focused list-button index */
 
+/* A page request without reply is repeated after this long. */
+#define LIST_REQ_RETRY_MS   1000
+
 /* LVGL objects */
 static lv_obj_t   *s_screen      = NULL;
 static lv_obj_t   *s_list        = NULL;
@@ -89,6 +103,7 @@ static uint8_t    s_dimmer_holdoff_s   = 0u;
 static uint8_t    s_dimmer_fadein_s    = 0u;
 /* ---------- Forward declarations ----------------------------------------- */
 static void on_list_item_clicked(lv_event_t *e);
+static void on_more_clicked(lv_event_t *e);
 static void on_wifi_btn_clicked(lv_event_t *e);
 static void update_wifi_btn_style(void);
 static void on_bt_btn_clicked(lv_event_t *e);
@@ -105,11 +120,6 @@ static void send_play_song(uint16_t song_id);
 
 /* ---------- async payload structs ---------------------------------------- */
 
-typedef struct {
-    uint8_t *data; /* heap-allocated; freed by the async callback */
-    uint16_t len;
-} async_songlist_payload_t;
-
 typedef struct {
     uint16_t song_id;
     uint8_t  flags;
@@ -126,6 +136,26 @@ typedef struct {
     int8_t steps;
 } async_encoder_move_t;
 
+typedef struct {
+    uint32_t version;
+    uint16_t total;
+} async_list_info_t;
+
+typedef struct {
+    ui_songlist_batch_t *batch;
+    uint32_t             version;
+    uint16_t             total;
+    uint16_t             start;
+} async_list_page_t;
+
+typedef struct {
+    uint32_t version;
+    uint8_t  op;
+    uint16_t song_id;
+    char     name[MAX_SONG_NAME_LEN];
+    char     old_name[MAX_SONG_NAME_LEN];
+} async_list_delta_t;
+
 /* =========================================================================
  * WiFi button helpers
  * ========================================================================= */
@@ -355,60 +385,178 @@ void ui_songlist_create(void)
  * Internal helpers
  * ========================================================================= */
 
+/** Settings cache slot of @p song_id, or NULL. */
+static song_settings_cache_t *settings_slot(uint16_t song_id)
+{
+    if (song_id == 0 || song_id > s_settings_cap) return NULL;
+    return &s_settings[song_id - 1];
+}
+
+/** Window index of @p song_id, or -1. */
+static int32_t song_pos(uint16_t song_id)
+{
+    for (uint16_t i = 0; i < s_song_count; i++) {
+        if (s_songs->ids[i] == song_id) return i;
+    }
+    return -1;
+}
+
+/** @p name as shown: underscores become spaces. */
+static void display_name(const char *name, char *buf, size_t len)
+{
+    strlcpy(buf, name, len);
+    for (char *c = buf; *c; c++) { if (*c == '_') *c = ' '; }
+}
+
+/** Song-ID on the focused button, 0 on a "more" row or an empty list. */
+static uint16_t focused_song_id(void)
+{
+    int32_t w = (int32_t)s_focused_idx - s_row_first;
+    return (w >= 0 && w < s_song_count) ? s_songs->ids[w] : 0;
+}
+
+/** Size the settings cache for ids 1..@p total; @p keep false drops every entry. */
+static void settings_fit(uint16_t total, bool keep)
+{
+    if (!keep && s_settings) memset(s_settings, 0, s_settings_cap * sizeof(*s_settings));
+    if (total <= s_settings_cap) return;
+    song_settings_cache_t *p = heap_caps_realloc_prefer(s_settings, total * sizeof(*p), 2,
+                                                        MALLOC_CAP_SPIRAM, MALLOC_CAP_DEFAULT);
+    if (!p) return;
+    memset(p + s_settings_cap, 0, (size_t)(total - s_settings_cap) * sizeof(*p));
+    s_settings     = p;
+    s_settings_cap = total;
+}
+
+/**
+ * Ask the player for the window starting at list position @p start
+ * (clamped so a full window fits).  A request for the same window is not
+ * repeated until LIST_REQ_RETRY_MS have passed without a reply.
+ */
+static void request_window(uint16_t start)
+{
+    uint16_t max_start = (s_list_total > SONGLIST_WINDOW) ? s_list_total - SONGLIST_WINDOW : 0;
+    if (start > max_start) start = max_start;
+    if (s_req_pending && s_req_start == start &&
+        lv_tick_elaps(s_req_tick) < LIST_REQ_RETRY_MS) {
+        return;
+    }
+    s_req_pending = true;
+    s_req_start   = start;
+    s_req_tick    = lv_tick_get();
+    uart_comm_send_list_page_req(start, SONGLIST_WINDOW);
+}
+
+/** Page the window towards the start (@p dir < 0) or the end of the list. */
+static void page_window(int8_t dir)
+{
+    const uint16_t step = SONGLIST_WINDOW * 3 / 4;   /* keep a few rows of context */
+    if (dir < 0) {
+        if (s_win_base == 0) return;
+        s_focus_pos = s_win_base - 1;
+        request_window(s_win_base > step ? s_win_base - step : 0);
+    } else {
+        if (s_win_base + s_song_count >= s_list_total) return;
+        s_focus_pos = s_win_base + s_song_count;
+        request_window(s_win_base + step);
+    }
+}
+
+static void style_row(lv_obj_t *btn, uint32_t bg)
+{
+    /* Style: dark item background, large font, high-contrast text */
+    lv_obj_set_style_bg_color(btn, lv_color_hex(bg), 0);
+    lv_obj_set_style_bg_opa(btn, LV_OPA_COVER, 0);
+    lv_obj_set_style_bg_color(btn, lv_color_hex(0xE94560), LV_STATE_FOCUSED);
+    lv_obj_set_style_bg_opa(btn, LV_OPA_COVER, LV_STATE_FOCUSED);
+    lv_obj_set_style_border_width(btn, 0, 0);
+    lv_obj_set_style_radius(btn, 6, 0);
+
+    /* Style the label child */
+    lv_obj_t *lbl = lv_obj_get_child(btn, -1); /* last child = label */
+    if (lbl) {
+        lv_obj_set_style_text_font(lbl, &lv_font_montserrat_28, 0);
+        lv_obj_set_style_text_color(lbl, lv_color_hex(0xE0E0FF), 0);
+        lv_obj_set_style_text_color(lbl, lv_color_white(), LV_STATE_FOCUSED);
+    }
+
+    /* Add to encoder group so it receives focus */
+    lv_group_add_obj(s_group, btn);
+    s_row_count++;
+}
+
+/** "n more" row paging the window in direction @p dir. */
+static void add_more_row(int8_t dir, uint16_t n)
+{
+    char text[24];
+    snprintf(text, sizeof(text), "%u more", n);
+    lv_obj_t *btn = lv_list_add_button(s_list, dir < 0 ? LV_SYMBOL_UP : LV_SYMBOL_DOWN, text);
+    lv_obj_add_event_cb(btn, on_more_clicked, LV_EVENT_CLICKED, (void *)(intptr_t)dir);
+    style_row(btn, 0x2A2A3E);
+}
+
 /**
- * Rebuild the lv_list contents from s_songs[].
+ * Rebuild the lv_list contents from the window and focus @p focus_id, or
+ * list position s_focus_pos when that song is not in the window.
  * Must be called with the LVGL lock held.
  */
-static void rebuild_list(void)
+static void rebuild_list(uint16_t focus_id)
 {
     /* Remove all existing children */
     lv_obj_clean(s_list);
     s_focused_idx = 0;
+    s_row_count   = 0;
+    s_row_first   = 0;
 
-    for (uint8_t i = 0; i < s_song_count; i++) {
-        lv_obj_t *btn = lv_list_add_button(s_list, LV_SYMBOL_AUDIO, s_songs[i].name);
-
-        /* Style: dark item background, large font, high-contrast text */
-        lv_obj_set_style_bg_color(btn, lv_color_hex(0x0F3460), 0);
-        lv_obj_set_style_bg_opa(btn, LV_OPA_COVER, 0);
-        lv_obj_set_style_bg_color(btn, lv_color_hex(0xE94560), LV_STATE_FOCUSED);
-        lv_obj_set_style_bg_opa(btn, LV_OPA_COVER, LV_STATE_FOCUSED);
-        lv_obj_set_style_border_width(btn, 0, 0);
-        lv_obj_set_style_radius(btn, 6, 0);
-
-        /* Style the label child */
-        lv_obj_t *lbl = lv_obj_get_child(btn, -1); /* last child = label */
-        if (lbl) {
-            lv_obj_set_style_text_font(lbl, &lv_font_montserrat_28, 0);
-            lv_obj_set_style_text_color(lbl, lv_color_hex(0xE0E0FF), 0);
-            lv_obj_set_style_text_color(lbl, lv_color_white(), LV_STATE_FOCUSED);
-        }
+    if (s_win_base > 0) {
+        add_more_row(-1, s_win_base);
+        s_row_first = 1;
+    }
+    for (uint16_t i = 0; i < s_song_count; i++) {
+        char name[MAX_SONG_NAME_LEN];
+        display_name(name_arena_get(&s_songs->names, i), name, sizeof(name));
+        lv_obj_t *btn = lv_list_add_button(s_list, LV_SYMBOL_AUDIO, name);
 
         /* Store song-ID in the button's user data */
-        lv_obj_set_user_data(btn, (void *)(uintptr_t)s_songs[i].id);
+        lv_obj_set_user_data(btn, (void *)(uintptr_t)s_songs->ids[i]);
 
         /* Touch / click event */
         lv_obj_add_event_cb(btn, on_list_item_clicked, LV_EVENT_CLICKED, NULL);
-
-        /* Add to encoder group so it receives focus */
-        lv_group_add_obj(s_group, btn);
+        style_row(btn, 0x0F3460);
+    }
+    if (s_win_base + s_song_count < s_list_total) {
+        add_more_row(1, (uint16_t)(s_list_total - s_win_base - s_song_count));
     }
 
-    /* Focus the first item */
     if (s_song_count > 0) {
-        focus_item(0);
+        int32_t w = song_pos(focus_id);
+        if (w < 0) {
+            w = (s_focus_pos > s_win_base) ? s_focus_pos - s_win_base : 0;
+            if (w >= s_song_count) w = s_song_count - 1;
+        }
+        focus_item((int16_t)(s_row_first + w));
     }
 }
 
-/** Move focus to item at absolute index idx (clamped to valid range). */
+/**
+ * Move focus to item at absolute index idx (clamped to valid range).
+ * Moving onto a "more" row pages the window instead.
+ */
 static void focus_item(int16_t idx)
 {
-    if (s_song_count == 0) return;
+    if (s_row_count == 0) return;
 
     if (idx < 0) idx = 0;
-    if (idx >= (int16_t)s_song_count) idx = (int16_t)s_song_count - 1;
+    if (idx >= (int16_t)s_row_count) idx = (int16_t)s_row_count - 1;
+
+    int32_t w = (int32_t)idx - s_row_first;
+    if (w < 0 || w >= s_song_count) {
+        page_window(w < 0 ? -1 : 1);
+        return;
+    }
 
     s_focused_idx = idx;
+    s_focus_pos   = (uint16_t)(s_win_base + w);
 
     /* Walk the group to the target object */
     lv_obj_t *target = lv_obj_get_child(s_list, idx);
@@ -430,6 +578,11 @@ static void on_list_item_clicked(lv_event_t *e)
     send_play_song(song_id);
 }
 
+static void on_more_clicked(lv_event_t *e)
+{
+    page_window((int8_t)(intptr_t)lv_event_get_user_data(e));
+}
+
 /* =========================================================================
  * Settings dialog
  * ========================================================================= */
@@ -558,17 +711,17 @@ static void on_settings_ok(lv_event_t *e)
     uint8_t d_fad  = s_dimmer_fadein_s;
 
     /* Update local cache */
-    uint8_t cache_idx = (uint8_t)(song_id - 1);
-    if (cache_idx < SONGLIST_MAX_SONGS) {
-        s_settings[cache_idx].flags               = flags;
-        s_settings[cache_idx].fixed_speed_x100    = fixed_speed_x100;
-        s_settings[cache_idx].dimmer_max          = d_max;
-        s_settings[cache_idx].dimmer_min          = d_min;
-        s_settings[cache_idx].dimmer_rps_ref_x10  = d_rps;
-        s_settings[cache_idx].dimmer_holdoff_s    = d_hld;
-        s_settings[cache_idx].dimmer_fadein_s     = d_fad;
-        s_settings[cache_idx].pitch_influence_pct = s_pitch_influence;
-        s_settings[cache_idx].valid               = true;
+    song_settings_cache_t *slot = settings_slot(song_id);
+    if (slot) {
+        slot->flags               = flags;
+        slot->fixed_speed_x100    = fixed_speed_x100;
+        slot->dimmer_max          = d_max;
+        slot->dimmer_min          = d_min;
+        slot->dimmer_rps_ref_x10  = d_rps;
+        slot->dimmer_holdoff_s    = d_hld;
+        slot->dimmer_fadein_s     = d_fad;
+        slot->pitch_influence_pct = s_pitch_influence;
+        slot->valid               = true;
     }
 
     /* Send to player and request fresh response so other views update */
@@ -602,13 +755,12 @@ static void create_settings_dialog(uint16_t song_id)
     }
 
     /* Find song name */
-    const char *song_name = "";
-    for (uint8_t i = 0; i < s_song_count; i++) {
-        if (s_songs[i].id == song_id) { song_name = s_songs[i].name; break; }
-    }
+    int32_t     pos       = song_pos(song_id);
+    char        song_name[MAX_SONG_NAME_LEN] = "";
+    if (pos >= 0) display_name(name_arena_get(&s_songs->names, (uint16_t)pos), song_name, sizeof(song_name));
 
     /* Determine current values from cache (factory defaults if not yet saved). */
-    uint8_t cache_idx = (uint8_t)(song_id - 1);
+    const song_settings_cache_t *slot = settings_slot(song_id);
     uint8_t cached_end_action      = 0u; /* 0=none, 1=next, 2=loop */
     bool    cached_speed           = false;
     bool    cached_light_organ     = false;
@@ -619,22 +771,22 @@ static void create_settings_dialog(uint16_t song_id)
     uint8_t cached_drps            = 14u;
     uint8_t cached_dhld            = 0u;
     uint8_t cached_dfad            = 0u;
-    if (cache_idx < SONGLIST_MAX_SONGS && s_settings[cache_idx].valid) {
-        bool cached_loop          = (s_settings[cache_idx].flags & 0x01u) != 0;
-        bool cached_autoplay_next = (s_settings[cache_idx].flags & 0x04u) != 0;
+    if (slot && slot->valid) {
+        bool cached_loop          = (slot->flags & 0x01u) != 0;
+        bool cached_autoplay_next = (slot->flags & 0x04u) != 0;
         if (cached_loop) cached_end_action = 2u;
         else if (cached_autoplay_next) cached_end_action = 1u;
-        cached_speed           = (s_settings[cache_idx].flags & 0x02u) != 0;
-        cached_light_organ     = (s_settings[cache_idx].flags & 0x10u) != 0;
-        cached_pitch_influence = s_settings[cache_idx].pitch_influence_pct;
-        cached_spd_x100        = s_settings[cache_idx].fixed_speed_x100;
+        cached_speed           = (slot->flags & 0x02u) != 0;
+        cached_light_organ     = (slot->flags & 0x10u) != 0;
+        cached_pitch_influence = slot->pitch_influence_pct;
+        cached_spd_x100        = slot->fixed_speed_x100;
         if (cached_spd_x100 < 70u || cached_spd_x100 > 140u) cached_spd_x100 = 100u;
-        cached_dmax = s_settings[cache_idx].dimmer_max;
-        cached_dmin = s_settings[cache_idx].dimmer_min;
-        cached_drps = s_settings[cache_idx].dimmer_rps_ref_x10;
+        cached_dmax = slot->dimmer_max;
+        cached_dmin = slot->dimmer_min;
+        cached_drps = slot->dimmer_rps_ref_x10;
         if (cached_drps == 0u) cached_drps = 14u;
-        cached_dhld = s_settings[cache_idx].dimmer_holdoff_s;
-        cached_dfad = s_settings[cache_idx].dimmer_fadein_s;
+        cached_dhld = slot->dimmer_holdoff_s;
+        cached_dfad = slot->dimmer_fadein_s;
     }
     s_pitch_influence  = cached_pitch_influence;
     s_end_action       = cached_end_action;
@@ -863,9 +1015,14 @@ void ui_songlist_open_settings_dialog(uint16_t song_id)
 
 uint16_t ui_songlist_find_song_id_by_name(const char *name)
 {
-    if (!name) return 0;
-    for (uint8_t i = 0; i < s_song_count; i++) {
-        if (strcmp(s_songs[i].name, name) == 0) return s_songs[i].id;
+    if (!name || s_song_count == 0) return 0;
+    /* Bisect to the names equal ignoring case, then match exactly. */
+    int32_t pos = name_arena_find_pos(&s_songs->names, name);
+    for (; pos >= 0 && pos < s_song_count; pos++) {
+        uint16_t    i = name_arena_sorted(&s_songs->names, (uint16_t)pos);
+        const char *n = name_arena_get(&s_songs->names, i);
+        if (strcmp(n, name) == 0) return s_songs->ids[i];
+        if (strcasecmp(n, name) != 0) break;
     }
     return 0;
 }
@@ -873,25 +1030,19 @@ uint16_t ui_songlist_find_song_id_by_name(const char *name)
 bool ui_songlist_get_song_name(uint16_t song_id, char *buf, size_t buf_len)
 {
     if (!buf || buf_len == 0) return false;
-    for (uint8_t i = 0; i < s_song_count; i++) {
-        if (s_songs[i].id == song_id) {
-            strlcpy(buf, s_songs[i].name, buf_len);
-            return true;
-        }
-    }
-    return false;
+    int32_t pos = song_pos(song_id);
+    if (pos < 0) return false;
+    display_name(name_arena_get(&s_songs->names, (uint16_t)pos), buf, buf_len);
+    return true;
 }
 
 uint16_t ui_songlist_get_next_song_id(uint16_t current_id)
 {
-    if (s_song_count == 0) return 0;
-    for (uint8_t i = 0; i < s_song_count; i++) {
-        if (s_songs[i].id == current_id) {
-            uint8_t next = (i + 1) % s_song_count;
-            return s_songs[next].id;
-        }
-    }
-    return s_songs[0].id;
+    int32_t pos = song_pos(current_id);
+    if (pos < 0) return 0;
+    if (pos + 1 < s_song_count) return s_songs->ids[pos + 1];
+    /* Last in the window: wraps only when the window is the whole list */
+    return (s_win_base == 0 && s_song_count >= s_list_total) ? s_songs->ids[0] : 0;
 }
 
 /* =========================================================================
@@ -917,61 +1068,266 @@ void ui_songlist_show_async(void)
 }
 
 /* =========================================================================
- * Song-list update (UART task → LVGL task)
+ * Song window (UART task → LVGL task)
  * ========================================================================= */
 
-static void async_cb_update_songlist(void *user_data)
+ui_songlist_batch_t *ui_songlist_batch_new(void)
+{
+    return calloc(1, sizeof(ui_songlist_batch_t));
+}
+
+bool ui_songlist_batch_add(ui_songlist_batch_t *b, uint16_t id, const char *name, size_t len)
+{
+    if (b->names.count == b->ids_cap) {
+        uint32_t cap = b->ids_cap ? (uint32_t)b->ids_cap * 2u : 64u;
+        if (cap > NAME_ARENA_MAX) cap = NAME_ARENA_MAX;
+        if (cap == b->ids_cap) return false;
+        uint16_t *ids = heap_caps_realloc_prefer(b->ids, cap * sizeof(*ids), 2,
+                                                 MALLOC_CAP_SPIRAM, MALLOC_CAP_DEFAULT);
+        if (!ids) return false;
+        b->ids     = ids;
+        b->ids_cap = (uint16_t)cap;
+    }
+    if (len >= MAX_SONG_NAME_LEN) len = MAX_SONG_NAME_LEN - 1;
+    int32_t i = name_arena_add(&b->names, name, len);
+    if (i < 0) return false;
+    b->ids[i] = id;
+    return true;
+}
+
+void ui_songlist_batch_free(ui_songlist_batch_t *b)
+{
+    if (!b) return;
+    name_arena_free(&b->names);
+    free(b->ids);
+    free(b);
+}
+
+/* ---------- Window edits for CMD_LIST_DELTA ------------------------------ */
+
+/**
+ * Replace the window with a copy that lacks window index @p drop and has
+ * song @p song_id named @p name before window index @p at (-1: neither).
+ * Out of memory drops the window and reloads it.
+ */
+static bool window_splice(int32_t drop, int32_t at, uint16_t song_id, const char *name)
+{
+    ui_songlist_batch_t *b = ui_songlist_batch_new();
+    bool ok = (b != NULL);
+    for (int32_t i = 0; ok && i <= s_song_count; i++) {
+        if (i == at) ok = ui_songlist_batch_add(b, song_id, name, strlen(name));
+        if (ok && i < s_song_count && i != drop) {
+            const char *n = name_arena_get(&s_songs->names, (uint16_t)i);
+            ok = ui_songlist_batch_add(b, s_songs->ids[i], n, strlen(n));
+        }
+    }
+    if (!ok) {
+        ESP_LOGE(TAG, "Out of memory");
+        ui_songlist_batch_free(b);
+        s_list_valid = false;
+        request_window(s_win_base);
+        return false;
+    }
+    ui_songlist_batch_free(s_songs);
+    s_songs      = b;
+    s_song_count = b->names.count;
+    return true;
+}
+
+/** Take song @p song_id (named @p name) out of the list view. */
+static void window_drop(uint16_t song_id, const char *name)
+{
+    int32_t w = song_pos(song_id);
+    if (w >= 0) {
+        window_splice(w, -1, 0, NULL);
+    } else if (s_song_count > 0 && s_win_base > 0 &&
+               name_arena_cmp(name, name_arena_get(&s_songs->names, 0)) < 0) {
+        s_win_base--;             /* it was before the window */
+    }
+}
+
+/**
+ * Put song @p song_id named @p name into the list view; @p others is the
+ * list length without it.
+ */
+static void window_insert(uint16_t song_id, const char *name, uint16_t others)
+{
+    uint16_t at = 0;
+    while (at < s_song_count &&
+           name_arena_cmp(name_arena_get(&s_songs->names, at), name) < 0) {
+        at++;
+    }
+    if (s_song_count > 0 && at == 0 && s_win_base > 0) {
+        s_win_base++;             /* before the window */
+        return;
+    }
+    if (at == s_song_count && s_win_base + s_song_count < others) {
+        return;                   /* after the window */
+    }
+    window_splice(-1, at, song_id, name);
+}
+
+static void apply_delta(const async_list_delta_t *d)
 {
-    async_songlist_payload_t *p = (async_songlist_payload_t *)user_data;
-
-    s_song_count = 0;
-    memset(s_settings, 0, sizeof(s_settings));
-
-    const uint8_t *ptr = p->data;
-    const uint8_t *end = p->data + p->len;
-
-    while (ptr + 2 < end) {
-        uint16_t id = (uint16_t)ptr[0] | ((uint16_t)ptr[1] << 8);
-        ptr += 2;
-        if (id == 0) break; /* end-of-list sentinel */
-
-        const uint8_t *name_start = ptr;
-        while (ptr < end && *ptr != '\0') ptr++;
-        if (ptr >= end) break;
-        ptr++; /* skip '\0' */
-
-        if (s_song_count < SONGLIST_MAX_SONGS) {
-            s_songs[s_song_count].id = id;
-            size_t name_len = (size_t)(ptr - name_start - 1);
-            if (name_len >= MAX_SONG_NAME_LEN) name_len = MAX_SONG_NAME_LEN - 1;
-            memcpy(s_songs[s_song_count].name, name_start, name_len);
-            s_songs[s_song_count].name[name_len] = '\0';
-            s_song_count++;
+    uint16_t focus_id = focused_song_id();
+
+    switch (d->op) {
+    case LIST_OP_ADD:
+        window_insert(d->song_id, d->name, s_list_total);
+        s_list_total++;
+        settings_fit(s_list_total, true);
+        break;
+    case LIST_OP_REMOVE:
+        window_drop(d->song_id, d->name);
+        if (s_list_total > 0) s_list_total--;
+        /* Higher song-IDs move down by one */
+        for (uint16_t i = 0; i < s_song_count; i++) {
+            if (s_songs->ids[i] > d->song_id) s_songs->ids[i]--;
+        }
+        if (d->song_id <= s_settings_cap) {
+            memmove(&s_settings[d->song_id - 1], &s_settings[d->song_id],
+                    (size_t)(s_settings_cap - d->song_id) * sizeof(*s_settings));
+            memset(&s_settings[s_settings_cap - 1], 0, sizeof(*s_settings));
         }
+        if (focus_id == d->song_id)     focus_id = 0;
+        else if (focus_id > d->song_id) focus_id--;
+        break;
+    case LIST_OP_RENAME:
+        window_drop(d->song_id, d->old_name);
+        window_insert(d->song_id, d->name, s_list_total ? s_list_total - 1 : 0);
+        break;
+    default:
+        ESP_LOGW(TAG, "List delta op %u unknown – reloading window", d->op);
+        s_list_valid = false;
+        break;
     }
+    if (!s_list_valid) {          /* splice ran out of memory, or unknown op */
+        request_window(s_win_base);
+        return;
+    }
+
+    s_list_version = d->version;
+    if (s_win_base > s_list_total) s_win_base = s_list_total;
+    if (s_songs) name_arena_sort(&s_songs->names);
+    rebuild_list(focus_id);
+    if (s_song_count == 0 && s_list_total > 0) request_window(s_win_base);
+}
 
-    free(p->data);
+/* ---------- List sync (UART task → LVGL task) ---------------------------- */
+
+static void async_cb_list_info(void *user_data)
+{
+    async_list_info_t *p = (async_list_info_t *)user_data;
+    if (!s_list_valid || p->version != s_list_version) {
+        s_list_valid = false;     /* deltas wait for the reloaded window */
+        s_list_total = p->total;
+        request_window(s_win_base);
+    }
     free(p);
+}
 
-    rebuild_list();
-    ESP_LOGI(TAG, "Song list updated: %u songs", s_song_count);
+void ui_songlist_list_info_async(uint32_t version, uint16_t total)
+{
+    if (!s_screen) return;
+    async_list_info_t *p = malloc(sizeof(async_list_info_t));
+    if (!p) return;
+    p->version = version;
+    p->total   = total;
+    lv_lock();
+    lv_async_call(async_cb_list_info, p);
+    lv_unlock();
 }
 
-void ui_songlist_update_async(const uint8_t *data, uint16_t len)
+static void async_cb_list_page(void *user_data)
 {
-    if (!s_screen || !data || len == 0) return;
+    async_list_page_t   *p = (async_list_page_t *)user_data;
+    ui_songlist_batch_t *b = p->batch;
+
+    /* A reply to an older request, or older than the window: drop it. */
+    if ((s_req_pending && p->start != s_req_start) ||
+        (s_list_valid && (int32_t)(p->version - s_list_version) < 0)) {
+        ui_songlist_batch_free(b);
+        free(p);
+        return;
+    }
 
-    async_songlist_payload_t *p = malloc(sizeof(async_songlist_payload_t));
-    if (!p) { ESP_LOGE(TAG, "OOM in update_async"); return; }
+    name_arena_sort(&b->names);   /* for ui_songlist_find_song_id_by_name() */
+
+    /* Song-IDs only keep their meaning within one list version. */
+    settings_fit(p->total, s_list_valid && p->version == s_list_version);
+
+    ui_songlist_batch_free(s_songs);
+    s_songs        = b;
+    s_song_count   = b->names.count;
+    s_win_base     = p->start;
+    s_list_total   = p->total;
+    s_list_version = p->version;
+    s_list_valid   = true;
+    s_req_pending  = false;
+
+    rebuild_list(0);
+    if (s_song_count == 0 && s_list_total > 0) request_window(s_win_base);  /* list shrank */
+    ESP_LOGI(TAG, "Song window %u..%u of %u (v%lu), names %u B",
+             s_win_base, s_win_base + s_song_count, s_list_total,
+             (unsigned long)s_list_version, (unsigned)name_arena_bytes(&b->names));
+    free(p);
+}
 
-    p->data = malloc(len);
-    if (!p->data) { free(p); ESP_LOGE(TAG, "OOM in update_async data"); return; }
+void ui_songlist_page_async(ui_songlist_batch_t *batch, uint32_t version,
+                            uint16_t total, uint16_t start)
+{
+    if (!batch) return;
+    if (!s_screen) { ui_songlist_batch_free(batch); return; }
+
+    async_list_page_t *p = malloc(sizeof(async_list_page_t));
+    if (!p) { ui_songlist_batch_free(batch); return; }
+    p->batch   = batch;
+    p->version = version;
+    p->total   = total;
+    p->start   = start;
+    lv_lock();
+    lv_async_call(async_cb_list_page, p);
+    lv_unlock();
+}
 
-    memcpy(p->data, data, len);
-    p->len = len;
+static void async_cb_list_delta(void *user_data)
+{
+    async_list_delta_t *d = (async_list_delta_t *)user_data;
+    int32_t ahead = (int32_t)(d->version - s_list_version);
+
+    if (s_list_valid && ahead == 1) {
+        apply_delta(d);
+    } else if (s_list_valid && ahead > 1) {
+        ESP_LOGW(TAG, "List delta v%lu after v%lu – reloading window",
+                 (unsigned long)d->version, (unsigned long)s_list_version);
+        s_list_valid = false;
+        request_window(s_win_base);
+    }
+    /* else already in the window, or a reload is under way */
+    free(d);
+}
 
+void ui_songlist_delta_async(uint32_t version, uint8_t op, uint16_t song_id,
+                             const char *name, size_t name_len,
+                             const char *old_name, size_t old_len)
+{
+    if (!s_screen) return;
+    async_list_delta_t *d = malloc(sizeof(async_list_delta_t));
+    if (!d) {
+        ESP_LOGE(TAG, "OOM in delta_async");
+        return;
+    }
+    if (name_len >= sizeof(d->name))    name_len = sizeof(d->name) - 1;
+    if (old_len >= sizeof(d->old_name)) old_len  = sizeof(d->old_name) - 1;
+    d->version = version;
+    d->op      = op;
+    d->song_id = song_id;
+    memcpy(d->name, name, name_len);
+    d->name[name_len] = '\0';
+    memcpy(d->old_name, old_name, old_len);
+    d->old_name[old_len] = '\0';
     lv_lock();
-    lv_async_call(async_cb_update_songlist, p);
+    lv_async_call(async_cb_list_delta, d);
     lv_unlock();
 }
 
@@ -1000,8 +1356,9 @@ void ui_songlist_encoder_move_async(int8_t steps)
 static void async_cb_encoder_btn(void *user_data)
 {
     (void)user_data;
-    if (s_focused_idx >= 0 && s_focused_idx < (int16_t)s_song_count) {
-        send_play_song(s_songs[s_focused_idx].id);
+    uint16_t song_id = focused_song_id();
+    if (song_id != 0) {
+        send_play_song(song_id);
     }
 }
 
@@ -1022,17 +1379,17 @@ static void async_cb_song_settings(void *user_data)
     async_song_settings_t *p = (async_song_settings_t *)user_data;
 
     /* Update the cache */
-    uint8_t idx = (uint8_t)(p->song_id - 1);
-    if (p->song_id > 0 && idx < SONGLIST_MAX_SONGS) {
-        s_settings[idx].flags               = p->flags;
-        s_settings[idx].fixed_speed_x100    = p->fixed_speed_x100;
-        s_settings[idx].dimmer_max          = p->dimmer_max;
-        s_settings[idx].dimmer_min          = p->dimmer_min;
-        s_settings[idx].dimmer_rps_ref_x10  = p->dimmer_rps_ref_x10;
-        s_settings[idx].dimmer_holdoff_s    = p->dimmer_holdoff_s;
-        s_settings[idx].dimmer_fadein_s     = p->dimmer_fadein_s;
-        s_settings[idx].pitch_influence_pct = p->pitch_influence_pct;
-        s_settings[idx].valid               = true;
+    song_settings_cache_t *slot = settings_slot(p->song_id);
+    if (slot) {
+        slot->flags               = p->flags;
+        slot->fixed_speed_x100    = p->fixed_speed_x100;
+        slot->dimmer_max          = p->dimmer_max;
+        slot->dimmer_min          = p->dimmer_min;
+        slot->dimmer_rps_ref_x10  = p->dimmer_rps_ref_x10;
+        slot->dimmer_holdoff_s    = p->dimmer_holdoff_s;
+        slot->dimmer_fadein_s     = p->dimmer_fadein_s;
+        slot->pitch_influence_pct = p->pitch_influence_pct;
+        slot->valid               = true;
     }
 
     /* Cache-only update. Never push to the live dialog –
@@ -7,8 +7,17 @@
  * All functions that touch LVGL objects MUST be called with the LVGL lock
  * held, OR via lv_async_call() from any other task / core.
  * The uart_comm layer uses lv_async_call() internally, so the public
- * "bridge" functions (ui_songlist_update_async, ui_songlist_encoder_move_async,
- * ui_songlist_encoder_btn_async) are safe to call directly from the UART task.
+ * "bridge" functions (ui_songlist_page_async, ui_songlist_delta_async,
+ * ui_songlist_encoder_move_async, ...) are safe to call directly from the
+ * UART task.
+ *
+ * Song window
+ * -----------
+ * Only a window of SONGLIST_WINDOW consecutive songs (in the player's name
+ * order) is held and shown; "more" rows at either end page the window
+ * through CMD_LIST_PAGE_REQ.  List deltas from the player are applied to
+ * the window in place.  Song lookups by id or name therefore only see
+ * songs inside the window.
  */
 #pragma once
 
@@ -16,13 +25,35 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include "lvgl.h"
+#include "name_arena.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-/* Maximum songs the list can display at once */
-#define SONGLIST_MAX_SONGS  128
+/* Songs per window: one CMD_LIST_PAGE_REQ, and one list button each. */
+#define SONGLIST_WINDOW     32
+
+/**
+ * A run of consecutive songs: ids[i] is the song-ID of names[i], in list
+ * order.  Names live in a PSRAM name arena, so the batch grows with the
+ * names actually received.  Built on the UART task, then handed to the
+ * LVGL task by ui_songlist_page_async().
+ */
+typedef struct {
+    name_arena_t names;
+    uint16_t    *ids;
+    uint16_t     ids_cap;
+} ui_songlist_batch_t;
+
+/** @brief Allocate an empty batch; NULL when out of memory. */
+ui_songlist_batch_t *ui_songlist_batch_new(void);
+
+/** @brief Append song @p id named by the first @p len bytes of @p name. */
+bool ui_songlist_batch_add(ui_songlist_batch_t *b, uint16_t id, const char *name, size_t len);
+
+/** @brief Release a batch that was not passed to ui_songlist_page_async(). */
+void ui_songlist_batch_free(ui_songlist_batch_t *b);
 
 /* ---------- Lifecycle ----------------------------------------------------- */
 
@@ -47,25 +78,35 @@ void ui_songlist_show_async(void);
 /* ---------- UART-task-safe async bridges ---------------------------------- */
 
 /**
- * @brief Schedule a song-list update from any task / core.
- *
- * @param data  Pointer to a buffer of null-terminated song-name strings,
- *              packed consecutively.  The list is terminated by a double
- *              null (i.e. an empty string "").  Each name is prefixed with
- *              a 2-byte little-endian song-ID.
- *
- *              Wire format per entry:
- *                [song_id_lo : u8][song_id_hi : u8][name : char...]['\0']
- *              Terminator:
- *                [0x00 0x00]  (song_id=0 treated as end-of-list sentinel
- *                              when followed by a zero name byte)
+ * @brief Deliver CMD_LIST_INFO: the player's list version and length.
+ *        Requests the window again when it is not at @p version.
+ */
+void ui_songlist_list_info_async(uint32_t version, uint16_t total);
+
+/**
+ * @brief Deliver a complete CMD_LIST_PAGE reply from any task / core.
  *
- * @param len   Total byte length of the data buffer.
+ * @param batch    Songs at positions @p start onwards.  Ownership passes
+ *                 to the UI, which frees the batch it replaces; the caller
+ *                 must not touch @p batch afterwards.
+ * @param version  List version of the names.
+ * @param total    List length.
+ */
+void ui_songlist_page_async(ui_songlist_batch_t *batch, uint32_t version,
+                            uint16_t total, uint16_t start);
+
+/**
+ * @brief Deliver one CMD_LIST_DELTA from any task / core.  The names are
+ *        copied.
  *
- * The function copies the data internally, so the caller's buffer may be
- * reused immediately after this call returns.
+ * @param version   List version after this change.
+ * @param op        LIST_OP_ADD / LIST_OP_REMOVE / LIST_OP_RENAME.
+ * @param song_id   1-based song id.
+ * @param old_name  RENAME only: the previous name.
  */
-void ui_songlist_update_async(const uint8_t *data, uint16_t len);
+void ui_songlist_delta_async(uint32_t version, uint8_t op, uint16_t song_id,
+                             const char *name, size_t name_len,
+                             const char *old_name, size_t old_len);
 
 /**
  * @brief Schedule an encoder-move event from any task / core.
@@ -146,7 +187,7 @@ bool ui_songlist_get_song_name(uint16_t song_id, char *buf, size_t buf_len);
 /**
  * @brief Return the song ID that follows @p current_id, wrapping at the end.
  *        Must be called from the LVGL task.
- * @return next song_id (> 0), or 0 if the song list is empty.
+ * @return next song_id (> 0), or 0 if it is not in the current window.
  */
 uint16_t ui_songlist_get_next_song_id(uint16_t current_id);
 
@@ -1,15 +1,23 @@
 /* cpu_detect_stub.cpp
  * Non-x86 stub for SoundTouch CPU-extension detection.
- * On Xtensa/ESP32 there are no MMX/SSE extensions; return 0.
+ * Xtensa has no MMX/SSE, but reporting SUPPORT_MMX makes SoundTouch's
+ * FIRFilter::newInstance() / TDStretch::newInstance() pick the "MMX"
+ * subclasses, which st_fir_dsp.cpp implements with esp-dsp instead.
+ * disableExtensions(SUPPORT_MMX) falls back to the generic C routines
+ * for instances created afterwards (used by the benchmark).  The mask is
+ * process-wide: soundtouch_el.cpp only changes it under the lock it also
+ * holds while constructing instances.
  */
 #include "cpu_detect.h"
 
+static uint s_disabled;
+
 uint detectCPUextensions(void)
 {
-    return 0;   /* no x86 SIMD extensions on Xtensa */
+    return SUPPORT_MMX & ~s_disabled;
 }
 
-void disableExtensions(uint /*wDisableMask*/)
+void disableExtensions(uint wDisableMask)
 {
-    /* no-op on Xtensa */
+    s_disabled = wDisableMask;
 }
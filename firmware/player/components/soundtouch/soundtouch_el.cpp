@@ -5,6 +5,11 @@
  * The ADF pipeline carries signed 16-bit interleaved PCM.
  * SoundTouch is compiled with SOUNDTOUCH_INTEGER_SAMPLES=1 so
  * SAMPLETYPE = short (int16_t) – no float conversion needed.
+ *
+ * With cfg.dual_core the element keeps a second, two-core chain (st_dual.h)
+ * next to the SoundTouch facade and uses it whenever pitch influence is 0,
+ * i.e. for pure time-stretch.  Both are cleared together on every influence
+ * change, which is the only point where the element switches between them.
  */
 
 #include "soundtouch_el.h"
@@ -13,10 +18,20 @@
 #include "audio_mem.h"
 #include "audio_error.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 
 #include "SoundTouch.h"
+#include "RateTransposer.h"
+#include "cpu_detect.h"
+#include "st_dual.h"
+
+#include "esp_cpu.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
 
 #include <new>      /* std::nothrow */
+#include <stdio.h>
 #include <string.h>
 #include <math.h>
 
@@ -33,12 +48,87 @@ static constexpr int ST_CHUNK_FRAMES = 16384;
  * Kept smaller than ST_CHUNK_FRAMES to limit stack/buffer pressure. */
 static constexpr int ST_DRAIN_FRAMES = 4096;
 
+/* Frames per ring-buffer write.  The output count is published after each
+ * write, so this bounds how far it can trail a blocked writer (256 frames =
+ * 5.8 ms at 44.1 kHz). */
+static constexpr int ST_OUT_FRAMES = 256;
+
+/* Output -> source map entries, one per ST_OUT_FRAMES write (power of two).
+ * 256 x 256 frames = 1.5 s at 44.1 kHz, more than all downstream buffers. */
+static constexpr uint32_t ST_OUT_HIST = 256;
+
+/* -- Quality profiles / CPU-headroom governor ----------------------------- */
+
+/* Quality ladder, best first.  The first SOUNDTOUCH_PROFILE_COUNT entries
+ * are the user-selectable profiles (level = HIFI - profile); "minimal" is
+ * only ever reached by the governor.  The selected profile is the ceiling
+ * the governor returns to once headroom is back.
+ * AA filter lengths must be multiples of 8 (FIRFilter requirement).
+ * 0 ms for sequence/seek = SoundTouch auto-tune.
+ * The interpolator is fixed when the SoundTouch instance is created, so it
+ * follows the selected profile only; governor steps never change it. */
+struct StQualityLevel {
+    const char *name;
+    int  aa_len;       /* AA filter taps (only used while rate != 1)  */
+    int  sequence_ms;  /* TDStretch sequence length, 0 = auto         */
+    int  seek_ms;      /* overlap-offset search window, 0 = auto      */
+    int  overlap_ms;   /* crossfade length between sequences          */
+    bool quickseek;    /* coarse-to-fine offset search instead of full scan */
+    soundtouch::TransposerBase::ALGORITHM interp; /* rate-transposer interpolator */
+};
+
+static const StQualityLevel ST_LEVELS[] = {
+    { "hifi",     64,  0,  0, 8, false, soundtouch::TransposerBase::CUBIC  },
+    { "balanced", 32,  0,  0, 8, true,  soundtouch::TransposerBase::CUBIC  },
+    { "eco",      16, 60, 15, 6, true,  soundtouch::TransposerBase::LINEAR },
+    { "minimal",   8, 50, 10, 4, true,  soundtouch::TransposerBase::LINEAR },
+};
+static constexpr int ST_NUM_LEVELS = sizeof(ST_LEVELS) / sizeof(ST_LEVELS[0]);
+static_assert(ST_NUM_LEVELS > SOUNDTOUCH_PROFILE_HIFI, "every profile needs a ladder entry");
+
+static inline int level_of_profile(int profile)
+{
+    return SOUNDTOUCH_PROFILE_HIFI - profile;
+}
+
+/* Benchmark: seconds of synthetic audio pushed through each profile. */
+static constexpr int BENCH_SECONDS = 4;
+
+/* Load = SoundTouch processing time / real-time duration of the chunk.
+ * Smoothed with an EMA so a single pre-empted chunk does not trigger a step. */
+static constexpr float   GOV_EMA_ALPHA     = 0.3f;
+static constexpr float   GOV_LOAD_HIGH     = 0.70f;     /* step down above this        */
+static constexpr float   GOV_LOAD_LOW      = 0.35f;     /* step up below this          */
+static constexpr int64_t GOV_DOWN_HOLD_US  = 500000;    /* min time between down steps */
+static constexpr int64_t GOV_UP_HOLD_US    = 5000000;   /* min time before stepping up */
+
+struct StGovernor {
+    int     level;                    /* index into ST_LEVELS               */
+    int     ceiling;                  /* best level allowed (= profile)     */
+    bool    primed;                   /* load_ema holds a valid value       */
+    float   load_ema;                 /* smoothed load, 1.0 = no headroom   */
+    int64_t level_since_us;           /* esp_timer time of last switch      */
+    int64_t dwell_us[ST_NUM_LEVELS];  /* accumulated time spent per level   */
+};
+
 /* -- Internal context ------------------------------------------------------ */
 
+/** Start of one output write: output sample count, source sample index and
+ *  source samples per output sample (the tempo it was stretched at). */
+struct StOutMark {
+    uint32_t out;
+    uint32_t src;
+    float    src_per_out;
+};
+
 struct StCtx {
     soundtouch::SoundTouch *st;
+    StDualChain   *dual;           /* nullptr unless cfg.dual_core              */
+    int64_t        dual_since_us;  /* start of the current per-core load window */
     int            samplerate;
     int            channels;
+    int            task_core;      /* element task core / priority, for the     */
+    int            task_prio;      /* dual-core worker                          */
     volatile float target_tempo;   /* written by any task, read by element task */
     float          applied_tempo;  /* last value actually sent to SoundTouch    */
     volatile bool  bypass;         /* true = passthrough, no SoundTouch         */
@@ -47,6 +137,32 @@ struct StCtx {
     volatile float pitch_influence;         /* 0.0 = time-stretch, 1.0 = tape effect  */
     float          applied_pitch_influence; /* last value applied to SoundTouch        */
 
+    volatile int   target_profile; /* soundtouch_profile_t, written by any task */
+    int            applied_profile;
+    StGovernor     gov;            /* only touched by the element task          */
+
+    /* Analysis tap: written by the element task, read by any number of
+     * other tasks (readers change nothing, they only validate).
+     * Indices are source sample indices (wrapping uint32).  tap_claim is
+     * advanced before a write and tap_head after it, so a reader can tell
+     * whether the slots it copied were touched; tap_seq is odd while a
+     * rebase is in progress. */
+    int16_t          *tap;              /* nullptr = tap disabled           */
+    uint32_t          tap_len;          /* samples, power of two            */
+    uint32_t          tap_base;         /* oldest valid index after a rebase */
+    uint32_t          tap_head;         /* one past the newest sample       */
+    uint32_t          tap_claim;        /* one past the newest slot in use  */
+    uint32_t          tap_seq;
+    volatile uint32_t tap_next_base;    /* from soundtouch_el_tap_set_base() */
+    volatile bool     tap_rebase;
+    /* Output -> source map (see soundtouch_el_tap_out_src()); written by
+     * the element task, read like the tap. */
+    StOutMark         out_hist[ST_OUT_HIST];
+    uint32_t          out_hist_n;       /* marks written (wrapping)          */
+    uint32_t          out_hist_floor;   /* first mark after the last rebase  */
+    uint32_t          out_written;      /* samples written downstream        */
+    double            out_src;          /* source index of the next output   */
+
     /* int16 buffers - interface to ADF ring buffers and SoundTouch        */
     int16_t *pcm_in;   /* ST_CHUNK_FRAMES x channels                       */
     int16_t *pcm_out;  /* ST_DRAIN_FRAMES x channels                       */
@@ -59,32 +175,285 @@ static inline StCtx *ctx_of(audio_element_handle_t self)
     return static_cast<StCtx *>(audio_element_getdata(self));
 }
 
+/** The two-core chain only handles rate == 1.0, so any pitch influence
+ *  runs through the facade. */
+static inline bool dual_active(const StCtx *ctx)
+{
+    return ctx->dual && ctx->applied_pitch_influence == 0.0f;
+}
+
+static void st_clear(StCtx *ctx)
+{
+    ctx->st->clear();
+    if (ctx->dual) ctx->dual->clear();
+}
+
+/** Write @p frames output frames downstream in ST_OUT_FRAMES pieces, each
+ *  standing for @p src_per_frame source frames per output frame, and record
+ *  where each piece came from in the source. */
+static void emit(audio_element_handle_t self, StCtx *ctx, int16_t *pcm,
+                 int frames, double src_per_frame)
+{
+    while (frames > 0) {
+        int      n       = frames < ST_OUT_FRAMES ? frames : ST_OUT_FRAMES;
+        uint32_t samples = (uint32_t)(n * ctx->channels);
+        if (ctx->tap) {
+            uint32_t   i = ctx->out_hist_n;
+            StOutMark &m = ctx->out_hist[i & (ST_OUT_HIST - 1)];
+            m.out         = ctx->out_written;
+            m.src         = (uint32_t)(uint64_t)ctx->out_src;
+            m.src_per_out = (float)src_per_frame;
+            __atomic_store_n(&ctx->out_hist_n, i + 1, __ATOMIC_RELEASE);
+        }
+        audio_element_output(self, reinterpret_cast<char *>(pcm),
+                             (int)samples * (int)sizeof(int16_t));
+        if (ctx->tap) {
+            ctx->out_src += (double)samples * src_per_frame;
+            __atomic_store_n(&ctx->out_written, ctx->out_written + samples, __ATOMIC_RELEASE);
+        }
+        pcm    += samples;
+        frames -= n;
+    }
+}
+
 /** Receive all frames currently available in SoundTouch and write to the
  *  downstream ring buffer.  SAMPLETYPE = short so pcm_out is used directly. */
 static void drain(audio_element_handle_t self, StCtx *ctx)
 {
+    bool dual = dual_active(ctx);
     uint frames;
     do {
-        frames = ctx->st->receiveSamples(ctx->pcm_out, (uint)ST_DRAIN_FRAMES);
-        if (frames > 0) {
-            audio_element_output(self,
-                                 reinterpret_cast<char *>(ctx->pcm_out),
-                                 (int)(frames * (uint)ctx->channels) * (int)sizeof(int16_t));
-        }
+        frames = dual ? ctx->dual->receiveSamples(ctx->pcm_out, (uint)ST_DRAIN_FRAMES)
+                      : ctx->st->receiveSamples(ctx->pcm_out, (uint)ST_DRAIN_FRAMES);
+        /* Each output frame stands for applied_tempo source frames whether
+         * the tempo comes from TDStretch or from the rate transposer. */
+        if (frames > 0) emit(self, ctx, ctx->pcm_out, (int)frames, (double)ctx->applied_tempo);
     } while (frames > 0);
 }
 
+/** Append @p samples interleaved samples to the analysis tap. */
+static void tap_write(StCtx *ctx, const int16_t *pcm, uint32_t samples)
+{
+    if (!ctx->tap || samples == 0) return;
+    uint32_t end  = ctx->tap_head + samples;
+    uint32_t head = ctx->tap_head;
+    if (samples > ctx->tap_len) {
+        /* Only the newest tap_len samples fit; the rest still count. */
+        pcm     += samples - ctx->tap_len;
+        head     = end - ctx->tap_len;
+        samples  = ctx->tap_len;
+    }
+    __atomic_store_n(&ctx->tap_claim, end, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    uint32_t pos   = head & (ctx->tap_len - 1);
+    uint32_t first = ctx->tap_len - pos;
+    if (first > samples) first = samples;
+    memcpy(ctx->tap + pos, pcm, first * sizeof(int16_t));
+    memcpy(ctx->tap, pcm + first, (samples - first) * sizeof(int16_t));
+
+    __atomic_store_n(&ctx->tap_head, end, __ATOMIC_RELEASE);
+}
+
+/** Apply a pending soundtouch_el_tap_set_base(); element task only. */
+static void tap_apply_base(StCtx *ctx)
+{
+    if (!ctx->tap || !ctx->tap_rebase) return;
+    ctx->tap_rebase = false;
+    uint32_t base = ctx->tap_next_base;
+    __atomic_store_n(&ctx->tap_seq, ctx->tap_seq + 1, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    __atomic_store_n(&ctx->tap_base,  base, __ATOMIC_RELEASE);
+    __atomic_store_n(&ctx->tap_claim, base, __ATOMIC_RELEASE);
+    __atomic_store_n(&ctx->tap_head,  base, __ATOMIC_RELEASE);
+    __atomic_store_n(&ctx->out_hist_floor, ctx->out_hist_n, __ATOMIC_RELEASE);
+    ctx->out_src = (double)base;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    __atomic_store_n(&ctx->tap_seq, ctx->tap_seq + 1, __ATOMIC_RELEASE);
+}
+
+/** Push the settings of quality level @p level into SoundTouch (or the
+ *  two-core chain, which mirrors setSetting()).
+ *  Safe between chunks: TDStretch recalculates its buffers in place. */
+template <typename Engine>
+static void apply_level(Engine *st, int level)
+{
+    const StQualityLevel &q = ST_LEVELS[level];
+    st->setSetting(SETTING_AA_FILTER_LENGTH, q.aa_len);
+    st->setSetting(SETTING_USE_QUICKSEEK,    q.quickseek ? 1 : 0);
+    st->setSetting(SETTING_SEQUENCE_MS,      q.sequence_ms);
+    st->setSetting(SETTING_SEEKWINDOW_MS,    q.seek_ms);
+    st->setSetting(SETTING_OVERLAP_MS,       q.overlap_ms);
+}
+
+/** Serialises the process-wide interpolator and filter-backend selections
+ *  with the constructors that read them.  The element task (profile
+ *  switch), the benchmarks (in the caller's task) and soundtouch_el_init()
+ *  all build instances, possibly at the same time. */
+static SemaphoreHandle_t ctor_lock(void)
+{
+    static SemaphoreHandle_t lock = xSemaphoreCreateMutex();   /* first caller creates it */
+    return lock;
+}
+
+/** Create a SoundTouch instance configured for quality level @p level.
+ *  TransposerBase::setAlgorithm() and disableExtensions() are global, so they
+ *  are set and consumed under ctor_lock().  @p generic_fir builds the instance
+ *  with SoundTouch's C filter instead of esp-dsp (benchmark only). */
+static soundtouch::SoundTouch *st_create(int samplerate, int channels, int level,
+                                         bool generic_fir = false)
+{
+    xSemaphoreTake(ctor_lock(), portMAX_DELAY);
+    soundtouch::TransposerBase::setAlgorithm(ST_LEVELS[level].interp);
+    if (generic_fir) disableExtensions(SUPPORT_MMX);
+    soundtouch::SoundTouch *st = new(std::nothrow) soundtouch::SoundTouch();
+    if (generic_fir) disableExtensions(0);
+    xSemaphoreGive(ctor_lock());
+    if (!st) return nullptr;
+    st->setSampleRate((uint)samplerate);
+    st->setChannels((uint)channels);
+    st->setSetting(SETTING_USE_AA_FILTER, 1);
+    apply_level(st, level);
+    return st;
+}
+
+/** Two-core counterpart of st_create().  The worker runs on the core the
+ *  element task is not pinned to, at the same priority. */
+static StDualChain *dual_create(int samplerate, int channels, int level,
+                                int task_core, int task_prio)
+{
+    xSemaphoreTake(ctor_lock(), portMAX_DELAY);   /* create() sets the interpolator too */
+    StDualChain *d = StDualChain::create(samplerate, channels, ST_LEVELS[level].interp,
+                                         task_core == 0 ? 1 : 0, task_prio);
+    xSemaphoreGive(ctor_lock());
+    if (!d) return nullptr;
+    d->setSetting(SETTING_USE_AA_FILTER, 1);
+    apply_level(d, level);
+    return d;
+}
+
+/** Log the CPU share of each core since the last call (dual-core mode). */
+static void dual_log_load(StCtx *ctx, int64_t now)
+{
+    if (!ctx->dual) return;
+    uint64_t worker, caller;
+    ctx->dual->takeCycles(&worker, &caller);
+    double window = (double)(now - ctx->dual_since_us) * CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+    ctx->dual_since_us = now;
+    if (window <= 0.0 || (worker == 0 && caller == 0)) return;
+    ESP_LOGI(TAG, "Dual-core load: element core %.1f%%, worker core %.1f%%",
+             100.0 * (double)caller / window, 100.0 * (double)worker / window);
+}
+
+/** Close the dwell interval of the current level and log the totals. */
+static void governor_log_dwell(StCtx *ctx, int64_t now)
+{
+    StGovernor &g = ctx->gov;
+    g.dwell_us[g.level] += now - g.level_since_us;
+    g.level_since_us = now;
+    char line[128];
+    int  n = 0;
+    for (int i = 0; i < ST_NUM_LEVELS && n < (int)sizeof(line); i++) {
+        n += snprintf(line + n, sizeof(line) - n, " %s=%.1fs",
+                      ST_LEVELS[i].name, (double)g.dwell_us[i] / 1e6);
+    }
+    ESP_LOGI(TAG, "Governor dwell:%s", line);
+}
+
+/** Feed one chunk's processing time into the governor and switch quality
+ *  level when the smoothed load leaves the [LOW, HIGH] band. */
+static void governor_update(StCtx *ctx, int64_t busy_us, int frames, int64_t now)
+{
+    StGovernor &g = ctx->gov;
+    float budget_us = (float)frames * 1e6f / (float)ctx->samplerate;
+    if (budget_us <= 0.0f) return;
+
+    float load = (float)busy_us / budget_us;
+    if (!g.primed) {
+        g.load_ema = load;
+        g.primed   = true;
+    } else {
+        g.load_ema += GOV_EMA_ALPHA * (load - g.load_ema);
+    }
+
+    int64_t held = now - g.level_since_us;
+    int next = g.level;
+    if (g.load_ema > GOV_LOAD_HIGH && g.level < ST_NUM_LEVELS - 1 && held >= GOV_DOWN_HOLD_US) {
+        next = g.level + 1;
+    } else if (g.load_ema < GOV_LOAD_LOW && g.level > g.ceiling && held >= GOV_UP_HOLD_US) {
+        next = g.level - 1;
+    }
+    if (next == g.level) return;
+
+    ESP_LOGI(TAG, "Governor: %s -> %s  (load %.0f%%, last chunk %.0f%%)",
+             ST_LEVELS[g.level].name, ST_LEVELS[next].name,
+             (double)(g.load_ema * 100.0f), (double)(load * 100.0f));
+    governor_log_dwell(ctx, now);
+    g.level = next;
+    apply_level(ctx->st, next);
+    if (ctx->dual) apply_level(ctx->dual, next);
+}
+
+/** Switch to the requested profile.  The instance is rebuilt only when the
+ *  interpolator differs; otherwise the settings are changed in place. */
+static bool switch_profile(StCtx *ctx, int profile)
+{
+    int level = level_of_profile(profile);
+    int built = level_of_profile(ctx->applied_profile);   /* level the instance was created for */
+    if (ST_LEVELS[level].interp != ST_LEVELS[built].interp) {
+        soundtouch::SoundTouch *st = st_create(ctx->samplerate, ctx->channels, level);
+        if (!st) {
+            ESP_LOGE(TAG, "OOM switching to profile %s", ST_LEVELS[level].name);
+            return false;
+        }
+        StDualChain *dual = nullptr;
+        if (ctx->dual) {
+            dual = dual_create(ctx->samplerate, ctx->channels, level,
+                               ctx->task_core, ctx->task_prio);
+            if (!dual) {
+                ESP_LOGE(TAG, "OOM switching to profile %s", ST_LEVELS[level].name);
+                delete st;
+                return false;
+            }
+            delete ctx->dual;
+            ctx->dual = dual;
+        }
+        delete ctx->st;
+        ctx->st = st;
+        ctx->applied_tempo = 0.0f;   /* force rate/tempo to be re-applied */
+    } else {
+        apply_level(ctx->st, level);
+        if (ctx->dual) apply_level(ctx->dual, level);
+    }
+    ESP_LOGI(TAG, "Profile: %s", ST_LEVELS[level].name);
+    governor_log_dwell(ctx, esp_timer_get_time());
+    ctx->gov.level   = level;
+    ctx->gov.ceiling = level;
+    ctx->gov.primed  = false;
+    return true;
+}
+
 /* -- ADF element callbacks ------------------------------------------------- */
 
 static esp_err_t _open(audio_element_handle_t self)
 {
-    ctx_of(self)->st->clear();
+    StCtx *ctx = ctx_of(self);
+    st_clear(ctx);
+    tap_apply_base(ctx);
+    /* Keep the current level across tracks, but re-seed the load estimate. */
+    ctx->gov.primed = false;
+    if (ctx->dual) {
+        ctx->dual->takeCycles(nullptr, nullptr);
+        ctx->dual_since_us = esp_timer_get_time();
+    }
     return ESP_OK;
 }
 
 static esp_err_t _close(audio_element_handle_t self)
 {
-    (void)self;
+    int64_t now = esp_timer_get_time();
+    governor_log_dwell(ctx_of(self), now);
+    dual_log_load(ctx_of(self), now);
     return ESP_OK;
 }
 
@@ -98,7 +467,7 @@ static audio_element_err_t _process(audio_element_handle_t self,
     if (cur_bypass != ctx->prev_bypass) {
         if (!cur_bypass) {
             /* Leaving bypass: clear SoundTouch to avoid stale lookahead data. */
-            ctx->st->clear();
+            st_clear(ctx);
         }
         ctx->prev_bypass = cur_bypass;
     }
@@ -110,13 +479,19 @@ static audio_element_err_t _process(audio_element_handle_t self,
                                            reinterpret_cast<char *>(ctx->pcm_in),
                                            rb_bytes);
         if (bytes_in > 0) {
-            audio_element_output(self,
-                                 reinterpret_cast<char *>(ctx->pcm_in),
-                                 bytes_in);
+            tap_write(ctx, ctx->pcm_in, (uint32_t)bytes_in / sizeof(int16_t));
+            emit(self, ctx, ctx->pcm_in,
+                 bytes_in / (ctx->channels * (int)sizeof(int16_t)), 1.0);
         }
         return static_cast<audio_element_err_t>(bytes_in);
     }
 
+    /* Apply a pending profile change first: it may rebuild the instance. */
+    int profile = ctx->target_profile;
+    if (profile != ctx->applied_profile) {
+        if (switch_profile(ctx, profile)) ctx->applied_profile = profile;
+    }
+
     /* Apply any pending tempo / rate change before processing this chunk. */
     float tgt   = ctx->target_tempo;
     float alpha = ctx->pitch_influence;
@@ -124,7 +499,7 @@ static audio_element_err_t _process(audio_element_handle_t self,
     bool changed = (tgt != ctx->applied_tempo || alpha != ctx->applied_pitch_influence);
     if (changed) {
         if (alpha != ctx->applied_pitch_influence) {
-            ctx->st->clear(); /* flush lookahead on influence change */
+            st_clear(ctx); /* flush lookahead on influence change */
             ctx->applied_pitch_influence = alpha;
         }
         ctx->applied_tempo = tgt;
@@ -132,7 +507,9 @@ static audio_element_err_t _process(audio_element_handle_t self,
         float tempo = powf(tgt, 1.0f - alpha);
         ctx->st->setRate((double)rate);
         ctx->st->setTempo((double)tempo);
+        if (ctx->dual) ctx->dual->setTempo((double)tempo);
     }
+    bool dual = dual_active(ctx);
 
     /* Pull one chunk of int16 PCM from the upstream ring buffer. */
     int rb_bytes = ST_CHUNK_FRAMES * ctx->channels * (int)sizeof(int16_t);
@@ -142,15 +519,25 @@ static audio_element_err_t _process(audio_element_handle_t self,
     if (bytes_in <= 0) {
         if (bytes_in == AEL_IO_DONE) {
             /* Flush SoundTouch's internal lookahead and emit remaining frames. */
-            ctx->st->flush();
+            if (dual) ctx->dual->flush(); else ctx->st->flush();
             drain(self, ctx);
         }
         return static_cast<audio_element_err_t>(bytes_in);
     }
 
+    tap_write(ctx, ctx->pcm_in, (uint32_t)bytes_in / sizeof(int16_t));
+
     /* Feed int16 PCM directly to SoundTouch (SAMPLETYPE = short). */
     int frames_in = bytes_in / (ctx->channels * (int)sizeof(int16_t));
-    ctx->st->putSamples(ctx->pcm_in, (uint)frames_in);
+    /* All rate-transposing and TDStretch work happens inside putSamples();
+     * drain() only copies and may block on the downstream ring buffer, so
+     * it is deliberately left out of the governor's measurement.  In
+     * dual-core mode this is the wall time of the overlapped pipeline. */
+    int64_t t0 = esp_timer_get_time();
+    if (dual) ctx->dual->putSamples(ctx->pcm_in, (uint)frames_in);
+    else      ctx->st->putSamples(ctx->pcm_in, (uint)frames_in);
+    int64_t t1 = esp_timer_get_time();
+    governor_update(ctx, t1 - t0, frames_in, t1);
 
     /* Drain all available output. */
     drain(self, ctx);
@@ -162,9 +549,11 @@ static esp_err_t _destroy(audio_element_handle_t self)
 {
     StCtx *ctx = ctx_of(self);
     if (ctx) {
+        delete ctx->dual;
         delete ctx->st;
         audio_free(ctx->pcm_in);
         audio_free(ctx->pcm_out);
+        audio_free(ctx->tap);
         audio_free(ctx);
     }
     return ESP_OK;
@@ -190,6 +579,263 @@ esp_err_t soundtouch_el_set_bypass(audio_element_handle_t self, bool bypass)
     return ESP_OK;
 }
 
+esp_err_t soundtouch_el_set_profile(audio_element_handle_t self, soundtouch_profile_t profile)
+{
+    StCtx *ctx = ctx_of(self);
+    if (!ctx || profile < 0 || profile >= SOUNDTOUCH_PROFILE_COUNT) return ESP_ERR_INVALID_ARG;
+    ctx->target_profile = (int)profile;
+    return ESP_OK;
+}
+
+esp_err_t soundtouch_el_tap_set_base(audio_element_handle_t self, uint32_t sample_index)
+{
+    StCtx *ctx = ctx_of(self);
+    if (!ctx) return ESP_ERR_INVALID_ARG;
+    if (!ctx->tap) return ESP_ERR_INVALID_STATE;
+    ctx->tap_next_base = sample_index;
+    __atomic_store_n(&ctx->tap_rebase, true, __ATOMIC_RELEASE);
+    return ESP_OK;
+}
+
+bool soundtouch_el_tap_read(audio_element_handle_t self, uint32_t first,
+                            int16_t *dst, size_t count)
+{
+    StCtx *ctx = ctx_of(self);
+    if (!ctx || !ctx->tap || !dst || count == 0 || count > ctx->tap_len) return false;
+
+    uint32_t seq = __atomic_load_n(&ctx->tap_seq, __ATOMIC_ACQUIRE);
+    if (seq & 1u) return false;
+    uint32_t base = __atomic_load_n(&ctx->tap_base, __ATOMIC_ACQUIRE);
+    uint32_t head = __atomic_load_n(&ctx->tap_head, __ATOMIC_ACQUIRE);
+    uint32_t end  = first + (uint32_t)count;
+    /* Wrap-safe: [first, end) must lie inside [base, head) and within
+     * tap_len of the newest slot in use. */
+    if ((int32_t)(first - base) < 0 || (int32_t)(head - end) < 0) return false;
+    if (head - first > ctx->tap_len) return false;
+
+    uint32_t pos  = first & (ctx->tap_len - 1);
+    uint32_t part = ctx->tap_len - pos;
+    if (part > (uint32_t)count) part = (uint32_t)count;
+    memcpy(dst, ctx->tap + pos, part * sizeof(int16_t));
+    memcpy(dst + part, ctx->tap, (count - part) * sizeof(int16_t));
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    uint32_t claim = __atomic_load_n(&ctx->tap_claim, __ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&ctx->tap_seq, __ATOMIC_ACQUIRE) != seq) return false;
+    return claim - first <= ctx->tap_len;
+}
+
+uint32_t soundtouch_el_tap_head(audio_element_handle_t self)
+{
+    StCtx *ctx = ctx_of(self);
+    if (!ctx || !ctx->tap) return 0;
+    return __atomic_load_n(&ctx->tap_head, __ATOMIC_ACQUIRE);
+}
+
+bool soundtouch_el_tap_out_src(audio_element_handle_t self, uint32_t back,
+                               uint32_t *src_index)
+{
+    StCtx *ctx = ctx_of(self);
+    if (!ctx || !ctx->tap || !src_index) return false;
+
+    uint32_t n       = __atomic_load_n(&ctx->out_hist_n, __ATOMIC_ACQUIRE);
+    uint32_t floor   = __atomic_load_n(&ctx->out_hist_floor, __ATOMIC_ACQUIRE);
+    uint32_t written = __atomic_load_n(&ctx->out_written, __ATOMIC_ACQUIRE);
+    uint32_t target  = written - back;
+
+    /* Newest mark at or before the target; stay clear of the slots the
+     * writer is about to reuse. */
+    uint32_t depth = n - floor;
+    if (depth > ST_OUT_HIST - 8) depth = ST_OUT_HIST - 8;
+    for (uint32_t k = 1; k <= depth; k++) {
+        StOutMark m = ctx->out_hist[(n - k) & (ST_OUT_HIST - 1)];
+        if ((int32_t)(target - m.out) < 0) continue;
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&ctx->out_hist_n, __ATOMIC_ACQUIRE) - (n - k) > ST_OUT_HIST) {
+            return false;   /* slot reused while copying */
+        }
+        *src_index = m.src + (uint32_t)((float)(target - m.out) * m.src_per_out);
+        return true;
+    }
+    return false;   /* before the first sample of this stream */
+}
+
+const char *soundtouch_profile_name(soundtouch_profile_t profile)
+{
+    if (profile < 0 || profile >= SOUNDTOUCH_PROFILE_COUNT) return "?";
+    return ST_LEVELS[level_of_profile(profile)].name;
+}
+
+/** Two-tone test signal with a little pseudo-random noise so the
+ *  cross-correlation search has something realistic to chew on. */
+static void bench_signal(int16_t *buf, int frames, int samplerate, int channels)
+{
+    uint32_t lfsr = 0xACE1u;
+    for (int i = 0; i < frames; i++) {
+        float t = (float)i / (float)samplerate;
+        lfsr = lfsr * 1664525u + 1013904223u;
+        float v = 0.4f * sinf(2.0f * (float)M_PI * 110.0f * t)
+                + 0.2f * sinf(2.0f * (float)M_PI * 1320.0f * t)
+                + 0.05f * ((float)(int16_t)(lfsr >> 16) / 32768.0f);
+        for (int c = 0; c < channels; c++) {
+            buf[i * channels + c] = (int16_t)(v * 32767.0f);
+        }
+    }
+}
+
+/** FNV-1a over a block of samples, for the single/dual identity check. */
+static uint32_t fnv1a(uint32_t h, const int16_t *p, size_t n)
+{
+    const uint8_t *b = reinterpret_cast<const uint8_t *>(p);
+    for (size_t i = 0; i < n * sizeof(int16_t); i++) {
+        h = (h ^ b[i]) * 16777619u;
+    }
+    return h;
+}
+
+esp_err_t soundtouch_el_benchmark(int samplerate, int channels, float speed,
+                                  float pitch_influence,
+                                  uint32_t cycles_per_s[SOUNDTOUCH_PROFILE_COUNT],
+                                  uint32_t generic_cycles_per_s[SOUNDTOUCH_PROFILE_COUNT])
+{
+    if (samplerate <= 0 || channels < 1 || channels > 2 || speed <= 0.0f || !cycles_per_s) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int16_t *in  = static_cast<int16_t *>(audio_calloc(ST_DRAIN_FRAMES * channels, sizeof(int16_t)));
+    int16_t *out = static_cast<int16_t *>(audio_calloc(ST_DRAIN_FRAMES * channels, sizeof(int16_t)));
+    if (!in || !out) {
+        audio_free(in);
+        audio_free(out);
+        return ESP_ERR_NO_MEM;
+    }
+
+    bench_signal(in, ST_DRAIN_FRAMES, samplerate, channels);
+
+    if (pitch_influence < 0.0f) pitch_influence = 0.0f;
+    else if (pitch_influence > 1.0f) pitch_influence = 1.0f;
+    int total_frames = BENCH_SECONDS * samplerate;
+    esp_err_t ret = ESP_OK;
+
+    /* Pass 0 uses the esp-dsp filter classes, pass 1 (optional) the generic
+     * C routines.  The filter implementation is picked when an instance is
+     * constructed, and st_create() holds ctor_lock() while the extensions are
+     * off, so instances built elsewhere meanwhile keep esp-dsp. */
+    for (int pass = 0; pass < (generic_cycles_per_s ? 2 : 1) && ret == ESP_OK; pass++) {
+        uint32_t *result = pass ? generic_cycles_per_s : cycles_per_s;
+        for (int p = 0; p < SOUNDTOUCH_PROFILE_COUNT; p++) {
+            soundtouch::SoundTouch *st = st_create(samplerate, channels, level_of_profile(p), pass != 0);
+            if (!st) { ret = ESP_ERR_NO_MEM; break; }
+            st->setRate((double)powf(speed, pitch_influence));
+            st->setTempo((double)powf(speed, 1.0f - pitch_influence));
+
+            uint64_t busy = 0;
+            for (int fed = 0; fed < total_frames; fed += ST_DRAIN_FRAMES) {
+                uint32_t c0 = esp_cpu_get_cycle_count();
+                st->putSamples(in, (uint)ST_DRAIN_FRAMES);
+                busy += esp_cpu_get_cycle_count() - c0;
+                while (st->receiveSamples(out, (uint)ST_DRAIN_FRAMES) > 0) {}
+            }
+            delete st;
+
+            result[p] = (uint32_t)(busy / BENCH_SECONDS);
+            ESP_LOGI(TAG, "Benchmark %-8s speed=%.2f infl=%.0f%% %s: %lu cycles per audio second",
+                     soundtouch_profile_name((soundtouch_profile_t)p), (double)speed,
+                     (double)(pitch_influence * 100.0f), pass ? "generic" : "esp-dsp",
+                     (unsigned long)result[p]);
+        }
+    }
+
+    audio_free(in);
+    audio_free(out);
+    return ret;
+}
+
+esp_err_t soundtouch_el_benchmark_dual(int samplerate, int channels, float speed,
+                                       soundtouch_profile_t profile,
+                                       soundtouch_dual_bench_t *out)
+{
+    if (samplerate <= 0 || channels < 1 || channels > 2 || speed <= 0.0f || !out ||
+        profile < 0 || profile >= SOUNDTOUCH_PROFILE_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(out, 0, sizeof(*out));
+
+    /* Element-sized chunks, so the pipeline fill/drain share is realistic. */
+    int16_t *in  = static_cast<int16_t *>(audio_calloc(ST_CHUNK_FRAMES * channels, sizeof(int16_t)));
+    int16_t *buf = static_cast<int16_t *>(audio_calloc(ST_DRAIN_FRAMES * channels, sizeof(int16_t)));
+    int level = level_of_profile(profile);
+    int core  = esp_cpu_get_core_id();
+    soundtouch::SoundTouch *st = st_create(samplerate, channels, level);
+    StDualChain *dual = dual_create(samplerate, channels, level, core,
+                                    (int)uxTaskPriorityGet(NULL));
+    if (!in || !buf || !st || !dual) {
+        audio_free(in);
+        audio_free(buf);
+        delete st;
+        delete dual;
+        return ESP_ERR_NO_MEM;
+    }
+    bench_signal(in, ST_CHUNK_FRAMES, samplerate, channels);
+    st->setTempo((double)speed);
+    dual->setTempo((double)speed);
+
+    int total_frames = BENCH_SECONDS * samplerate;
+    uint32_t h_single = 2166136261u, h_dual = 2166136261u;
+    size_t   n_single = 0, n_dual = 0;
+    uint64_t single_cycles = 0, worker_cycles = 0, caller_cycles = 0;
+
+    for (int fed = 0; fed < total_frames; fed += ST_CHUNK_FRAMES) {
+        uint32_t c0 = esp_cpu_get_cycle_count();
+        st->putSamples(in, (uint)ST_CHUNK_FRAMES);
+        single_cycles += esp_cpu_get_cycle_count() - c0;
+        uint n;
+        while ((n = st->receiveSamples(buf, (uint)ST_DRAIN_FRAMES)) > 0) {
+            h_single = fnv1a(h_single, buf, n * channels);
+            n_single += n;
+        }
+
+        dual->putSamples(in, (uint)ST_CHUNK_FRAMES);
+        while ((n = dual->receiveSamples(buf, (uint)ST_DRAIN_FRAMES)) > 0) {
+            h_dual = fnv1a(h_dual, buf, n * channels);
+            n_dual += n;
+        }
+    }
+    dual->takeCycles(&worker_cycles, &caller_cycles);
+
+    /* The tail matters too: flush() pads and trims in both paths. */
+    uint n;
+    st->flush();
+    while ((n = st->receiveSamples(buf, (uint)ST_DRAIN_FRAMES)) > 0) {
+        h_single = fnv1a(h_single, buf, n * channels);
+        n_single += n;
+    }
+    dual->flush();
+    while ((n = dual->receiveSamples(buf, (uint)ST_DRAIN_FRAMES)) > 0) {
+        h_dual = fnv1a(h_dual, buf, n * channels);
+        n_dual += n;
+    }
+
+    delete st;
+    delete dual;
+    audio_free(in);
+    audio_free(buf);
+
+    out->single_cycles_per_s = (uint32_t)(single_cycles / BENCH_SECONDS);
+    out->dual_caller_cycles_per_s = (uint32_t)(caller_cycles / BENCH_SECONDS);
+    out->dual_worker_cycles_per_s = (uint32_t)(worker_cycles / BENCH_SECONDS);
+    out->identical = (h_single == h_dual && n_single == n_dual);
+    ESP_LOGI(TAG, "Dual benchmark %s speed=%.2f: single %lu, dual caller %lu + worker %lu cycles/s, "
+             "output %s (%u vs %u frames)",
+             ST_LEVELS[level].name, (double)speed,
+             (unsigned long)out->single_cycles_per_s,
+             (unsigned long)out->dual_caller_cycles_per_s,
+             (unsigned long)out->dual_worker_cycles_per_s,
+             out->identical ? "identical" : "DIFFERS",
+             (unsigned)n_single, (unsigned)n_dual);
+    return ESP_OK;
+}
+
 esp_err_t soundtouch_el_set_pitch_influence(audio_element_handle_t self, float pitch_influence)
 {
     StCtx *ctx = ctx_of(self);
@@ -207,12 +853,19 @@ audio_element_handle_t soundtouch_el_init(const soundtouch_el_cfg_t *cfg)
 
     ctx->samplerate    = cfg->samplerate;
     ctx->channels      = cfg->channels;
+    ctx->task_core     = cfg->task_core;
+    ctx->task_prio     = cfg->task_prio;
     ctx->applied_tempo      = cfg->tempo;
     ctx->target_tempo       = cfg->tempo;
     ctx->bypass             = false;
     ctx->prev_bypass        = false;
     ctx->pitch_influence         = 0.0f;
     ctx->applied_pitch_influence = 0.0f;
+    ctx->target_profile          = (cfg->profile >= 0 && cfg->profile < SOUNDTOUCH_PROFILE_COUNT)
+                                   ? (int)cfg->profile : (int)SOUNDTOUCH_PROFILE_BALANCED;
+    ctx->applied_profile         = ctx->target_profile;
+    ctx->gov.level               = level_of_profile(ctx->target_profile);
+    ctx->gov.ceiling             = ctx->gov.level;
 
     /* int16 PCM buffers (may live in PSRAM via audio_calloc). */
     ctx->pcm_in  = static_cast<int16_t *>(
@@ -225,24 +878,38 @@ audio_element_handle_t soundtouch_el_init(const soundtouch_el_cfg_t *cfg)
         goto fail;
     }
 
-    /* SoundTouch instance. */
-    ctx->st = new(std::nothrow) soundtouch::SoundTouch();
-    if (!ctx->st) { ESP_LOGE(TAG, "OOM: SoundTouch()"); goto fail; }
+    /* Analysis tap (PSRAM).  Not fatal if it cannot be allocated. */
+    if (cfg->tap_samples > 0) {
+        if ((cfg->tap_samples & (cfg->tap_samples - 1)) != 0) {
+            ESP_LOGW(TAG, "tap_samples %d is not a power of two, tap disabled", cfg->tap_samples);
+        } else {
+            ctx->tap = static_cast<int16_t *>(audio_calloc(cfg->tap_samples, sizeof(int16_t)));
+            if (ctx->tap) ctx->tap_len = (uint32_t)cfg->tap_samples;
+            else ESP_LOGW(TAG, "OOM allocating %d-sample analysis tap", cfg->tap_samples);
+        }
+    }
 
-    ctx->st->setSampleRate((uint)cfg->samplerate);
-    ctx->st->setChannels((uint)cfg->channels);
+    /* SoundTouch instance, configured for the selected quality profile.
+     * Stutter prevention is achieved by setting ST_CHUNK_FRAMES large enough
+     * (16384) that even the maximum auto-tuned input advance at 2.0x tempo
+     * (6528 frames) fits in a single call.  The governor steps down the
+     * ladder if core 1 runs short of headroom. */
+    ctx->st = st_create(cfg->samplerate, cfg->channels, ctx->gov.level);
+    if (!ctx->st) { ESP_LOGE(TAG, "OOM: SoundTouch()"); goto fail; }
     ctx->st->setTempo((double)cfg->tempo);
-
-    /* Quality settings – let SoundTouch auto-tune sequence/seek/overlap for
-     * the best possible quality.  Stutter prevention is achieved by setting
-     * ST_CHUNK_FRAMES large enough (16384) that even the maximum auto-tuned
-     * input advance at 2.0x tempo (6528 frames) fits in a single call. */
-    ctx->st->setSetting(SETTING_USE_AA_FILTER,    1);
-    ctx->st->setSetting(SETTING_AA_FILTER_LENGTH, 32);  /* 32-tap AA filter */
-    ctx->st->setSetting(SETTING_USE_QUICKSEEK,    1);   /* QuickSeek ON: ~4x faster cross-corr */
-    ctx->st->setSetting(SETTING_SEQUENCE_MS,      0);   /* auto-tune             */
-    ctx->st->setSetting(SETTING_SEEKWINDOW_MS,    0);   /* auto-tune             */
-    ctx->st->setSetting(SETTING_OVERLAP_MS,       0);   /* auto-tune             */
+    ctx->gov.level_since_us = esp_timer_get_time();
+
+    if (cfg->dual_core) {
+        ctx->dual = dual_create(cfg->samplerate, cfg->channels, ctx->gov.level,
+                                cfg->task_core, cfg->task_prio);
+        if (!ctx->dual) {
+            /* Not fatal: everything still runs through the facade. */
+            ESP_LOGW(TAG, "Dual-core chain unavailable, using single core");
+        } else {
+            ctx->dual->setTempo((double)cfg->tempo);
+            ctx->dual_since_us = ctx->gov.level_since_us;
+        }
+    }
 
     {
         audio_element_cfg_t el_cfg = DEFAULT_AUDIO_ELEMENT_CONFIG();
@@ -261,16 +928,20 @@ audio_element_handle_t soundtouch_el_init(const soundtouch_el_cfg_t *cfg)
         audio_element_handle_t el = audio_element_init(&el_cfg);
         if (!el) { ESP_LOGE(TAG, "audio_element_init failed"); goto fail; }
         audio_element_setdata(el, ctx);
-        ESP_LOGI(TAG, "SoundTouch element ready  sr=%d  ch=%d  tempo=%.2f",
-                 cfg->samplerate, cfg->channels, (double)cfg->tempo);
+        ESP_LOGI(TAG, "SoundTouch element ready  sr=%d  ch=%d  tempo=%.2f  profile=%s  dual=%s",
+                 cfg->samplerate, cfg->channels, (double)cfg->tempo,
+                 soundtouch_profile_name((soundtouch_profile_t)ctx->applied_profile),
+                 ctx->dual ? "yes" : "no");
         return el;
     }
 
 fail:
     if (ctx) {
+        delete ctx->dual;
         delete ctx->st;
         audio_free(ctx->pcm_in);
         audio_free(ctx->pcm_out);
+        audio_free(ctx->tap);
         audio_free(ctx);
     }
     return NULL;
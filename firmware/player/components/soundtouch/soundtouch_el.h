@@ -14,17 +14,49 @@
  *   // register in pipeline like any other element
  *   // change tempo at runtime:
  *   soundtouch_el_set_tempo(el, 1.25f);
+ *
+ * A built-in CPU-headroom governor times every chunk against its real-time
+ * budget and steps SoundTouch down through lighter quality levels (AA taps,
+ * seek window, overlap) when the load gets close to the limit, and back up
+ * once headroom returns.  Level switches are logged under the SOUNDTOUCH tag.
+ *
+ * The starting point of that ladder is a named quality profile (eco /
+ * balanced / hifi) that can be changed at runtime with
+ * soundtouch_el_set_profile(); the governor never climbs above it.
+ *
+ * Setting cfg.dual_core moves the TDStretch stage onto a worker task on the
+ * other core and overlaps it with the rate transposer on the element task.
+ * It is used for pure time-stretch (pitch influence 0) and produces the
+ * same samples as the single-core path; see soundtouch_el_benchmark_dual().
+ *
+ * With cfg.tap_samples > 0 every chunk of input PCM (source time, before
+ * stretching) is also copied into a lock-free analysis ring that another
+ * task can read by source sample index with soundtouch_el_tap_read().
+ * Because the element runs ahead of the DAC, the ring already holds the
+ * audio that is about to be heard.  soundtouch_el_tap_out_src() maps a
+ * position in the element's output stream back to the source, so the
+ * caller can find the sample at the DAC from how much output is still
+ * queued downstream.
  */
 #pragma once
 
 #include "audio_element.h"
 #include "esp_err.h"
 #include <stdbool.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/** Time-stretch quality profiles, cheapest first (values are persisted). */
+typedef enum {
+    SOUNDTOUCH_PROFILE_ECO = 0,   /*!< short sequences, small seek window, linear interp */
+    SOUNDTOUCH_PROFILE_BALANCED,  /*!< auto-tuned sequence/seek, 32-tap AA, QuickSeek    */
+    SOUNDTOUCH_PROFILE_HIFI,      /*!< 64-tap AA, full offset search (no QuickSeek)      */
+    SOUNDTOUCH_PROFILE_COUNT,
+} soundtouch_profile_t;
+
 typedef struct {
     int   samplerate;    /*!< Sample rate in Hz (e.g. 44100)                  */
     int   channels;      /*!< 1 = mono, 2 = stereo                            */
@@ -34,6 +66,9 @@ typedef struct {
     int   task_core;     /*!< CPU core for element task (0 or 1)              */
     int   task_prio;     /*!< Element task priority                           */
     bool  stack_in_ext;  /*!< Allocate task stack in external (PSRAM) memory  */
+    soundtouch_profile_t profile; /*!< Initial quality profile                 */
+    bool  dual_core;     /*!< Split pure time-stretch across both cores      */
+    int   tap_samples;   /*!< Analysis tap size in samples (power of two), 0 = off */
 } soundtouch_el_cfg_t;
 
 #define SOUNDTOUCH_EL_DEFAULT_CFG() {  \
@@ -45,6 +80,9 @@ typedef struct {
     .task_core    = 0,                 \
     .task_prio    = 5,                 \
     .stack_in_ext = true,              \
+    .profile      = SOUNDTOUCH_PROFILE_BALANCED, \
+    .dual_core    = false,             \
+    .tap_samples  = 0,                 \
 }
 
 /**
@@ -102,6 +140,123 @@ esp_err_t soundtouch_el_set_bypass(audio_element_handle_t self, bool bypass);
  */
 esp_err_t soundtouch_el_set_pitch_influence(audio_element_handle_t self, float pitch_influence);
 
+/**
+ * @brief  Select the time-stretch quality profile at runtime.
+ *
+ * Thread-safe; applied at the start of the next processing chunk without
+ * touching the pipeline.  Changing between profiles that use a different
+ * interpolator re-creates the internal SoundTouch instance, which drops
+ * its ~100 ms lookahead once.  The CPU governor uses the profile as its
+ * quality ceiling.
+ *
+ * @param  self     Element handle returned by soundtouch_el_init().
+ * @param  profile  One of soundtouch_profile_t.
+ * @return ESP_OK or ESP_ERR_INVALID_ARG.
+ */
+esp_err_t soundtouch_el_set_profile(audio_element_handle_t self, soundtouch_profile_t profile);
+
+/**
+ * @brief  Set the source sample index of the next PCM the element reads.
+ *
+ * Call before (re)starting the pipeline at a new file position, with the
+ * index of the first interleaved sample that will arrive (byte offset into
+ * the PCM data / bytes per sample).  Takes effect when the element opens;
+ * the tap is emptied at that point.
+ *
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG / ESP_ERR_INVALID_STATE if no tap.
+ */
+esp_err_t soundtouch_el_tap_set_base(audio_element_handle_t self, uint32_t sample_index);
+
+/**
+ * @brief  Copy samples out of the analysis tap.
+ *
+ * Lock-free; any number of reader tasks.  Fails rather than blocks
+ * if any part of the range has not arrived yet, has already been
+ * overwritten, or was overwritten while copying.
+ *
+ * @param  first  Source index of the first interleaved sample.
+ * @param  dst    Output buffer, @p count samples.
+ * @param  count  Samples to copy (not frames).
+ * @return true if @p dst holds the complete range.
+ */
+bool soundtouch_el_tap_read(audio_element_handle_t self, uint32_t first,
+                            int16_t *dst, size_t count);
+
+/**
+ * @brief  Source index one past the newest sample in the tap, e.g. to clamp
+ *         a read window to the buffered audio.  0 if there is no tap.
+ */
+uint32_t soundtouch_el_tap_head(audio_element_handle_t self);
+
+/**
+ * @brief  Source index of an output sample.
+ *
+ * Maps the sample @p back samples before the end of what the element has
+ * written to its output ring buffer to the source (tap index space), using
+ * the tempo that stretch of output was produced at.  Lock-free for any
+ * number of readers, like soundtouch_el_tap_read().
+ *
+ * @param  back       Output samples (not frames) still queued downstream.
+ * @param  src_index  Receives the source index.
+ * @return false if there is no tap, or the sample lies before the current
+ *         stream (nothing written since the last rebase) or is too old.
+ */
+bool soundtouch_el_tap_out_src(audio_element_handle_t self, uint32_t back,
+                               uint32_t *src_index);
+
+/** @brief Short lowercase name of @p profile ("eco", "balanced", "hifi"). */
+const char *soundtouch_profile_name(soundtouch_profile_t profile);
+
+/**
+ * @brief  Measure the CPU cost of every quality profile.
+ *
+ * Pushes a few seconds of synthetic audio through a private SoundTouch
+ * instance per profile and reports CPU cycles spent per second of input
+ * audio (divide by the CPU clock for the load fraction).  Runs in the
+ * caller's task and blocks for a few seconds; cycles include any
+ * pre-emption on that core, so run it while playback is stopped.
+ *
+ * The rate transposer's anti-alias filter runs on esp-dsp kernels.  When
+ * @p generic_cycles_per_s is given, every profile is measured a second
+ * time with SoundTouch's generic C filter for comparison.
+ *
+ * @param  samplerate       Sample rate of the synthetic input.
+ * @param  channels         1 or 2.
+ * @param  speed            Playback speed to simulate (e.g. 1.4).
+ * @param  pitch_influence  0.0–1.0, as for soundtouch_el_set_pitch_influence().
+ * @param  cycles_per_s     Out: one entry per soundtouch_profile_t.
+ * @param  generic_cycles_per_s  Optional out (may be NULL): same with the
+ *                          generic C filter.
+ * @return ESP_OK, ESP_ERR_INVALID_ARG or ESP_ERR_NO_MEM.
+ */
+esp_err_t soundtouch_el_benchmark(int samplerate, int channels, float speed,
+                                  float pitch_influence,
+                                  uint32_t cycles_per_s[SOUNDTOUCH_PROFILE_COUNT],
+                                  uint32_t generic_cycles_per_s[SOUNDTOUCH_PROFILE_COUNT]);
+
+/** Result of soundtouch_el_benchmark_dual(); cycles per second of input audio. */
+typedef struct {
+    uint32_t single_cycles_per_s;       /*!< whole chain on the calling core      */
+    uint32_t dual_caller_cycles_per_s;  /*!< dual: RateTransposer, calling core   */
+    uint32_t dual_worker_cycles_per_s;  /*!< dual: TDStretch, other core          */
+    bool     identical;                 /*!< both paths produced the same samples */
+} soundtouch_dual_bench_t;
+
+/**
+ * @brief  Compare the single-core and dual-core paths on synthetic audio.
+ *
+ * Feeds the same signal through a SoundTouch instance and a two-core chain
+ * at @p speed (pitch influence 0), including the final flush, and checks
+ * that both outputs hash to the same value.  The worker runs on the other
+ * core at the caller's priority.  Blocks for several seconds; run it while
+ * playback is stopped.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_ARG or ESP_ERR_NO_MEM.
+ */
+esp_err_t soundtouch_el_benchmark_dual(int samplerate, int channels, float speed,
+                                       soundtouch_profile_t profile,
+                                       soundtouch_dual_bench_t *out);
+
 #ifdef __cplusplus
 }
 #endif
@@ -12,6 +12,8 @@
  * instead of throw.  The result is identical behaviour for a correctly
  * parameterised SoundTouch instance, and a hard reset instead of an
  * uncatchable exception if something goes wrong.
+ *
+ * It also switches on the library's SIMD filter classes, see below.
  */
 #pragma once
 
@@ -22,3 +24,10 @@
 /* Replace the throw-based error macro with abort(). */
 #undef  ST_THROW_RT_ERROR
 #define ST_THROW_RT_ERROR(x)  do { abort(); } while (0)
+
+/* Declare SoundTouch's FIRFilterMMX / TDStretchMMX classes.  STTypes.h only
+ * enables them for x86; on Xtensa they are implemented in st_fir_dsp.cpp
+ * with esp-dsp kernels and selected through cpu_detect_stub.cpp. */
+#ifndef SOUNDTOUCH_ALLOW_MMX
+#define SOUNDTOUCH_ALLOW_MMX  1
+#endif
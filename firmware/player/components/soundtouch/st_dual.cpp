@@ -0,0 +1,237 @@
+/**
+ * @file st_dual.cpp
+ * @brief Two-core SoundTouch chain – see st_dual.h.
+ *
+ * Mirrors SoundTouch::putSamples / receiveSamples / flush / clear for the
+ * rate <= 1.0 stage order (RateTransposer -> TDStretch) so the output
+ * stream matches the facade sample for sample.
+ */
+
+#include "st_dual.h"
+
+#include "SoundTouch.h"
+
+#include "audio_mem.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+
+#include <new>      /* std::nothrow */
+#include <math.h>
+#include <string.h>
+
+using namespace soundtouch;
+
+static const char *TAG = "ST_DUAL";
+
+/* Frames handed to the worker per job.  Small enough that the last block's
+ * un-overlapped TDStretch time is a minor share of a 16384-frame chunk,
+ * large enough that the semaphore round trip (~10 us) is negligible. */
+static constexpr uint DUAL_BLOCK_FRAMES = 2048;
+
+/* Mid-buffer capacity.  Per job the transposer can emit at most its input
+ * plus the AA-filter / interpolator history it held back from the previous
+ * job (< 128 frames for every supported filter length). */
+static constexpr uint DUAL_MID_FRAMES = DUAL_BLOCK_FRAMES + 256;
+
+/* Same padding SoundTouch::flush() uses to push out its lookahead. */
+static constexpr uint FLUSH_BLOCK_FRAMES = 128;
+static constexpr int  FLUSH_MAX_BLOCKS   = 200;
+
+/* TDStretch runs here, so the same stack as the element task. */
+static constexpr uint32_t WORKER_STACK = 16 * 1024;
+
+/* -- Lifecycle ------------------------------------------------------------- */
+
+StDualChain *StDualChain::create(int samplerate, int channels,
+                                 TransposerBase::ALGORITHM interp,
+                                 int worker_core, int worker_prio)
+{
+    StDualChain *c = new(std::nothrow) StDualChain();
+    if (!c) return nullptr;
+    c->channels_ = channels;
+
+    /* Same construction sequence as SoundTouch(): setRate(1) / setTempo(1)
+     * from calcEffectiveRateAndTempo(), then setSampleRate, setChannels. */
+    TransposerBase::setAlgorithm(interp);
+    c->rt_ = new(std::nothrow) RateTransposer();
+    c->td_ = TDStretch::newInstance();
+    for (int i = 0; i < 2; i++) {
+        c->mid_[i] = static_cast<SAMPLETYPE *>(
+            audio_calloc(DUAL_MID_FRAMES * channels, sizeof(SAMPLETYPE)));
+    }
+    c->go_   = xSemaphoreCreateBinary();
+    c->done_ = xSemaphoreCreateBinary();
+    if (!c->rt_ || !c->td_ || !c->mid_[0] || !c->mid_[1] || !c->go_ || !c->done_) {
+        ESP_LOGE(TAG, "OOM creating dual-core chain");
+        delete c;
+        return nullptr;
+    }
+    c->rt_->setRate(1.0);
+    c->td_->setTempo(1.0);
+    c->td_->setParameters(samplerate);
+    c->rt_->setChannels(channels);
+    c->td_->setChannels(channels);
+
+    if (xTaskCreatePinnedToCore(worker_task, "st_td", WORKER_STACK, c,
+                                (UBaseType_t)worker_prio, &c->worker_,
+                                (BaseType_t)worker_core) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to start worker task");
+        c->worker_ = nullptr;
+        delete c;
+        return nullptr;
+    }
+    ESP_LOGI(TAG, "TDStretch worker on core %d", worker_core);
+    return c;
+}
+
+StDualChain::~StDualChain()
+{
+    if (worker_) {
+        quit_ = true;
+        xSemaphoreGive(go_);
+        xSemaphoreTake(done_, portMAX_DELAY);   /* worker deletes itself */
+    }
+    if (go_)   vSemaphoreDelete(go_);
+    if (done_) vSemaphoreDelete(done_);
+    audio_free(mid_[0]);
+    audio_free(mid_[1]);
+    delete rt_;
+    delete td_;
+}
+
+/* -- Worker ---------------------------------------------------------------- */
+
+void StDualChain::worker_task(void *arg)
+{
+    StDualChain *c = static_cast<StDualChain *>(arg);
+    for (;;) {
+        xSemaphoreTake(c->go_, portMAX_DELAY);
+        if (c->quit_) break;
+
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        c->td_->putSamples(c->mid_[c->job_slot_], c->mid_frames_[c->job_slot_]);
+        c->worker_cycles_ += esp_cpu_get_cycle_count() - t0;
+
+        xSemaphoreGive(c->done_);
+    }
+    xSemaphoreGive(c->done_);
+    vTaskDelete(NULL);
+}
+
+void StDualChain::submit(int slot)
+{
+    job_slot_ = slot;
+    xSemaphoreGive(go_);
+}
+
+void StDualChain::wait_done()
+{
+    xSemaphoreTake(done_, portMAX_DELAY);
+}
+
+/* -- SoundTouch facade equivalents ----------------------------------------- */
+
+bool StDualChain::setSetting(int setting_id, int value)
+{
+    int sample_rate, sequence_ms, seek_ms, overlap_ms;
+    td_->getParameters(&sample_rate, &sequence_ms, &seek_ms, &overlap_ms);
+
+    switch (setting_id) {
+    case SETTING_USE_AA_FILTER:
+        rt_->enableAAFilter(value != 0);
+        return true;
+    case SETTING_AA_FILTER_LENGTH:
+        rt_->getAAFilter()->setLength((uint)value);
+        return true;
+    case SETTING_USE_QUICKSEEK:
+        td_->enableQuickSeek(value != 0);
+        return true;
+    case SETTING_SEQUENCE_MS:
+        td_->setParameters(sample_rate, value, seek_ms, overlap_ms);
+        return true;
+    case SETTING_SEEKWINDOW_MS:
+        td_->setParameters(sample_rate, sequence_ms, value, overlap_ms);
+        return true;
+    case SETTING_OVERLAP_MS:
+        td_->setParameters(sample_rate, sequence_ms, seek_ms, value);
+        return true;
+    default:
+        return false;
+    }
+}
+
+void StDualChain::setTempo(double tempo)
+{
+    /* SoundTouch only forwards changes above its TEST_FLOAT_EQUAL epsilon,
+     * but always uses the new value for the expected-output bookkeeping. */
+    if (fabs(tempo - tempo_) >= 1e-10) td_->setTempo(tempo);
+    tempo_ = tempo;
+}
+
+void StDualChain::putSamples(const SAMPLETYPE *samples, uint frames)
+{
+    samples_expected_ += (double)frames / tempo_;
+    if (frames == 0) return;
+
+    /* Software pipeline: this task transposes block i+1 while the worker
+     * runs TDStretch on block i.  Slots alternate between the two mid
+     * buffers, so neither side ever touches the buffer the other owns.
+     * The last job is waited for, so td_ is idle again on return. */
+    int  slot = 0;
+    bool busy = false;
+    while (frames > 0) {
+        uint n = frames < DUAL_BLOCK_FRAMES ? frames : DUAL_BLOCK_FRAMES;
+
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        rt_->putSamples(samples, n);
+        mid_frames_[slot] = rt_->receiveSamples(mid_[slot], DUAL_MID_FRAMES);
+        caller_cycles_ += esp_cpu_get_cycle_count() - t0;
+        samples += n * (uint)channels_;
+        frames  -= n;
+
+        if (busy) wait_done();
+        submit(slot);
+        busy  = true;
+        slot ^= 1;
+    }
+    wait_done();
+}
+
+uint StDualChain::receiveSamples(SAMPLETYPE *out, uint max_frames)
+{
+    uint n = td_->receiveSamples(out, max_frames);
+    samples_output_ += (long)n;
+    return n;
+}
+
+void StDualChain::flush()
+{
+    int still_expected = (int)((long)(samples_expected_ + 0.5) - samples_output_);
+    if (still_expected < 0) still_expected = 0;
+
+    SAMPLETYPE *blank = new(std::nothrow) SAMPLETYPE[FLUSH_BLOCK_FRAMES * channels_]();
+    if (blank) {
+        for (int i = 0; still_expected > (int)numSamples() && i < FLUSH_MAX_BLOCKS; i++) {
+            putSamples(blank, FLUSH_BLOCK_FRAMES);
+        }
+        delete[] blank;
+    }
+    td_->adjustAmountOfSamples((uint)still_expected);
+    td_->clearInput();
+}
+
+void StDualChain::clear()
+{
+    samples_expected_ = 0.0;
+    samples_output_   = 0;
+    rt_->clear();
+    td_->clear();
+}
+
+void StDualChain::takeCycles(uint64_t *worker_cycles, uint64_t *caller_cycles)
+{
+    if (worker_cycles) *worker_cycles = worker_cycles_;
+    if (caller_cycles) *caller_cycles = caller_cycles_;
+    worker_cycles_ = 0;
+    caller_cycles_ = 0;
+}
@@ -0,0 +1,92 @@
+/**
+ * @file st_dual.h
+ * @brief Two-core SoundTouch chain for pure time-stretch (rate == 1.0).
+ *
+ * SoundTouch's facade runs its two stages – RateTransposer (AA filter +
+ * interpolator) followed by TDStretch (overlap-offset search + overlap-add)
+ * – back to back on the calling task.  StDualChain owns the two stages
+ * itself and runs TDStretch, by far the more expensive one at rate 1.0, on
+ * a worker task pinned to the other core.  Each putSamples() call is cut
+ * into blocks; while the worker stretches block i, the caller already
+ * transposes block i+1 into the second of two mid buffers.
+ *
+ * Both stages produce the same output no matter how their input is split
+ * into calls, so the sample stream is bit-identical to SoundTouch::putSamples()
+ * with the same settings.  The public methods mirror the SoundTouch facade
+ * (including flush() padding and trimming) so soundtouch_el can swap one for
+ * the other at any clear() point.
+ *
+ * Only valid while the rate stays at 1.0 (pitch_influence == 0): the stage
+ * order is then fixed and no rate-crossover buffer shuffling is needed.
+ * Internal to the soundtouch component (C++ only).
+ */
+#pragma once
+
+#include "RateTransposer.h"
+#include "TDStretch.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include <stdint.h>
+
+class StDualChain {
+public:
+    /**
+     * Create the chain and start its worker task.
+     * @param interp       Interpolator for the RateTransposer.  Set through the
+     *                     global TransposerBase::setAlgorithm(); the caller
+     *                     serialises create() with other constructors.
+     * @param worker_core  Core the TDStretch worker is pinned to.
+     * @param worker_prio  Worker task priority.
+     * @return nullptr on OOM or if the worker task cannot be created.
+     */
+    static StDualChain *create(int samplerate, int channels,
+                               soundtouch::TransposerBase::ALGORITHM interp,
+                               int worker_core, int worker_prio);
+    ~StDualChain();
+
+    /** Same semantics as SoundTouch::setSetting() for the settings used here. */
+    bool setSetting(int setting_id, int value);
+    void setTempo(double tempo);
+
+    void putSamples(const soundtouch::SAMPLETYPE *samples, uint frames);
+    uint receiveSamples(soundtouch::SAMPLETYPE *out, uint max_frames);
+    uint numSamples() const { return td_->numSamples(); }
+    void flush();
+    void clear();
+
+    /** CPU cycles spent in each stage since the last call; counters are reset. */
+    void takeCycles(uint64_t *worker_cycles, uint64_t *caller_cycles);
+
+private:
+    StDualChain() = default;
+    static void worker_task(void *arg);
+    void submit(int slot);
+    void wait_done();
+
+    soundtouch::RateTransposer *rt_ = nullptr;   /* caller-side stage      */
+    soundtouch::TDStretch      *td_ = nullptr;   /* worker-side stage; only
+                                                    touched by the caller
+                                                    while no job is out */
+    int    channels_           = 0;
+    double tempo_              = 1.0;
+    double samples_expected_   = 0.0;            /* as SoundTouch::samplesExpectedOut */
+    long   samples_output_     = 0;              /* as SoundTouch::samplesOutput      */
+
+    /* Double-buffered handoff RateTransposer -> TDStretch. */
+    soundtouch::SAMPLETYPE *mid_[2] = {};
+    uint   mid_frames_[2]      = {};
+
+    /* Job posted to the worker: the mid buffer to stretch. */
+    int    job_slot_           = 0;
+    volatile bool quit_        = false;
+
+    SemaphoreHandle_t go_      = nullptr;
+    SemaphoreHandle_t done_    = nullptr;
+    TaskHandle_t      worker_  = nullptr;
+
+    uint64_t worker_cycles_    = 0;
+    uint64_t caller_cycles_    = 0;
+};
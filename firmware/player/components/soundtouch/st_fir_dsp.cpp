@@ -0,0 +1,137 @@
+/**
+ * @file st_fir_dsp.cpp
+ * @brief esp-dsp backed filter classes for SoundTouch on Xtensa.
+ *
+ * SoundTouch creates its FIR and TDStretch objects through factories that
+ * return the FIRFilterMMX / TDStretchMMX subclasses when the CPU reports
+ * SUPPORT_MMX.  The x86 implementation (mmx_optimized.cpp) is not built;
+ * this file provides the classes instead:
+ *
+ *  - FIRFilterMMX runs the rate transposer's stereo anti-alias filter on
+ *    esp-dsp's float dot product (dsps_dotprod_f32, single-cycle MAC loop
+ *    on the ESP32-S3) instead of the generic 16x16->32 C loop.  Results
+ *    are truncated and saturated like the integer routine; float rounding
+ *    can flip the last bit, so the output is not bit-exact with it.
+ *  - TDStretchMMX keeps the generic routines.
+ *
+ * Off-target (host builds) a plain C dot product stands in for esp-dsp.
+ */
+
+#include "FIRFilter.h"
+#include "TDStretch.h"
+
+#ifdef ESP_PLATFORM
+#include "dsps_dotprod.h"
+#endif
+
+#include <math.h>
+#include <stdint.h>
+
+using namespace soundtouch;
+
+/* Output frames converted per pass; the float copies of the input live on
+ * the stack, (FIR_BLOCK_FRAMES + FIR_MAX_TAPS) x 2 channels x 4 bytes. */
+static constexpr uint FIR_BLOCK_FRAMES = 128;
+static constexpr uint FIR_MAX_TAPS     = 128;
+
+static inline float dot(const float *a, const float *b, int len)
+{
+#ifdef ESP_PLATFORM
+    float r;
+    dsps_dotprod_f32(a, b, &r, len);
+    return r;
+#else
+    float r = 0.0f;
+    for (int i = 0; i < len; i++) r += a[i] * b[i];
+    return r;
+#endif
+}
+
+static inline short to_sample(float v)
+{
+    /* floorf: same rounding as the integer routine's arithmetic shift. */
+    long s = (long)floorf(v);
+    return (short)(s < -32768 ? -32768 : (s > 32767 ? 32767 : s));
+}
+
+/* -- FIRFilterMMX ---------------------------------------------------------- */
+
+FIRFilterMMX::FIRFilterMMX() : FIRFilter()
+{
+    filterCoeffsUnalign = nullptr;
+    filterCoeffsAlign   = nullptr;
+}
+
+FIRFilterMMX::~FIRFilterMMX()
+{
+    delete[] filterCoeffsUnalign;
+}
+
+/* The member types are fixed by FIRFilter.h (short *); the aligned block
+ * holds the coefficients as floats, pre-scaled by 2^-resultDivFactor. */
+void FIRFilterMMX::setCoefficients(const short *coeffs, uint newLength, uint uResultDivFactor)
+{
+    FIRFilter::setCoefficients(coeffs, newLength, uResultDivFactor);
+
+    delete[] filterCoeffsUnalign;
+    filterCoeffsUnalign = new short[newLength * (sizeof(float) / sizeof(short)) + 8];
+    filterCoeffsAlign   = reinterpret_cast<short *>(
+        (reinterpret_cast<uintptr_t>(filterCoeffsUnalign) + 15) & ~(uintptr_t)15);
+
+    float *fc = reinterpret_cast<float *>(filterCoeffsAlign);
+    float scale = 1.0f / (float)(1u << uResultDivFactor);
+    for (uint i = 0; i < newLength; i++) {
+        fc[i] = (float)coeffs[i] * scale;
+    }
+}
+
+uint FIRFilterMMX::evaluateFilterStereo(short *dest, const short *src, uint numSamples) const
+{
+    if (length > FIR_MAX_TAPS) {
+        return FIRFilter::evaluateFilterStereo(dest, src, numSamples);
+    }
+
+    const float *fc = reinterpret_cast<const float *>(filterCoeffsAlign);
+    float left[FIR_BLOCK_FRAMES + FIR_MAX_TAPS];
+    float right[FIR_BLOCK_FRAMES + FIR_MAX_TAPS];
+
+    /* Same output count as the generic routine: numSamples - length. */
+    uint end = numSamples - length;
+    for (uint j0 = 0; j0 < end; j0 += FIR_BLOCK_FRAMES) {
+        uint n    = (end - j0 < FIR_BLOCK_FRAMES) ? end - j0 : FIR_BLOCK_FRAMES;
+        uint span = n + length - 1;
+        const short *p = src + 2 * j0;
+        for (uint i = 0; i < span; i++) {
+            left[i]  = (float)p[2 * i];
+            right[i] = (float)p[2 * i + 1];
+        }
+        short *d = dest + 2 * j0;
+        for (uint i = 0; i < n; i++) {
+            d[2 * i]     = to_sample(dot(left  + i, fc, (int)length));
+            d[2 * i + 1] = to_sample(dot(right + i, fc, (int)length));
+        }
+    }
+    return end;
+}
+
+/* -- TDStretchMMX ---------------------------------------------------------- */
+
+double TDStretchMMX::calcCrossCorr(const short *mixingPos, const short *compare, double &norm)
+{
+    return TDStretch::calcCrossCorr(mixingPos, compare, norm);
+}
+
+double TDStretchMMX::calcCrossCorrAccumulate(const short *mixingPos, const short *compare, double &norm)
+{
+    return TDStretch::calcCrossCorrAccumulate(mixingPos, compare, norm);
+}
+
+void TDStretchMMX::overlapStereo(short *output, const short *input) const
+{
+    TDStretch::overlapStereo(output, input);
+}
+
+void TDStretchMMX::clearCrossCorrState()
+{
+    TDStretch::clearCrossCorrState();
+}
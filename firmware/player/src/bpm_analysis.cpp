@@ -0,0 +1,230 @@
+/**
+ * @file bpm_analysis.cpp
+ * @brief Background per-song BPM analysis – see bpm_analysis.h.
+ *
+ * The beat grid is the phase of the detected beats against the detected
+ * period: the strength-weighted circular mean of beat_pos mod 60/bpm.
+ */
+
+#ifdef HAVE_ADF
+
+#include "bpm_analysis.h"
+#include "song_settings.h"
+#include "library.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+/* The soundtouch component builds with 16-bit samples (a PRIVATE define
+ * there); BPMDetect's SAMPLETYPE must match. */
+#ifndef SOUNDTOUCH_INTEGER_SAMPLES
+#define SOUNDTOUCH_INTEGER_SAMPLES 1
+#endif
+#include "BPMDetect.h"
+
+#include <math.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+static const char *TAG = "bpm";
+
+#define BPM_PATH_MAX      80      /* "/sdcard/" + song name + ".wav" */
+#define BPM_READ_FRAMES   4096
+
+#define BPM_TASK_STACK    4096
+#define BPM_TASK_PRIO     tskIDLE_PRIORITY
+#define BPM_TASK_CORE     1       /* audio core: idle whenever we may run */
+
+static TaskHandle_t           s_task    = nullptr;
+static bpm_analysis_done_cb_t s_done    = nullptr;
+static volatile bool          s_playing = false;
+static volatile bool          s_rescan  = false;   /* library changed since the pass began */
+
+/* Counters (written by the task only). */
+static volatile bool     s_paused  = false;
+static volatile uint32_t s_left    = 0;     /* songs left in the current pass */
+static uint32_t          s_songs   = 0;
+static uint32_t          s_failed  = 0;
+static int64_t           s_busy_us = 0;
+static double            s_audio_s = 0.0;
+
+/* ── Helpers ──────────────────────────────────────────────────────────── */
+
+/* Park while a song plays.  @p t_run is the start of the current busy
+ * stretch; the parked time is not counted. */
+static void wait_while_playing(int64_t *t_run)
+{
+    if (!s_playing) return;
+    s_busy_us += esp_timer_get_time() - *t_run;
+    s_paused = true;
+    while (s_playing) ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    s_paused = false;
+    *t_run = esp_timer_get_time();
+}
+
+/* Beat-grid offset in [0, 60/bpm): circular mean of the beat phases. */
+static float grid_offset(soundtouch::BPMDetect *bd, float bpm)
+{
+    int n = bd->getBeats(nullptr, nullptr, 0);
+    if (n <= 0) return 0.0f;
+    float *pos = (float *)malloc(sizeof(float) * 2 * (size_t)n);
+    if (!pos) return 0.0f;
+    float *str = pos + n;
+    n = bd->getBeats(pos, str, n);
+
+    float period = 60.0f / bpm;
+    float c = 0.0f, s = 0.0f;
+    for (int i = 0; i < n; i++) {
+        float a = 2.0f * (float)M_PI * fmodf(pos[i], period) / period;
+        c += str[i] * cosf(a);
+        s += str[i] * sinf(a);
+    }
+    free(pos);
+    float off = atan2f(s, c) / (2.0f * (float)M_PI) * period;
+    return (off < 0.0f) ? off + period : off;
+}
+
+/* Format and data chunk come from the library entry @p e, as for playback. */
+static bool analyse(const char *wav_path, uint32_t wav_bytes, const library_entry_t *e,
+                    int64_t *t_run)
+{
+    uint32_t sr = e->sample_rate;
+    uint32_t ch = e->channels;
+    if (!library_is_pcm16(e)) {
+        ESP_LOGW(TAG, "%s: unsupported format (tag %u, %u bit)", wav_path, e->format, e->bps * 8u);
+        return false;
+    }
+
+    FILE *f = fopen(wav_path, "rb");
+    if (!f) return false;
+    if (fseek(f, (long)e->data_offset, SEEK_SET) != 0) {
+        fclose(f);
+        return false;
+    }
+
+    uint32_t total = e->data_bytes / (ch * 2u);
+    int16_t *buf   = (int16_t *)malloc(BPM_READ_FRAMES * ch * sizeof(int16_t));
+    soundtouch::BPMDetect *bd = new (std::nothrow) soundtouch::BPMDetect((int)ch, (int)sr);
+    bool ok = buf && bd;
+
+    int64_t  t0   = esp_timer_get_time();
+    uint32_t done = 0;
+    while (ok && done < total) {
+        wait_while_playing(t_run);
+        uint32_t n = total - done;
+        if (n > BPM_READ_FRAMES) n = BPM_READ_FRAMES;
+        if (fread(buf, sizeof(int16_t) * ch, n, f) != n) { ok = false; break; }
+        bd->inputSamples(buf, (int)n);
+        done += n;
+    }
+    fclose(f);
+    free(buf);
+
+    float bpm = 0.0f, off = 0.0f;
+    if (ok) {
+        bpm = bd->getBpm();
+        if (bpm > 0.0f) off = grid_offset(bd, bpm);
+        /* bpm 0 (no steady beat) is stored too, so the song is not redone. */
+        ok = song_settings_set_bpm(wav_path, bpm, off, wav_bytes);
+    }
+    delete bd;
+    if (!ok) return false;
+
+    s_audio_s += (double)total / (double)sr;
+    ESP_LOGI(TAG, "%s: %.1f BPM, grid offset %.3f s (%lu ms)", wav_path,
+             (double)bpm, (double)off, (unsigned long)((esp_timer_get_time() - t0) / 1000));
+    if (s_done) s_done(wav_path, bpm, off);
+    return true;
+}
+
+/* Analyse library entry @p idx unless its sidecar already has a result. */
+static void visit(uint16_t idx)
+{
+    char wav_path[BPM_PATH_MAX];
+    if (!library_path(idx, wav_path, sizeof(wav_path))) return;
+
+    int64_t t_run = esp_timer_get_time();
+    wait_while_playing(&t_run);
+
+    struct stat     st;
+    library_entry_t e;
+    if (stat(wav_path, &st) != 0 || !library_find(wav_path, &e) || e.data_bytes == 0) return;
+    song_settings_t s;
+    song_settings_load(wav_path, &s);
+    if (s.bpm_wav_bytes == (uint32_t)st.st_size) return;   /* already done */
+
+    if (analyse(wav_path, (uint32_t)st.st_size, &e, &t_run)) s_songs++;
+    else                                                       s_failed++;
+    s_busy_us += esp_timer_get_time() - t_run;
+}
+
+/* ── Task ─────────────────────────────────────────────────────────────── */
+
+/* One pass walks the library by index.  A walk that reorders the entries
+ * mid-pass also reports the songs it added, which sets s_rescan, so a song
+ * skipped by the shift is picked up by the next pass. */
+static void bpm_task(void *arg)
+{
+    (void)arg;
+    for (;;) {
+        while (!s_rescan) ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        s_rescan = false;
+
+        uint16_t n = library_count();
+        for (uint16_t idx = 0; idx < n; idx++) {
+            s_left = (uint32_t)(n - idx);
+            visit(idx);
+        }
+        s_left = 0;
+    }
+}
+
+/* ── Public API ───────────────────────────────────────────────────────── */
+
+void bpm_analysis_init(bpm_analysis_done_cb_t done)
+{
+    if (s_task) return;
+    s_done = done;
+    BaseType_t ok = xTaskCreatePinnedToCore(bpm_task, "bpm_analysis", BPM_TASK_STACK,
+                                            nullptr, BPM_TASK_PRIO, &s_task, BPM_TASK_CORE);
+    if (ok != pdPASS) {
+        s_task = nullptr;
+        ESP_LOGE(TAG, "Failed to start task");
+    }
+}
+
+void bpm_analysis_request(const char *wav_path)
+{
+    (void)wav_path;   /* the pass reads the library itself */
+    if (!s_task) return;
+    if (!s_rescan) ESP_LOGD(TAG, "Library changed, another pass is due");
+    s_rescan = true;
+    xTaskNotifyGive(s_task);
+}
+
+void bpm_analysis_set_playing(bool playing)
+{
+    if (playing == s_playing) return;
+    s_playing = playing;
+    if (!playing && s_task) xTaskNotifyGive(s_task);
+}
+
+void bpm_analysis_get_stats(bpm_analysis_stats_t *out)
+{
+    if (!out) return;
+    float busy_s = (float)s_busy_us * 1e-6f;
+    out->songs         = s_songs;
+    out->failed        = s_failed;
+    out->queued        = s_left;
+    out->busy_ms       = (uint32_t)(s_busy_us / 1000);
+    out->songs_per_min = (busy_s > 0.0f) ? (float)s_songs * 60.0f / busy_s : 0.0f;
+    out->audio_x       = (busy_s > 0.0f) ? (float)s_audio_s / busy_s : 0.0f;
+    out->paused        = s_paused;
+}
+
+#endif /* HAVE_ADF */
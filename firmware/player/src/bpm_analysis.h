@@ -0,0 +1,55 @@
+/**
+ * @file bpm_analysis.h
+ * @brief Background per-song BPM analysis with SoundTouch's BPMDetect.
+ *
+ * An idle-priority task walks the song library and streams each WAV once
+ * through soundtouch::BPMDetect, storing the tempo and a beat grid (offset
+ * of a grid line) in the song's JSON sidecar (song_settings_set_bpm()).
+ * Songs that already have a result for their current file size are
+ * skipped.  After a full pass the task sleeps until a song is reported new
+ * or changed (bpm_analysis_request()), then walks the library again.
+ *
+ * The pass pauses while a song plays (bpm_analysis_set_playing()) and
+ * continues where it stopped, so it never competes with playback for the
+ * SD card or CPU.  Throughput is measured over the time actually spent
+ * analysing.
+ *
+ * Only available with ESP-ADF (HAVE_ADF), which provides SoundTouch.
+ */
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Called from the analysis task when a song's result is stored. */
+typedef void (*bpm_analysis_done_cb_t)(const char *wav_path, float bpm, float beat_offset_s);
+
+typedef struct {
+    uint32_t songs;          /**< songs analysed since boot                 */
+    uint32_t failed;         /**< songs that could not be read / no tempo   */
+    uint32_t queued;         /**< songs left in the current pass            */
+    uint32_t busy_ms;        /**< time spent analysing (pauses excluded)    */
+    float    songs_per_min;  /**< songs / busy minute                       */
+    float    audio_x;        /**< audio seconds analysed per busy second    */
+    bool     paused;         /**< waiting for playback to stop              */
+} bpm_analysis_stats_t;
+
+/** @brief Start the analysis task.  Call once from app_main. */
+void bpm_analysis_init(bpm_analysis_done_cb_t done);
+
+/** @brief @p wav_path is new or changed: start another pass over the
+ *         library once the current one ends. */
+void bpm_analysis_request(const char *wav_path);
+
+/** @brief Pause (true) or resume the pass.  Cheap to call every tick. */
+void bpm_analysis_set_playing(bool playing);
+
+/** @brief Copy the counters into @p out. */
+void bpm_analysis_get_stats(bpm_analysis_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
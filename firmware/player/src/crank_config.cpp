@@ -1,4 +1,6 @@
 #include "crank_config.h"
+#include "crank_filter.h"
+#include "crank_trace.h"
 #include "encoder2.h"
 #include "potis.h"
 
@@ -26,13 +28,22 @@ void crank_config_defaults(crank_config_t *c)
     c->release_ticks = 2;
     c->vol_fade_step  = 1;
     c->crank_dir      = -1;
+    c->speed_mode     = 0;      /* ENC2_SPEED_COUNTS */
+    c->estimator      = CRANK_EST_EMA;
+    c->ab_alpha       = 0.10f;
+    c->ab_beta        = 0.005f;
+    c->ab_lead        = 1.0f;
     c->lo_bass_weight = 45.0f;
     c->lo_mid_weight  = 5.0f;
     c->lo_decay_rate  = 0.998f;
     c->lo_lookahead_s = 0.0f;
+    c->lo_rate_hz     = 20;
+    c->lo_onset_gain  = 0.6f;
     c->pot_cal_lo     = 559;
     c->pot_cal_mid    = 945;
     c->pot_cal_hi     = 3071;
+    c->st_profile     = 1;      /* balanced */
+    c->st_dual_core   = 0;
 }
 
 /* ── load ──────────────────────────────────────────────────────────────── */
@@ -98,13 +109,22 @@ void crank_config_load(void)
             if (v >= -1 && v <= 1) g_crank_cfg.crank_dir = (int8_t)v;
         }
     }
+    read_u8(root, "speed_mode",     0,   1,   &g_crank_cfg.speed_mode);
+    read_u8(root, "estimator",      0,   1,   &g_crank_cfg.estimator);
+    read_f (root, "ab_alpha",       0.01f,  1.0f,  &g_crank_cfg.ab_alpha);
+    read_f (root, "ab_beta",        0.001f, 0.5f,  &g_crank_cfg.ab_beta);
+    read_f (root, "ab_lead",        0.0f,   2.0f,  &g_crank_cfg.ab_lead);
     read_f (root, "lo_bass_weight", 1.0f, 200.0f, &g_crank_cfg.lo_bass_weight);
     read_f (root, "lo_mid_weight",  0.0f,  50.0f, &g_crank_cfg.lo_mid_weight);
     read_f (root, "lo_decay_rate",  0.990f, 0.999f, &g_crank_cfg.lo_decay_rate);
     read_f (root, "lo_lookahead_s", -1.0f,  1.0f,   &g_crank_cfg.lo_lookahead_s);
+    read_u8 (root, "lo_rate_hz",    10, 100, &g_crank_cfg.lo_rate_hz);
+    read_f  (root, "lo_onset_gain", 0.0f, 1.0f, &g_crank_cfg.lo_onset_gain);
     read_u16(root, "pot_cal_lo",    0, 4095, &g_crank_cfg.pot_cal_lo);
     read_u16(root, "pot_cal_mid",   0, 4095, &g_crank_cfg.pot_cal_mid);
     read_u16(root, "pot_cal_hi",    0, 4095, &g_crank_cfg.pot_cal_hi);
+    read_u8 (root, "st_profile",    0, 2,    &g_crank_cfg.st_profile);
+    read_u8 (root, "st_dual_core",  0, 1,    &g_crank_cfg.st_dual_core);
 
     cJSON_Delete(root);
     ESP_LOGI(TAG, "Loaded: attack=%.3f rel=%.1f stop=%.2f start=%.2f rt=%u fs=%u",
@@ -128,13 +148,22 @@ void crank_config_save(void)
     cJSON_AddNumberToObject(root, "release_ticks", (double)g_crank_cfg.release_ticks);
     cJSON_AddNumberToObject(root, "vol_fade_step",  (double)g_crank_cfg.vol_fade_step);
     cJSON_AddNumberToObject(root, "crank_dir",       (double)g_crank_cfg.crank_dir);
+    cJSON_AddNumberToObject(root, "speed_mode",      (double)g_crank_cfg.speed_mode);
+    cJSON_AddNumberToObject(root, "estimator",       (double)g_crank_cfg.estimator);
+    cJSON_AddNumberToObject(root, "ab_alpha",        (double)g_crank_cfg.ab_alpha);
+    cJSON_AddNumberToObject(root, "ab_beta",         (double)g_crank_cfg.ab_beta);
+    cJSON_AddNumberToObject(root, "ab_lead",         (double)g_crank_cfg.ab_lead);
     cJSON_AddNumberToObject(root, "lo_bass_weight",  (double)g_crank_cfg.lo_bass_weight);
     cJSON_AddNumberToObject(root, "lo_mid_weight",   (double)g_crank_cfg.lo_mid_weight);
     cJSON_AddNumberToObject(root, "lo_decay_rate",   (double)g_crank_cfg.lo_decay_rate);
     cJSON_AddNumberToObject(root, "lo_lookahead_s",  (double)g_crank_cfg.lo_lookahead_s);
+    cJSON_AddNumberToObject(root, "lo_rate_hz",      (double)g_crank_cfg.lo_rate_hz);
+    cJSON_AddNumberToObject(root, "lo_onset_gain",   (double)g_crank_cfg.lo_onset_gain);
     cJSON_AddNumberToObject(root, "pot_cal_lo",      (double)g_crank_cfg.pot_cal_lo);
     cJSON_AddNumberToObject(root, "pot_cal_mid",     (double)g_crank_cfg.pot_cal_mid);
     cJSON_AddNumberToObject(root, "pot_cal_hi",      (double)g_crank_cfg.pot_cal_hi);
+    cJSON_AddNumberToObject(root, "st_profile",      (double)g_crank_cfg.st_profile);
+    cJSON_AddNumberToObject(root, "st_dual_core",    (double)g_crank_cfg.st_dual_core);
 
     char *str = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
@@ -157,6 +186,10 @@ void crank_config_apply(void)
 {
     encoder2_apply_config(g_crank_cfg.ema_attack, g_crank_cfg.ema_release,
                           g_crank_cfg.stop_thresh, g_crank_cfg.start_thresh,
-                          g_crank_cfg.release_ticks, g_crank_cfg.crank_dir);
+                          g_crank_cfg.release_ticks, g_crank_cfg.crank_dir,
+                          g_crank_cfg.speed_mode);
+    encoder2_set_estimator(g_crank_cfg.estimator, g_crank_cfg.ab_alpha,
+                           g_crank_cfg.ab_beta, g_crank_cfg.ab_lead);
     potis_set_cal(g_crank_cfg.pot_cal_lo, g_crank_cfg.pot_cal_mid, g_crank_cfg.pot_cal_hi);
+    crank_trace_config_changed();
 }
@@ -24,14 +24,23 @@ typedef struct {
     uint8_t release_ticks;   /**< zero-windows before fast decay onset [0–10, def 2] */
     uint8_t vol_fade_step;   /**< volume units per 10 ms fade tick [1–10, def 1]    */
     int8_t  crank_dir;       /**< 0=any direction, +1=positive counts only, -1=negative counts only [def 0] */
+    uint8_t speed_mode;      /**< crank speed from 0=count windows, 1=edge timestamps [def 0] */
+    uint8_t estimator;       /**< speed estimator: 0=EMA, 1=α-β with prediction [def 0] */
+    float   ab_alpha;        /**< α-β speed gain        [0.01–1.00, def 0.10] */
+    float   ab_beta;         /**< α-β acceleration gain [0.001–0.500, def 0.005] */
+    float   ab_lead;         /**< α-β prediction horizon × measured output latency [0–2, def 1.0] */
     /* Light-organ (FFT) global parameters – only used when per-song light_organ is set */
     float   lo_bass_weight;  /**< sqrtf(bass) multiplier [1–200, def 45]  */
     float   lo_mid_weight;   /**< sqrtf(mid)  multiplier [0– 50, def  5]  */
     float   lo_decay_rate;   /**< auto-range peak decay per 50 ms frame [0.990–0.999, def 0.998] */
-    float   lo_lookahead_s;  /**< FFT read offset vs g_audio_pos_s [−1.0..+1.0 s, def 0]: + = lamp before beat, − = lamp after */
+    float   lo_lookahead_s;  /**< FFT read offset vs the measured audible position [−1.0..+1.0 s, def 0]: + = lamp before beat, − = lamp after */
+    uint8_t lo_rate_hz;      /**< light-organ analysis frames per second [10–100, def 20] */
+    float   lo_onset_gain;   /**< onset pulse share of the remaining headroom [0–1, def 0.6]; 0 = energy only */
     uint16_t pot_cal_lo;     /**< raw ADC at pot minimum stop  [0–4095, def 559]  */
     uint16_t pot_cal_mid;    /**< raw ADC at pot center knob   [0–4095, def 945]  */
     uint16_t pot_cal_hi;     /**< raw ADC at pot maximum stop  [0–4095, def 3071] */
+    uint8_t  st_profile;     /**< time-stretch quality: 0=eco 1=balanced 2=hifi [def 1]; per-song override in song_settings */
+    uint8_t  st_dual_core;   /**< 1 = split time-stretch across both cores [0–1, def 0]; applied at boot */
 } crank_config_t;
 
 /** Globally shared config; written by crank_config_load() and the web POST handler. */
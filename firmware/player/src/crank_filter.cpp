@@ -0,0 +1,136 @@
+/**
+ * @file crank_filter.cpp
+ * @brief Crank speed estimator – see crank_filter.h.
+ */
+
+#include "crank_filter.h"
+
+#include <math.h>
+#include <string.h>
+
+/*
+ * EMA smoothing factor α (applied once per 50 ms window).
+ * Three-phase asymmetric envelope:
+ *   STARTUP  – fast climb from 0 to threshold.    τ ≈  0.6 s  (not yet moving)
+ *   ATTACK   – slow speed changes during playback. τ ≈ 12.5 s  (already moving)
+ *   RELEASE  – fast decay when crank stops.        τ ≈  172 ms
+ */
+#define CRANK_EMA_ALPHA_STARTUP  1.500f
+#define CRANK_EMA_ALPHA_ATTACK   0.025f
+#define CRANK_EMA_ALPHA_RELEASE  1.500f
+
+/*
+ * Consecutive zero-count windows required before switching to fast release.
+ * 2 windows × 50 ms = 100 ms of silence before decay kicks in.
+ */
+#define CRANK_RELEASE_WINDOWS    2
+
+/* Hysteretic stop/start thresholds [RPS] */
+#define CRANK_STOP_THRESH        0.25f   /* moving  → stopped (lower threshold) */
+#define CRANK_START_THRESH       0.70f   /* stopped → moving  (upper threshold) */
+
+/* α-β gains per window; β ≈ α²/(2 − α) is near critical damping. */
+#define CRANK_AB_ALPHA           0.10f
+#define CRANK_AB_BETA            0.005f
+
+bool crank_window_add(crank_window_t *w, int tick_delta, int64_t now_us,
+                      int *delta, float *dt)
+{
+    w->acc += tick_delta;
+    if (++w->ticks < CRANK_WINDOW_TICKS) return false;
+
+    *delta = w->acc;
+    *dt    = (w->last_us != 0) ? (float)(now_us - w->last_us) * 1e-6f : 0.0f;
+    if (*dt < CRANK_WINDOW_S * 0.5f || *dt > CRANK_WINDOW_S * 4.0f) *dt = CRANK_WINDOW_S;
+    w->ticks   = 0;
+    w->acc     = 0;
+    w->last_us = now_us;
+    return true;
+}
+
+void crank_filter_defaults(crank_filter_cfg_t *c)
+{
+    c->ema_attack      = CRANK_EMA_ALPHA_ATTACK;
+    c->ema_release     = CRANK_EMA_ALPHA_RELEASE;
+    c->stop_thresh     = CRANK_STOP_THRESH;
+    c->start_thresh    = CRANK_START_THRESH;
+    c->release_windows = CRANK_RELEASE_WINDOWS;
+    c->crank_dir       = 0;
+    c->estimator       = CRANK_EST_EMA;
+    c->ab_alpha        = CRANK_AB_ALPHA;
+    c->ab_beta         = CRANK_AB_BETA;
+    c->lead_s          = 0.0f;
+}
+
+void crank_filter_reset(crank_filter_t *f)
+{
+    memset(f, 0, sizeof(*f));
+}
+
+float crank_filter_push(crank_filter_t *f, const crank_filter_cfg_t *c,
+                        int delta, float dt, float edge_rps)
+{
+    /* Ignore delta that is in the unwanted direction */
+    if (c->crank_dir > 0 && delta < 0) delta = 0;
+    if (c->crank_dir < 0 && delta > 0) delta = 0;
+
+    /* Signed instant speed so direction reversals cancel in the filter. */
+    float z = (float)delta / (CRANK_COUNTS_PER_REV * dt);
+    if (edge_rps >= 0.0f) z = (delta > 0) ? edge_rps : (delta < 0) ? -edge_rps : 0.0f;
+    f->instant = fabsf(z);
+
+    /* Release only engages after release_windows consecutive zero-count
+     * windows, so brief pauses mid-crank are ignored. */
+    if (delta == 0) {
+        if (f->zero_windows < c->release_windows) f->zero_windows++;
+    } else {
+        f->zero_windows = 0;
+    }
+    bool release = f->zero_windows >= c->release_windows;
+
+    float out = f->speed;
+    if (c->estimator == CRANK_EST_ALPHA_BETA) {
+        if (release) {
+            f->speed = c->ema_release * z + (1.0f - c->ema_release) * f->speed;
+            f->accel = 0.0f;
+        } else if (!f->moving) {
+            /* Startup: follow the measurement, nothing to predict yet. */
+            f->speed = z;
+            f->accel = 0.0f;
+        } else {
+            float pred = f->speed + f->accel * dt;
+            float r    = z - pred;
+            f->speed   = pred + c->ab_alpha * r;
+            f->accel  += c->ab_beta * r / dt;
+        }
+        /* Speed when the audio stretched now is heard; never past zero. */
+        out = f->speed + f->accel * c->lead_s;
+        if (out * f->speed < 0.0f) out = 0.0f;
+    } else {
+        /* Three-phase alpha selection:
+         *   release  – zero-count silence threshold reached
+         *   startup  – crank spinning but playback not yet active (fast climb)
+         *   attack   – playback running, smooth out speed changes (slow) */
+        float alpha;
+        if (release) {
+            alpha = c->ema_release;
+        } else if (!f->moving) {
+            alpha = CRANK_EMA_ALPHA_STARTUP;  /* startup is not user-configurable */
+        } else {
+            alpha = c->ema_attack;
+        }
+        f->speed = alpha * z + (1.0f - alpha) * f->speed;
+        out = f->speed;
+    }
+
+    /* Hysteretic stopped / moving state machine on the filtered speed */
+    float speed_abs = fabsf(f->speed);
+    if (!f->moving && speed_abs > c->start_thresh) {
+        f->moving = true;
+    } else if (f->moving && speed_abs < c->stop_thresh) {
+        f->moving = false;
+    }
+
+    f->out = f->moving ? fabsf(out) : 0.0f;
+    return f->out;
+}
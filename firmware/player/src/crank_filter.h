@@ -0,0 +1,108 @@
+/**
+ * @file crank_filter.h
+ * @brief Crank speed estimator: one measurement window in, playback speed out.
+ *
+ * encoder2 adds the PCNT delta of every 10 ms io_task tick to a
+ * crank_window_t; each completed 50 ms window (count delta, measured window
+ * length, optional edge-timing speed) is pushed into the estimator.  Two
+ * estimators turn the raw window speed into the speed io_task plays at:
+ *
+ *   EMA         – the three-phase asymmetric EMA (startup / attack /
+ *                 release alphas).  Smooth, but an attack takes seconds.
+ *   ALPHA_BETA  – tracks speed and acceleration (α-β filter) and outputs
+ *                 the speed predicted lead_s ahead, i.e. at the moment the
+ *                 audio stretched now reaches the DAC.
+ *
+ * Both share the zero-window release (crank stopped) and the hysteretic
+ * moving / stopped state machine: the state follows the filtered speed,
+ * the prediction only shapes the returned value.
+ *
+ * Plain C/C++ without ESP-IDF dependencies so tools/crank_replay.py can
+ * build it on the host.
+ */
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 360 quad cycles/rev × 4 PCNT edges = 1440 counts per full revolution */
+#define CRANK_COUNTS_PER_REV  1440.0f
+
+/* io_task ticks per measurement window: 5 × 10 ms = 50 ms.  The nominal tick
+ * (IO_TICK_US in main.cpp) only sizes the window; speed uses its measured
+ * length. */
+#define CRANK_TICK_S          0.010f
+#define CRANK_WINDOW_TICKS    5
+#define CRANK_WINDOW_S        (CRANK_TICK_S * CRANK_WINDOW_TICKS)
+
+typedef enum {
+    CRANK_EST_EMA        = 0,
+    CRANK_EST_ALPHA_BETA = 1,
+} crank_est_t;
+
+typedef struct {
+    float   ema_attack;      /**< EMA α during playback                    */
+    float   ema_release;     /**< α once the crank stopped (both filters)  */
+    float   stop_thresh;     /**< moving → stopped [RPS]                   */
+    float   start_thresh;    /**< stopped → moving [RPS]                   */
+    uint8_t release_windows; /**< zero-count windows before release        */
+    int8_t  crank_dir;       /**< 0 = any, +1 / −1 = only that count sign  */
+    uint8_t estimator;       /**< crank_est_t                              */
+    float   ab_alpha;        /**< α-β speed gain (0–1]                     */
+    float   ab_beta;         /**< α-β acceleration gain (0–1]              */
+    float   lead_s;          /**< α-β prediction horizon [s]               */
+} crank_filter_cfg_t;
+
+typedef struct {
+    float   speed;           /**< filtered signed speed [RPS]              */
+    float   accel;           /**< α-β acceleration [RPS/s]                 */
+    float   instant;         /**< |raw window speed| [RPS]                 */
+    float   out;             /**< last returned speed                      */
+    bool    moving;
+    uint8_t zero_windows;    /**< consecutive windows with delta == 0      */
+} crank_filter_t;
+
+typedef struct {
+    uint8_t ticks;           /**< ticks accumulated in the current window  */
+    int     acc;             /**< count sum of the current window          */
+    int64_t last_us;         /**< time of the last window end, 0 = none    */
+} crank_window_t;
+
+/**
+ * @brief Add one io_task tick to the window.
+ *
+ * A measured window outside [½, 4] × CRANK_WINDOW_S (first window, task
+ * stalled for long) falls back to the nominal length.
+ *
+ * @param tick_delta  PCNT counts since the previous tick
+ * @param now_us      time the counter was read [µs]
+ * @param delta       out: window count delta (when true is returned)
+ * @param dt          out: window length [s]
+ * @return true when this tick completed a window.
+ */
+bool  crank_window_add(crank_window_t *w, int tick_delta, int64_t now_us,
+                       int *delta, float *dt);
+
+/** @brief Compile-time defaults (crank_config_defaults() mirrors them). */
+void  crank_filter_defaults(crank_filter_cfg_t *c);
+
+/** @brief Clear @p f (stopped, speed 0). */
+void  crank_filter_reset(crank_filter_t *f);
+
+/**
+ * @brief Feed one measurement window.
+ *
+ * @param delta     PCNT counts in the window (signed)
+ * @param dt        window length [s]
+ * @param edge_rps  speed magnitude from edge timing, < 0 = use the counts
+ * @return Playback speed [RPS]: 0 while stopped, else the estimate.
+ */
+float crank_filter_push(crank_filter_t *f, const crank_filter_cfg_t *c,
+                        int delta, float dt, float edge_rps);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,84 @@
+/**
+ * @file crank_gate.cpp
+ * @brief Crank-driven pause / resume – see crank_gate.h.
+ */
+
+#include "crank_gate.h"
+
+#include <string.h>
+
+void crank_gate_reset(crank_gate_t *g)
+{
+    memset(g, 0, sizeof(*g));
+}
+
+void crank_gate_step(crank_gate_t *g, bool moving, bool playing, bool paused,
+                     bool have_song, uint8_t vol, uint8_t fade_step,
+                     crank_gate_out_t *o)
+{
+    o->resume = false;
+    o->pause  = false;
+    o->volume = -1;
+
+    if (moving) {
+        /* Cancel any in-progress fade-out; continue fading in from that level */
+        if (g->fading) {
+            g->fading     = false;
+            g->fadein     = true;
+            g->fadein_vol = g->fade_vol;
+        }
+        g->pause_sent = false; /* re-arm for next stop */
+        /* Rising edge: encoder started spinning while song is paused */
+        if (!g->was_moving && paused && have_song) {
+            /* Pre-silence output, then resume and ramp up */
+            g->fadein     = true;
+            g->fadein_vol = 0;
+            o->volume     = 0;
+            o->resume     = true;
+        }
+        /* Step fade-in each tick until target volume is reached */
+        if (g->fadein && fade_step > 0) {
+            g->fadein_vol += (int16_t)fade_step;
+            if (g->fadein_vol >= (int16_t)vol) {
+                g->fadein_vol = (int16_t)vol;
+                g->fadein     = false;
+            }
+            o->volume = g->fadein_vol;
+        }
+    } else {
+        /* Cancel any in-progress fade-in; start fade-out from that level */
+        if (g->fadein) {
+            g->fadein   = false;
+            g->fading   = true;
+            g->fade_vol = g->fadein_vol;
+        }
+        /* Encoder stopped – fade volume to 0 before pausing */
+        if (playing && !g->pause_sent) {
+            if (!g->fading) {
+                /* Start fade from the current poti volume */
+                g->fading   = true;
+                g->fade_vol = (int16_t)vol;
+            }
+            if (fade_step > 0) {
+                g->fade_vol -= (int16_t)fade_step;
+                if (g->fade_vol <= 0) {
+                    /* Fade complete – pause and restore volume so the
+                     * next resume starts at the correct level */
+                    g->fade_vol   = 0;
+                    g->fading     = false;
+                    o->volume     = (int16_t)vol;
+                    o->pause      = true;
+                    g->pause_sent = true;
+                } else {
+                    o->volume = g->fade_vol;
+                }
+            } else {
+                /* No audio pipeline – pause immediately */
+                g->fading     = false;
+                o->pause      = true;
+                g->pause_sent = true;
+            }
+        }
+    }
+    g->was_moving = moving;
+}
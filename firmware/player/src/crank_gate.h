@@ -0,0 +1,61 @@
+/**
+ * @file crank_gate.h
+ * @brief Crank-driven pause / resume with volume fades.
+ *
+ * Runs once per io_task tick on the moving / stopped state of encoder2:
+ *
+ *   crank starts while paused  → silence output, resume, fade volume in
+ *   crank stops while playing  → fade volume out, then pause and restore
+ *                                the volume for the next resume
+ *
+ * A reversal mid-fade cross-fades from the current level.  The caller owns
+ * the side effects: it applies the returned volume and raises the pause /
+ * resume commands for audio_task.
+ *
+ * Plain C/C++ without ESP-IDF dependencies so tools/crank_replay.py can
+ * build it on the host.
+ */
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    bool    was_moving;      /**< moving at the previous tick               */
+    bool    pause_sent;      /**< pause issued, re-armed when moving again  */
+    bool    fading;          /**< fade-out active                           */
+    bool    fadein;          /**< fade-in active                            */
+    int16_t fade_vol;        /**< fade-out level (vol → 0)                  */
+    int16_t fadein_vol;      /**< fade-in level  (0 → vol)                  */
+} crank_gate_t;
+
+typedef struct {
+    bool    resume;          /**< raise the resume command                  */
+    bool    pause;           /**< raise the pause command                   */
+    int16_t volume;          /**< volume to apply this tick, −1 = unchanged */
+} crank_gate_out_t;
+
+/** @brief Clear @p g (stopped, no fade). */
+void crank_gate_reset(crank_gate_t *g);
+
+/**
+ * @brief Advance one io_task tick.
+ *
+ * @param moving     encoder2_is_moving()
+ * @param playing    g_is_playing
+ * @param paused     g_is_paused
+ * @param have_song  a song is loaded
+ * @param vol        target volume (poti)
+ * @param fade_step  volume units per tick; 0 = no audio pipeline, pause at
+ *                   once and never step the volume
+ */
+void crank_gate_step(crank_gate_t *g, bool moving, bool playing, bool paused,
+                     bool have_song, uint8_t vol, uint8_t fade_step,
+                     crank_gate_out_t *o);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,129 @@
+/**
+ * @file crank_trace.cpp
+ * @brief Crank flight recorder – see crank_trace.h.
+ *
+ * The ring is written by io_task and read by the HTTP server task.  A read
+ * holds the ring for the whole download instead of copying 600 KB: io_task
+ * drops (and counts) its records meanwhile, a second or two per download.
+ */
+
+#include "crank_trace.h"
+#include "crank_config.h"
+#include "crank_filter.h"
+
+#include "freertos/FreeRTOS.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "crank_trace";
+
+/* 5 minutes of 10 ms ticks, 20 bytes each → 600 KB PSRAM. */
+#define CRANK_TRACE_RECORDS  30000u
+
+static_assert(sizeof(crank_trace_rec_t) == 20, "trace record layout");
+static_assert(sizeof(crank_trace_hdr_t) == 64, "trace header layout");
+
+static crank_trace_rec_t *s_ring  = nullptr;
+static portMUX_TYPE s_mux         = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t     s_written     = 0;     /* records ever added           */
+static uint32_t     s_cfg_seq     = 0;     /* s_written at the last config change */
+static uint32_t     s_lost        = 0;
+static bool         s_held        = false;
+
+void crank_trace_init(void)
+{
+    s_ring = (crank_trace_rec_t *)heap_caps_malloc(
+        CRANK_TRACE_RECORDS * sizeof(crank_trace_rec_t), MALLOC_CAP_SPIRAM);
+    if (!s_ring) {
+        ESP_LOGW(TAG, "No PSRAM for the crank trace – recorder off");
+        return;
+    }
+    ESP_LOGI(TAG, "Recording %u s of crank ticks",
+             (unsigned)(CRANK_TRACE_RECORDS * CRANK_TICK_S));
+}
+
+void crank_trace_add(const crank_trace_rec_t *r)
+{
+    if (!s_ring) return;
+    portENTER_CRITICAL(&s_mux);
+    if (s_held) {
+        s_lost++;
+    } else {
+        s_ring[s_written % CRANK_TRACE_RECORDS] = *r;
+        s_written++;
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void crank_trace_config_changed(void)
+{
+    portENTER_CRITICAL(&s_mux);
+    s_cfg_seq = s_written;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void crank_trace_clear(void)
+{
+    portENTER_CRITICAL(&s_mux);
+    s_written = 0;
+    s_cfg_seq = 0;
+    s_lost    = 0;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+size_t crank_trace_read_begin(crank_trace_hdr_t *hdr)
+{
+    portENTER_CRITICAL(&s_mux);
+    s_held = true;
+    uint32_t written = s_written;
+    uint32_t cfg_seq = s_cfg_seq;
+    uint32_t lost    = s_lost;
+    portEXIT_CRITICAL(&s_mux);
+
+    uint32_t count = s_ring ? (written < CRANK_TRACE_RECORDS ? written : CRANK_TRACE_RECORDS) : 0;
+    uint32_t first = written - count;
+
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->magic         = CRANK_TRACE_MAGIC;
+    hdr->version       = CRANK_TRACE_VERSION;
+    hdr->rec_size      = sizeof(crank_trace_rec_t);
+    hdr->count         = count;
+    hdr->lost          = lost;
+    hdr->cfg_since     = (cfg_seq > first) ? cfg_seq - first : 0;
+    hdr->tick_us       = (uint32_t)(CRANK_TICK_S * 1e6f + 0.5f);
+    hdr->ema_attack    = g_crank_cfg.ema_attack;
+    hdr->ema_release   = g_crank_cfg.ema_release;
+    hdr->stop_thresh   = g_crank_cfg.stop_thresh;
+    hdr->start_thresh  = g_crank_cfg.start_thresh;
+    hdr->ab_alpha      = g_crank_cfg.ab_alpha;
+    hdr->ab_beta       = g_crank_cfg.ab_beta;
+    hdr->ab_lead       = g_crank_cfg.ab_lead;
+    hdr->release_ticks = g_crank_cfg.release_ticks;
+    hdr->crank_dir     = g_crank_cfg.crank_dir;
+    hdr->estimator     = g_crank_cfg.estimator;
+    hdr->speed_mode    = g_crank_cfg.speed_mode;
+    hdr->vol_fade_step = g_crank_cfg.vol_fade_step;
+    return count;
+}
+
+size_t crank_trace_read(size_t first, void *dst, size_t n)
+{
+    /* Held: s_written cannot change until crank_trace_read_end(). */
+    uint32_t count = s_written < CRANK_TRACE_RECORDS ? s_written : CRANK_TRACE_RECORDS;
+    if (!s_ring || first >= count) return 0;
+    if (n > count - first) n = count - first;
+    uint32_t start = s_written - count + (uint32_t)first;
+    uint8_t *d = (uint8_t *)dst;
+    for (size_t i = 0; i < n; i++, d += sizeof(crank_trace_rec_t)) {
+        memcpy(d, &s_ring[(start + i) % CRANK_TRACE_RECORDS], sizeof(crank_trace_rec_t));
+    }
+    return n;
+}
+
+void crank_trace_read_end(void)
+{
+    portENTER_CRITICAL(&s_mux);
+    s_held = false;
+    portEXIT_CRITICAL(&s_mux);
+}
@@ -0,0 +1,102 @@
+/**
+ * @file crank_trace.h
+ * @brief Crank flight recorder: the last minutes of io_task ticks in PSRAM.
+ *
+ * io_task appends one record per 10 ms tick: the raw PCNT delta with its
+ * timestamp, the edge-timing speed, the speed encoder2 returned and the
+ * crank_gate decisions.  The ring always runs; GET /api/crank_trace
+ * downloads it as a binary file that tools/crank_replay.py replays through
+ * crank_filter / crank_gate under any candidate config.
+ *
+ * File layout (little endian): crank_trace_hdr_t, then hdr.count records of
+ * crank_trace_rec_t, oldest first.
+ */
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CRANK_TRACE_MAGIC    0x31525443u   /* "CTR1" */
+#define CRANK_TRACE_VERSION  1
+
+/* crank_trace_rec_t.flags */
+#define CRANK_TR_WINDOW   0x01   /**< tick completed a 50 ms window        */
+#define CRANK_TR_MOVING   0x02   /**< encoder2_is_moving()                 */
+#define CRANK_TR_PLAYING  0x04   /**< g_is_playing at the gate             */
+#define CRANK_TR_PAUSED   0x08   /**< g_is_paused at the gate              */
+#define CRANK_TR_SONG     0x10   /**< a song is loaded                     */
+#define CRANK_TR_PAUSE    0x20   /**< crank_gate raised pause              */
+#define CRANK_TR_RESUME   0x40   /**< crank_gate raised resume             */
+
+typedef struct {
+    uint32_t t_us;           /**< esp_timer at the PCNT read, low 32 bits  */
+    int16_t  delta;          /**< PCNT counts this tick (saturated)        */
+    uint8_t  flags;          /**< CRANK_TR_*                               */
+    uint8_t  vol;            /**< poti volume, the level fades run to      */
+    float    edge_rps;       /**< edge-timing speed at window ends, < 0 = none */
+    float    out;            /**< encoder2_update() result [RPS]           */
+    float    latency_s;      /**< output latency (α-β look-ahead base)     */
+} crank_trace_rec_t;
+
+/** Download header; the config is the one in force since record cfg_since. */
+typedef struct {
+    uint32_t magic;          /**< CRANK_TRACE_MAGIC                        */
+    uint16_t version;        /**< CRANK_TRACE_VERSION                      */
+    uint16_t rec_size;       /**< sizeof(crank_trace_rec_t)                */
+    uint32_t count;          /**< records that follow                      */
+    uint32_t lost;           /**< records dropped while a download held the ring */
+    uint32_t cfg_since;      /**< first record made under the config below */
+    uint32_t tick_us;        /**< nominal io_task tick                     */
+    float    ema_attack;
+    float    ema_release;
+    float    stop_thresh;
+    float    start_thresh;
+    float    ab_alpha;
+    float    ab_beta;
+    float    ab_lead;
+    uint8_t  release_ticks;
+    int8_t   crank_dir;
+    uint8_t  estimator;
+    uint8_t  speed_mode;
+    uint8_t  vol_fade_step;
+    uint8_t  reserved[7];
+} crank_trace_hdr_t;
+
+/**
+ * @brief Allocate the ring in PSRAM.  Without it the recorder stays off and
+ *        every other call is a no-op.
+ */
+void   crank_trace_init(void);
+
+/** @brief Append one record (io_task only).  Dropped while a read holds the ring. */
+void   crank_trace_add(const crank_trace_rec_t *r);
+
+/** @brief Mark the current g_crank_cfg as the one later records run under. */
+void   crank_trace_config_changed(void);
+
+/** @brief Discard all records. */
+void   crank_trace_clear(void);
+
+/**
+ * @brief Stop recording and fill @p hdr for a download.
+ *        Every call must be paired with crank_trace_read_end().
+ * @return Number of records available (hdr->count).
+ */
+size_t crank_trace_read_begin(crank_trace_hdr_t *hdr);
+
+/**
+ * @brief Copy records [first, first + n) of the held ring, oldest first,
+ *        to @p dst (any alignment).
+ * @return Records copied.
+ */
+size_t crank_trace_read(size_t first, void *dst, size_t n);
+
+/** @brief Resume recording after a download. */
+void   crank_trace_read_end(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,299 @@
+/**
+ * @file cue_track.cpp
+ * @brief Per-song cue track – see cue_track.h.
+ *
+ * The selected song's cues (compiled intro first, then the sidecar, merged
+ * by time) sit in one sorted array.  cue_track_eval() applies every cue up
+ * to the position and leaves the cursor on the next one; ramps are stored
+ * as (from, to, start, length) per lane and evaluated at the position, so
+ * they are exact at any crank speed and after forward seeks.
+ */
+
+#include "cue_track.h"
+#include "library.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+static const char *TAG = "cue";
+
+#define CUE_MAGIC        "CUE1"
+#define CUE_PATH_MAX     128
+#define CUE_INTRO_MAX    2
+#define CUE_SEEK_BACK_S  0.1f   /* position step back treated as a seek */
+
+typedef struct __attribute__((packed)) {
+    char     magic[4];
+    uint32_t count;
+} cue_hdr_t;
+static_assert(sizeof(cue_hdr_t) == 8, "cue header layout");
+static_assert(sizeof(cue_t) == 8, "cue record layout");
+
+/* Lane value: from → to over [t0, t0 + dur]. */
+typedef struct {
+    float from, to;
+    float t0, dur;
+} lane_t;
+
+static SemaphoreHandle_t s_mutex = nullptr;   /* guards everything below */
+static char   s_path[CUE_PATH_MAX] = {};
+static cue_t *s_file     = nullptr;           /* sidecar cues               */
+static int    s_file_n   = 0;
+static cue_t  s_intro[CUE_INTRO_MAX];         /* holdoff / fade-in          */
+static int    s_intro_n  = 0;
+static cue_t *s_cues     = nullptr;           /* merged, sorted             */
+static int    s_n        = 0;
+
+/* Scheduler state. */
+static int    s_cursor   = 0;                 /* next cue to apply          */
+static float  s_last_pos = -1.0f;             /* < 0: replay from start     */
+static lane_t s_lamp, s_vol;
+static float  s_tempo    = 0.0f;
+
+/* ── Helpers ──────────────────────────────────────────────────────────── */
+
+/* "/sdcard/foo.wav" → "/sdcard/foo.cue".  false if not a .wav path. */
+static bool cue_path_of(const char *wav_path, char *out, size_t bufsz)
+{
+    size_t len = strlen(wav_path);
+    if (len < 4 || len >= bufsz || strcasecmp(wav_path + len - 4, ".wav") != 0) return false;
+    memcpy(out, wav_path, len - 4);
+    memcpy(out + len - 4, ".cue", 5);
+    return true;
+}
+
+static bool cue_valid(const cue_t *c)
+{
+    switch (c->type) {
+    case CUE_LAMP_LEVEL:
+    case CUE_LAMP_RAMP:
+    case CUE_VOLUME_RAMP: return c->value <= 100u;
+    case CUE_TEMPO_LOCK:  return true;
+    default:              return false;
+    }
+}
+
+/* Sidecar cues of @p wav_path into a new array; 0 if none, -1 if damaged. */
+static int load_file(const char *wav_path, cue_t **out)
+{
+    *out = nullptr;
+    char cue_path[CUE_PATH_MAX];
+    if (!cue_path_of(wav_path, cue_path, sizeof(cue_path))) return 0;
+    FILE *f = fopen(cue_path, "rb");
+    if (!f) return 0;
+
+    cue_hdr_t h;
+    bool ok = fread(&h, sizeof(h), 1, f) == 1 && memcmp(h.magic, CUE_MAGIC, 4) == 0
+           && h.count > 0 && h.count <= CUE_TRACK_MAX;
+    cue_t *c = ok ? (cue_t *)malloc(sizeof(cue_t) * h.count) : nullptr;
+    ok = c && fread(c, sizeof(cue_t), h.count, f) == h.count;
+    fclose(f);
+    for (uint32_t i = 0; ok && i < h.count; i++) {
+        ok = cue_valid(&c[i]) && (i == 0 || c[i - 1].t_ms <= c[i].t_ms);
+    }
+    if (!ok) {
+        free(c);
+        ESP_LOGW(TAG, "%s: damaged, ignored", cue_path);
+        return -1;
+    }
+    *out = c;
+    return (int)h.count;
+}
+
+/* Holdoff / fade-in as cues: lamp off from 0, on (or ramping up) at the
+ * holdoff timestamp.  Without a holdoff the fade-in never applied. */
+static void compile_intro(float holdoff_s, float fadein_s)
+{
+    s_intro_n = 0;
+    if (holdoff_s <= 0.0f) return;
+    s_intro[s_intro_n++] = { 0u, CUE_LAMP_LEVEL, 0u, 0u };
+    float ramp_ms = fadein_s * 1000.0f;
+    if (ramp_ms > 65535.0f) ramp_ms = 65535.0f;
+    cue_t on = { (uint32_t)(holdoff_s * 1000.0f + 0.5f), CUE_LAMP_LEVEL, 100u, 0u };
+    if (ramp_ms >= 1.0f) {
+        on.type   = CUE_LAMP_RAMP;
+        on.dur_ms = (uint16_t)ramp_ms;
+    }
+    s_intro[s_intro_n++] = on;
+}
+
+static void reset_lanes(void)
+{
+    s_lamp     = { 1.0f, 1.0f, 0.0f, 0.0f };
+    s_vol      = { 1.0f, 1.0f, 0.0f, 0.0f };
+    s_tempo    = 0.0f;
+    s_cursor   = 0;
+}
+
+/* Merge intro and sidecar cues (intro first on equal times, so a sidecar
+ * cue at the same instant wins).  Caller holds s_mutex. */
+static void rebuild_locked(void)
+{
+    free(s_cues);
+    s_cues = nullptr;
+    s_n    = 0;
+    int total = s_intro_n + s_file_n;
+    if (total > 0) s_cues = (cue_t *)malloc(sizeof(cue_t) * (size_t)total);
+    if (s_cues) {
+        int i = 0, j = 0;
+        while (i < s_intro_n || j < s_file_n) {
+            bool intro = j >= s_file_n || (i < s_intro_n && s_intro[i].t_ms <= s_file[j].t_ms);
+            s_cues[s_n++] = intro ? s_intro[i++] : s_file[j++];
+        }
+    } else if (total > 0) {
+        ESP_LOGE(TAG, "Out of memory for %d cues", total);
+    }
+    reset_lanes();
+    s_last_pos = -1.0f;
+}
+
+static float lane_value(const lane_t *l, float t)
+{
+    if (l->dur <= 0.0f || t >= l->t0 + l->dur) return l->to;
+    if (t <= l->t0) return l->from;
+    return l->from + (l->to - l->from) * (t - l->t0) / l->dur;
+}
+
+static void apply(const cue_t *c)
+{
+    float t = (float)c->t_ms / 1000.0f;
+    float v = (float)c->value / 100.0f;
+    switch (c->type) {
+    case CUE_LAMP_LEVEL:
+        s_lamp = { v, v, t, 0.0f };
+        break;
+    case CUE_LAMP_RAMP:
+        s_lamp = { lane_value(&s_lamp, t), v, t, (float)c->dur_ms / 1000.0f };
+        break;
+    case CUE_VOLUME_RAMP:
+        s_vol = { lane_value(&s_vol, t), v, t, (float)c->dur_ms / 1000.0f };
+        break;
+    case CUE_TEMPO_LOCK:
+        s_tempo = v;
+        break;
+    }
+}
+
+/* ── Public API ───────────────────────────────────────────────────────── */
+
+void cue_track_init(void)
+{
+    if (!s_mutex) s_mutex = xSemaphoreCreateMutex();
+    reset_lanes();
+}
+
+void cue_track_select(const char *wav_path, bool has_sidecar, float holdoff_s, float fadein_s)
+{
+    cue_t *file = nullptr;
+    int    n    = (wav_path && has_sidecar) ? load_file(wav_path, &file) : 0;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    free(s_file);
+    s_file   = file;
+    s_file_n = (n > 0) ? n : 0;
+    if (wav_path) snprintf(s_path, sizeof(s_path), "%s", wav_path);
+    else          s_path[0] = '\0';
+    compile_intro(wav_path ? holdoff_s : 0.0f, fadein_s);
+    rebuild_locked();
+    xSemaphoreGive(s_mutex);
+
+    if (s_file_n > 0) ESP_LOGI(TAG, "%s: %d cues", wav_path, s_file_n);
+}
+
+void cue_track_set_intro(float holdoff_s, float fadein_s)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (s_path[0] != '\0') {
+        compile_intro(holdoff_s, fadein_s);
+        rebuild_locked();
+    }
+    xSemaphoreGive(s_mutex);
+}
+
+void cue_track_eval(float pos_s, cue_out_t *out)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (s_last_pos < 0.0f || pos_s < s_last_pos - CUE_SEEK_BACK_S) reset_lanes();
+    uint32_t pos_ms = (pos_s > 0.0f) ? (uint32_t)(pos_s * 1000.0f) : 0u;
+    while (s_cursor < s_n && s_cues[s_cursor].t_ms <= pos_ms) {
+        apply(&s_cues[s_cursor++]);
+    }
+    s_last_pos  = (pos_s > 0.0f) ? pos_s : 0.0f;
+    out->lamp   = lane_value(&s_lamp, pos_s);
+    out->volume = lane_value(&s_vol, pos_s);
+    out->tempo  = s_tempo;
+    xSemaphoreGive(s_mutex);
+}
+
+int cue_track_read(const char *wav_path, cue_t *out, int max)
+{
+    cue_t *c = nullptr;
+    int    n = load_file(wav_path, &c);
+    if (n > max) n = max;
+    if (n > 0) memcpy(out, c, sizeof(cue_t) * (size_t)n);
+    free(c);
+    return n;
+}
+
+bool cue_track_write(const char *wav_path, cue_t *cues, int n)
+{
+    char cue_path[CUE_PATH_MAX];
+    if (!wav_path || n < 0 || n > CUE_TRACK_MAX
+        || !cue_path_of(wav_path, cue_path, sizeof(cue_path))) return false;
+    for (int i = 0; i < n; i++) {
+        if (!cue_valid(&cues[i])) return false;
+    }
+    /* Stable insertion sort: cues at the same time keep their order. */
+    for (int i = 1; i < n; i++) {
+        cue_t c = cues[i];
+        int   j = i;
+        for (; j > 0 && cues[j - 1].t_ms > c.t_ms; j--) cues[j] = cues[j - 1];
+        cues[j] = c;
+    }
+
+    if (n == 0) {
+        remove(cue_path);
+    } else {
+        char tmp_path[CUE_PATH_MAX + 4];
+        snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", cue_path);
+        cue_hdr_t h;
+        memcpy(h.magic, CUE_MAGIC, 4);
+        h.count = (uint32_t)n;
+        FILE *o = fopen(tmp_path, "wb");
+        bool ok = o && fwrite(&h, sizeof(h), 1, o) == 1
+               && fwrite(cues, sizeof(cue_t), (size_t)n, o) == (size_t)n;
+        if (o) fclose(o);
+        if (ok) {
+            remove(cue_path);
+            ok = rename(tmp_path, cue_path) == 0;
+        }
+        if (!ok) {
+            remove(tmp_path);
+            ESP_LOGE(TAG, "Cannot write %s", cue_path);
+            return false;
+        }
+    }
+    library_note_sidecar(wav_path, LIB_SIDE_CUE, n > 0);
+
+    /* Reload if this is the selected song (intro cues are kept). */
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    bool selected = strcmp(s_path, wav_path) == 0;
+    xSemaphoreGive(s_mutex);
+    if (!selected) return true;
+
+    cue_t *file = nullptr;
+    int    fn   = load_file(wav_path, &file);
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    free(s_file);
+    s_file   = file;
+    s_file_n = (fn > 0) ? fn : 0;
+    rebuild_locked();
+    xSemaphoreGive(s_mutex);
+    return true;
+}
@@ -0,0 +1,91 @@
+/**
+ * @file cue_track.h
+ * @brief Per-song cue track: timestamped lamp / volume / tempo automation.
+ *
+ * A song's cues live in a binary sidecar next to the WAV, sorted by time:
+ * "/sdcard/foo.wav" → "/sdcard/foo.cue".  The song's dimmer_holdoff_s and
+ * dimmer_fadein_s settings are compiled into cues as well (lamp off from 0,
+ * lamp ramp to 100 % at the holdoff timestamp), so io_task has a single
+ * source for time-based lamp behaviour.
+ *
+ * io_task evaluates the track every tick at the audible song position
+ * (cue_track_eval()).  A cursor remembers the next cue, so a tick costs the
+ * same however long the list is; only a seek backwards replays the list
+ * from the start.
+ *
+ * Each cue acts on one lane:
+ *   lamp     – scale 0–100 % of the lamp level io_task computes
+ *              (crank speed or light organ, between dimmer_min/max)
+ *   volume   – scale 0–100 % of the volume poti
+ *   tempo    – speed override (tempo lock) or release
+ *
+ * File layout (little endian):
+ *   8-byte header   "CUE1", u32 count
+ *   count × 8 B     u32 t_ms, u8 type, u8 value, u16 dur_ms
+ */
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CUE_TRACK_MAX   1024    /* cues per song, sidecar included */
+
+typedef enum {
+    CUE_LAMP_LEVEL  = 1,   /**< lamp scale = value %, at once            */
+    CUE_LAMP_RAMP   = 2,   /**< lamp scale → value % over dur_ms         */
+    CUE_VOLUME_RAMP = 3,   /**< volume scale → value % over dur_ms       */
+    CUE_TEMPO_LOCK  = 4,   /**< speed = value / 100 (0 releases the lock) */
+} cue_type_t;
+
+typedef struct {
+    uint32_t t_ms;     /**< song position of the cue        */
+    uint8_t  type;     /**< cue_type_t                      */
+    uint8_t  value;    /**< percent, or speed × 100         */
+    uint16_t dur_ms;   /**< ramp length (ramps only)        */
+} cue_t;
+
+/** Lane values at one song position. */
+typedef struct {
+    float lamp;        /**< 0–1 lamp scale (1 without cues)              */
+    float volume;      /**< 0–1 volume scale (1 without cues)            */
+    float tempo;       /**< speed override, 0 = none                     */
+} cue_out_t;
+
+/** @brief Create the lock.  Call once from app_main before any other call. */
+void cue_track_init(void);
+
+/**
+ * @brief Make @p wav_path the song cue_track_eval() answers for: loads its
+ *        ".cue" sidecar (if @p has_sidecar, from the library index) and
+ *        compiles the lamp intro from @p holdoff_s / @p fadein_s.  NULL
+ *        clears the track.
+ */
+void cue_track_select(const char *wav_path, bool has_sidecar, float holdoff_s, float fadein_s);
+
+/** @brief Recompile the lamp intro of the selected song (settings edited). */
+void cue_track_set_intro(float holdoff_s, float fadein_s);
+
+/** @brief Lane values at song position @p pos_s.  Called by io_task. */
+void cue_track_eval(float pos_s, cue_out_t *out);
+
+/**
+ * @brief Read the ".cue" sidecar of @p wav_path (sidecar cues only).
+ * @return Number of cues stored in @p out (≤ @p max), 0 if none, -1 on a
+ *         damaged file.
+ */
+int  cue_track_read(const char *wav_path, cue_t *out, int max);
+
+/**
+ * @brief Sort @p cues by time and store them as the ".cue" sidecar of
+ *        @p wav_path; @p n == 0 removes it.  Reloads the track if the song
+ *        is selected.
+ * @return false on an invalid cue or a write error.
+ */
+bool cue_track_write(const char *wav_path, cue_t *cues, int n);
+
+#ifdef __cplusplus
+}
+#endif
@@ -12,6 +12,13 @@
  *      (SDA=GPIO4 as UART TX, SCL=GPIO0 as UART RX), 115200/8N1.
  *   3. After a successful switch, re-probes over I2C and logs device status.
  *
+ * Level writes are asynchronous: dimmerlink_set_level() drops the value in
+ * a single-slot mailbox (a newer value replaces one not yet sent) and wakes
+ * a writer task, which sends at most one level per DL_MIN_PERIOD_MS.  After
+ * DL_FAIL_LIMIT failed writes in a row the device is taken as absent and
+ * re-probed over I2C with exponential backoff (DL_BACKOFF_MIN_MS …
+ * DL_BACKOFF_MAX_MS); the latest level is sent once it answers again.
+ *
  * I2C connection parameters (from datasheet):
  *   Address : 0x50 (7-bit)
  *   Speed   : 100 kHz (Standard Mode)
@@ -25,6 +32,7 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "driver/gpio.h"
 #include "driver/i2c_master.h"
 #include "driver/uart.h"
@@ -57,11 +65,33 @@ static const char *TAG = "dimmerlink";
 /* SWITCH_I2C command frame: STX(0x02) + CMD(0x5B) */
 static const uint8_t k_switch_i2c_cmd[2] = { 0x02u, 0x5Bu };
 
+/* Writer task */
+#define DL_MIN_PERIOD_MS    20      /* ≤ 50 level writes per second        */
+#define DL_WRITE_TIMEOUT_MS 20
+#define DL_PROBE_TIMEOUT_MS 50
+#define DL_FAIL_LIMIT       3       /* consecutive failures → absent        */
+#define DL_BACKOFF_MIN_MS   250
+#define DL_BACKOFF_MAX_MS   8000
+#define DL_RATE_WINDOW_MS   1000
+#define DL_TASK_STACK       3072
+#define DL_TASK_PRIO        4       /* below io_task, above the analysis tasks */
+#define DL_TASK_CORE        0
+
+#define DL_SLOT_FULL        0x100u  /* mailbox: bit 8 set = level pending  */
+
 /* ── Module state ──────────────────────────────────────────────────────── */
 
 static i2c_master_bus_handle_t s_bus = nullptr;
 static i2c_master_dev_handle_t s_dev = nullptr;
 
+static SemaphoreHandle_t s_bus_lock  = nullptr;  /* s_bus/s_dev: writer vs suspend/resume */
+static TaskHandle_t      s_task      = nullptr;
+static volatile uint32_t s_mailbox   = 0;        /* DL_SLOT_FULL | pct, 0 = empty */
+static volatile uint8_t  s_requested = 0;        /* last level asked for          */
+static volatile bool     s_suspended = false;
+static volatile bool     s_probe_now = false;    /* resume: re-probe at once      */
+static dimmerlink_stats_t s_stats    = {};
+
 /* ── I2C helpers ───────────────────────────────────────────────────────── */
 
 /**
@@ -76,6 +106,28 @@ static esp_err_t read_reg(uint8_t reg, uint8_t *out)
                                        /*timeout_ms=*/50);
 }
 
+static void fill_bus_cfg(i2c_master_bus_config_t *bus_cfg)
+{
+    memset(bus_cfg, 0, sizeof(*bus_cfg));
+    bus_cfg->i2c_port           = I2C_NUM_0;
+    bus_cfg->sda_io_num         = (gpio_num_t)DIMMERLINK_SDA_PIN;
+    bus_cfg->scl_io_num         = (gpio_num_t)DIMMERLINK_SCL_PIN;
+    bus_cfg->clk_source         = I2C_CLK_SRC_DEFAULT;
+    bus_cfg->glitch_ignore_cnt  = 7;
+    /* External 4.7 kΩ pull-ups are required; do not enable internal pull-ups. */
+    bus_cfg->flags.enable_internal_pullup = false;
+}
+
+static esp_err_t add_device(void)
+{
+    i2c_device_config_t dev_cfg;
+    memset(&dev_cfg, 0, sizeof(dev_cfg));
+    dev_cfg.dev_addr_length = I2C_ADDR_BIT_LEN_7;
+    dev_cfg.device_address  = DIMMERLINK_I2C_ADDR;
+    dev_cfg.scl_speed_hz    = DIMMERLINK_SPEED_HZ;
+    return i2c_master_bus_add_device(s_bus, &dev_cfg, &s_dev);
+}
+
 /* ── UART fallback ─────────────────────────────────────────────────────── */
 
 /**
@@ -138,20 +190,152 @@ static bool uart_switch_to_i2c(void)
     return false;
 }
 
-/* ── Public API ────────────────────────────────────────────────────────── */
+/* ── Writer task ───────────────────────────────────────────────────────── */
 
-bool dimmerlink_probe(void)
+/* I2C-only re-probe (the UART switch is a one-time factory step).
+ * Re-creates the bus after a failed boot probe or a resume. */
+static bool reprobe(void)
+{
+    bool ok = false;
+    xSemaphoreTake(s_bus_lock, portMAX_DELAY);
+    if (!s_suspended) {
+        if (!s_bus) {
+            i2c_master_bus_config_t bus_cfg;
+            fill_bus_cfg(&bus_cfg);
+            if (i2c_new_master_bus(&bus_cfg, &s_bus) != ESP_OK) s_bus = nullptr;
+        }
+        ok = s_bus
+          && i2c_master_probe(s_bus, DIMMERLINK_I2C_ADDR, DL_PROBE_TIMEOUT_MS) == ESP_OK
+          && (s_dev || add_device() == ESP_OK);
+    }
+    xSemaphoreGive(s_bus_lock);
+    s_stats.reprobes++;
+    return ok;
+}
+
+static esp_err_t write_level(uint8_t pct)
+{
+    esp_err_t err = ESP_ERR_INVALID_STATE;
+    xSemaphoreTake(s_bus_lock, portMAX_DELAY);
+    if (s_dev && !s_suspended) {
+        uint8_t buf[2] = { REG_DIM0_LEVEL, pct };
+        err = i2c_master_transmit(s_dev, buf, sizeof(buf), DL_WRITE_TIMEOUT_MS);
+    }
+    xSemaphoreGive(s_bus_lock);
+    return err;
+}
+
+static void writer_task(void *arg)
+{
+    (void)arg;
+    const TickType_t period     = pdMS_TO_TICKS(DL_MIN_PERIOD_MS);
+    TickType_t       last_write = xTaskGetTickCount() - period;
+    TickType_t       next_probe = xTaskGetTickCount();
+    TickType_t       win_start  = xTaskGetTickCount();
+    uint32_t         win_writes = 0;
+    uint32_t         backoff_ms = DL_BACKOFF_MIN_MS;
+    uint8_t          fails      = 0;
+    int              written    = -1;   /* level the device holds, -1 = unknown */
+
+    for (;;) {
+        TickType_t now  = xTaskGetTickCount();
+        TickType_t wait = pdMS_TO_TICKS(DL_RATE_WINDOW_MS);
+        if (!s_stats.online && !s_suspended) {
+            wait = (int32_t)(next_probe - now) > 0 ? next_probe - now : 0;
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+        now = xTaskGetTickCount();
+
+        if (now - win_start >= pdMS_TO_TICKS(DL_RATE_WINDOW_MS)) {
+            s_stats.rate_hz = (uint16_t)(win_writes * 1000u / ((now - win_start) * portTICK_PERIOD_MS));
+            win_writes = 0;
+            win_start  = now;
+        }
+        if (s_suspended) continue;
+
+        if (s_probe_now) {
+            s_probe_now    = false;
+            s_stats.online = false;
+            next_probe     = now;
+            backoff_ms     = DL_BACKOFF_MIN_MS;
+        }
+        if (!s_stats.online) {
+            if ((int32_t)(now - next_probe) < 0) continue;
+            if (!reprobe()) {
+                next_probe = now + pdMS_TO_TICKS(backoff_ms);
+                backoff_ms = (backoff_ms * 2u > DL_BACKOFF_MAX_MS) ? DL_BACKOFF_MAX_MS : backoff_ms * 2u;
+                continue;
+            }
+            ESP_LOGI(TAG, "DimmerLink answering again");
+            s_stats.online = true;
+            backoff_ms     = DL_BACKOFF_MIN_MS;
+            fails          = 0;
+            written        = -1;
+            /* Resend the latest level unless a newer one is already waiting. */
+            uint32_t empty = 0;
+            __atomic_compare_exchange_n(&s_mailbox, &empty, DL_SLOT_FULL | s_requested,
+                                        false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+        }
+
+        /* Rate limit; values arriving meanwhile replace the pending one. */
+        if (now - last_write < period) {
+            vTaskDelay(period - (now - last_write));
+        }
+        uint32_t slot = __atomic_exchange_n(&s_mailbox, 0u, __ATOMIC_ACQ_REL);
+        if (!(slot & DL_SLOT_FULL)) continue;
+        uint8_t pct = (uint8_t)(slot & 0xFFu);
+        if ((int)pct == written) continue;
+
+        esp_err_t err = write_level(pct);
+        last_write = xTaskGetTickCount();
+        if (err == ESP_OK) {
+            written = pct;
+            fails   = 0;
+            s_stats.writes++;
+            s_stats.level = pct;
+            win_writes++;
+            continue;
+        }
+
+        s_stats.failures++;
+        written = -1;
+        /* Retry this value on the next pass unless a newer one arrived. */
+        uint32_t empty = 0;
+        __atomic_compare_exchange_n(&s_mailbox, &empty, slot,
+                                    false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+        if (++fails >= DL_FAIL_LIMIT) {
+            ESP_LOGW(TAG, "DimmerLink not answering (%s) – re-probing in the background",
+                     esp_err_to_name(err));
+            s_stats.online = false;
+            next_probe     = last_write + pdMS_TO_TICKS(backoff_ms);
+        } else {
+            xTaskNotifyGive(xTaskGetCurrentTaskHandle());   /* retry after the period */
+        }
+    }
+}
+
+static void start_writer(void)
+{
+    if (s_task) return;
+    s_bus_lock = xSemaphoreCreateMutex();
+    if (!s_bus_lock) {
+        ESP_LOGE(TAG, "Out of memory");
+        return;
+    }
+    if (xTaskCreatePinnedToCore(writer_task, "dimmerlink", DL_TASK_STACK, nullptr,
+                                DL_TASK_PRIO, &s_task, DL_TASK_CORE) != pdPASS) {
+        s_task = nullptr;
+        ESP_LOGE(TAG, "Failed to start writer task");
+    }
+}
+
+/* ── Startup probe ─────────────────────────────────────────────────────── */
+
+static bool probe_device(void)
 {
     /* ── 1. Prepare I2C master bus config (reused on retry) ─────────────── */
     i2c_master_bus_config_t bus_cfg;
-    memset(&bus_cfg, 0, sizeof(bus_cfg));
-    bus_cfg.i2c_port           = I2C_NUM_0;
-    bus_cfg.sda_io_num         = (gpio_num_t)DIMMERLINK_SDA_PIN;
-    bus_cfg.scl_io_num         = (gpio_num_t)DIMMERLINK_SCL_PIN;
-    bus_cfg.clk_source         = I2C_CLK_SRC_DEFAULT;
-    bus_cfg.glitch_ignore_cnt  = 7;
-    /* External 4.7 kΩ pull-ups are required; do not enable internal pull-ups. */
-    bus_cfg.flags.enable_internal_pullup = false;
+    fill_bus_cfg(&bus_cfg);
 
     /* ── 2. Initialise I2C master bus ───────────────────────────────────── */
     esp_err_t err = i2c_new_master_bus(&bus_cfg, &s_bus);
@@ -196,13 +380,7 @@ bool dimmerlink_probe(void)
     }
 
     /* ── 4. Register device handle ──────────────────────────────────────── */
-    i2c_device_config_t dev_cfg;
-    memset(&dev_cfg, 0, sizeof(dev_cfg));
-    dev_cfg.dev_addr_length = I2C_ADDR_BIT_LEN_7;
-    dev_cfg.device_address  = DIMMERLINK_I2C_ADDR;
-    dev_cfg.scl_speed_hz    = DIMMERLINK_SPEED_HZ;
-
-    err = i2c_master_bus_add_device(s_bus, &dev_cfg, &s_dev);
+    err = add_device();
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to add I2C device: %s", esp_err_to_name(err));
         i2c_del_master_bus(s_bus);
@@ -265,29 +443,36 @@ bool dimmerlink_probe(void)
     return true;
 }
 
+/* ── Public API ────────────────────────────────────────────────────────── */
+
+bool dimmerlink_probe(void)
+{
+    bool ok = probe_device();
+    s_stats.online = ok;
+    /* The writer runs whatever the probe found; an absent device is
+     * re-probed in the background. */
+    start_writer();
+    return ok;
+}
+
 void dimmerlink_set_level(uint8_t pct)
 {
     if (pct > 100u) pct = 100u;
+    s_requested = pct;
+    uint32_t prev = __atomic_exchange_n(&s_mailbox, DL_SLOT_FULL | pct, __ATOMIC_ACQ_REL);
+    if (prev & DL_SLOT_FULL) s_stats.coalesced++;
+    if (s_task) xTaskNotifyGive(s_task);
+}
 
-    /* Log whenever brightness changes – gives a live trace in the monitor. */
-    /*static uint8_t s_last_pct = 0xFFu;
-    if (pct != s_last_pct) {
-        s_last_pct = pct;
-        // Build a 10-char ASCII bar for quick visual reading
-        char bar[11];
-        uint8_t filled = (uint8_t)((pct + 5u) / 10u);
-        for (uint8_t i = 0; i < 10u; i++) bar[i] = (i < filled) ? '#' : '.';
-        bar[10] = '\0';
-        ESP_LOGI(TAG, "level=%3u%% [%s]%s", pct, bar, s_dev ? "" : "  (no hw)");
-    }*/
-
-    if (!s_dev) return;
-    uint8_t buf[2] = { REG_DIM0_LEVEL, pct };
-    i2c_master_transmit(s_dev, buf, sizeof(buf), /*timeout_ms=*/20);
+void dimmerlink_get_stats(dimmerlink_stats_t *out)
+{
+    if (out) *out = s_stats;
 }
 
 void dimmerlink_suspend(void)
 {
+    if (s_bus_lock) xSemaphoreTake(s_bus_lock, portMAX_DELAY);
+    s_suspended = true;
     if (s_dev) {
         i2c_master_bus_rm_device(s_dev);
         s_dev = nullptr;
@@ -296,6 +481,7 @@ void dimmerlink_suspend(void)
         i2c_del_master_bus(s_bus);
         s_bus = nullptr;
     }
+    if (s_bus_lock) xSemaphoreGive(s_bus_lock);
     /* Reset the pin to high-impedance so disp_ota can drive it freely.  *
      * The external 4.7 kΩ pull-up will hold the line HIGH during the    *
      * brief window before disp_ota pulls it LOW for download mode.      */
@@ -305,33 +491,14 @@ void dimmerlink_suspend(void)
 
 void dimmerlink_resume(void)
 {
-    if (s_bus) return;   /* already running */
-
-    i2c_master_bus_config_t bus_cfg;
-    memset(&bus_cfg, 0, sizeof(bus_cfg));
-    bus_cfg.i2c_port           = I2C_NUM_0;
-    bus_cfg.sda_io_num         = (gpio_num_t)DIMMERLINK_SDA_PIN;
-    bus_cfg.scl_io_num         = (gpio_num_t)DIMMERLINK_SCL_PIN;
-    bus_cfg.clk_source         = I2C_CLK_SRC_DEFAULT;
-    bus_cfg.glitch_ignore_cnt  = 7;
-    bus_cfg.flags.enable_internal_pullup = false;
-
-    if (i2c_new_master_bus(&bus_cfg, &s_bus) != ESP_OK) {
-        ESP_LOGE(TAG, "dimmerlink_resume: failed to recreate I2C bus");
-        return;
-    }
-
-    i2c_device_config_t dev_cfg;
-    memset(&dev_cfg, 0, sizeof(dev_cfg));
-    dev_cfg.dev_addr_length = I2C_ADDR_BIT_LEN_7;
-    dev_cfg.device_address  = DIMMERLINK_I2C_ADDR;
-    dev_cfg.scl_speed_hz    = DIMMERLINK_SPEED_HZ;
-
-    if (i2c_master_bus_add_device(s_bus, &dev_cfg, &s_dev) != ESP_OK) {
-        ESP_LOGE(TAG, "dimmerlink_resume: failed to re-add device");
-        i2c_del_master_bus(s_bus);
-        s_bus = nullptr;
-        return;
-    }
+    if (s_bus_lock) xSemaphoreTake(s_bus_lock, portMAX_DELAY);
+    bool was_suspended = s_suspended;
+    s_suspended = false;
+    if (s_bus_lock) xSemaphoreGive(s_bus_lock);
+    if (!was_suspended) return;   /* already running */
+
+    /* The writer re-creates the bus and re-probes the device. */
+    s_probe_now = true;
+    if (s_task) xTaskNotifyGive(s_task);
     ESP_LOGI(TAG, "dimmerlink resumed (I2C restored after display OTA)");
 }
@@ -6,7 +6,8 @@
  * (DIMMERLINK_SDA_PIN / DIMMERLINK_SCL_PIN), checks for the device at
  * the default 7-bit address 0x50, then reads and logs the device status.
  *
- * Call dimmerlink_probe() once during app_main.
+ * Call dimmerlink_probe() once during app_main.  It also starts the writer
+ * task that sends level changes, so callers never wait on the I2C bus.
  */
 #pragma once
 
@@ -17,6 +18,16 @@
 extern "C" {
 #endif
 
+typedef struct {
+    uint32_t writes;      /**< levels written to the device                  */
+    uint32_t coalesced;   /**< levels replaced by a newer one before sending */
+    uint32_t failures;    /**< failed level writes                           */
+    uint32_t reprobes;    /**< background re-probe attempts                  */
+    uint16_t rate_hz;     /**< level writes in the last second               */
+    uint8_t  level;       /**< last level the device acknowledged            */
+    bool     online;      /**< device answering                              */
+} dimmerlink_stats_t;
+
 /**
  * @brief Probe for the DimmerLink I2C module and log its status.
  *
@@ -28,12 +39,18 @@ bool dimmerlink_probe(void);
 /**
  * @brief Set the DimmerLink brightness.
  *
- * Safe to call even if dimmerlink_probe() returned false (no-op in that case).
+ * Never blocks: the value is handed to the writer task, which sends the
+ * latest value at most every 20 ms.  Safe to call even if
+ * dimmerlink_probe() returned false; the level is sent once the device
+ * answers a background re-probe.
  *
  * @param pct  Brightness 0–100 (percent).  Values > 100 are clamped.
  */
 void dimmerlink_set_level(uint8_t pct);
 
+/** @brief Copy the writer counters into @p out. */
+void dimmerlink_get_stats(dimmerlink_stats_t *out);
+
 /**
  * @brief Release I2C bus and free GPIO4 (SCL) for use as BOOT0 output.
  *
@@ -45,9 +62,9 @@ void dimmerlink_suspend(void);
 /**
  * @brief Re-create the I2C bus and device handle after dimmerlink_suspend().
  *
- * Does not re-run the full probe / UART fallback – just reinstates the
- * already-configured bus.  dimmerlink_set_level() will be a no-op if the
- * device is not responding, so this is safe to call unconditionally.
+ * Does not re-run the full probe / UART fallback – the writer task
+ * re-creates the bus and re-probes over I2C, so this is safe to call
+ * unconditionally.
  */
 void dimmerlink_resume(void);
 
@@ -11,7 +11,8 @@
  * Key commands used (ROM loader, no stub):
  *   SYNC         (0x08) – synchronise
  *   SPI_ATTACH   (0x0D) – attach SPI flash
- *   CHANGE_BAUD  (0x0F) – speed up after initial sync
+ *   CHANGE_BAUD  (0x0F) – speed up after initial sync (to the display link's rate)
+ *   READ_REG     (0x0A) – probe that the loader still answers after the switch
  *   FLASH_BEGIN  (0x02) – erase + prepare write region
  *   FLASH_DATA   (0x03) – write one 16 KB block
  *   FLASH_END    (0x04) – finalise + reboot
@@ -51,12 +52,15 @@ static const uint8_t SLIP_END_BYTE    = 0xC0;
 #define ROM_SYNC        0x08u
 #define ROM_SPI_ATTACH  0x0Du
 #define ROM_CHANGE_BAUD 0x0Fu
+#define ROM_READ_REG    0x0Au
 #define ROM_FLASH_BEGIN 0x02u
 #define ROM_FLASH_DATA  0x03u
 #define ROM_FLASH_END   0x04u
 
 #define FLASH_BLOCK_SIZE  0x400u    /* 1 KB per FLASH_DATA block (ROM loader; stub uses 0x4000) */
-#define OTA_BAUD_RATE     460800    /* baud after CHANGE_BAUDRATE                       */
+#define OTA_BAUD_RATE     460800    /* CHANGE_BAUDRATE fallback                         */
+#define OTA_BAUD_MAX      2000000   /* cap on the link rate for the ROM loader          */
+#define ROM_PROBE_REG     0x40001000u  /* chip-detect register; any answer will do      */
 
 #define CSUM_MAGIC 0xEFu            /* XOR-checksum seed for FLASH_DATA                 */
 
@@ -291,6 +295,31 @@ static bool rom_change_baud(uint32_t new_baud)
     return true;
 }
 
+/* A register read the loader must answer at the rate just switched to. */
+static bool rom_probe(void)
+{
+    uint8_t payload[4];
+    payload[0] = (uint8_t)(ROM_PROBE_REG        & 0xFF);
+    payload[1] = (uint8_t)((ROM_PROBE_REG >>  8) & 0xFF);
+    payload[2] = (uint8_t)((ROM_PROBE_REG >> 16) & 0xFF);
+    payload[3] = (uint8_t)((ROM_PROBE_REG >> 24) & 0xFF);
+    rom_send_cmd(ROM_READ_REG, payload, 4, 0);
+    return rom_wait_resp(ROM_READ_REG, 300);
+}
+
+/**
+ * The rate the display link has proven on this wiring (uart_master's rate
+ * ladder), capped at OTA_BAUD_MAX: the ROM loader has no retries, so it
+ * does not get the link's top steps.
+ */
+static uint32_t ota_baud_rate(void)
+{
+    uint32_t baud = uart_master_link_baud();
+    if (baud > OTA_BAUD_MAX)  baud = OTA_BAUD_MAX;
+    if (baud < OTA_BAUD_RATE) baud = OTA_BAUD_RATE;
+    return baud;
+}
+
 /**
  * FLASH_BEGIN: erase the flash region and prepare for writing.
  *
@@ -458,6 +487,9 @@ esp_err_t disp_ota_flash(const char *path, uint32_t flash_addr, httpd_req_t *req
     {
         uint32_t fw_size    = (uint32_t)st.st_size;
         uint32_t num_blocks = (fw_size + FLASH_BLOCK_SIZE - 1u) / FLASH_BLOCK_SIZE;
+        uint32_t ota_baud   = ota_baud_rate();   /* the link's rate, before the pause */
+        bool     baud_ok    = false;
+        int64_t  t_write    = 0;
         progress(req, "Firmware: %lu bytes  |  %lu blocks x %u bytes",
                  (unsigned long)fw_size, (unsigned long)num_blocks, FLASH_BLOCK_SIZE);
 
@@ -569,12 +601,21 @@ esp_err_t disp_ota_flash(const char *path, uint32_t flash_addr, httpd_req_t *req
         progress(req, "SPI_ATTACH OK");
 
         /* ── 7. CHANGE_BAUDRATE (optional speed-up) ──────────────────── */
-        progress(req, "Switching to %d baud...", OTA_BAUD_RATE);
-        if (!rom_change_baud(OTA_BAUD_RATE)) {
-            progress(req, "Warning: CHANGE_BAUDRATE failed – continuing at 115200");
+        progress(req, "Switching to %lu baud (display link rate)...", (unsigned long)ota_baud);
+        baud_ok = rom_change_baud(ota_baud) && rom_probe();
+        if (!baud_ok && ota_baud != OTA_BAUD_RATE) {
+            progress(req, "Warning: %lu baud failed – trying %d",
+                     (unsigned long)ota_baud, OTA_BAUD_RATE);
+            ota_baud = OTA_BAUD_RATE;
+            baud_ok  = rom_change_baud(ota_baud) && rom_probe();
+        }
+        if (!baud_ok) {
+            uart_get_baudrate(OTA_PORT, &ota_baud);
+            progress(req, "Warning: CHANGE_BAUDRATE failed – continuing at %lu",
+                     (unsigned long)ota_baud);
             /* non-fatal */
         } else {
-            progress(req, "Baud rate changed to %d", OTA_BAUD_RATE);
+            progress(req, "Baud rate changed to %lu", (unsigned long)ota_baud);
         }
 
         /* ── 8. FLASH_BEGIN (erase) ───────────────────────────────────── */
@@ -594,6 +635,7 @@ esp_err_t disp_ota_flash(const char *path, uint32_t flash_addr, httpd_req_t *req
             goto cleanup_uart;
         }
 
+        t_write = esp_timer_get_time();
         for (uint32_t seq = 0; seq < num_blocks; seq++) {
             memset(block, 0xFF, FLASH_BLOCK_SIZE);         /* pad with 0xFF  */
             size_t rd = fread(block, 1, FLASH_BLOCK_SIZE, fw_file);
@@ -613,6 +655,13 @@ esp_err_t disp_ota_flash(const char *path, uint32_t flash_addr, httpd_req_t *req
         }
         fclose(fw_file);
         fw_file = nullptr;
+        {
+            uint32_t ms = (uint32_t)((esp_timer_get_time() - t_write) / 1000);
+            progress(req, "Wrote %lu bytes in %lu ms (%lu B/s at %lu baud)",
+                     (unsigned long)fw_size, (unsigned long)ms,
+                     (unsigned long)(ms ? (uint64_t)fw_size * 1000u / ms : 0),
+                     (unsigned long)ota_baud);
+        }
 
         /* ── 10. FLASH_END ───────────────────────────────────────────── */
         progress(req, "Finalising flash...");
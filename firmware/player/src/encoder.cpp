@@ -17,7 +17,6 @@
 
 #include "driver/pulse_cnt.h"
 #include "driver/gpio.h"
-#include "esp_adc/adc_oneshot.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -42,9 +41,6 @@ static int s_count_remainder = 0;
 
 /* ── Button state ────────────────────────────────────────────────────────── */
 
-static adc_oneshot_unit_handle_t s_btn_adc = nullptr;
-static adc_channel_t             s_btn_ch  = ADC_CHANNEL_2;
-
 /* Debounce state */
 static int8_t  s_btn_last_id    = -1;  /* raw decoded button from last sample */
 static uint8_t s_btn_stable_cnt =  0;  /* # of consecutive identical readings */
@@ -135,23 +131,9 @@ void encoder_init(void)
     ESP_ERROR_CHECK(pcnt_unit_clear_count(s_pcnt_unit));
     ESP_ERROR_CHECK(pcnt_unit_start(s_pcnt_unit));
 
-    /* ── Button ADC (shares ADC1 handle owned by potis) ──────────────────── */
-    s_btn_adc = potis_get_adc_handle();
-
-    adc_unit_t btn_unit;
-    ESP_ERROR_CHECK(adc_oneshot_io_to_channel(BTN_ADC_PIN, &btn_unit, &s_btn_ch));
-    if (btn_unit != ADC_UNIT_1) {
-        ESP_LOGE(TAG, "BTN_ADC_PIN (GPIO%d) is not on ADC1 – check pins.h", BTN_ADC_PIN);
-    }
-
-    adc_oneshot_chan_cfg_t btn_chan_cfg = {
-        .atten    = ADC_ATTEN_DB_12,   /* 0–3.3 V */
-        .bitwidth = ADC_BITWIDTH_12,
-    };
-    ESP_ERROR_CHECK(adc_oneshot_config_channel(s_btn_adc, s_btn_ch, &btn_chan_cfg));
-
-    ESP_LOGI(TAG, "Encoder ready: A=%d B=%d BTN_ADC=GPIO%d (ADC1_CH%d, %d rungs)",
-             ENC_PIN_A, ENC_PIN_B, BTN_ADC_PIN, (int)s_btn_ch, BTN_COUNT);
+    /* Button ladder: sampled by potis' ADC1 continuous conversion. */
+    ESP_LOGI(TAG, "Encoder ready: A=%d B=%d BTN_ADC=GPIO%d (%d rungs)",
+             ENC_PIN_A, ENC_PIN_B, BTN_ADC_PIN, BTN_COUNT);
 }
 
 int16_t encoder_read_steps(void)
@@ -179,10 +161,7 @@ int16_t encoder_read_steps(void)
 
 int8_t encoder_btn_read(void)
 {
-    if (!s_btn_adc) return -1;
-
-    int raw = 0;
-    adc_oneshot_read(s_btn_adc, s_btn_ch, &raw);
+    int raw = potis_read_btn_raw();
     int8_t id = adc_to_btn(raw);
 
     /* Debounce: require BTN_DEBOUNCE_SAMPLES consecutive identical readings */
@@ -3,9 +3,9 @@
  * @brief Rotary encoder driver using the ESP32 PCNT hardware peripheral.
  *
  * Provides debounce-free rotation reading via hardware pulse counting.
- * Button detection uses ADC polling on a resistor-ladder (see BTN_ADC_PIN /
- * BTN_THRESHOLDS in pins.h) so up to BTN_COUNT independent buttons are
- * supported on a single GPIO.
+ * Button detection polls the resistor-ladder voltage that potis samples
+ * continuously (see BTN_ADC_PIN / BTN_THRESHOLDS in pins.h) so up to
+ * BTN_COUNT independent buttons are supported on a single GPIO.
  *
  * Wire:
  *   ENC_PIN_A   – encoder channel A (any GPIO with input support)
@@ -38,8 +38,8 @@ extern "C" {
 /* ── API ──────────────────────────────────────────────────────────────────── */
 
 /**
- * @brief Initialise PCNT unit and ADC button channel.
- *        potis_init() MUST be called first (shares the ADC1 handle).
+ * @brief Initialise the PCNT unit.
+ *        potis_init() MUST be called first (it samples the button ladder).
  *        Assumes gpio_install_isr_service() has already been called.
  */
 void encoder_init(void);
@@ -1,19 +1,28 @@
 /**
  * @file encoder2.cpp
- * @brief Organ-encoder driver: PCNT speed measurement with EMA smoothing.
+ * @brief Organ-encoder driver: PCNT speed measurement, crank_filter smoothing.
  *
  * Reads the 2nd rotary encoder wired to ENC2_PIN_A / ENC2_PIN_B.
  * The encoder has 360 quadrature cycles per revolution; in X4 counting mode
  * that is 1440 PCNT edges/revolution.
  *
  * encoder2_update() is called every ~10 ms from io_task.  It computes an
- * instant speed from the PCNT delta and applies an exponential moving average
- * (EMA) with a ~45 ms time constant, giving smooth speed transitions without
- * audible clicks.
+ * instant speed from the PCNT delta over the measured time since the previous
+ * window (esp_timer), so a late io_task tick does not read as a speed change,
+ * and pushes each 50 ms window through crank_filter (EMA or α-β estimator,
+ * hysteretic moving / stopped state – see crank_filter.h).
  *
- * Hysteretic thresholds:
- *   Stopped → Moving :  smoothed speed > 0.35 RPS
- *   Moving  → Stopped:  smoothed speed < 0.25 RPS
+ * Measurement modes (crank_config speed_mode):
+ *   COUNTS – PCNT count delta / window length.  Quantised to 1/1440 rev per
+ *            window, i.e. ±0.014 RPS per 50 ms.
+ *   EDGE   – an MCPWM capture channel timestamps every rising edge of
+ *            channel A (80 MHz capture timer).  Speed is whole encoder
+ *            cycles divided by the exact time between the last edge of the
+ *            previous window and the last edge of this one, so it has
+ *            sub-millisecond time resolution even when a window holds only a
+ *            few edges.  A window without an edge bounds the speed by
+ *            "one cycle since the last edge".  PCNT still supplies the
+ *            direction and the zero-count release detection.
  *
  * Speed mapping (done by the caller, io_task):
  *   Returned RPS is used directly as the playback speed multiplier
@@ -21,50 +30,28 @@
  */
 
 #include "encoder2.h"
+#include "crank_filter.h"
 #include "pins.h"
 
+#include "freertos/FreeRTOS.h"
 #include "driver/gpio.h"
 #include "driver/pulse_cnt.h"
+#include "driver/mcpwm_cap.h"
+#include "esp_attr.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include <math.h>
 
 static const char *TAG = "enc2";
 
 /* ── Tuning constants ────────────────────────────────────────────────────── */
 
-/* 360 quad cycles/rev × 4 PCNT edges = 1440 counts per full revolution */
-#define ENC2_COUNTS_PER_REV  1440.0f
+#define ENC2_COUNTS_PER_REV  CRANK_COUNTS_PER_REV
+#define ENC2_CYCLES_PER_REV  360.0f    /* rising edges of channel A per rev */
 
-/* io_task tick period [s] – must match vTaskDelay(pdMS_TO_TICKS(10)) */
-#define ENC2_TICK_DT         0.010f
-
-/*
- * Number of io_task ticks accumulated into one speed sample.
- * 5 × 10 ms = 50 ms measurement window per EMA update.
- */
-#define ENC2_WINDOW_TICKS    5
-#define ENC2_DT              (ENC2_TICK_DT * ENC2_WINDOW_TICKS)  /* 0.050 s */
-
-/*
- * EMA smoothing factor α (applied once per 50 ms window).
- * Three-phase asymmetric envelope:
- *   STARTUP  – fast climb from 0 to threshold.    τ ≈  0.6 s  (not yet moving)
- *   ATTACK   – slow speed changes during playback. τ ≈ 12.5 s  (already moving)
- *   RELEASE  – fast decay when crank stops.        τ ≈  172 ms
- */
-#define ENC2_EMA_ALPHA_STARTUP   1.500f
-#define ENC2_EMA_ALPHA_ATTACK    0.025f
-#define ENC2_EMA_ALPHA_RELEASE   1.500f
-
-/*
- * Consecutive zero-count windows required before switching to fast release.
- * 2 windows × 50 ms = 100 ms of silence before decay kicks in.
- */
-#define ENC2_RELEASE_TICKS  2
-
-/* Hysteretic stop/start thresholds [RPS] */
-#define ENC2_STOP_THRESH     0.25f   /* moving  → stopped (lower threshold) */
-#define ENC2_START_THRESH    0.70   /* stopped → moving  (upper threshold) */
+/* EDGE mode: an edge more than this after the previous one starts a new run;
+ * speed is never averaged across such a gap. */
+#define ENC2_EDGE_GAP_S      0.25f
 
 /* ── Module state ────────────────────────────────────────────────────────── */
 
@@ -72,20 +59,129 @@ static pcnt_unit_handle_t    s_unit   = nullptr;
 static pcnt_channel_handle_t s_chan_a = nullptr;
 static pcnt_channel_handle_t s_chan_b = nullptr;
 
-static float   s_speed_smooth = 0.0f;
-static float   s_instant_rps  = 0.0f; /* raw speed from last 50 ms window, no EMA */
-static bool    s_moving       = false;
-static uint8_t s_zero_ticks   = 0;   /* consecutive windows with delta == 0 */
-static uint8_t s_tick_count   = 0;   /* ticks accumulated in current window  */
-static int     s_delta_acc    = 0;   /* running count sum for current window  */
-
-/* ── Runtime-configurable tuning (defaults mirror the compile-time #defines) */
-static float   s_cfg_ema_attack    = ENC2_EMA_ALPHA_ATTACK;
-static float   s_cfg_ema_release   = ENC2_EMA_ALPHA_RELEASE;
-static float   s_cfg_stop_thresh   = ENC2_STOP_THRESH;
-static float   s_cfg_start_thresh  = ENC2_START_THRESH;
-static uint8_t s_cfg_release_ticks = ENC2_RELEASE_TICKS;
-static int8_t  s_cfg_crank_dir     = 0;  /* 0=any, +1=positive only, -1=negative only */
+static crank_filter_t s_filt = {};
+static crank_window_t s_win = {};
+static enc2_tick_t    s_tick = {};   /* last tick, for the crank trace */
+
+/* EDGE mode: written by the capture ISR under s_edge_mux. */
+static mcpwm_cap_timer_handle_t   s_cap_timer  = nullptr;
+static mcpwm_cap_channel_handle_t s_cap_chan   = nullptr;
+static uint32_t    s_cap_res_hz  = 0;        /* capture timer ticks per second */
+static uint32_t    s_gap_ticks   = 0;        /* ENC2_EDGE_GAP_S in capture ticks */
+static portMUX_TYPE s_edge_mux   = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t    s_edge_n      = 0;        /* rising edges seen               */
+static uint32_t    s_edge_ticks  = 0;        /* timestamp of the last edge      */
+static int64_t     s_edge_us     = 0;        /* same edge, esp_timer time       */
+static uint32_t    s_run_n       = 0;        /* edge count at the first edge of the run */
+static uint32_t    s_run_ticks   = 0;
+
+/* EDGE mode: reference at the end of the previous window (encoder2_update). */
+static uint32_t    s_ref_n       = 0;
+static uint32_t    s_ref_ticks   = 0;
+static float       s_edge_rps    = 0.0f;     /* magnitude of the last edge estimate */
+
+/* ── Runtime-configurable tuning (set in encoder2_init, then by crank_config) */
+static crank_filter_cfg_t s_cfg;
+static uint8_t s_cfg_speed_mode    = ENC2_SPEED_COUNTS;
+static float   s_cfg_lead_scale    = 0.0f;   /* α-β horizon / output latency */
+
+/* ══════════════════════════════════════════════════════════════════════════════
+ * Edge timestamps (EDGE mode)
+ * ══════════════════════════════════════════════════════════════════════════════ */
+
+static bool IRAM_ATTR on_edge(mcpwm_cap_channel_handle_t chan,
+                              const mcpwm_capture_event_data_t *edata, void *ctx)
+{
+    (void)chan;
+    (void)ctx;
+    uint32_t t   = edata->cap_value;
+    int64_t  now = esp_timer_get_time();
+    portENTER_CRITICAL_ISR(&s_edge_mux);
+    /* The 32-bit capture timer wraps every ~54 s, so after a long stop the
+     * tick difference alone can look short; esp_timer does not wrap. */
+    if (s_edge_n == 0 || t - s_edge_ticks > s_gap_ticks
+        || now - s_edge_us > (int64_t)(ENC2_EDGE_GAP_S * 1e6f)) {
+        s_run_n     = s_edge_n + 1u;
+        s_run_ticks = t;
+    }
+    s_edge_n++;
+    s_edge_ticks = t;
+    s_edge_us    = now;
+    portEXIT_CRITICAL_ISR(&s_edge_mux);
+    return false;
+}
+
+/* Timestamp the rising edges of channel A.  PCNT already routes the pin; the
+ * GPIO matrix feeds the same input to the capture channel as well. */
+static void edge_capture_init(void)
+{
+    mcpwm_capture_timer_config_t tcfg = {};
+    tcfg.group_id = 0;
+    tcfg.clk_src  = MCPWM_CAPTURE_CLK_SRC_DEFAULT;
+    mcpwm_capture_channel_config_t ccfg = {};
+    ccfg.gpio_num       = ENC2_PIN_A;
+    ccfg.prescale       = 1;
+    ccfg.flags.pos_edge = true;
+    ccfg.flags.pull_up  = true;   /* as left by gpio_reset_pin() */
+    mcpwm_capture_event_callbacks_t cbs = {};
+    cbs.on_cap = on_edge;
+
+    esp_err_t err = mcpwm_new_capture_timer(&tcfg, &s_cap_timer);
+    if (err == ESP_OK) err = mcpwm_capture_timer_get_resolution(s_cap_timer, &s_cap_res_hz);
+    s_gap_ticks = (uint32_t)(ENC2_EDGE_GAP_S * (float)s_cap_res_hz);
+    if (err == ESP_OK) err = mcpwm_new_capture_channel(s_cap_timer, &ccfg, &s_cap_chan);
+    if (err == ESP_OK) err = mcpwm_capture_channel_register_event_callbacks(s_cap_chan, &cbs, nullptr);
+    if (err == ESP_OK) err = mcpwm_capture_channel_enable(s_cap_chan);
+    if (err == ESP_OK) err = mcpwm_capture_timer_enable(s_cap_timer);
+    if (err == ESP_OK) err = mcpwm_capture_timer_start(s_cap_timer);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Edge capture unavailable (%s) – count windows only",
+                 esp_err_to_name(err));
+        s_cap_chan = nullptr;
+        return;
+    }
+    ESP_LOGI(TAG, "Edge capture on GPIO%d at %lu Hz", ENC2_PIN_A, (unsigned long)s_cap_res_hz);
+}
+
+/*
+ * Speed magnitude from the edges since the previous window [RPS].
+ * @p count_rps (count-window estimate) is returned when the edges cannot
+ * tell: first window, or a run that has only one edge so far.
+ */
+static float edge_rps(int64_t now_us, float count_rps)
+{
+    portENTER_CRITICAL(&s_edge_mux);
+    uint32_t n       = s_edge_n;
+    uint32_t ticks   = s_edge_ticks;
+    int64_t  edge_us = s_edge_us;
+    uint32_t run_n   = s_run_n;
+    uint32_t run_t   = s_run_ticks;
+    portEXIT_CRITICAL(&s_edge_mux);
+
+    /* Never average across a stop: start from the run's first edge. */
+    uint32_t ref_n = s_ref_n, ref_t = s_ref_ticks;
+    if ((int32_t)(run_n - ref_n) > 0) {
+        ref_n = run_n;
+        ref_t = run_t;
+    }
+    s_ref_n     = n;
+    s_ref_ticks = ticks;
+
+    float rps;
+    if (n != ref_n && ticks != ref_t) {
+        float span = (float)(ticks - ref_t) / (float)s_cap_res_hz;
+        rps = (float)(n - ref_n) / (ENC2_CYCLES_PER_REV * span);
+    } else if (n == ref_n && n != 0 && n != run_n) {
+        /* No edge this window: at most one cycle since the last edge. */
+        float since = (float)(now_us - edge_us) * 1e-6f;
+        float bound = (since > 0.0f) ? 1.0f / (ENC2_CYCLES_PER_REV * since) : s_edge_rps;
+        rps = (bound < s_edge_rps) ? bound : s_edge_rps;
+    } else {
+        rps = count_rps;
+    }
+    s_edge_rps = rps;
+    return rps;
+}
 
 /* ══════════════════════════════════════════════════════════════════════════════
  * Public API
@@ -93,6 +189,9 @@ static int8_t  s_cfg_crank_dir     = 0;  /* 0=any, +1=positive only, -1=negative
 
 void encoder2_init(void)
 {
+    crank_filter_defaults(&s_cfg);
+    crank_filter_reset(&s_filt);
+
     pcnt_unit_config_t unit_cfg = {
         .low_limit  = -32000,
         .high_limit =  32000,
@@ -136,89 +235,83 @@ void encoder2_init(void)
     ESP_ERROR_CHECK(pcnt_unit_clear_count(s_unit));
     ESP_ERROR_CHECK(pcnt_unit_start(s_unit));
 
+    edge_capture_init();
+
     ESP_LOGI(TAG, "Organ encoder ready: A=GPIO%d B=GPIO%d  (%.0f cnts/rev)",
              ENC2_PIN_A, ENC2_PIN_B, ENC2_COUNTS_PER_REV);
 }
 
 float encoder2_update(void)
 {
-    /* Read this tick's count and add to the running window sum. */
+    /* Read this tick's count and add it to the running window. */
     int tick_delta = 0;
     pcnt_unit_get_count(s_unit, &tick_delta);
     pcnt_unit_clear_count(s_unit);
-    s_delta_acc += tick_delta;
+    int64_t now_us = esp_timer_get_time();
+    s_tick.t_us     = now_us;
+    s_tick.delta    = tick_delta;
+    s_tick.window   = false;
+    s_tick.edge_rps = -1.0f;
 
     /* Only compute speed once per full 50 ms window; return last value early. */
-    if (++s_tick_count < ENC2_WINDOW_TICKS) {
-        return s_moving ? fabsf(s_speed_smooth) : 0.0f;
+    int   delta;
+    float dt;
+    if (!crank_window_add(&s_win, tick_delta, now_us, &delta, &dt)) {
+        return s_filt.out;
     }
-    s_tick_count = 0;
-    int delta   = s_delta_acc;
-    s_delta_acc = 0;
-
-    /* Ignore delta that is in the unwanted direction */
-    if (s_cfg_crank_dir > 0 && delta < 0) delta = 0;
-    if (s_cfg_crank_dir < 0 && delta > 0) delta = 0;
-
-    /* Signed instant speed so direction reversals cancel in the filter. */
-    float instant_rps_signed = (float)delta / (ENC2_COUNTS_PER_REV * ENC2_DT);
-    /* Store raw (unsmoothed) magnitude for consumers that want instant response
-     * (e.g. DimmerLink – deliberately skips the heavy audio EMA). */
-    s_instant_rps = fabsf(instant_rps_signed);
-
-    /* Asymmetric EMA: slow attack (organ feel), fast release (crank stopped).
-     * Release only engages after ENC2_RELEASE_TICKS consecutive zero-count
-     * windows (5 × 50 ms = 250 ms), so brief pauses mid-crank are ignored. */
-    if (delta == 0) {
-        if (s_zero_ticks < s_cfg_release_ticks) s_zero_ticks++;
-    } else {
-        s_zero_ticks = 0;
-    }
-    /* Three-phase alpha selection:
-     *   release  – zero-count silence threshold reached
-     *   startup  – crank spinning but playback not yet active (fast climb)
-     *   attack   – playback running, smooth out speed changes (slow) */
-    float alpha;
-    if (s_zero_ticks >= s_cfg_release_ticks) {
-        alpha = s_cfg_ema_release;
-    } else if (!s_moving) {
-        alpha = ENC2_EMA_ALPHA_STARTUP;  /* startup is not user-configurable */
-    } else {
-        alpha = s_cfg_ema_attack;
-    }
-    s_speed_smooth = alpha * instant_rps_signed
-                   + (1.0f - alpha) * s_speed_smooth;
-
-    float speed_abs = fabsf(s_speed_smooth);
-
-    /* Hysteretic stopped / moving state machine */
-    if (!s_moving && speed_abs > s_cfg_start_thresh) {
-        s_moving = true;
-    } else if (s_moving && speed_abs < s_cfg_stop_thresh) {
-        s_moving = false;
+    s_tick.window = true;
+
+    float edge = -1.0f;
+    if (s_cap_chan) {
+        /* Edge reference tracked in both modes so a mode switch is seamless. */
+        float count_rps = fabsf((float)delta) / (ENC2_COUNTS_PER_REV * dt);
+        s_tick.edge_rps = edge_rps(now_us, count_rps);
+        if (s_cfg_speed_mode == ENC2_SPEED_EDGE) edge = s_tick.edge_rps;
     }
+    return crank_filter_push(&s_filt, &s_cfg, delta, dt, edge);
+}
 
-    return s_moving ? speed_abs : 0.0f;
+void encoder2_get_tick(enc2_tick_t *t)
+{
+    *t = s_tick;
 }
 
 bool encoder2_is_moving(void)
 {
-    return s_moving;
+    return s_filt.moving;
 }
 
 float encoder2_get_instant_rps(void)
 {
-    return s_instant_rps;
+    /* Raw (unsmoothed) magnitude for consumers that want instant response
+     * (e.g. DimmerLink – deliberately skips the heavy audio EMA). */
+    return s_filt.instant;
 }
 
 void encoder2_apply_config(float ema_attack, float ema_release,
                             float stop_thresh, float start_thresh,
-                            uint8_t release_ticks, int8_t crank_dir)
+                            uint8_t release_ticks, int8_t crank_dir,
+                            uint8_t speed_mode)
+{
+    s_cfg.ema_attack      = ema_attack;
+    s_cfg.ema_release     = ema_release;
+    s_cfg.stop_thresh     = stop_thresh;
+    s_cfg.start_thresh    = start_thresh;
+    s_cfg.release_windows = release_ticks;
+    s_cfg.crank_dir       = crank_dir;
+    s_cfg_speed_mode      = speed_mode;
+}
+
+void encoder2_set_estimator(uint8_t estimator, float ab_alpha, float ab_beta,
+                            float lead_scale)
+{
+    s_cfg.ab_alpha    = ab_alpha;
+    s_cfg.ab_beta     = ab_beta;
+    s_cfg_lead_scale  = lead_scale;
+    s_cfg.estimator   = estimator;
+}
+
+void encoder2_set_output_latency(float latency_s)
 {
-    s_cfg_ema_attack    = ema_attack;
-    s_cfg_ema_release   = ema_release;
-    s_cfg_stop_thresh   = stop_thresh;
-    s_cfg_start_thresh  = start_thresh;
-    s_cfg_release_ticks = release_ticks;
-    s_cfg_crank_dir     = crank_dir;
+    s_cfg.lead_s = s_cfg_lead_scale * latency_s;
 }
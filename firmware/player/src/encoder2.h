@@ -1,21 +1,34 @@
 /**
  * @file encoder2.h
- * @brief Organ-encoder driver: speed measurement with EMA smoothing.
+ * @brief Organ-encoder driver: speed measurement and smoothing.
  *
  * Reads the 2nd rotary encoder (ENC2_PIN_A / ENC2_PIN_B, 360 quad-cycles/rev).
  * Call encoder2_update() every ~10 ms from io_task; it returns a smoothed
- * speed in rotations/second (RPS).  io_task maps RPS → SoundTouch playback
- * speed and drives pause/resume transitions.
+ * speed in rotations/second (RPS) from crank_filter (EMA or α-β).  io_task
+ * maps RPS → SoundTouch playback speed and drives pause/resume transitions.
  *
  * Reference:  1 RPS  →  1.0× playback speed
  */
 #pragma once
+#include <stdbool.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/** Speed measurement mode (crank_config speed_mode). */
+#define ENC2_SPEED_COUNTS  0   /**< PCNT counts per 50 ms window            */
+#define ENC2_SPEED_EDGE    1   /**< cycles / time between captured A edges */
+
+/** Raw input of the last encoder2_update() call (crank trace). */
+typedef struct {
+    int64_t t_us;       /**< esp_timer time the counter was read          */
+    int     delta;      /**< PCNT counts since the previous tick          */
+    bool    window;     /**< this tick completed a 50 ms window           */
+    float   edge_rps;   /**< edge-timing speed at window ends, else < 0   */
+} enc2_tick_t;
+
 /**
  * @brief Initialise the PCNT unit for encoder 2.
  *        Call once in app_main before io_task starts.
@@ -23,12 +36,13 @@ extern "C" {
 void  encoder2_init(void);
 
 /**
- * @brief Update the internal EMA from the latest PCNT delta.
- *        Must be called every ~10 ms (io_task tick).
+ * @brief Update the speed estimate from the latest PCNT delta.
+ *        Must be called every ~10 ms (io_task tick), first thing in the
+ *        tick; speed is taken over the measured time between windows.
  *
  * @return Smoothed speed [rotations/second].
  *         Returns 0.0 when the encoder is considered stopped
- *         (see ENC2_STOP_THRESH / ENC2_START_THRESH in encoder2.cpp).
+ *         (stop / start thresholds, see crank_filter.h).
  */
 float encoder2_update(void);
 
@@ -48,6 +62,14 @@ bool  encoder2_is_moving(void);
  */
 float encoder2_get_instant_rps(void);
 
+/**
+ * @brief Raw input of the last encoder2_update() call.
+ *
+ * edge_rps is filled whenever edge capture is running, in either speed
+ * mode, so a recorded trace can be replayed under both.
+ */
+void  encoder2_get_tick(enc2_tick_t *t);
+
 /**
  * @brief Apply runtime-configurable tuning parameters.
  *
@@ -62,10 +84,31 @@ float encoder2_get_instant_rps(void);
  * @param start_thresh   Resume threshold [RPS] (0.200–1.200)
  * @param release_ticks  Zero-windows before fast decay (0–10)
  * @param crank_dir      Direction filter: 0=any, +1=positive only, -1=negative only
+ * @param speed_mode     ENC2_SPEED_COUNTS or ENC2_SPEED_EDGE (falls back to
+ *                       counts if edge capture could not be set up)
  */
 void encoder2_apply_config(float ema_attack, float ema_release,
                             float stop_thresh, float start_thresh,
-                            uint8_t release_ticks, int8_t crank_dir);
+                            uint8_t release_ticks, int8_t crank_dir,
+                            uint8_t speed_mode);
+
+/**
+ * @brief Select the speed estimator (crank_est_t in crank_filter.h).
+ *
+ * @param estimator   CRANK_EST_EMA or CRANK_EST_ALPHA_BETA
+ * @param ab_alpha    α-β speed gain
+ * @param ab_beta     α-β acceleration gain
+ * @param lead_scale  α-β prediction horizon as a multiple of the output
+ *                    latency (encoder2_set_output_latency()); 0 = no lead
+ */
+void encoder2_set_estimator(uint8_t estimator, float ab_alpha, float ab_beta,
+                            float lead_scale);
+
+/**
+ * @brief Time from the SoundTouch element to the DAC [s], as measured by
+ *        io_task.  The α-β estimator predicts the speed this far ahead.
+ */
+void encoder2_set_output_latency(float latency_s);
 
 #ifdef __cplusplus
 }
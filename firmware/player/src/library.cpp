@@ -0,0 +1,637 @@
+/**
+ * @file library.cpp
+ * @brief Persistent song library index – see library.h.
+ *
+ * The entry array and its name arena are replaced, never edited in place, by
+ * the library task: a walk builds both beside the old ones and swaps them
+ * under the mutex, so readers (which copy under the mutex) never see a half-built
+ * list.  Only the library task writes the index file.  When the song list
+ * keeps its names and order, changed entries are patched in place; otherwise
+ * the file is rewritten through a temporary file.
+ */
+
+#include "library.h"
+#include "name_arena.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "ff.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+static const char *TAG = "library";
+
+#define LIB_MAGIC         "LIB1"
+#define LIB_VERSION       2
+#define LIB_INDEX_FILE    ".library.idx"
+#define LIB_PATH_MAX      (16 + LIB_NAME_MAX + 8)
+#define LIB_WAV_HDR       44u     /* canonical header, used when parsing fails */
+#define LIB_CHUNK_SCAN    16      /* RIFF chunks examined before "data" */
+
+#define LIB_TASK_STACK    4096
+#define LIB_TASK_PRIO     2
+#define LIB_TASK_CORE     0
+
+typedef struct __attribute__((packed)) {
+    char     magic[4];
+    uint16_t version;
+    uint16_t entry_size;
+    uint32_t count;
+    uint32_t name_bytes;
+    uint32_t list_version;
+    uint8_t  reserved[12];
+} lib_hdr_t;
+static_assert(sizeof(lib_hdr_t) == 32, "library header layout");
+static_assert(sizeof(library_entry_t) == 32, "library entry layout");
+static_assert(LIB_MAX_SONGS < NAME_ARENA_MAX, "song index must fit the arena");
+
+static SemaphoreHandle_t s_mutex   = nullptr;   /* guards everything below */
+static library_entry_t  *s_entries = nullptr;
+static name_arena_t      s_names   = NAME_ARENA_INIT;   /* sorted, same index */
+static uint16_t          s_count   = 0;
+static uint32_t          s_version = 0;         /* list version, see library.h */
+static uint8_t           s_unsaved[LIB_MAX_SONGS / 8];   /* noted, not in the file */
+
+static char              s_mount[16] = {};
+static uint8_t           s_pdrv      = 0;
+static TaskHandle_t      s_task      = nullptr;
+static bool              s_first     = true;    /* library task only */
+static library_song_cb_t s_on_song   = nullptr;
+static library_list_cb_t s_on_list   = nullptr;
+
+/* ── Helpers ──────────────────────────────────────────────────────────── */
+
+static library_entry_t *alloc_entries(size_t n)
+{
+    if (n == 0) n = 1;
+    void *p = heap_caps_malloc(n * sizeof(library_entry_t), MALLOC_CAP_SPIRAM);
+    if (!p) p = malloc(n * sizeof(library_entry_t));
+    return (library_entry_t *)p;
+}
+
+static uint32_t rd32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t rd16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+/* "Foo.WAV" → base "Foo", LIB_HDR_OK for a WAV, LIB_SIDE_* for a sidecar,
+ * 0 for anything else or a base name that does not fit. */
+static uint8_t classify(const char *fname, char *base)
+{
+    const char *dot = strrchr(fname, '.');
+    if (!dot || dot == fname) return 0;
+    size_t len = (size_t)(dot - fname);
+    if (len >= LIB_NAME_MAX) return 0;
+
+    uint8_t kind;
+    if      (strcasecmp(dot, ".wav")  == 0) kind = LIB_HDR_OK;
+    else if (strcasecmp(dot, ".json") == 0) kind = LIB_SIDE_JSON;
+    else if (strcasecmp(dot, ".cue")  == 0) kind = LIB_SIDE_CUE;
+    else if (strcasecmp(dot, ".env")  == 0) kind = LIB_SIDE_ENV;
+    else return 0;
+
+    memcpy(base, fname, len);
+    base[len] = '\0';
+    return kind;
+}
+
+static void wav_path_of(const char *name, char *buf, size_t len)
+{
+    snprintf(buf, len, "%s/%s.wav", s_mount, name);
+}
+
+/* Fill the format fields of @p e from its RIFF chunks; canonical 44-byte
+ * header defaults (44.1 kHz, stereo, 16 bit) when the header is unreadable. */
+static void parse_wav(library_entry_t *e, const char *name)
+{
+    e->format      = 1;
+    e->channels    = 2;
+    e->bps         = 2;
+    e->sample_rate = 44100;
+    e->data_offset = LIB_WAV_HDR;
+    e->data_bytes  = (e->size > LIB_WAV_HDR) ? e->size - LIB_WAV_HDR : 0u;
+    e->sidecars   &= (uint8_t)~LIB_HDR_OK;
+
+    char path[LIB_PATH_MAX];
+    wav_path_of(name, path, sizeof(path));
+    FILE *f = fopen(path, "rb");
+    uint8_t h[12];
+    if (f && fread(h, 1, sizeof(h), f) == sizeof(h)
+          && memcmp(h, "RIFF", 4) == 0 && memcmp(h + 8, "WAVE", 4) == 0) {
+        uint32_t pos = 12;
+        bool     fmt = false;
+        for (int i = 0; i < LIB_CHUNK_SCAN; i++) {
+            uint8_t c[8];
+            if (fseek(f, (long)pos, SEEK_SET) != 0 || fread(c, 1, sizeof(c), f) != sizeof(c)) break;
+            uint32_t len = rd32(c + 4);
+            if (memcmp(c, "fmt ", 4) == 0 && len >= 16) {
+                uint8_t fm[26] = {};
+                size_t  n      = fread(fm, 1, (len < sizeof(fm)) ? len : sizeof(fm), f);
+                if (n < 16) break;
+                uint16_t bits  = rd16(fm + 14);
+                e->format      = rd16(fm);
+                if (e->format == 0xFFFEu && n >= 26) e->format = rd16(fm + 24);  /* extensible */
+                if (fm[2] != 0)       e->channels    = fm[2];
+                if (rd32(fm + 4) > 0) e->sample_rate = rd32(fm + 4);
+                if (bits >= 8)        e->bps         = (uint8_t)(bits / 8);
+                fmt = true;
+            } else if (memcmp(c, "data", 4) == 0) {
+                uint32_t off   = pos + 8;
+                uint32_t avail = (e->size > off) ? e->size - off : 0u;
+                e->data_offset = off;
+                e->data_bytes  = (len < avail) ? len : avail;
+                if (fmt) e->sidecars |= LIB_HDR_OK;
+                break;
+            }
+            pos += 8u + len + (len & 1u);
+            if (pos >= e->size) break;
+        }
+    }
+    if (f) fclose(f);
+    e->frames = e->data_bytes / ((uint32_t)e->channels * e->bps);
+    if (!(e->sidecars & LIB_HDR_OK)) ESP_LOGW(TAG, "%s: no WAV header, using defaults", path);
+}
+
+/* ── Index file ───────────────────────────────────────────────────────── */
+
+static void index_path(char *buf, size_t len)
+{
+    snprintf(buf, len, "%s/" LIB_INDEX_FILE, s_mount);
+}
+
+static void load_index(void)
+{
+    char path[LIB_PATH_MAX];
+    index_path(path, sizeof(path));
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        ESP_LOGI(TAG, "No index yet – built by the first scan");
+        return;
+    }
+    lib_hdr_t h;
+    bool ok = fread(&h, sizeof(h), 1, f) == 1 && memcmp(h.magic, LIB_MAGIC, 4) == 0
+           && h.version == LIB_VERSION && h.entry_size == sizeof(library_entry_t)
+           && h.count <= LIB_MAX_SONGS && h.name_bytes <= h.count * LIB_NAME_MAX;
+    library_entry_t *v    = ok ? alloc_entries(h.count) : nullptr;
+    char            *blob = ok ? (char *)malloc(h.name_bytes ? h.name_bytes : 1u) : nullptr;
+    ok = v && blob && fread(v, sizeof(*v), h.count, f) == h.count
+                   && fread(blob, 1, h.name_bytes, f) == h.name_bytes;
+    fclose(f);
+
+    /* Names must be non-empty, fit LIB_NAME_MAX and fill the blob exactly. */
+    name_arena_t names = NAME_ARENA_INIT;
+    uint32_t     pos   = 0;
+    while (ok && pos < h.name_bytes) {
+        size_t len = strnlen(blob + pos, h.name_bytes - pos);
+        ok = len > 0 && len < LIB_NAME_MAX && pos + len < h.name_bytes
+          && name_arena_add(&names, blob + pos, len) >= 0;
+        pos += (uint32_t)len + 1u;
+    }
+    free(blob);
+    ok = ok && names.count == h.count;
+    if (!ok) {
+        free(v);
+        name_arena_free(&names);
+        ESP_LOGW(TAG, "%s: damaged, rebuilding", path);
+        return;
+    }
+    name_arena_sort(&names);
+    s_entries = v;
+    s_names   = names;
+    s_count   = (uint16_t)h.count;
+    s_version = h.list_version;
+    ESP_LOGI(TAG, "Index: %u song(s), %u name bytes, list v%u", s_count, (unsigned)names.used,
+             (unsigned)s_version);
+}
+
+/* Rewrite the whole index (list changed). */
+static bool save_index(const library_entry_t *v, const name_arena_t *names, uint16_t n,
+                       uint32_t version)
+{
+    char path[LIB_PATH_MAX], tmp_path[LIB_PATH_MAX + 4];
+    index_path(path, sizeof(path));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    lib_hdr_t h = {};
+    memcpy(h.magic, LIB_MAGIC, 4);
+    h.version    = LIB_VERSION;
+    h.entry_size = sizeof(library_entry_t);
+    h.count      = n;
+    h.name_bytes = names->used;
+    h.list_version = version;
+    FILE *o = fopen(tmp_path, "wb");
+    bool ok = o && fwrite(&h, sizeof(h), 1, o) == 1
+           && fwrite(v, sizeof(*v), n, o) == n
+           && fwrite(names->blob, 1, names->used, o) == names->used;
+    if (o) fclose(o);
+    if (ok) {
+        remove(path);
+        ok = rename(tmp_path, path) == 0;
+    }
+    if (!ok) {
+        remove(tmp_path);
+        ESP_LOGE(TAG, "Cannot write %s", path);
+    }
+    return ok;
+}
+
+/* Patch the entries flagged in @p dirty (same names and order as the file). */
+static bool patch_index(const library_entry_t *v, const name_arena_t *names, uint16_t n,
+                        uint32_t version, const uint8_t *dirty)
+{
+    char path[LIB_PATH_MAX];
+    index_path(path, sizeof(path));
+    FILE *f = fopen(path, "r+b");
+    if (!f) return save_index(v, names, n, version);
+    bool ok = true;
+    for (uint16_t i = 0; ok && i < n; i++) {
+        if (!dirty[i]) continue;
+        ok = fseek(f, (long)(sizeof(lib_hdr_t) + (size_t)i * sizeof(*v)), SEEK_SET) == 0
+          && fwrite(&v[i], sizeof(*v), 1, f) == 1;
+    }
+    fclose(f);
+    if (!ok) return save_index(v, names, n, version);
+    return true;
+}
+
+/* ── Walk ─────────────────────────────────────────────────────────────── */
+
+/* One pass over the root directory: WAVs (@p want_wav) into @p v and
+ * @p names, or sidecar bits onto them (@p names sorted). */
+static bool read_dir(bool want_wav, library_entry_t **v, name_arena_t *names, size_t *cap)
+{
+    char drv[8];
+    snprintf(drv, sizeof(drv), "%u:", (unsigned)s_pdrv);
+    FF_DIR  dir;
+    FILINFO fi;
+    if (f_opendir(&dir, drv) != FR_OK) {
+        ESP_LOGE(TAG, "Cannot open %s", s_mount);
+        return false;
+    }
+    char base[LIB_NAME_MAX];
+    while (f_readdir(&dir, &fi) == FR_OK && fi.fname[0] != '\0') {
+        if (fi.fattrib & AM_DIR) continue;
+        uint8_t kind = classify(fi.fname, base);
+        if (kind == 0 || (kind == LIB_HDR_OK) != want_wav) continue;
+
+        if (!want_wav) {
+            int32_t k = name_arena_find(names, base);
+            if (k >= 0) (*v)[k].sidecars |= kind;
+            continue;
+        }
+        size_t n = names->count;
+        if (n == *cap) {
+            if (*cap >= LIB_MAX_SONGS) {
+                ESP_LOGW(TAG, "More than %u songs – rest ignored", LIB_MAX_SONGS);
+                break;
+            }
+            size_t           grow = (*cap * 2 < LIB_MAX_SONGS) ? *cap * 2 : LIB_MAX_SONGS;
+            library_entry_t *nv   = alloc_entries(grow);
+            if (!nv) break;
+            memcpy(nv, *v, n * sizeof(*nv));
+            free(*v);
+            *v   = nv;
+            *cap = grow;
+        }
+        if (name_arena_add(names, base, strlen(base)) < 0) {
+            ESP_LOGE(TAG, "Out of memory");
+            break;
+        }
+        library_entry_t *e = &(*v)[n];
+        memset(e, 0, sizeof(*e));
+        e->size  = (uint32_t)fi.fsize;
+        e->mtime = ((uint32_t)fi.fdate << 16) | fi.ftime;
+    }
+    f_closedir(&dir);
+    return true;
+}
+
+/* A list change found by walk(): arena indices, turned into a
+ * library_change_t once both arenas are final. */
+typedef struct {
+    uint8_t  op;
+    uint16_t idx;        /* see library_change_t                  */
+    uint16_t name_i;     /* ADD/RENAME: new arena, REMOVE: old    */
+    uint16_t old_i;      /* RENAME: old arena                     */
+} change_rec_t;
+
+/* Unplaced fresh WAV with the size and time of old entry @p o and a name
+ * the old list does not have: @p o was renamed (FAT keeps the time). */
+static int32_t find_renamed(const library_entry_t *o, const library_entry_t *fresh,
+                            const name_arena_t *fnames, const uint8_t *used)
+{
+    for (uint16_t k = 0; k < fnames->count; k++) {
+        if (used[k] || fresh[k].size != o->size || fresh[k].mtime != o->mtime) continue;
+        if (name_arena_find(&s_names, name_arena_get(fnames, k)) < 0) return k;
+    }
+    return -1;
+}
+
+static void walk(void)
+{
+    size_t           cap    = 64;
+    library_entry_t *fresh  = alloc_entries(cap);
+    name_arena_t     fnames = NAME_ARENA_INIT;           /* fresh[k] is fnames[k] */
+    name_arena_t     names  = NAME_ARENA_INIT;           /* out[i] is names[i]    */
+    bool ok = fresh && read_dir(true, &fresh, &fnames, &cap);
+    if (ok) {
+        name_arena_sort(&fnames);
+        ok = read_dir(false, &fresh, &fnames, &cap);
+    }
+    if (!ok) { free(fresh); name_arena_free(&fnames); return; }
+    size_t n = fnames.count;
+
+    /* Only this task replaces s_entries; library_note_sidecar() edits
+     * sidecar bits, which the walk recomputes, so the old list is read
+     * without the lock. */
+    size_t           nz     = n ? n : 1;
+    library_entry_t *out    = alloc_entries(n);
+    uint8_t         *used   = (uint8_t *)calloc(nz, 1);   /* fresh[k] placed       */
+    uint8_t         *report = (uint8_t *)calloc(nz, 1);   /* out[i] new or changed */
+    uint8_t         *dirty  = (uint8_t *)calloc(nz, 1);   /* out[i] not in the file */
+    uint8_t         *kept   = (uint8_t *)calloc(s_count ? s_count : 1, 1);   /* old i */
+    change_rec_t    *recs   = (change_rec_t *)calloc(LIB_DELTA_MAX, sizeof(change_rec_t));
+    if (!out || !used || !report || !dirty || !kept || !recs) {
+        ESP_LOGE(TAG, "Out of memory");
+        free(fresh); free(out); free(used); free(report); free(dirty); free(kept); free(recs);
+        name_arena_free(&fnames);
+        return;
+    }
+
+    /* Changes are recorded renames first, then removals, then additions;
+     * more than LIB_DELTA_MAX are reported as a reset (n_rec 0). */
+    uint32_t n_ren = 0, n_rem = 0, n_chg = 0;
+    uint16_t m     = 0;
+    for (uint16_t i = 0; ok && i < s_count; i++) {
+        const library_entry_t *o       = &s_entries[i];
+        int32_t                k       = name_arena_find(&fnames, name_arena_get(&s_names, i));
+        bool                   renamed = false;
+        if (k < 0 && n_ren + n_rem < LIB_DELTA_MAX) {
+            k       = find_renamed(o, fresh, &fnames, used);
+            renamed = k >= 0;
+        }
+        if (k < 0) { n_rem++; continue; }                   /* deleted */
+        library_entry_t *f = &fresh[k];
+        if (o->size == f->size && o->mtime == f->mtime) {
+            uint8_t side = f->sidecars;
+            *f           = *o;
+            f->sidecars  = (uint8_t)((o->sidecars & LIB_HDR_OK) | side);
+        } else {
+            parse_wav(f, name_arena_get(&fnames, (uint16_t)k));
+            report[m] = 1;
+        }
+        if (renamed) {
+            /* Sidecars are looked up by name: analyse the new name. */
+            report[m] = 1;
+            if (n_ren < LIB_DELTA_MAX) recs[n_ren] = { LIB_CHANGE_RENAME, i, m, i };
+            n_ren++;
+        }
+        used[k] = 1;
+        kept[i] = 1;
+        ok = name_arena_add(&names, fnames.blob + fnames.off[k], strlen(fnames.blob + fnames.off[k])) >= 0;
+        out[m++] = *f;
+    }
+    /* Removals last index first, so each index is still valid when applied. */
+    n_chg = n_ren;
+    for (int32_t i = (int32_t)s_count - 1; ok && i >= 0; i--) {
+        if (kept[i]) continue;
+        if (n_chg < LIB_DELTA_MAX) recs[n_chg] = { LIB_CHANGE_REMOVE, (uint16_t)i, (uint16_t)i, 0 };
+        n_chg++;
+    }
+    free(kept);
+    for (uint16_t pos = 0; ok && pos < n; pos++) {          /* new songs, name order */
+        uint16_t k = name_arena_sorted(&fnames, pos);
+        if (used[k]) continue;
+        const char *name = name_arena_get(&fnames, k);
+        parse_wav(&fresh[k], name);
+        report[m] = 1;
+        if (n_chg < LIB_DELTA_MAX) recs[n_chg] = { LIB_CHANGE_ADD, m, m, 0 };
+        n_chg++;
+        ok = name_arena_add(&names, name, strlen(name)) >= 0;
+        out[m++]  = fresh[k];
+    }
+    free(fresh);
+    free(used);
+    name_arena_free(&fnames);
+    if (!ok) {
+        ESP_LOGE(TAG, "Out of memory");
+        free(out); free(report); free(dirty); free(recs);
+        name_arena_free(&names);
+        return;
+    }
+    name_arena_sort(&names);
+
+    bool list_changed = n_chg > 0;
+    uint16_t n_rec    = (n_chg <= LIB_DELTA_MAX) ? (uint16_t)n_chg : 0u;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    bool changed = list_changed;
+    for (uint16_t i = 0; !list_changed && i < m; i++) {
+        dirty[i] = memcmp(&out[i], &s_entries[i], sizeof(out[i])) != 0
+                || (s_unsaved[i / 8] & (1u << (i % 8)));
+        changed |= dirty[i] != 0;
+    }
+    library_entry_t *old       = s_entries;
+    name_arena_t     old_names = s_names;
+    s_entries = out;
+    s_names   = names;
+    s_count   = m;
+    if (list_changed) s_version += n_rec ? n_rec : 1u;
+    uint32_t version = s_version;
+    memset(s_unsaved, 0, sizeof(s_unsaved));
+    xSemaphoreGive(s_mutex);
+    free(old);
+
+    /* out and names stay valid below: only this task frees them. */
+    if (list_changed) save_index(out, &names, m, version);
+    else if (changed) patch_index(out, &names, m, version, dirty);
+    if (changed) {
+        ESP_LOGI(TAG, "Library: %u song(s), list v%u (%u change(s)), names %u B of %u B held", m,
+                 (unsigned)version, (unsigned)n_chg, (unsigned)names.used,
+                 (unsigned)name_arena_bytes(&names));
+    }
+    free(dirty);
+
+    char path[LIB_PATH_MAX];
+    for (uint16_t i = 0; s_on_song && i < m; i++) {
+        if (!s_first && !report[i]) continue;
+        wav_path_of(name_arena_get(&names, i), path, sizeof(path));
+        s_on_song(path);
+    }
+    s_first = false;
+    free(report);
+
+    if (list_changed && s_on_list) {
+        library_change_t chg[LIB_DELTA_MAX];
+        for (uint16_t c = 0; c < n_rec; c++) {
+            const change_rec_t *rc = &recs[c];
+            chg[c].op       = rc->op;
+            chg[c].idx      = rc->idx;
+            chg[c].name     = name_arena_get((rc->op == LIB_CHANGE_REMOVE) ? &old_names : &names,
+                                             rc->name_i);
+            chg[c].old_name = (rc->op == LIB_CHANGE_RENAME) ? name_arena_get(&old_names, rc->old_i)
+                                                            : nullptr;
+        }
+        s_on_list(version, chg, n_rec);
+    }
+    free(recs);
+    name_arena_free(&old_names);
+}
+
+static void library_task(void *arg)
+{
+    (void)arg;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        walk();
+    }
+}
+
+/* ── Public API ───────────────────────────────────────────────────────── */
+
+void library_init(const char *mount, uint8_t pdrv,
+                  library_song_cb_t on_song, library_list_cb_t on_list)
+{
+    if (s_task) return;
+    strncpy(s_mount, mount, sizeof(s_mount) - 1);
+    s_pdrv    = pdrv;
+    s_on_song = on_song;
+    s_on_list = on_list;
+    s_mutex   = xSemaphoreCreateMutex();
+    if (!s_mutex) {
+        ESP_LOGE(TAG, "Out of memory");
+        return;
+    }
+    load_index();
+
+    BaseType_t ok = xTaskCreatePinnedToCore(library_task, "library", LIB_TASK_STACK,
+                                            nullptr, LIB_TASK_PRIO, &s_task, LIB_TASK_CORE);
+    if (ok != pdPASS) {
+        s_task = nullptr;
+        ESP_LOGE(TAG, "Failed to start task");
+    }
+}
+
+void library_refresh(void)
+{
+    if (s_task) xTaskNotifyGive(s_task);
+}
+
+uint32_t library_version(void)
+{
+    if (!s_mutex) return 0;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    uint32_t v = s_version;
+    xSemaphoreGive(s_mutex);
+    return v;
+}
+
+uint16_t library_count(void)
+{
+    if (!s_mutex) return 0;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    uint16_t n = s_count;
+    xSemaphoreGive(s_mutex);
+    return n;
+}
+
+bool library_get(uint16_t idx, library_entry_t *out)
+{
+    if (!s_mutex) return false;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    bool ok = idx < s_count;
+    if (ok) *out = s_entries[idx];
+    xSemaphoreGive(s_mutex);
+    return ok;
+}
+
+bool library_name(uint16_t idx, char *buf, size_t len)
+{
+    if (len == 0) return false;
+    buf[0] = '\0';
+    if (!s_mutex) return false;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    bool ok = idx < s_count;
+    if (ok) snprintf(buf, len, "%s", name_arena_get(&s_names, idx));
+    xSemaphoreGive(s_mutex);
+    return ok;
+}
+
+bool library_listing(uint16_t pos, uint16_t *idx, char *buf, size_t len)
+{
+    if (len == 0) return false;
+    buf[0] = '\0';
+    if (!s_mutex) return false;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    bool ok = pos < s_count;
+    if (ok) {
+        *idx = name_arena_sorted(&s_names, pos);
+        snprintf(buf, len, "%s", name_arena_get(&s_names, *idx));
+    }
+    xSemaphoreGive(s_mutex);
+    return ok;
+}
+
+uint16_t library_next(uint16_t idx)
+{
+    if (!s_mutex) return 0;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    uint16_t next = 0;
+    if (idx < s_count) {
+        /* FAT names are unique ignoring case, so the lookup lands on idx. */
+        int32_t pos = name_arena_find_pos(&s_names, name_arena_get(&s_names, idx));
+        if (pos >= 0 && pos + 1 < s_count) next = name_arena_sorted(&s_names, (uint16_t)(pos + 1));
+        else if (pos >= 0)                 next = name_arena_sorted(&s_names, 0);
+    }
+    xSemaphoreGive(s_mutex);
+    return next;
+}
+
+bool library_path(uint16_t idx, char *buf, size_t len)
+{
+    char name[LIB_NAME_MAX];
+    if (!library_name(idx, name, sizeof(name))) return false;
+    wav_path_of(name, buf, len);
+    return true;
+}
+
+bool library_find(const char *wav_path, library_entry_t *out)
+{
+    const char *slash = strrchr(wav_path, '/');
+    char        base[LIB_NAME_MAX];
+    if (!s_mutex || classify(slash ? slash + 1 : wav_path, base) != LIB_HDR_OK) return false;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    int32_t i = name_arena_find(&s_names, base);
+    if (i >= 0) *out = s_entries[i];
+    xSemaphoreGive(s_mutex);
+    return i >= 0;
+}
+
+void library_note_sidecar(const char *wav_path, uint8_t side, bool present)
+{
+    const char *slash = strrchr(wav_path, '/');
+    char        base[LIB_NAME_MAX];
+    if (!s_mutex || classify(slash ? slash + 1 : wav_path, base) != LIB_HDR_OK) return;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    int32_t i = name_arena_find(&s_names, base);
+    if (i >= 0) {
+        library_entry_t *e = &s_entries[i];
+        e->sidecars = present ? (uint8_t)(e->sidecars | side) : (uint8_t)(e->sidecars & ~side);
+        s_unsaved[i / 8] |= (uint8_t)(1u << (i % 8));
+    }
+    xSemaphoreGive(s_mutex);
+    library_refresh();   /* saves the entry; picks up a write the walk raced */
+}
@@ -0,0 +1,153 @@
+/**
+ * @file library.h
+ * @brief Persistent song library index on the SD card.
+ *
+ * Every WAV in the card root has one entry holding what playback needs
+ * before the file is opened: the data chunk offset and length, the format,
+ * the frame count and which sidecars (.json / .cue / .env) exist.  The
+ * entries are kept in PSRAM and saved to "/sdcard/.library.idx", so a boot
+ * only reads that file and play_song_idx() never re-parses a header.
+ *
+ * A refresh walks the root directory once through FatFS (f_readdir returns
+ * size and modification time per entry without a per-file stat), keeps the
+ * cached header of every WAV whose size and time are unchanged and parses
+ * only new or modified files.  FAT does not update a directory's own time
+ * when its contents change, so the walk itself is the change check; it runs
+ * in the background on the library task and costs one directory read.
+ *
+ * Songs keep their index across refreshes: deleted songs are dropped,
+ * new ones appended in name order, and a renamed file (same size and time,
+ * new name) keeps its index.  Every list change bumps a list version that
+ * is saved with the index, so a mirror of the list (the display) can tell
+ * whether it is current and apply the changes one by one.
+ *
+ * Names live apart from the entries in a name arena
+ * (firmware/common/name_arena.h) at the same index, so a song costs its
+ * name length plus 38 bytes rather than a fixed name slot;
+ * library_listing() walks the songs in case-insensitive name order.
+ *
+ * Index file layout (little endian):
+ *   32-byte header   "LIB1", u16 version, u16 entry size, u32 count,
+ *                    u32 name bytes, u32 list version
+ *   count × 32 B     library_entry_t
+ *   name bytes       count NUL-terminated names, in index order
+ */
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LIB_NAME_MAX     64      /* base name incl. NUL (UM_MAX_SONG_NAME) */
+#define LIB_MAX_SONGS    4096    /* < NAME_ARENA_MAX */
+#define LIB_DELTA_MAX    32      /* changes per walk reported one by one */
+
+/* library_entry_t::sidecars */
+#define LIB_SIDE_JSON    0x01u   /**< foo.json song settings      */
+#define LIB_SIDE_CUE     0x02u   /**< foo.cue cue track           */
+#define LIB_SIDE_ENV     0x04u   /**< foo.env light-organ envelope */
+#define LIB_HDR_OK       0x80u   /**< WAV header parsed; else defaults */
+
+typedef struct {
+    uint32_t size;                /**< file size [bytes]                */
+    uint32_t mtime;               /**< FAT date << 16 | FAT time        */
+    uint32_t data_offset;         /**< first PCM byte in the file       */
+    uint32_t data_bytes;          /**< PCM bytes                        */
+    uint32_t frames;              /**< data_bytes / (channels × bps)    */
+    uint32_t sample_rate;
+    uint16_t format;              /**< WAVE format tag (1 = PCM)        */
+    uint8_t  channels;
+    uint8_t  bps;                 /**< bytes per sample                 */
+    uint8_t  sidecars;            /**< LIB_SIDE_* | LIB_HDR_OK          */
+    uint8_t  reserved[3];
+} library_entry_t;
+
+/* library_change_t::op */
+#define LIB_CHANGE_ADD     1u    /**< song idx added (always the last index)    */
+#define LIB_CHANGE_REMOVE  2u    /**< song idx removed; later indices move down */
+#define LIB_CHANGE_RENAME  3u    /**< song idx renamed from old_name            */
+
+/** One list change; names are valid during the library_list_cb_t call. */
+typedef struct {
+    uint8_t     op;
+    uint16_t    idx;
+    const char *name;        /**< ADD / RENAME: new name, REMOVE: old name */
+    const char *old_name;    /**< RENAME only                              */
+} library_change_t;
+
+/** A song is new or modified (every song on the first walk after boot). */
+typedef void (*library_song_cb_t)(const char *wav_path);
+
+/**
+ * The song list changed and is now at list version @p version.
+ * changes[i] takes the list from version - n + i to version - n + i + 1, so
+ * they apply in order.  @p n is 0 when there were more than LIB_DELTA_MAX
+ * changes: the version moved by one and a mirror has to reload.
+ */
+typedef void (*library_list_cb_t)(uint32_t version, const library_change_t *changes, uint16_t n);
+
+/**
+ * @brief Load the index file and start the library task.  Entries are
+ *        available on return; the directory is not read until the first
+ *        library_refresh().
+ *
+ * @param mount  VFS mount point of the card ("/sdcard")
+ * @param pdrv   FatFS drive number of the card (ff_diskio_get_pdrv_card())
+ */
+void library_init(const char *mount, uint8_t pdrv,
+                  library_song_cb_t on_song, library_list_cb_t on_list);
+
+/**
+ * @brief Ask the library task to walk the directory.  Non-blocking; the
+ *        callbacks run on the library task when the walk is done.  The first
+ *        walk after boot reports every song through on_song.
+ */
+void library_refresh(void);
+
+/** @brief Current list version (bumped by every list change, persisted). */
+uint32_t library_version(void);
+
+uint16_t library_count(void);
+
+/** @brief Copy entry @p idx.  false if out of range. */
+bool library_get(uint16_t idx, library_entry_t *out);
+
+/** @brief Copy the name of entry @p idx; "" and false if out of range. */
+bool library_name(uint16_t idx, char *buf, size_t len);
+
+/**
+ * @brief The song at position @p pos in name order: its index into @p idx
+ *        and its name into @p buf.  false if @p pos is out of range.
+ */
+bool library_listing(uint16_t pos, uint16_t *idx, char *buf, size_t len);
+
+/** @brief Index of the song after @p idx in name order, wrapping around. */
+uint16_t library_next(uint16_t idx);
+
+/** @brief "/sdcard/<name>.wav" of entry @p idx.  false if out of range. */
+bool library_path(uint16_t idx, char *buf, size_t len);
+
+/** @brief Copy the entry of @p wav_path.  false if it is not in the library. */
+bool library_find(const char *wav_path, library_entry_t *out);
+
+/** @brief 16-bit PCM, mono or stereo: the format the decoder plays and the
+ *         analysis jobs read. */
+static inline bool library_is_pcm16(const library_entry_t *e)
+{
+    return e->format == 1 && e->bps == 2 && e->channels >= 1 && e->channels <= 2
+        && e->sample_rate > 0;
+}
+
+/**
+ * @brief Record that the @p side sidecar (LIB_SIDE_*) of @p wav_path was
+ *        written (@p present) or removed, so the entry is right before the
+ *        next walk.
+ */
+void library_note_sidecar(const char *wav_path, uint8_t side, bool present);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,358 @@
+/**
+ * @file light_organ.cpp
+ * @brief Light-organ analysis task – see light_organ.h.
+ *
+ * Per frame: 256 windowed real samples are packed as 128 complex points
+ * (even samples → re, odd → im) and transformed with esp-dsp's radix-2 FFT,
+ * half the work of a 256-point complex FFT with a zero imaginary part.  Only
+ * bins 1–15 are needed, so the real-FFT split step is evaluated for those
+ * bins alone.  Band energy is the sum of squared magnitudes (no sqrtf) and
+ * is compressed with a table-based log10.
+ *
+ * When the current song has a precomputed envelope (lo_envelope.h) the band
+ * values are looked up at the playback position instead and the FFT is
+ * skipped; the auto-ranging below is the same for both sources.
+ *
+ * Onsets fire a pulse that decays with LO_PULSE_MS and is blended over the
+ * auto-ranged level, so the lamp hits on beats instead of only breathing
+ * with the band energy.
+ */
+
+#include "light_organ.h"
+#include "lo_envelope.h"
+#include "lo_onset.h"
+#include "crank_config.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "dsps_fft2r.h"
+#include "dsps_wind.h"
+
+#include <math.h>
+#include <string.h>
+
+static const char *TAG = "light_organ";
+
+#define LO_N            LIGHT_ORGAN_FFT_SIZE
+#define LO_HALF         (LO_N / 2)          /* complex FFT length          */
+#define LO_BASS_FIRST   1                   /* bins 1–2: kick / bass       */
+#define LO_BASS_LAST    2
+#define LO_MID_FIRST    3                   /* bins 3–15: snare / vocals   */
+#define LO_MID_LAST     15
+
+#define LO_PULSE_MS     80.0f               /* onset pulse decay time constant */
+#define LO_GRID_TOL_S   0.07f               /* onset counts as on the beat grid */
+#define LO_OFFBEAT_GAIN 0.5f                /* pulse scale for off-grid onsets  */
+
+#define LO_RATE_MIN     10
+#define LO_RATE_MAX     100
+#define LO_STATS_US     (10 * 1000 * 1000)  /* stats window / log interval */
+
+#define LO_TASK_STACK   4096
+#define LO_TASK_PRIO    2                   /* below io_task and the HTTP server */
+#define LO_TASK_CORE    0
+
+/* ── FFT state ────────────────────────────────────────────────────────── */
+/* Tables are written once in dsp_init() and read-only afterwards, so
+ * light_organ_bands() may run from other tasks with their own work buffer. */
+static float s_win[LO_N];                 /* Hann window                     */
+static float s_tw[LO_MID_LAST + 1][2];    /* cos/sin(2πk/N) for the split step */
+static bool  s_dsp_ready = false;
+static float s_buf[LO_HALF * 2];          /* task-private: packed complex     */
+static int16_t s_pcm[LO_N];
+static float s_bins[LO_ONSET_BINS];
+
+static_assert(LO_ONSET_BINS == LO_MID_LAST, "onset bins are the analysed bins 1–15");
+
+/* ── Onset state (task-private) ───────────────────────────────────────── */
+static lo_onset_t s_onset;
+static float      s_pulse    = 0.0f;     /* 0–1, decays every frame        */
+static float      s_prev_pos = -1.0f;    /* envelope position of last frame */
+
+/* Beat grid of the current song (bpm_analysis.h); bpm 0 = none. */
+static volatile float s_grid_bpm    = 0.0f;
+static volatile float s_grid_offset = 0.0f;
+
+/* ── Table log10 ──────────────────────────────────────────────────────── */
+#define LOG_LUT_BITS  6
+static float s_log2_lut[(1 << LOG_LUT_BITS) + 1];  /* log2(1 + i/64) */
+
+/* ── Published result (double-buffered) ───────────────────────────────── */
+typedef struct {
+    uint8_t level;
+    float   bass;       /* log-compressed band values before weighting */
+    float   mid;
+} lo_result_t;
+static lo_result_t       s_result[2];
+static volatile uint32_t s_result_idx = 0;   /* slot readers use */
+
+static TaskHandle_t           s_task   = nullptr;
+static light_organ_fetch_cb_t s_fetch  = nullptr;
+static light_organ_pos_cb_t   s_pos    = nullptr;
+static volatile bool          s_active = false;
+static light_organ_stats_t    s_stats  = {};
+
+/* ── Helpers ──────────────────────────────────────────────────────────── */
+
+/* log10 of x > 0 from the float exponent plus an interpolated mantissa
+ * table; error < 0.0002, far below what the lamp can show. */
+static inline float fast_log10f(float x)
+{
+    uint32_t u;
+    memcpy(&u, &x, sizeof(u));
+    int      e    = (int)((u >> 23) & 0xFF) - 127;
+    uint32_t m    = u & 0x7FFFFFu;
+    uint32_t idx  = m >> (23 - LOG_LUT_BITS);
+    float    frac = (float)(m & ((1u << (23 - LOG_LUT_BITS)) - 1u))
+                  * (1.0f / (float)(1u << (23 - LOG_LUT_BITS)));
+    float    l2   = (float)e + s_log2_lut[idx]
+                  + frac * (s_log2_lut[idx + 1] - s_log2_lut[idx]);
+    return l2 * 0.30103f;   /* log10(2) */
+}
+
+static void publish(const lo_result_t *r)
+{
+    uint32_t w = s_result_idx ^ 1u;
+    s_result[w] = *r;
+    __atomic_store_n(&s_result_idx, w, __ATOMIC_RELEASE);
+}
+
+/* Squared magnitude of bin k of the 256-point real FFT, recovered from the
+ * 128-point complex FFT Z of the packed input:
+ *   X[k] = E[k] + e^{-j2πk/N}·O[k],
+ *   E[k] = (Z[k] + conj Z[N/2-k]) / 2,  O[k] = -j (Z[k] - conj Z[N/2-k]) / 2 */
+static inline float bin_energy(const float *z, int k)
+{
+    float ar = z[2 * k],            ai = z[2 * k + 1];
+    float br = z[2 * (LO_HALF - k)], bi = z[2 * (LO_HALF - k) + 1];
+    float er = 0.5f * (ar + br), ei = 0.5f * (ai - bi);
+    float orr = 0.5f * (ai + bi), oi = -0.5f * (ar - br);
+    float c = s_tw[k][0], s = s_tw[k][1];
+    float xr = er + orr * c + oi * s;
+    float xi = ei + oi * c - orr * s;
+    return xr * xr + xi * xi;
+}
+
+static bool dsp_init(void)
+{
+    if (s_dsp_ready) return true;
+    esp_err_t err = dsps_fft2r_init_fc32(NULL, LO_HALF);
+    if (err != ESP_OK && err != ESP_ERR_DSP_REINITIALIZED) {
+        ESP_LOGE(TAG, "FFT init failed: %s", esp_err_to_name(err));
+        return false;
+    }
+    dsps_wind_hann_f32(s_win, LO_N);
+    for (int k = 0; k <= LO_MID_LAST; k++) {
+        s_tw[k][0] = cosf(2.0f * (float)M_PI * (float)k / (float)LO_N);
+        s_tw[k][1] = sinf(2.0f * (float)M_PI * (float)k / (float)LO_N);
+    }
+    for (int i = 0; i <= (1 << LOG_LUT_BITS); i++) {
+        s_log2_lut[i] = log2f(1.0f + (float)i / (float)(1 << LOG_LUT_BITS));
+    }
+    s_dsp_ready = true;
+    return true;
+}
+
+/* Pulse scale for an onset at song position @p pos_s: full on the beat
+ * grid, LO_OFFBEAT_GAIN between beats. */
+static float grid_gain(float pos_s)
+{
+    float bpm = s_grid_bpm;
+    if (bpm <= 0.0f) return 1.0f;
+    float period = 60.0f / bpm;
+    float d = fmodf(pos_s - s_grid_offset, period);
+    if (d < 0.0f) d += period;
+    if (d > 0.5f * period) d = period - d;
+    return (d <= LO_GRID_TOL_S) ? 1.0f : LO_OFFBEAT_GAIN;
+}
+
+/* One analysis frame.  @p decay is lo_decay_rate and @p pulse_decay the
+ * onset pulse decay, both scaled to the frame period. */
+static bool analyse_frame(float decay, float pulse_decay)
+{
+    lo_result_t r = {};
+    float pos_s = 0.0f, onset = 0.0f;
+    bool have_pos = s_pos && s_pos(&pos_s);
+    bool have = have_pos
+             && lo_envelope_lookup(s_prev_pos, pos_s, &r.bass, &r.mid, &onset);
+    if (have) {
+        s_stats.env_frames++;
+        s_prev_pos = pos_s;
+    } else {
+        s_prev_pos = -1.0f;
+        if (!s_fetch || !s_fetch(s_pcm, LO_N)) return false;
+        light_organ_bands(s_pcm, s_buf, &r.bass, &r.mid, s_bins);
+        onset = lo_onset_push(&s_onset, s_bins);
+    }
+    s_pulse *= pulse_decay;
+    if (onset > 0.0f) {
+        if (have_pos) onset *= grid_gain(pos_s);
+        s_stats.onsets++;
+        if (onset > s_pulse) s_pulse = onset;
+    }
+    float fft_raw = r.bass * g_crank_cfg.lo_bass_weight
+                  + r.mid  * g_crank_cfg.lo_mid_weight;
+
+    /* Auto-ranging mit angepasstem Rauschboden gegen Flackern bei Stille */
+    static float s_lo_max = 5.0f;  /* Höherer Start/Mindestwert gegen Rauschen */
+    static float s_lo_min = 0.0f;
+
+    if (fft_raw > s_lo_max) s_lo_max = fft_raw;
+    else { s_lo_max *= decay; if (s_lo_max < 5.0f) s_lo_max = 5.0f; }
+
+    if (fft_raw < s_lo_min) s_lo_min = fft_raw * 0.5f + s_lo_min * 0.5f;
+    else { s_lo_min *= decay; if (s_lo_min < 0.0f) s_lo_min = 0.0f; }
+
+    float range = s_lo_max - s_lo_min;
+    float level = (range > 0.5f)
+                  ? (fft_raw - s_lo_min) / range * 100.0f
+                  : 12.0f; /* Standard-Glimmen (Pre-Heat) wenn keine Dynamik da ist */
+
+    if (level > 100.0f) level = 100.0f;
+    if (level < 12.0f)  level = 12.0f;  /* Konsequenter Pre-Heat Schutz für Halogen */
+
+    /* Onset pulse: push the lamp towards full brightness. */
+    level += g_crank_cfg.lo_onset_gain * s_pulse * (100.0f - level);
+
+    r.level = (uint8_t)level;
+    publish(&r);
+    return true;
+}
+
+/* ── Task ─────────────────────────────────────────────────────────────── */
+
+static void light_organ_task(void *arg)
+{
+    (void)arg;
+    uint64_t win_sum_us = 0;
+    uint32_t win_n      = 0;
+    uint32_t win_max_us = 0;
+    int64_t  win_start  = esp_timer_get_time();
+    TickType_t last     = xTaskGetTickCount();
+    TickType_t onset_period = 0;    /* hop the detector is set up for */
+
+    for (;;) {
+        if (!s_active) {
+            lo_result_t off = {};
+            publish(&off);      /* only this task writes the result slots */
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            last         = xTaskGetTickCount();
+            onset_period = 0;       /* new song or resume: fresh history */
+            s_pulse      = 0.0f;
+            s_prev_pos   = -1.0f;
+            continue;
+        }
+
+        uint8_t hz = g_crank_cfg.lo_rate_hz;
+        if (hz < LO_RATE_MIN) hz = LO_RATE_MIN;
+        if (hz > LO_RATE_MAX) hz = LO_RATE_MAX;
+        TickType_t period = pdMS_TO_TICKS(1000u / hz);
+        if (period == 0) period = 1;
+        /* lo_decay_rate is specified per 50 ms frame. */
+        float period_ms = (float)(period * portTICK_PERIOD_MS);
+        float decay     = powf(g_crank_cfg.lo_decay_rate, period_ms / 50.0f);
+        float pulse_decay = expf(-period_ms / LO_PULSE_MS);
+        if (period != onset_period) {
+            lo_onset_init(&s_onset, period_ms);
+            onset_period = period;
+        }
+
+        int64_t t0 = esp_timer_get_time();
+        if (analyse_frame(decay, pulse_decay)) {
+            uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+            win_sum_us += us;
+            win_n++;
+            if (us > win_max_us) win_max_us = us;
+            s_stats.frames++;
+        } else {
+            s_stats.skipped++;
+        }
+        s_stats.rate_hz = (uint8_t)(1000u / (period * portTICK_PERIOD_MS));
+
+        int64_t now = esp_timer_get_time();
+        if (now - win_start >= LO_STATS_US) {
+            if (win_n > 0) {
+                s_stats.avg_us = (uint32_t)(win_sum_us / win_n);
+                s_stats.max_us = win_max_us;
+                ESP_LOGI(TAG, "%u Hz: %lu us avg, %lu us max per frame (%lu skipped)",
+                         (unsigned)s_stats.rate_hz, (unsigned long)s_stats.avg_us,
+                         (unsigned long)s_stats.max_us, (unsigned long)s_stats.skipped);
+            }
+            win_sum_us = 0;
+            win_n      = 0;
+            win_max_us = 0;
+            win_start  = now;
+        }
+
+        vTaskDelayUntil(&last, period);
+    }
+}
+
+/* ── Public API ───────────────────────────────────────────────────────── */
+
+bool light_organ_bands(const int16_t *pcm, float *work, float *bass, float *mid,
+                       float *bins)
+{
+    if (!s_dsp_ready) return false;
+    for (int i = 0; i < LO_N; i++) {
+        work[i] = ((float)pcm[i] / 32768.0f) * s_win[i];
+    }
+    dsps_fft2r_fc32(work, LO_HALF);
+    dsps_bit_rev_fc32(work, LO_HALF);
+
+    float bass_e = 0.0f, mid_e = 0.0f;
+    for (int k = LO_BASS_FIRST; k <= LO_MID_LAST; k++) {
+        float e = bin_energy(work, k);
+        if (k <= LO_BASS_LAST) bass_e += e;
+        else                   mid_e  += e;
+        if (bins) bins[k - 1] = 0.5f * fast_log10f(e + 1.0f);
+    }
+
+    /* Logarithmische Kompression fühlt sich für das Auge linearer an.
+     * log10(E)/2 = log10 of the RMS magnitude, so the weights keep their scale. */
+    *bass = 0.5f * fast_log10f(bass_e + 1.0f);
+    *mid  = 0.5f * fast_log10f(mid_e  + 1.0f);
+    return true;
+}
+
+void light_organ_start(light_organ_fetch_cb_t fetch, light_organ_pos_cb_t pos)
+{
+    if (s_task) return;
+    s_fetch = fetch;
+    s_pos   = pos;
+    if (!dsp_init()) return;
+
+    BaseType_t ok = xTaskCreatePinnedToCore(light_organ_task, "light_organ",
+                                            LO_TASK_STACK, nullptr,
+                                            LO_TASK_PRIO, &s_task, LO_TASK_CORE);
+    if (ok != pdPASS) {
+        s_task = nullptr;
+        ESP_LOGE(TAG, "Failed to start task");
+    }
+}
+
+void light_organ_set_active(bool active)
+{
+    if (active == s_active) return;
+    s_active = active;
+    if (active && s_task) xTaskNotifyGive(s_task);
+}
+
+uint8_t light_organ_get_level(void)
+{
+    uint32_t idx = __atomic_load_n(&s_result_idx, __ATOMIC_ACQUIRE);
+    return s_result[idx].level;
+}
+
+void light_organ_set_beat_grid(float bpm, float offset_s)
+{
+    s_grid_offset = offset_s;
+    s_grid_bpm    = (bpm > 0.0f) ? bpm : 0.0f;
+}
+
+void light_organ_get_stats(light_organ_stats_t *out)
+{
+    if (out) *out = s_stats;
+}
@@ -0,0 +1,95 @@
+/**
+ * @file light_organ.h
+ * @brief Light-organ analysis task: audio band energy → lamp level.
+ *
+ * A low-priority task on core 0 pulls LIGHT_ORGAN_FFT_SIZE mono samples of
+ * the audio around the playback position through a fetch callback, runs a
+ * real-input FFT and turns bass/mid band energy into an auto-ranged dimmer
+ * level (12–100 %).  The analysis rate is g_crank_cfg.lo_rate_hz (10–100 Hz);
+ * band weights, range decay and look-ahead also come from g_crank_cfg.
+ *
+ * io_task only reads the published level (light_organ_get_level()), so the
+ * FFT no longer shares its 10 ms tick with the encoder and pot polling.
+ *
+ * Songs with a precomputed envelope (lo_envelope.h) skip the fetch and FFT:
+ * the band values are looked up at the position from the position callback.
+ *
+ * Onsets (lo_onset.h) add short lamp pulses on top of the energy level,
+ * scaled by g_crank_cfg.lo_onset_gain.  Live frames run the detector on the
+ * FFT; envelopes carry the onsets found when the song was analysed.
+ * With a beat grid from the BPM analysis (light_organ_set_beat_grid()),
+ * onsets between beats pulse at half strength, so the lamp accents the beat.
+ */
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LIGHT_ORGAN_FFT_SIZE  256   /* real samples per analysis frame */
+
+/**
+ * @brief Fill @p dst with @p frames mono samples of the audio to analyse.
+ *        Called from the light-organ task once per frame.
+ * @return false if no audio is available (frame is skipped).
+ */
+typedef bool (*light_organ_fetch_cb_t)(int16_t *dst, int frames);
+
+/**
+ * @brief Source position in seconds the lamp should show now (audible
+ *        position plus the look-ahead trim), for the envelope lookup.
+ * @return false if the position is unknown (falls back to fetch + FFT).
+ */
+typedef bool (*light_organ_pos_cb_t)(float *pos_s);
+
+typedef struct {
+    uint32_t frames;     /**< frames analysed since boot                  */
+    uint32_t skipped;    /**< frames where the fetch callback had no audio */
+    uint32_t env_frames; /**< frames taken from a precomputed envelope    */
+    uint32_t onsets;     /**< lamp pulses triggered                        */
+    uint32_t avg_us;     /**< mean time per analysed frame (last window)   */
+    uint32_t max_us;     /**< worst time per analysed frame (last window)  */
+    uint8_t  rate_hz;    /**< current analysis rate                        */
+} light_organ_stats_t;
+
+/**
+ * @brief Start the analysis task (idle until light_organ_set_active(true)).
+ *        Call once from app_main.
+ */
+void    light_organ_start(light_organ_fetch_cb_t fetch, light_organ_pos_cb_t pos);
+
+/**
+ * @brief Run or park the analysis.  Cheap to call every io_task tick.
+ *        Deactivating publishes level 0.
+ */
+void    light_organ_set_active(bool active);
+
+/** @return Latest dimmer level 0–100 % (0 while inactive). */
+uint8_t light_organ_get_level(void);
+
+/**
+ * @brief Log-compressed bass and mid band values (0.5·log10 of band energy)
+ *        of LIGHT_ORGAN_FFT_SIZE mono samples – the analysis the task runs,
+ *        shared with the envelope precompute job.  Reentrant.
+ * @param work  Scratch of LIGHT_ORGAN_FFT_SIZE floats owned by the caller.
+ * @param bins  NULL, or LO_ONSET_BINS floats for the per-bin log magnitudes
+ *              (bins 1–15) that feed the onset detector.
+ * @return false before light_organ_start() has set up the FFT tables.
+ */
+bool    light_organ_bands(const int16_t *pcm, float *work, float *bass, float *mid,
+                          float *bins);
+
+/**
+ * @brief Beat grid of the playing song: beats at @p offset_s + n·60/@p bpm
+ *        seconds of song time.  @p bpm 0 clears it (all onsets equal).
+ */
+void    light_organ_set_beat_grid(float bpm, float offset_s);
+
+/** @brief Copy the timing statistics into @p out. */
+void    light_organ_get_stats(light_organ_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,398 @@
+/**
+ * @file lo_envelope.cpp
+ * @brief Precomputed light-organ envelope – see lo_envelope.h.
+ *
+ * The job task (core 0, priority below the light organ) takes WAV paths
+ * from a queue; lo_envelope_select() pushes to the front so the song about
+ * to play is analysed first.  The WAV is read in 4096-frame blocks with a
+ * tick of delay between them, so the SD reader of the playback pipeline is
+ * never starved.  Band values are kept as floats (PSRAM) until the song is
+ * done, then normalised to u8 and written via a temporary file.  Onsets are
+ * detected with the same streaming detector as the live path, at the 10 ms
+ * envelope hop.
+ */
+
+#include "lo_envelope.h"
+#include "light_organ.h"
+#include "lo_onset.h"
+#include "library.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+static const char *TAG = "lo_env";
+
+#define ENV_MAGIC         "LOE2"
+#define ENV_FRAME_MS      10
+#define ENV_FRAME_BYTES   3       /* bass, mid, onset */
+#define ENV_ONSET_SCAN    50      /* frames lookup scans for onsets (0.5 s) */
+#define ENV_MAX_FRAMES    (20 * 60 * (1000 / ENV_FRAME_MS))   /* 20 min */
+#define ENV_PATH_MAX      128
+#define ENV_QUEUE_LEN     16
+#define ENV_READ_FRAMES   4096
+
+#define ENV_TASK_STACK    4096
+#define ENV_TASK_PRIO     1       /* below the light-organ task */
+#define ENV_TASK_CORE     0
+
+#define LO_N              LIGHT_ORGAN_FFT_SIZE
+
+typedef struct __attribute__((packed)) {
+    char     magic[4];
+    uint16_t frame_ms;
+    uint16_t reserved;
+    uint32_t frames;
+    uint32_t wav_bytes;     /* size of the WAV file the envelope belongs to */
+    float    bass_lo, bass_hi;
+    float    mid_lo,  mid_hi;
+} env_hdr_t;
+static_assert(sizeof(env_hdr_t) == 32, "env header layout");
+
+/* Envelope of the selected song.  data: frames × {bass, mid, onset}. */
+typedef struct {
+    uint32_t frames;
+    float    bass_lo, bass_step;
+    float    mid_lo,  mid_step;
+    uint8_t *data;
+} env_t;
+
+static QueueHandle_t     s_queue = nullptr;
+static SemaphoreHandle_t s_mutex = nullptr;   /* guards s_env and s_cur */
+static env_t             s_env   = {};
+static char              s_cur[ENV_PATH_MAX] = {};
+
+/* Job scratch (job task only). */
+static int16_t    s_mono[ENV_READ_FRAMES + LO_N];
+static float      s_work[LO_N];
+static float      s_bins[LO_ONSET_BINS];
+static lo_onset_t s_onset;
+
+/* ── Helpers ──────────────────────────────────────────────────────────── */
+
+/* "/sdcard/foo.wav" → "/sdcard/foo.env".  false if not a .wav path. */
+static bool env_path_of(const char *wav_path, char *out, size_t bufsz)
+{
+    size_t len = strlen(wav_path);
+    if (len < 4 || len >= bufsz || strcasecmp(wav_path + len - 4, ".wav") != 0) return false;
+    memcpy(out, wav_path, len - 4);
+    memcpy(out + len - 4, ".env", 5);
+    return true;
+}
+
+static bool read_hdr(FILE *f, uint32_t wav_bytes, env_hdr_t *h)
+{
+    if (fread(h, 1, sizeof(*h), f) != sizeof(*h)) return false;
+    return memcmp(h->magic, ENV_MAGIC, 4) == 0
+        && h->frame_ms == ENV_FRAME_MS
+        && h->wav_bytes == wav_bytes
+        && h->frames > 0 && h->frames <= ENV_MAX_FRAMES;
+}
+
+/* true if @p env_path holds an envelope for a WAV of @p wav_bytes. */
+static bool sidecar_current(const char *env_path, uint32_t wav_bytes)
+{
+    FILE *f = fopen(env_path, "rb");
+    if (!f) return false;
+    env_hdr_t h;
+    bool ok = read_hdr(f, wav_bytes, &h);
+    fclose(f);
+    return ok;
+}
+
+static void env_from_hdr(const env_hdr_t *h, uint8_t *data, env_t *out)
+{
+    out->frames    = h->frames;
+    out->bass_lo   = h->bass_lo;
+    out->bass_step = (h->bass_hi - h->bass_lo) / 255.0f;
+    out->mid_lo    = h->mid_lo;
+    out->mid_step  = (h->mid_hi - h->mid_lo) / 255.0f;
+    out->data      = data;
+}
+
+/* Attach @p env if @p wav_path is still the selected song, else free it. */
+static void attach(const char *wav_path, env_t *env)
+{
+    uint8_t *old = env->data;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (strcmp(wav_path, s_cur) == 0) {
+        old    = s_env.data;
+        s_env  = *env;
+    }
+    xSemaphoreGive(s_mutex);
+    free(old);
+}
+
+static bool load_sidecar(const char *wav_path, env_t *out)
+{
+    char env_path[ENV_PATH_MAX];
+    struct stat st;
+    if (!env_path_of(wav_path, env_path, sizeof(env_path))) return false;
+    if (stat(wav_path, &st) != 0) return false;
+
+    FILE *f = fopen(env_path, "rb");
+    if (!f) return false;
+    env_hdr_t h;
+    uint8_t  *data = nullptr;
+    bool ok = read_hdr(f, (uint32_t)st.st_size, &h);
+    if (ok) {
+        data = (uint8_t *)malloc((size_t)h.frames * ENV_FRAME_BYTES);
+        ok   = data && fread(data, ENV_FRAME_BYTES, h.frames, f) == h.frames;
+    }
+    fclose(f);
+    if (!ok) { free(data); return false; }
+    env_from_hdr(&h, data, out);
+    return true;
+}
+
+/* ── Analysis ─────────────────────────────────────────────────────────── */
+
+/* Analyse @p wav_path and write its sidecar.  Format and data chunk come
+ * from the library entry @p e, as for playback.  On success @p out holds
+ * the envelope (caller owns out->data). */
+static bool analyse(const char *wav_path, const char *env_path, uint32_t wav_bytes,
+                    const library_entry_t *e, env_t *out)
+{
+    uint32_t sr = e->sample_rate;
+    uint32_t ch = e->channels;
+    if (!library_is_pcm16(e)) {
+        ESP_LOGW(TAG, "%s: unsupported format (tag %u, %lu Hz, %lu ch, %u bit)",
+                 wav_path, e->format, (unsigned long)sr, (unsigned long)ch, e->bps * 8u);
+        return false;
+    }
+
+    FILE *f = fopen(wav_path, "rb");
+    if (!f) return false;
+    if (fseek(f, (long)e->data_offset, SEEK_SET) != 0) {
+        fclose(f);
+        return false;
+    }
+
+    uint32_t total  = e->data_bytes / (ch * 2u);   /* frames */
+    uint32_t hop    = sr * ENV_FRAME_MS / 1000u;
+    uint32_t frames = (total + hop - 1) / hop;
+    if (frames == 0 || frames > ENV_MAX_FRAMES) {
+        ESP_LOGW(TAG, "%s: %lu frames – not analysed", wav_path, (unsigned long)frames);
+        fclose(f);
+        return false;
+    }
+
+    /* bass, mid, onset per frame (PSRAM) */
+    float   *vals = (float *)malloc((size_t)frames * ENV_FRAME_BYTES * sizeof(float));
+    int16_t *raw  = (int16_t *)malloc(ENV_READ_FRAMES * ch * sizeof(int16_t));
+    bool     ok   = vals && raw;
+    int64_t  t0   = esp_timer_get_time();
+
+    /* s_mono holds channel 0 of samples [mono_start, mono_start + mono_len);
+     * frame k is the LO_N window centred on sample k·hop, so the song starts
+     * with half a window of silence. */
+    int64_t  mono_start = -(LO_N / 2);
+    uint32_t mono_len   = LO_N / 2;
+    uint32_t read_pos   = 0;
+    memset(s_mono, 0, sizeof(int16_t) * mono_len);
+    lo_onset_init(&s_onset, (float)ENV_FRAME_MS);
+
+    for (uint32_t k = 0; ok && k < frames; k++) {
+        int64_t first = (int64_t)k * hop - LO_N / 2;
+        while (ok && mono_start + (int64_t)mono_len < first + LO_N) {
+            int64_t drop = first - mono_start;      /* hop may exceed LO_N */
+            if (drop > 0) {
+                uint32_t d = (drop > (int64_t)mono_len) ? mono_len : (uint32_t)drop;
+                mono_len  -= d;
+                memmove(s_mono, s_mono + d, sizeof(int16_t) * mono_len);
+                mono_start += d;
+            }
+            uint32_t n = ENV_READ_FRAMES + LO_N - mono_len;
+            if (n > ENV_READ_FRAMES) n = ENV_READ_FRAMES;
+            if (read_pos < total) {
+                if (n > total - read_pos) n = total - read_pos;
+                if (fread(raw, sizeof(int16_t) * ch, n, f) != n) { ok = false; break; }
+                for (uint32_t i = 0; i < n; i++) s_mono[mono_len + i] = raw[i * ch];
+                read_pos += n;
+                vTaskDelay(1);      /* leave the card to the playback pipeline */
+            } else {
+                memset(s_mono + mono_len, 0, sizeof(int16_t) * n);   /* tail */
+            }
+            mono_len += n;
+        }
+        if (ok) {
+            float *v = &vals[ENV_FRAME_BYTES * k];
+            ok   = light_organ_bands(s_mono + (first - mono_start), s_work,
+                                     &v[0], &v[1], s_bins);
+            v[2] = lo_onset_push(&s_onset, s_bins);
+        }
+    }
+    fclose(f);
+    free(raw);
+
+    env_hdr_t h = {};
+    uint8_t  *data = nullptr;
+    if (ok) {
+        memcpy(h.magic, ENV_MAGIC, 4);
+        h.frame_ms  = ENV_FRAME_MS;
+        h.frames    = frames;
+        h.wav_bytes = wav_bytes;
+        h.bass_lo = h.bass_hi = vals[0];
+        h.mid_lo  = h.mid_hi  = vals[1];
+        for (uint32_t k = 1; k < frames; k++) {
+            float b = vals[ENV_FRAME_BYTES * k], m = vals[ENV_FRAME_BYTES * k + 1];
+            if (b < h.bass_lo) h.bass_lo = b;
+            if (b > h.bass_hi) h.bass_hi = b;
+            if (m < h.mid_lo)  h.mid_lo  = m;
+            if (m > h.mid_hi)  h.mid_hi  = m;
+        }
+        float bs = (h.bass_hi > h.bass_lo) ? 255.0f / (h.bass_hi - h.bass_lo) : 0.0f;
+        float ms = (h.mid_hi  > h.mid_lo)  ? 255.0f / (h.mid_hi  - h.mid_lo)  : 0.0f;
+        data = (uint8_t *)malloc((size_t)frames * ENV_FRAME_BYTES);
+        ok   = data != nullptr;
+        for (uint32_t k = 0; ok && k < frames; k++) {
+            const float *v = &vals[ENV_FRAME_BYTES * k];
+            uint8_t     *d = &data[ENV_FRAME_BYTES * k];
+            d[0] = (uint8_t)((v[0] - h.bass_lo) * bs + 0.5f);
+            d[1] = (uint8_t)((v[1] - h.mid_lo)  * ms + 0.5f);
+            d[2] = (v[2] > 0.0f) ? (uint8_t)(1.0f + v[2] * 254.0f) : 0;   /* onset ≥ 1 */
+        }
+    }
+    free(vals);
+
+    if (ok) {
+        char tmp_path[ENV_PATH_MAX + 4];
+        snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", env_path);
+        FILE *o = fopen(tmp_path, "wb");
+        ok = o && fwrite(&h, sizeof(h), 1, o) == 1
+               && fwrite(data, ENV_FRAME_BYTES, frames, o) == frames;
+        if (o) fclose(o);
+        if (ok) {
+            remove(env_path);
+            ok = rename(tmp_path, env_path) == 0;
+        }
+        if (!ok) {
+            remove(tmp_path);
+            ESP_LOGE(TAG, "Cannot write %s", env_path);
+        }
+    }
+    if (!ok) {
+        free(data);
+        return false;
+    }
+    library_note_sidecar(wav_path, LIB_SIDE_ENV, true);
+
+    ESP_LOGI(TAG, "%s: %lu frames in %lu ms", env_path, (unsigned long)frames,
+             (unsigned long)((esp_timer_get_time() - t0) / 1000));
+    env_from_hdr(&h, data, out);
+    return true;
+}
+
+/* ── Task ─────────────────────────────────────────────────────────────── */
+
+static void lo_envelope_task(void *arg)
+{
+    (void)arg;
+    char wav_path[ENV_PATH_MAX];
+    char env_path[ENV_PATH_MAX];
+
+    for (;;) {
+        if (xQueueReceive(s_queue, wav_path, portMAX_DELAY) != pdTRUE) continue;
+        if (!env_path_of(wav_path, env_path, sizeof(env_path))) continue;
+
+        struct stat     st;
+        library_entry_t e;
+        if (stat(wav_path, &st) != 0 || !library_find(wav_path, &e) || e.data_bytes == 0) continue;
+        if (sidecar_current(env_path, (uint32_t)st.st_size)) continue;
+
+        env_t env = {};
+        if (analyse(wav_path, env_path, (uint32_t)st.st_size, &e, &env)) {
+            attach(wav_path, &env);
+        }
+    }
+}
+
+/* ── Public API ───────────────────────────────────────────────────────── */
+
+void lo_envelope_init(void)
+{
+    if (s_queue) return;
+    s_mutex = xSemaphoreCreateMutex();
+    s_queue = xQueueCreate(ENV_QUEUE_LEN, ENV_PATH_MAX);
+    if (!s_mutex || !s_queue) {
+        ESP_LOGE(TAG, "Out of memory");
+        return;
+    }
+    BaseType_t ok = xTaskCreatePinnedToCore(lo_envelope_task, "lo_envelope",
+                                            ENV_TASK_STACK, nullptr,
+                                            ENV_TASK_PRIO, nullptr, ENV_TASK_CORE);
+    if (ok != pdPASS) ESP_LOGE(TAG, "Failed to start task");
+}
+
+void lo_envelope_request(const char *wav_path)
+{
+    char item[ENV_PATH_MAX];
+    if (!s_queue || !wav_path || strlen(wav_path) >= sizeof(item)) return;
+    strncpy(item, wav_path, sizeof(item));
+    if (xQueueSend(s_queue, item, 0) != pdTRUE) {
+        ESP_LOGD(TAG, "Queue full, %s deferred to first play", wav_path);
+    }
+}
+
+void lo_envelope_select(const char *wav_path)
+{
+    if (!s_mutex) return;
+    if (wav_path && strlen(wav_path) >= ENV_PATH_MAX) wav_path = nullptr;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    uint8_t *old = s_env.data;
+    s_env = {};
+    if (wav_path) strncpy(s_cur, wav_path, sizeof(s_cur));
+    else          s_cur[0] = '\0';
+    xSemaphoreGive(s_mutex);
+    free(old);
+
+    if (!wav_path) return;
+    env_t env = {};
+    if (load_sidecar(wav_path, &env)) {
+        attach(wav_path, &env);
+    } else {
+        char item[ENV_PATH_MAX];
+        strncpy(item, wav_path, sizeof(item));
+        xQueueSendToFront(s_queue, item, 0);
+    }
+}
+
+bool lo_envelope_lookup(float prev_s, float pos_s, float *bass, float *mid, float *onset)
+{
+    if (!s_mutex || pos_s < 0.0f) return false;
+    uint32_t k = (uint32_t)(pos_s * (1000.0f / ENV_FRAME_MS) + 0.5f);
+    /* Onset frames after the previous lookup, at most ENV_ONSET_SCAN. */
+    uint32_t first = k;
+    if (prev_s >= 0.0f) {
+        uint32_t p = (uint32_t)(prev_s * (1000.0f / ENV_FRAME_MS) + 0.5f);
+        if (p >= k)                         first = k + 1;   /* no new frame */
+        else if (k - p <= ENV_ONSET_SCAN)   first = p + 1;
+    }
+
+    bool ok = false;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (s_env.data && k < s_env.frames) {
+        const uint8_t *d = &s_env.data[ENV_FRAME_BYTES * k];
+        *bass = s_env.bass_lo + s_env.bass_step * (float)d[0];
+        *mid  = s_env.mid_lo  + s_env.mid_step  * (float)d[1];
+        uint8_t o = 0;
+        for (uint32_t i = first; i <= k; i++) {
+            uint8_t v = s_env.data[ENV_FRAME_BYTES * i + 2];
+            if (v > o) o = v;
+        }
+        *onset = (float)o * (1.0f / 255.0f);
+        ok = true;
+    }
+    xSemaphoreGive(s_mutex);
+    return ok;
+}
@@ -0,0 +1,63 @@
+/**
+ * @file lo_envelope.h
+ * @brief Precomputed light-organ envelope per song (".env" sidecar).
+ *
+ * A low-priority background job reads each WAV once – after an upload or
+ * rescan, or on first play – runs the light organ's band analysis
+ * (light_organ_bands()) and the onset detector (lo_onset.h) every 10 ms of
+ * song time and writes the bass and mid values, normalised to 0–255 over
+ * the song, and the onset strength next to the WAV:
+ * "/sdcard/foo.wav" → "/sdcard/foo.env".
+ *
+ * During playback the light organ looks the values up at the playback
+ * position (lo_envelope_lookup()) instead of running the FFT, so the lamp
+ * follows the exact song position at any crank speed without DSP work.
+ *
+ * File layout (little endian):
+ *   32-byte header  "LOE2", u16 frame_ms, u16 reserved, u32 frames,
+ *                   u32 WAV file size, f32 bass_lo, bass_hi, mid_lo, mid_hi
+ *   frames × 3 B    u8 bass, u8 mid  (0 = *_lo, 255 = *_hi),
+ *                   u8 onset strength (0 = none, 255 = 1.0)
+ * A sidecar whose recorded WAV size differs from the file, or of an older
+ * format, is recomputed.
+ */
+#pragma once
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Start the background job.  Call once from app_main after
+ *        light_organ_start() (the job uses its FFT tables).
+ */
+void lo_envelope_init(void);
+
+/**
+ * @brief Queue @p wav_path for analysis unless a current sidecar exists.
+ *        Non-blocking; requests beyond the queue depth are dropped and
+ *        picked up again on first play.
+ */
+void lo_envelope_request(const char *wav_path);
+
+/**
+ * @brief Make @p wav_path the song lo_envelope_lookup() answers for.
+ *        Loads its sidecar if present; otherwise the song is analysed first
+ *        in line and attached when the job finishes.  NULL detaches.
+ */
+void lo_envelope_select(const char *wav_path);
+
+/**
+ * @brief Band values at song position @p pos_s, on the same log scale as
+ *        light_organ_bands(), and the strongest onset after @p prev_s up to
+ *        @p pos_s.  With @p prev_s < 0, after a seek or a gap over 0.5 s
+ *        only the frame at @p pos_s is checked for an onset.
+ * @return false if the selected song has no envelope (yet) or @p pos_s is
+ *         outside it.
+ */
+bool lo_envelope_lookup(float prev_s, float pos_s, float *bass, float *mid, float *onset);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,83 @@
+/**
+ * @file lo_onset.cpp
+ * @brief Streaming spectral-flux onset detector – see lo_onset.h.
+ */
+
+#include "lo_onset.h"
+
+#include <math.h>
+#include <string.h>
+
+#define LO_ONSET_WIN_MS   1000.0f  /* threshold statistics window         */
+#define LO_ONSET_GAP_MS   100.0f   /* no second onset within this time    */
+#define LO_ONSET_K        1.0f     /* threshold: mean + K · std           */
+#define LO_ONSET_FLOOR    0.05f    /* ... + floor, so silence never fires */
+#define LO_ONSET_RELEASE  2.0f     /* reference decay, log10 units per s  */
+
+void lo_onset_init(lo_onset_t *d, float hop_ms)
+{
+    memset(d, 0, sizeof(*d));
+    if (hop_ms < 1.0f) hop_ms = 1.0f;
+    float win = LO_ONSET_WIN_MS / hop_ms;
+    if (win > LO_ONSET_WIN_MAX) win = LO_ONSET_WIN_MAX;
+    if (win < 4.0f) win = 4.0f;
+    d->win   = (uint16_t)win;
+    d->gap   = (uint16_t)ceilf(LO_ONSET_GAP_MS / hop_ms);
+    d->since = d->gap;
+    d->release = LO_ONSET_RELEASE * hop_ms / 1000.0f;
+}
+
+float lo_onset_push(lo_onset_t *d, const float *bins)
+{
+    /* Increase over a peak-hold reference rather than the previous frame:
+     * a 256-sample window is shorter than a bass period, so bin energy
+     * wobbles with the phase of a sustained note and frame-to-frame flux
+     * would fire on the wobble. */
+    float flux = 0.0f;
+    for (int k = 0; k < LO_ONSET_BINS; k++) {
+        float ref  = d->prev[k] - d->release;
+        float diff = bins[k] - ref;
+        if (diff > 0.0f) flux += diff;
+        d->prev[k] = (bins[k] > ref) ? bins[k] : ref;
+    }
+    if (!d->primed) {           /* first frame: no previous spectrum */
+        d->primed = true;
+        return 0.0f;
+    }
+
+    /* Threshold from the frames before this one. */
+    float strength = 0.0f;
+    if (d->since < 0xFFFF) d->since++;
+    if (d->n >= d->win / 2) {
+        float mean = d->sum / (float)d->n;
+        float var  = d->sum_sq / (float)d->n - mean * mean;
+        float thr  = mean + LO_ONSET_K * sqrtf(var > 0.0f ? var : 0.0f) + LO_ONSET_FLOOR;
+        if (flux > thr && flux > d->last_flux && d->since >= d->gap) {
+            strength = 1.0f - thr / flux;
+            d->since = 0;
+        }
+    }
+    d->last_flux = flux;
+
+    /* Ring update; the sums are rebuilt once per lap so rounding does not
+     * accumulate (amortised O(1)). */
+    if (d->n == d->win) {
+        float old = d->hist[d->pos];
+        d->sum    -= old;
+        d->sum_sq -= old * old;
+    } else {
+        d->n++;
+    }
+    d->hist[d->pos] = flux;
+    d->sum    += flux;
+    d->sum_sq += flux * flux;
+    if (++d->pos == d->win) {
+        d->pos = 0;
+        d->sum = d->sum_sq = 0.0f;
+        for (uint16_t i = 0; i < d->n; i++) {
+            d->sum    += d->hist[i];
+            d->sum_sq += d->hist[i] * d->hist[i];
+        }
+    }
+    return strength;
+}
@@ -0,0 +1,52 @@
+/**
+ * @file lo_onset.h
+ * @brief Streaming spectral-flux onset detector for the light organ.
+ *
+ * Fed one spectrum per hop (log magnitudes of FFT bins 1–15, as produced by
+ * light_organ_bands()).  Flux is the sum of the positive bin-wise increases
+ * over a per-bin peak-hold reference that decays by LO_ONSET_RELEASE per
+ * second; an onset is a rising flux value above an adaptive
+ * threshold – mean + LO_ONSET_K standard deviations of the flux over the
+ * last second, plus a floor – at least LO_ONSET_GAP_MS after the previous
+ * onset.  Memory is constant and work per hop amortised constant: the
+ * threshold statistics are running sums over a fixed ring, rebuilt from
+ * the ring once per lap so rounding does not accumulate.
+ *
+ * Plain C/C++ without ESP-IDF dependencies so tools/lo_onset_score.py can
+ * build it on the host.
+ */
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LO_ONSET_BINS     15    /* FFT bins 1–15 of the 256-point frame */
+#define LO_ONSET_WIN_MAX  100   /* threshold window, frames (1 s at 10 ms) */
+
+typedef struct {
+    float    prev[LO_ONSET_BINS];    /* peak-hold reference spectrum     */
+    float    hist[LO_ONSET_WIN_MAX]; /* recent flux values (ring)        */
+    float    sum, sum_sq;            /* running sums over hist           */
+    float    last_flux;
+    float    release;                /* reference decay per hop          */
+    uint16_t win;                    /* ring length for this hop         */
+    uint16_t pos, n;
+    uint16_t gap, since;             /* minimum onset spacing, frames    */
+    bool     primed;                 /* prev holds a spectrum            */
+} lo_onset_t;
+
+/** @brief Reset @p d for a hop of @p hop_ms milliseconds. */
+void  lo_onset_init(lo_onset_t *d, float hop_ms);
+
+/**
+ * @brief Feed the next spectrum (LO_ONSET_BINS log magnitudes).
+ * @return Onset strength 0–1 for this frame; 0 = no onset.
+ */
+float lo_onset_push(lo_onset_t *d, const float *bins);
+
+#ifdef __cplusplus
+}
+#endif
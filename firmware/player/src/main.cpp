@@ -17,6 +17,7 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include <dirent.h>
@@ -33,10 +34,7 @@
 #include "driver/sdmmc_host.h"
 #include "sdmmc_cmd.h"
 #include "esp_vfs_fat.h"
-#ifdef HAVE_ADF
-#include "dsps_fft2r.h"
-#include "dsps_wind.h"
-#endif
+#include "diskio_sdmmc.h"
 
 /* Application modules (pure ESP-IDF, always compiled) */
 #include "pins.h"
@@ -44,12 +42,19 @@
 #include "disp_ota.h"
 #include "encoder.h"
 #include "encoder2.h"
+#include "crank_gate.h"
+#include "crank_trace.h"
 #include "potis.h"
 #include "uart_master.h"
 #include "web_server.h"
 #include "song_settings.h"
 #include "crank_config.h"
 #include "bt_ctrl.h"
+#include "light_organ.h"
+#include "lo_envelope.h"
+#include "bpm_analysis.h"
+#include "cue_track.h"
+#include "library.h"
 #include "cJSON.h"
 
 /* ESP-ADF headers (only when ADF_PATH is set in CMakeLists) */
@@ -72,7 +77,6 @@ static const char *TAG = "musicplayer";
  * Constants
  * ====================================================================== */
 
-#define MAX_SONGS      64
 #define MAX_NAME       (UM_MAX_SONG_NAME - 1)
 #define MOUNT_POINT    "/sdcard"
 #define WAV_HDR_BYTES  44u
@@ -84,8 +88,7 @@ static const char *TAG = "musicplayer";
  * Global state
  * ====================================================================== */
 
-static char    g_song_names[MAX_SONGS][UM_MAX_SONG_NAME];
-static uint8_t g_song_count = 0;
+static_assert(LIB_NAME_MAX == UM_MAX_SONG_NAME, "library names go to the display as is");
 
 static SemaphoreHandle_t s_state_mutex = nullptr;
 static int16_t  g_current_song = -1;
@@ -110,9 +113,11 @@ static volatile float    g_song_dimmer_rps_ref    = 1.4f; /* per-song full-brigh
 static volatile float    g_song_dimmer_holdoff_s  = 0.0f; /* song-position timestamp (s) before which dimmer is suppressed */
 static volatile float    g_song_dimmer_fadein_s   = 0.0f; /* seconds to fade from 0→full after holdoff */
 static volatile bool     g_song_light_organ        = false; /* true: dimmer driven by audio FFT, not crank speed */
-static volatile uint8_t  g_fft_dimmer_pct          = 0u;   /* 0-100, updated by light-organ FFT analysis */
+static volatile int8_t   g_song_st_profile         = -1;   /* time-stretch profile override, -1 = g_crank_cfg */
+static volatile float    g_song_bpm                = 0.0f; /* detected tempo at 1x, 0 = unknown (bpm_analysis) */
 
 static uint32_t g_song_bytes   = 0;
+static uint32_t g_data_offset  = WAV_HDR_BYTES;   /* first PCM byte of the song file */
 static uint32_t g_sample_rate  = 44100;
 static uint8_t  g_channels     = 2;
 static uint8_t  g_bps          = 2;
@@ -139,90 +144,6 @@ static esp_timer_handle_t s_wifi_auto_off_timer  = nullptr;
 
 static sdmmc_card_t *s_sdcard = nullptr;
 
-#ifdef HAVE_ADF
-/* ── Light-organ FFT analysis state ────────────────────────────────────────── */
-#define LO_FFT_SIZE  256   /* must be a power of two */
-static float  s_lo_fft_buf[LO_FFT_SIZE * 2]; /* real/imag interleaved               */
-static float  s_lo_fft_win[LO_FFT_SIZE];     /* Hann window coefficients             */
-static FILE  *s_lo_file    = nullptr;         /* second file handle for analysis reads */
-static bool   s_lo_fft_init = false;          /* one-time DSP initialisation flag     */
-
-static void run_light_organ_fft(void)
-{
-    if (!s_lo_file || !g_is_playing) return;
-
-    if (!s_lo_fft_init) {
-        dsps_fft2r_init_fc32(NULL, LO_FFT_SIZE);
-        dsps_wind_hann_f32(s_lo_fft_win, LO_FFT_SIZE);
-        s_lo_fft_init = true;
-    }
-
-    uint32_t bps_total = g_sample_rate * (uint32_t)g_channels * (uint32_t)g_bps;
-    float read_pos_s = g_audio_pos_s + g_crank_cfg.lo_lookahead_s;
-    if (read_pos_s < 0.0f) return;
-    uint32_t offset = WAV_HDR_BYTES + (uint32_t)(read_pos_s * (float)bps_total);
-    
-    uint32_t frame_sz = (uint32_t)g_channels * (uint32_t)g_bps;
-    if (frame_sz > 0) offset = (offset / frame_sz) * frame_sz;
-
-    if (fseek(s_lo_file, (long)offset, SEEK_SET) != 0) return;
-
-    /* REPARIERT: Array-Größe und Lese-Logik basierend auf int16_t Elementen */
-    int total_samples_needed = LO_FFT_SIZE * (int)g_channels;
-    int16_t raw[512]; /* Genug Platz für 256 Samples Stereo (512 Elemente) */
-    if (total_samples_needed > 512) total_samples_needed = 512;
-
-    size_t read_elements = fread(raw, sizeof(int16_t), total_samples_needed, s_lo_file);
-    if (read_elements < (size_t)total_samples_needed) return;
-
-    int step = (g_channels > 1) ? (int)g_channels : 1;
-    for (int i = 0; i < LO_FFT_SIZE; i++) {
-        float s = ((float)raw[i * step] / 32768.0f) * s_lo_fft_win[i];
-        s_lo_fft_buf[i * 2]     = s;    
-        s_lo_fft_buf[i * 2 + 1] = 0.0f; 
-    }
-
-    dsps_fft2r_fc32(s_lo_fft_buf, LO_FFT_SIZE);
-    dsps_bit_rev_fc32(s_lo_fft_buf, LO_FFT_SIZE);
-
-    /* Optimierte Frequenzbänder (Bass fokussiert auf echte Kicks) */
-    float bass = 0.0f, mid = 0.0f;
-    for (int i = 1; i <= 2; i++) { /* Nur Bin 1 & 2 für knackigen Bass */
-        float r = s_lo_fft_buf[i*2], im = s_lo_fft_buf[i*2+1];
-        bass += sqrtf(r*r + im*im);
-    }
-    for (int i = 3; i <= 15; i++) { /* Bin 3 rutscht zu den Mitten */
-        float r = s_lo_fft_buf[i*2], im = s_lo_fft_buf[i*2+1];
-        mid += sqrtf(r*r + im*im);
-    }
-
-    /* Logarithmische Kompression fühlt sich für das Auge linearer an */
-    float fft_raw = log10f(bass + 1.0f) * g_crank_cfg.lo_bass_weight
-                  + log10f(mid + 1.0f)  * g_crank_cfg.lo_mid_weight;
-
-    /* Auto-ranging mit angepasstem Rauschboden gegen Flackern bei Stille */
-    static float s_lo_max = 5.0f;  /* Höherer Start/Mindestwert gegen Rauschen */
-    static float s_lo_min = 0.0f;
-    
-    if (fft_raw > s_lo_max) s_lo_max = fft_raw;
-    else { s_lo_max *= g_crank_cfg.lo_decay_rate; if (s_lo_max < 5.0f) s_lo_max = 5.0f; }
-    
-    if (fft_raw < s_lo_min) s_lo_min = fft_raw * 0.5f + s_lo_min * 0.5f;
-    else { s_lo_min *= g_crank_cfg.lo_decay_rate; if (s_lo_min < 0.0f) s_lo_min = 0.0f; }
-
-    float range = s_lo_max - s_lo_min;
-    float level = (range > 0.5f)
-                  ? (fft_raw - s_lo_min) / range * 100.0f
-                  : 12.0f; /* Standard-Glimmen (Pre-Heat) wenn keine Dynamik da ist */
-                  
-    if (level > 100.0f) level = 100.0f;
-    if (level < 12.0f)  level = 12.0f;  /* Konsequenter Pre-Heat Schutz für Halogen */
-
-    g_fft_dimmer_pct = (uint8_t)level;
-}
-
-#endif /* HAVE_ADF */
-
 #ifdef HAVE_ADF
 static audio_pipeline_handle_t    g_pipeline  = nullptr;
 static audio_element_handle_t     g_fatfs_el  = nullptr;
@@ -233,47 +154,98 @@ static audio_element_handle_t     g_i2s_el    = nullptr;
 static audio_event_iface_handle_t g_evt       = nullptr;
 #endif
 
-/* ======================================================================
- * Helper: read WAV file header
- * ====================================================================== */
+#ifdef HAVE_ADF
+/* ── Audible position ─────────────────────────────────────────────────────── */
+/* i2s_stream write buffer and DMA ring (create_pipeline). */
+#define I2S_BUFFER_LEN     3600u
+#define I2S_DMA_DESC_NUM   4u
+#define I2S_DMA_FRAME_NUM  256u
+
+/* Last measured output latency, for /api/light_organ and the α-β
+ * look-ahead.  Written by io_task only. */
+static volatile float s_out_latency_ms = 0.0f;
+
+/* Output samples written by the SoundTouch element but not heard yet: the
+ * sonic→alc and alc→i2s ring buffers, half of i2s_stream's write buffer on
+ * average and the I2S DMA ring. */
+static uint32_t out_queued_samples(void)
+{
+    uint32_t bps    = (g_bps > 0) ? (uint32_t)g_bps : 2u;
+    int      queued = rb_bytes_filled(audio_element_get_output_ringbuf(g_sonic_el))
+                    + rb_bytes_filled(audio_element_get_output_ringbuf(g_alc_el));
+    /* The DMA ring is taken as full: i2s_stream blocks until a descriptor
+     * frees.  Mono slot mode: one sample per DMA frame. */
+    return (uint32_t)queued / bps
+         + I2S_BUFFER_LEN / 2u / bps
+         + I2S_DMA_DESC_NUM * I2S_DMA_FRAME_NUM;
+}
+
+/* Source sample index (tap index space) of the audio at the DAC right now.
+ * The element maps the queued output samples back to the source at the
+ * tempo they were stretched at, so the result holds across crank-speed
+ * changes.  Called from io_task and the light-organ task.
+ * false until the first output of the current stream is audible. */
+static bool audible_tap_index(uint32_t *idx)
+{
+    return soundtouch_el_tap_out_src(g_sonic_el, out_queued_samples(), idx);
+}
 
-static bool read_wav_info(const char *path,
-                          uint32_t   *out_data_bytes,
-                          uint32_t   *out_sample_rate,
-                          uint8_t    *out_channels,
-                          uint8_t    *out_bps)
+/* Playback position of the audio being heard, for lamp timing.
+ * false while stopped/paused or before the first sample is audible. */
+static bool get_audible_pos_s(float *out_s)
 {
-    struct stat st;
-    if (stat(path, &st) != 0) return false;
-
-    FILE *f = fopen(path, "rb");
-    if (!f) return false;
-
-    uint8_t hdr[WAV_HDR_BYTES];
-    bool ok = (fread(hdr, 1, WAV_HDR_BYTES, f) == WAV_HDR_BYTES);
-    fclose(f);
-
-    if (!ok) return false;
-    if (hdr[0]!='R'||hdr[1]!='I'||hdr[2]!='F'||hdr[3]!='F') return false;
-
-    uint32_t sr   = (uint32_t)hdr[24]       | ((uint32_t)hdr[25]<<8)
-                  | ((uint32_t)hdr[26]<<16) | ((uint32_t)hdr[27]<<24);
-    uint8_t  ch   = hdr[22];
-    uint16_t bits = (uint16_t)hdr[34] | ((uint16_t)hdr[35]<<8);
-    uint8_t  bps  = (bits >= 8) ? (uint8_t)(bits / 8) : 2;
-
-    if (sr  == 0) sr  = 44100;
-    if (ch  == 0) ch  = 2;
-    if (bps == 0) bps = 2;
-
-    *out_sample_rate = sr;
-    *out_channels    = ch;
-    *out_bps         = bps;
-    *out_data_bytes  = (st.st_size > (off_t)WAV_HDR_BYTES)
-                       ? (uint32_t)(st.st_size - WAV_HDR_BYTES) : 0u;
+    if (!g_is_playing || g_is_paused || !g_sonic_el) return false;
+    uint32_t ch  = (g_channels > 0) ? (uint32_t)g_channels : 1u;
+    uint32_t idx = 0;
+    if (!audible_tap_index(&idx)) return false;
+    *out_s = (float)idx / ((float)g_sample_rate * (float)ch);
     return true;
 }
 
+/* ── Light-organ audio source ─────────────────────────────────────────────── */
+/* Decoded PCM is tapped inside the SoundTouch element (source time, before
+ * stretching) instead of being re-read from the SD card.  The element runs
+ * one 16384-frame chunk plus the downstream ring buffers ahead of the DAC,
+ * so 128 Ki samples (256 KB PSRAM, ~1.5 s of 44.1 kHz stereo) cover the
+ * audible position and any lookahead that is already buffered. */
+#define LO_TAP_SAMPLES  (128 * 1024)
+
+/* Fetch callback of the light-organ task (core 0, low priority): first
+ * channel of the window centred on the audible sample, shifted by the
+ * lo_lookahead_s trim (lamp thermal lag). */
+static bool lo_fetch(int16_t *dst, int frames)
+{
+    if (!g_is_playing || g_is_paused || !g_sonic_el) return false;
+
+    uint32_t ch = (g_channels > 0) ? (uint32_t)g_channels : 1u;
+    int16_t raw[LIGHT_ORGAN_FFT_SIZE * 2];
+    if (ch > 2 || frames > LIGHT_ORGAN_FFT_SIZE) return false;
+    uint32_t count = (uint32_t)frames * ch;
+
+    uint32_t audible = 0;
+    if (!audible_tap_index(&audible)) return false;
+    int32_t  trim  = (int32_t)(g_crank_cfg.lo_lookahead_s * (float)g_sample_rate) * (int32_t)ch;
+    uint32_t first = audible + (uint32_t)trim - count / 2;
+    /* Lookahead past what the pipeline has decoded so far: use the newest
+     * buffered audio rather than skip the frame. */
+    uint32_t head = soundtouch_el_tap_head(g_sonic_el);
+    if ((int32_t)(head - (first + count)) < 0) first = head - count;
+    if (!soundtouch_el_tap_read(g_sonic_el, first, raw, count)) return false;
+
+    for (int i = 0; i < frames; i++) dst[i] = raw[i * ch];
+    return true;
+}
+
+/* Position callback of the light-organ task: song position the lamp shows
+ * now, for the precomputed envelope (same trim as lo_fetch). */
+static bool lo_pos(float *pos_s)
+{
+    if (!get_audible_pos_s(pos_s)) return false;
+    *pos_s += g_crank_cfg.lo_lookahead_s;
+    return true;
+}
+#endif /* HAVE_ADF */
+
 /* ======================================================================
  * SD card mount
  * ====================================================================== */
@@ -321,49 +293,43 @@ static void mount_sd(void)
 }
 
 /* ======================================================================
- * Playlist scanner
+ * Song library (library task)
  * ====================================================================== */
 
-static void scan_playlist(void)
+/* A song is new or changed: queue its light-organ envelope and have the
+ * BPM job walk the library again; songs with a current result are
+ * skipped by the jobs. */
+static void on_library_song(const char *wav_path)
 {
-    g_song_count = 0;
-    DIR *dir = opendir(MOUNT_POINT);
-    if (!dir) {
-        ESP_LOGE(TAG, "Cannot open " MOUNT_POINT);
-        return;
-    }
-
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != nullptr && g_song_count < MAX_SONGS) {
-        if (entry->d_type != DT_REG) continue;
-
-        const char *name = entry->d_name;
-        size_t      len  = strlen(name);
-        if (len <= 4) continue;
-
-        const char *ext = name + len - 4;
-        if (strcasecmp(ext, ".wav") != 0) continue;
+#ifdef HAVE_ADF
+    lo_envelope_request(wav_path);
+    bpm_analysis_request(wav_path);
+#else
+    (void)wav_path;
+#endif
+}
 
-        size_t base_len = len - 4;
-        if (base_len >= UM_MAX_SONG_NAME) base_len = UM_MAX_SONG_NAME - 1;
-        memcpy(g_song_names[g_song_count], name, base_len);
-        g_song_names[g_song_count][base_len] = '\0';
+static const um_list_src_t s_list_src = { library_version, library_count, library_listing };
 
-        ESP_LOGI(TAG, "  [%2u] %s", g_song_count, g_song_names[g_song_count]);
-        g_song_count++;
+/* Songs added, removed or renamed: one CMD_LIST_DELTA per change, or the
+ * new version alone (the display reloads its window) after a bulk change. */
+static void on_library_list(uint32_t version, const library_change_t *changes, uint16_t n)
+{
+    if (n == 0) {
+        uart_master_send_list_info(version, library_count());
+        return;
+    }
+    for (uint16_t i = 0; i < n; i++) {
+        const library_change_t *c = &changes[i];
+        uart_master_send_list_delta(version - n + i + 1u, c->op, (uint16_t)(c->idx + 1u),
+                                    c->name, c->old_name);
     }
-    closedir(dir);
-    ESP_LOGI(TAG, "Playlist: %u WAV file(s)", g_song_count);
 }
 
-/**
- * Public rescan entry-point called by the web server after a file operation.
- * Rescans the SD card and pushes the updated song list to the display.
- */
-static void player_rescan(void)
+/* The display asks for the window of the list it shows (uart rx_task). */
+static void on_list_page_req(uint16_t start, uint8_t count)
 {
-    scan_playlist();
-    uart_master_send_song_list(g_song_names, g_song_count);
+    uart_master_send_list_page(&s_list_src, start, count);
 }
 
 /* ======================================================================
@@ -384,10 +350,12 @@ static float get_current_pos_s_locked(void)
  * Volume / speed control (call with s_state_mutex held)
  * ====================================================================== */
 
+static float s_cue_volume = 1.0f;   /* cue-track volume scale 0–1 (io_task) */
+
 static void apply_volume_locked(uint8_t vol)
 {
     /* Power-law taper (γ=0.5): stretches the bottom quarter from –64…–48 dB to –64…–32 dB. */
-    float norm = sqrtf((float)vol / 100.0f);
+    float norm = sqrtf((float)vol * s_cue_volume / 100.0f);
     int db = (int)(norm * 64.0f) - 64;
     if (db < -64) db = -64;
     if (db >  63) db =  63;
@@ -427,17 +395,20 @@ static void pipeline_stop_and_reset(void)
  * This avoids a start→immediate-stop race that confuses the WAV decoder. */
 static void play_song_idx(uint16_t idx, bool start_pipeline = true)
 {
-    if (idx >= g_song_count) {
+    library_entry_t song;
+    if (!library_get(idx, &song)) {
         ESP_LOGW(TAG, "play_song_idx: index %u out of range", idx);
         return;
     }
 
     char path[8 + UM_MAX_SONG_NAME + 5];
-    snprintf(path, sizeof(path), "%s/%s.wav", MOUNT_POINT, g_song_names[idx]);
+    library_path(idx, path, sizeof(path));
 
-    /* Load optional per-song JSON settings before touching the pipeline. */
+    /* Load optional per-song JSON settings before touching the pipeline.
+     * The index knows whether the sidecars exist, so a song without them
+     * costs no directory lookup. */
     song_settings_t settings;
-    song_settings_load(path, &settings);
+    song_settings_load((song.sidecars & LIB_SIDE_JSON) ? path : nullptr, &settings);
     g_song_loop           = settings.loop;
     g_song_autoplay_next  = settings.autoplay_next;
     g_song_fixed_speed_en = (settings.fixed_speed > 0.0f);
@@ -450,20 +421,16 @@ static void play_song_idx(uint16_t idx, bool start_pipeline = true)
     g_song_dimmer_holdoff_s  = (float)settings.dimmer_holdoff_s;
     g_song_dimmer_fadein_s   = (float)settings.dimmer_fadein_s;
     g_song_light_organ       = settings.light_organ;
-#ifdef HAVE_ADF
-    if (s_lo_file) { fclose(s_lo_file); s_lo_file = nullptr; }
-    if (g_song_light_organ) s_lo_file = fopen(path, "rb");
-#endif
+    g_song_st_profile        = settings.st_profile;
+    g_song_bpm               = settings.bpm;
+    light_organ_set_beat_grid(settings.bpm, settings.beat_offset_s);
+    cue_track_select(path, (song.sidecars & LIB_SIDE_CUE) != 0,
+                     g_song_dimmer_holdoff_s, g_song_dimmer_fadein_s);
+    lo_envelope_select(path);   /* precomputed lamp envelope, analysed if missing */
 
-    uint32_t data_bytes = 0, sr = 44100;
-    uint8_t  ch = 2, bps = 2;
-    if (!read_wav_info(path, &data_bytes, &sr, &ch, &bps)) {
-        ESP_LOGW(TAG, "Cannot read WAV header: %s (using defaults)", path);
-        struct stat st;
-        if (stat(path, &st) == 0 && st.st_size > (off_t)WAV_HDR_BYTES) {
-            data_bytes = (uint32_t)(st.st_size - WAV_HDR_BYTES);
-        }
-    }
+    /* Format and data chunk come from the index (parsed once per file). */
+    uint32_t data_bytes = song.data_bytes, sr = song.sample_rate;
+    uint8_t  ch = song.channels, bps = song.bps;
 
     if (g_is_playing || g_is_paused) {
         pipeline_stop_and_reset();
@@ -472,6 +439,7 @@ static void play_song_idx(uint16_t idx, bool start_pipeline = true)
     xSemaphoreTake(s_state_mutex, portMAX_DELAY);
     g_current_song = (int16_t)idx;
     g_song_bytes   = data_bytes;
+    g_data_offset  = song.data_offset;
     g_sample_rate  = sr;
     g_channels     = ch;
     g_bps          = bps;
@@ -495,11 +463,14 @@ static void play_song_idx(uint16_t idx, bool start_pipeline = true)
     }
 
     if (start_pipeline) {
+        audio_el_tap_rebase(0);
         audio_pipeline_run(g_pipeline);
     }
 
+    char name[LIB_NAME_MAX];
+    library_name(idx, name, sizeof(name));
     ESP_LOGI(TAG, "Playing [%u]: %s  (%u B, %uHz, %uch, %ubps)",
-             idx, g_song_names[idx], data_bytes, sr, ch, bps);
+             idx, name, data_bytes, sr, ch, bps);
 }
 
 static void do_stop(void)
@@ -522,10 +493,10 @@ static void do_stop(void)
     g_song_dimmer_holdoff_s      = 0.0f;
     g_song_dimmer_fadein_s       = 0.0f;
     g_song_light_organ           = false;
-    g_fft_dimmer_pct             = 0u;
-#ifdef HAVE_ADF
-    if (s_lo_file) { fclose(s_lo_file); s_lo_file = nullptr; }
-#endif
+    g_song_st_profile            = -1;
+    g_song_bpm                   = 0.0f;
+    light_organ_set_beat_grid(0.0f, 0.0f);
+    cue_track_select(nullptr, false, 0.0f, 0.0f);
     ESP_LOGI(TAG, "Stopped");
 }
 
@@ -574,6 +545,14 @@ static void inject_wav_header(uint32_t pcm_remaining)
     }
 }
 
+/* Tell the SoundTouch analysis tap which source sample the next run starts
+ * at, so light-organ reads can address it by playback position. */
+static void audio_el_tap_rebase(uint32_t data_offset_bytes)
+{
+    uint32_t bps = (g_bps > 0) ? (uint32_t)g_bps : 2u;
+    soundtouch_el_tap_set_base(g_sonic_el, data_offset_bytes / bps);
+}
+
 static void do_pause(void)
 {
     if (!g_is_playing || g_is_paused) return;
@@ -599,7 +578,7 @@ static void do_resume(void)
     uint32_t raw_off       = (bytes_per_sec > 0)
                              ? (uint32_t)(g_audio_pos_s * (float)bytes_per_sec) : 0u;
     uint32_t aligned_off   = (raw_off / frame_sz) * frame_sz;
-    uint32_t file_offset   = WAV_HDR_BYTES + aligned_off;
+    uint32_t file_offset   = g_data_offset + aligned_off;
 
     audio_element_info_t info = {};
     audio_element_getinfo(g_fatfs_el, &info);
@@ -633,6 +612,7 @@ static void do_resume(void)
     g_wall_ref_us = esp_timer_get_time();
     xSemaphoreGive(s_state_mutex);
 
+    audio_el_tap_rebase(aligned_off);
     audio_pipeline_run(g_pipeline);
     ESP_LOGI(TAG, "Resumed from %.2f s (byte %u)  vol=%u", (double)g_audio_pos_s, file_offset, g_volume);
 }
@@ -656,7 +636,7 @@ static void do_seek(uint8_t pct)
         return;
     }
 
-    uint32_t file_offset = WAV_HDR_BYTES + aligned_off;
+    uint32_t file_offset = g_data_offset + aligned_off;
 
     pipeline_stop_and_reset();
 
@@ -686,6 +666,7 @@ static void do_seek(uint8_t pct)
     g_is_paused    = false;
     xSemaphoreGive(s_state_mutex);
 
+    audio_el_tap_rebase(aligned_off);
     audio_pipeline_run(g_pipeline);
     ESP_LOGI(TAG, "Seek %u%% -> %.2f s (byte %u)", pct, (double)new_pos_s, file_offset);
 }
@@ -722,6 +703,9 @@ static void create_pipeline(void)
     st_cfg.out_rb_size = 16 * 1024; /* 16 KB PSRAM – absorbs bursty TDHS output          */
     st_cfg.task_stack  =  16 * 1024; /*  16 KB – TDHS uses significant stack              */
     st_cfg.task_core   =          1; /* core 1: TDHS off core 0 so WAV decoder runs freely */
+    st_cfg.profile     = (soundtouch_profile_t)g_crank_cfg.st_profile;
+    st_cfg.dual_core   = g_crank_cfg.st_dual_core != 0; /* TDStretch on core 0 */
+    st_cfg.tap_samples = LO_TAP_SAMPLES;                /* light-organ analysis input */
     g_sonic_el = soundtouch_el_init(&st_cfg);
     configASSERT(g_sonic_el);
 
@@ -748,10 +732,10 @@ static void create_pipeline(void)
     i2s_cfg.std_cfg.slot_cfg.slot_mask       = I2S_STD_SLOT_BOTH;
     /* DMA buffers live in internal RAM; out_rb_size goes to PSRAM via audio_mem_calloc.
      * buffer_len must be a multiple of 12 (I2S_BUFFER_ALINED_BYTES_SIZE). */
-    i2s_cfg.buffer_len            = 3600;           /* default                   */
+    i2s_cfg.buffer_len            = I2S_BUFFER_LEN; /* default                   */
     i2s_cfg.out_rb_size           =  16 * 1024;     /*  16 KB       */
-    i2s_cfg.chan_cfg.dma_desc_num  = 4;             /* descriptors (was 8)       */
-    i2s_cfg.chan_cfg.dma_frame_num = 256;           /* frames/desc (was 1024)    */
+    i2s_cfg.chan_cfg.dma_desc_num  = I2S_DMA_DESC_NUM;  /* descriptors (was 8)    */
+    i2s_cfg.chan_cfg.dma_frame_num = I2S_DMA_FRAME_NUM; /* frames/desc (was 1024) */
     g_i2s_el = i2s_stream_init(&i2s_cfg);
     configASSERT(g_i2s_el);
 
@@ -822,7 +806,7 @@ static void audio_task(void *arg)
 
         if (s_cmd_display_ready) {
             s_cmd_display_ready = false;
-            uart_master_send_song_list(g_song_names, g_song_count);
+            uart_master_send_list_info(library_version(), library_count());
         }
 
 #ifdef HAVE_ADF
@@ -851,6 +835,15 @@ static void audio_task(void *arg)
             ESP_LOGI(TAG, "Tempo lock: %s (tempo_raw=%u)",
                      lock ? "LOCK" : "UNLOCK", (unsigned)lt);
         }
+
+        /* Time-stretch quality: per-song override, else the global setting.
+         * Re-evaluated every pass so web config changes apply live; the
+         * element ignores writes that do not change the profile. */
+        {
+            int8_t song_profile = g_song_st_profile;
+            int    profile      = (song_profile >= 0) ? song_profile : g_crank_cfg.st_profile;
+            soundtouch_el_set_profile(g_sonic_el, (soundtouch_profile_t)profile);
+        }
 #endif
 
         /* Listen for pipeline events (50 ms) */
@@ -879,9 +872,8 @@ static void audio_task(void *arg)
                     ESP_LOGI(TAG, "Loop: restarting song %u", loop_idx);
                     play_song_idx(loop_idx, false); /* load at pos 0, pipeline not started */
                     do_resume();                    /* start immediately                   */
-                } else if (g_song_autoplay_next && g_current_song >= 0 && g_song_count > 0) {
-                    uint16_t next_idx = (uint16_t)g_current_song + 1u;
-                    if (next_idx >= g_song_count) next_idx = 0u;
+                } else if (g_song_autoplay_next && g_current_song >= 0 && library_count() > 0) {
+                    uint16_t next_idx = library_next((uint16_t)g_current_song);   /* list order */
                     ESP_LOGI(TAG, "Autoplay-next: advancing to song %u", (unsigned)next_idx);
                     play_song_idx(next_idx, false);
                     do_resume();
@@ -905,7 +897,7 @@ static void audio_task(void *arg)
 
 static void on_play_song(uint16_t song_id)
 {
-    if (song_id > 0 && song_id <= g_song_count) {
+    if (song_id > 0 && song_id <= library_count()) {
         s_cmd_play_id = (int16_t)(song_id - 1);
     }
 }
@@ -975,14 +967,12 @@ static void on_seek(uint8_t pct)
  */
 static void on_song_settings_req(uint16_t song_id)
 {
-    if (song_id == 0 || song_id > g_song_count) {
+    char path[8 + UM_MAX_SONG_NAME + 5];
+    if (!library_path((uint16_t)(song_id - 1), path, sizeof(path))) {
         ESP_LOGW("main", "song_settings_req: id %u out of range", song_id);
         return;
     }
 
-    char path[8 + UM_MAX_SONG_NAME + 5];
-    snprintf(path, sizeof(path), "%s/%s.wav", MOUNT_POINT, g_song_names[song_id - 1]);
-
     song_settings_t s;
     song_settings_load(path, &s);
 
@@ -1020,24 +1010,29 @@ static void on_set_song_settings(uint16_t song_id,
                                  uint8_t  dimmer_fadein_s,
                                  uint8_t  pitch_influence_pct)
 {
-    if (song_id == 0 || song_id > g_song_count) {
+    /* Build paths */
+    char wav_path[8 + UM_MAX_SONG_NAME + 5];
+    if (!library_path((uint16_t)(song_id - 1), wav_path, sizeof(wav_path))) {
         ESP_LOGW("main", "set_song_settings: id %u out of range", song_id);
         return;
     }
 
-    /* Build paths */
-    char wav_path[8 + UM_MAX_SONG_NAME + 5];
-    snprintf(wav_path, sizeof(wav_path), "%s/%s.wav", MOUNT_POINT, g_song_names[song_id - 1]);
-
     size_t wav_len = strlen(wav_path);
     char   json_path[8 + UM_MAX_SONG_NAME + 7];
     memcpy(json_path, wav_path, wav_len - 4);
     memcpy(json_path + wav_len - 4, ".json", 6);
 
+    /* The display does not know about the time-stretch profile or the BPM
+     * analysis; keep the values already stored in the sidecar. */
+    song_settings_t prev;
+    song_settings_load(wav_path, &prev);
+
     /* If all settings are default: remove the sidecar file */
     if (flags == 0 && dimmer_holdoff_s == 0 && dimmer_fadein_s == 0 && pitch_influence_pct == 0
-        && dimmer_max == 100u && dimmer_min == 0u && dimmer_rps_ref_x10 == 14u) {
+        && dimmer_max == 100u && dimmer_min == 0u && dimmer_rps_ref_x10 == 14u
+        && prev.st_profile < 0 && prev.bpm_wav_bytes == 0u) {
         remove(json_path);
+        library_note_sidecar(wav_path, LIB_SIDE_JSON, false);
         ESP_LOGI("main", "Removed settings for song %u (all default)", song_id);
         if ((int16_t)(song_id - 1) == g_current_song) {
             g_song_loop           = false;
@@ -1048,6 +1043,7 @@ static void on_set_song_settings(uint16_t song_id,
             g_song_dimmer_holdoff_s      = 0.0f;
             g_song_dimmer_fadein_s       = 0.0f;
             soundtouch_el_set_pitch_influence(g_sonic_el, 0.0f);
+            cue_track_set_intro(0.0f, 0.0f);
         }
         return;
     }
@@ -1084,6 +1080,10 @@ static void on_set_song_settings(uint16_t song_id,
     if (light_organ) {
         cJSON_AddBoolToObject(root, "light_organ", true);
     }
+    if (prev.st_profile >= 0) {
+        cJSON_AddNumberToObject(root, "st_profile", prev.st_profile);
+    }
+    song_settings_keep_analysis(&prev, root);
 
     char *json_str = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
@@ -1094,6 +1094,7 @@ static void on_set_song_settings(uint16_t song_id,
     if (f) {
         fputs(json_str, f);
         fclose(f);
+        library_note_sidecar(wav_path, LIB_SIDE_JSON, true);
         ESP_LOGI("main", "Saved settings for song %u: %s", song_id, json_str);
     } else {
         ESP_LOGE("main", "Cannot write %s", json_path);
@@ -1113,16 +1114,8 @@ static void on_set_song_settings(uint16_t song_id,
         g_song_dimmer_holdoff_s  = (float)dimmer_holdoff_s;
         g_song_dimmer_fadein_s   = (float)dimmer_fadein_s;
         g_song_light_organ       = light_organ;
-        g_fft_dimmer_pct         = 0u;
-#ifdef HAVE_ADF
-        if (s_lo_file) { fclose(s_lo_file); s_lo_file = nullptr; }
-        if (light_organ) {
-            char wav_p[8 + UM_MAX_SONG_NAME + 5];
-            snprintf(wav_p, sizeof(wav_p), "%s/%s.wav", MOUNT_POINT, g_song_names[(uint8_t)g_current_song]);
-            s_lo_file = fopen(wav_p, "rb");
-        }
-#endif
         soundtouch_el_set_pitch_influence(g_sonic_el, (float)pitch_influence_pct / 100.0f);
+        cue_track_set_intro((float)dimmer_holdoff_s, (float)dimmer_fadein_s);
         ESP_LOGI("main", "Applied settings live: loop=%d autoplay_next=%d fixed_en=%d spd=%.2f pitch_infl=%u%% "
                  "max=%u min=%u rps_ref=%.1f holdoff=%us fadein=%us",
                  (int)loop, (int)autoplay_next, (int)fixed_en, fixed_en ? (double)spd : 1.0, pitch_influence_pct,
@@ -1148,8 +1141,7 @@ static void on_web_song_settings_saved(const char *wav_path,
     if (g_current_song < 0) return;
 
     char cur_path[8 + UM_MAX_SONG_NAME + 5];
-    snprintf(cur_path, sizeof(cur_path), "%s/%s.wav", MOUNT_POINT,
-             g_song_names[(uint8_t)g_current_song]);
+    if (!library_path((uint16_t)g_current_song, cur_path, sizeof(cur_path))) return;
     if (strcmp(wav_path, cur_path) != 0) return;
     if (loop && autoplay_next) autoplay_next = false;
 
@@ -1165,6 +1157,14 @@ static void on_web_song_settings_saved(const char *wav_path,
     g_song_dimmer_rps_ref   = (dimmer_rps_ref > 0.0f) ? dimmer_rps_ref : 1.4f;
     g_song_dimmer_holdoff_s = (float)dimmer_holdoff_s;
     g_song_dimmer_fadein_s  = (float)dimmer_fadein_s;
+    cue_track_set_intro((float)dimmer_holdoff_s, (float)dimmer_fadein_s);
+    {
+        /* The profile is not part of the callback arguments; read it back
+         * from the sidecar the web handler has just written. */
+        song_settings_t s;
+        song_settings_load(wav_path, &s);
+        g_song_st_profile = s.st_profile;
+    }
     /* Pitch influence on SoundTouch must be applied from the audio_task */
 #ifdef HAVE_ADF
     s_cmd_st_bypass_value   = (fixed_speed > 0.0f); /* reuse bypass flag for fixed-speed */
@@ -1177,6 +1177,284 @@ static void on_web_song_settings_saved(const char *wav_path,
              dimmer_holdoff_s, dimmer_fadein_s);
 }
 
+/* ======================================================================
+ * Time-stretch benchmark endpoint (HTTP-server task)
+ * GET /api/st_bench?speed=1.4&infl=0   (infl = pitch influence 0-100 %)
+ * Every profile is measured with the esp-dsp AA filter and with
+ * SoundTouch's generic C filter ("generic_*").  At infl=0 "dual" also
+ * compares the single- and dual-core paths with the configured profile.
+ * ====================================================================== */
+
+#ifdef HAVE_ADF
+struct st_bench_job_t {
+    float             speed;
+    float             pitch_influence;
+    uint32_t          cycles[SOUNDTOUCH_PROFILE_COUNT];
+    uint32_t          generic_cycles[SOUNDTOUCH_PROFILE_COUNT];
+    soundtouch_dual_bench_t dual;
+    esp_err_t         err;
+    esp_err_t         dual_err;
+    SemaphoreHandle_t done;
+};
+
+/* Runs pinned to core 1 so the cycle counter is the one of the audio core. */
+static void st_bench_task(void *arg)
+{
+    st_bench_job_t *job = static_cast<st_bench_job_t *>(arg);
+    job->err = soundtouch_el_benchmark((int)g_sample_rate, (int)g_channels,
+                                       job->speed, job->pitch_influence,
+                                       job->cycles, job->generic_cycles);
+    job->dual_err = ESP_ERR_NOT_SUPPORTED;
+    if (job->pitch_influence == 0.0f) {
+        job->dual_err = soundtouch_el_benchmark_dual((int)g_sample_rate, (int)g_channels, job->speed,
+                                                     (soundtouch_profile_t)g_crank_cfg.st_profile,
+                                                     &job->dual);
+    }
+    xSemaphoreGive(job->done);
+    vTaskDelete(nullptr);
+}
+
+static int on_st_bench(const char *query, char *buf, size_t len)
+{
+    if (g_is_playing) {
+        return snprintf(buf, len, "{\"error\":\"stop playback before benchmarking\"}");
+    }
+
+    st_bench_job_t job = {};
+    job.speed = SPEED_MAX;
+    const char *p;
+    if ((p = strstr(query, "speed=")) != nullptr) job.speed = strtof(p + 6, nullptr);
+    if ((p = strstr(query, "infl="))  != nullptr) job.pitch_influence = strtof(p + 5, nullptr) / 100.0f;
+    if (job.pitch_influence < 0.0f) job.pitch_influence = 0.0f;
+    else if (job.pitch_influence > 1.0f) job.pitch_influence = 1.0f;
+    if (job.speed < 0.5f || job.speed > 2.0f) job.speed = SPEED_MAX;
+
+    job.done = xSemaphoreCreateBinary();
+    if (!job.done) return -1;
+    if (xTaskCreatePinnedToCore(st_bench_task, "st_bench", 16 * 1024, &job,
+                                5, nullptr, 1) != pdPASS) {
+        vSemaphoreDelete(job.done);
+        return -1;
+    }
+    xSemaphoreTake(job.done, portMAX_DELAY);
+    vSemaphoreDelete(job.done);
+    if (job.err != ESP_OK) return -1;
+
+    const double cpu_hz = (double)CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ * 1e6;
+    int n = snprintf(buf, len, "{\"speed\":%.2f,\"pitch_influence\":%.0f,\"cpu_mhz\":%d,\"profiles\":[",
+                     (double)job.speed, (double)(job.pitch_influence * 100.0f),
+                     CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+    for (int i = 0; i < SOUNDTOUCH_PROFILE_COUNT && n < (int)len; i++) {
+        n += snprintf(buf + n, len - n,
+                      "%s{\"name\":\"%s\",\"cycles_per_s\":%lu,\"load_pct\":%.1f,"
+                      "\"generic_cycles_per_s\":%lu,\"generic_load_pct\":%.1f}",
+                      i ? "," : "", soundtouch_profile_name((soundtouch_profile_t)i),
+                      (unsigned long)job.cycles[i], (double)job.cycles[i] * 100.0 / cpu_hz,
+                      (unsigned long)job.generic_cycles[i],
+                      (double)job.generic_cycles[i] * 100.0 / cpu_hz);
+    }
+    if (n < (int)len) n += snprintf(buf + n, len - n, "]");
+    if (job.dual_err == ESP_OK && n < (int)len) {
+        n += snprintf(buf + n, len - n,
+                      ",\"dual\":{\"profile\":\"%s\",\"identical\":%s,"
+                      "\"single_pct\":%.1f,\"dual_core1_pct\":%.1f,\"dual_core0_pct\":%.1f}",
+                      soundtouch_profile_name((soundtouch_profile_t)g_crank_cfg.st_profile),
+                      job.dual.identical ? "true" : "false",
+                      (double)job.dual.single_cycles_per_s * 100.0 / cpu_hz,
+                      (double)job.dual.dual_caller_cycles_per_s * 100.0 / cpu_hz,
+                      (double)job.dual.dual_worker_cycles_per_s * 100.0 / cpu_hz);
+    }
+    if (n < (int)len) n += snprintf(buf + n, len - n, "}");
+    return (n < (int)len) ? n : -1;
+}
+#endif /* HAVE_ADF */
+
+/* ======================================================================
+ * Light-organ statistics endpoint (HTTP-server task)
+ * GET /api/light_organ   analysis rate, time per frame, output latency
+ * ====================================================================== */
+
+#ifdef HAVE_ADF
+static int on_light_organ_stats(const char *query, char *buf, size_t len)
+{
+    (void)query;
+    light_organ_stats_t st;
+    light_organ_get_stats(&st);
+    int n = snprintf(buf, len,
+                     "{\"rate_hz\":%u,\"frames\":%lu,\"skipped\":%lu,"
+                     "\"env_frames\":%lu,\"onsets\":%lu,\"avg_us\":%lu,\"max_us\":%lu,"
+                     "\"level\":%u,\"out_latency_ms\":%.1f}",
+                     (unsigned)st.rate_hz, (unsigned long)st.frames,
+                     (unsigned long)st.skipped, (unsigned long)st.env_frames,
+                     (unsigned long)st.onsets,
+                     (unsigned long)st.avg_us,
+                     (unsigned long)st.max_us, (unsigned)light_organ_get_level(),
+                     (double)s_out_latency_ms);
+    return (n < (int)len) ? n : -1;
+}
+#endif /* HAVE_ADF */
+
+/* ======================================================================
+ * BPM analysis (analysis task / HTTP-server task)
+ * GET /api/bpm   analysis throughput, tempo of the current song
+ * ====================================================================== */
+
+#ifdef HAVE_ADF
+/* A song finished analysing: if it is the one loaded, apply its grid now. */
+static void on_bpm_done(const char *wav_path, float bpm, float beat_offset_s)
+{
+    if (g_current_song < 0) return;
+    char path[8 + UM_MAX_SONG_NAME + 5];
+    if (!library_path((uint16_t)g_current_song, path, sizeof(path))) return;
+    if (strcmp(path, wav_path) != 0) return;
+    g_song_bpm = bpm;
+    light_organ_set_beat_grid(bpm, beat_offset_s);
+}
+
+static int on_bpm_stats(const char *query, char *buf, size_t len)
+{
+    (void)query;
+    bpm_analysis_stats_t st;
+    bpm_analysis_get_stats(&st);
+    float bpm = g_song_bpm;
+    int n = snprintf(buf, len,
+                     "{\"songs\":%lu,\"failed\":%lu,\"queued\":%lu,\"busy_ms\":%lu,"
+                     "\"songs_per_min\":%.2f,\"audio_x\":%.1f,\"paused\":%s,"
+                     "\"song\":%d,\"bpm\":%.1f,\"bpm_now\":%.1f}",
+                     (unsigned long)st.songs, (unsigned long)st.failed,
+                     (unsigned long)st.queued, (unsigned long)st.busy_ms,
+                     (double)st.songs_per_min, (double)st.audio_x,
+                     st.paused ? "true" : "false",
+                     (int)g_current_song, (double)bpm, (double)(bpm * g_speed));
+    return (n < (int)len) ? n : -1;
+}
+#endif /* HAVE_ADF */
+
+/* GET /api/dimmer – DimmerLink writer counters. */
+static int on_dimmer_stats(const char *query, char *buf, size_t len)
+{
+    (void)query;
+    dimmerlink_stats_t st;
+    dimmerlink_get_stats(&st);
+    int n = snprintf(buf, len,
+                     "{\"online\":%s,\"level\":%u,\"rate_hz\":%u,\"writes\":%lu,"
+                     "\"coalesced\":%lu,\"failures\":%lu,\"reprobes\":%lu}",
+                     st.online ? "true" : "false", (unsigned)st.level, (unsigned)st.rate_hz,
+                     (unsigned long)st.writes, (unsigned long)st.coalesced,
+                     (unsigned long)st.failures, (unsigned long)st.reprobes);
+    return (n < (int)len) ? n : -1;
+}
+
+/* GET /api/uart_link[?reset=1] – display link framing, error counters, the
+ * committed link rate and the last rate test at each step of the ladder. */
+static int on_uart_link_stats(const char *query, char *buf, size_t len)
+{
+    link_stats_t   st;
+    um_baud_step_t steps[UM_BAUD_STEP_MAX];
+    uint8_t ver     = uart_master_get_link_stats(&st, strstr(query, "reset=1") != nullptr);
+    uint8_t n_steps = uart_master_get_baud_steps(steps, UM_BAUD_STEP_MAX);
+    int n = snprintf(buf, len,
+                     "{\"version\":%u,\"baud\":%lu,\"tx_frames\":%lu,\"tx_bytes\":%lu,\"tx_payload\":%lu,"
+                     "\"tx_efficiency_pct\":%lu,\"rx_frames\":%lu,\"rx_bytes\":%lu,"
+                     "\"rx_payload\":%lu,\"rx_bad\":%lu,\"rx_malformed\":%lu,"
+                     "\"rx_noise\":%lu,\"rx_lost\":%lu,\"rx_reads\":%lu,"
+                     "\"rx_bytes_per_read\":%lu,\"rx_overflow\":%lu,\"no_reply\":%lu,"
+                     "\"baud_steps\":[",
+                     (unsigned)ver, (unsigned long)uart_master_link_baud(), (unsigned long)st.tx_frames, (unsigned long)st.tx_bytes,
+                     (unsigned long)st.tx_payload, (unsigned long)link_tx_efficiency_pct(&st),
+                     (unsigned long)st.rx_frames, (unsigned long)st.rx_bytes,
+                     (unsigned long)st.rx_payload, (unsigned long)st.rx_bad,
+                     (unsigned long)st.rx_malformed, (unsigned long)st.rx_noise,
+                     (unsigned long)st.rx_lost, (unsigned long)st.rx_reads,
+                     (unsigned long)link_rx_bytes_per_read(&st),
+                     (unsigned long)st.rx_overflow, (unsigned long)st.no_reply);
+    for (uint8_t i = 0; i < n_steps && n < (int)len; i++) {
+        n += snprintf(buf + n, len - (size_t)n,
+                      "%s{\"baud\":%lu,\"tested\":%s,\"ok\":%s,\"rtt_us\":%lu,\"bytes_per_s\":%lu}",
+                      i ? "," : "", (unsigned long)steps[i].baud,
+                      steps[i].tested ? "true" : "false", steps[i].ok ? "true" : "false",
+                      (unsigned long)steps[i].rtt_us, (unsigned long)steps[i].bytes_per_s);
+    }
+    if (n < (int)len) n += snprintf(buf + n, len - (size_t)n, "]}");
+    return (n < (int)len) ? n : -1;
+}
+
+/* ======================================================================
+ * IO loop timing
+ * ======================================================================
+ * io_task is paced by a periodic esp_timer instead of vTaskDelay(10), so the
+ * period does not stretch with the work done in a tick.  Each tick records
+ * how far the wake-up period deviated from IO_TICK_US in a histogram. */
+
+#define IO_TICK_US      10000   /* 100 Hz control loop */
+#define LIST_INFO_PERIOD_MS  2000 /* CMD_LIST_INFO repeat */
+#define IO_JITTER_BINS  8
+
+/* Upper edges [µs] of the |period − IO_TICK_US| bins; the last is open. */
+static const uint32_t k_jitter_edges_us[IO_JITTER_BINS - 1] = {
+    50, 100, 250, 500, 1000, 2500, 5000,
+};
+
+typedef struct {
+    uint32_t ticks;
+    uint32_t missed;                     /* timer periods that found the task busy */
+    uint32_t max_jitter_us;
+    uint32_t max_work_us;                /* longest tick body */
+    uint32_t hist[IO_JITTER_BINS];
+} io_loop_stats_t;
+
+static TaskHandle_t       s_io_task       = nullptr;
+static esp_timer_handle_t s_io_timer      = nullptr;
+static io_loop_stats_t    s_io_stats      = {};
+static volatile bool      s_io_stats_reset = false;
+
+static void io_timer_cb(void *arg)
+{
+    (void)arg;
+    xTaskNotifyGive(s_io_task);
+}
+
+/* Account one wake-up: @p pending notifications, woken at @p wake_us. */
+static void io_loop_tick(uint32_t pending, int64_t wake_us, int64_t *last_wake_us)
+{
+    if (s_io_stats_reset) {
+        s_io_stats_reset = false;
+        memset(&s_io_stats, 0, sizeof(s_io_stats));
+        *last_wake_us = 0;
+    }
+    if (pending > 1u) s_io_stats.missed += pending - 1u;
+    if (*last_wake_us != 0) {
+        int64_t  dev    = (wake_us - *last_wake_us) - (int64_t)IO_TICK_US * (int64_t)pending;
+        uint32_t jitter = (uint32_t)(dev < 0 ? -dev : dev);
+        int b = 0;
+        while (b < IO_JITTER_BINS - 1 && jitter >= k_jitter_edges_us[b]) b++;
+        s_io_stats.hist[b]++;
+        if (jitter > s_io_stats.max_jitter_us) s_io_stats.max_jitter_us = jitter;
+    }
+    s_io_stats.ticks++;
+    *last_wake_us = wake_us;
+}
+
+/* GET /api/io_loop[?reset=1] – control-loop jitter histogram. */
+static int on_io_loop_stats(const char *query, char *buf, size_t len)
+{
+    io_loop_stats_t st = s_io_stats;
+    if (strstr(query, "reset=1")) s_io_stats_reset = true;
+    int n = snprintf(buf, len,
+                     "{\"tick_us\":%d,\"ticks\":%lu,\"missed\":%lu,"
+                     "\"max_jitter_us\":%lu,\"max_work_us\":%lu,\"hist\":[",
+                     IO_TICK_US, (unsigned long)st.ticks, (unsigned long)st.missed,
+                     (unsigned long)st.max_jitter_us, (unsigned long)st.max_work_us);
+    for (int b = 0; b < IO_JITTER_BINS && n < (int)len; b++) {
+        n += snprintf(buf + n, len - (size_t)n, "%s{\"lt_us\":%ld,\"n\":%lu}",
+                      b ? "," : "",
+                      (b < IO_JITTER_BINS - 1) ? (long)k_jitter_edges_us[b] : -1L,
+                      (unsigned long)st.hist[b]);
+    }
+    if (n < (int)len) n += snprintf(buf + n, len - (size_t)n, "]}");
+    return (n < (int)len) ? n : -1;
+}
+
 /* ======================================================================
  * IO task (Core 0)
  * ====================================================================== */
@@ -1201,11 +1479,29 @@ static void io_task(void *arg)
     float speed_applied = SPEED_MIN;
 
     TickType_t last_state_tick = xTaskGetTickCount();
+    TickType_t last_list_tick  = last_state_tick;
     ESP_LOGI(TAG, "IO task running on core %d", xPortGetCoreID());
 
+    const esp_timer_create_args_t ta = {
+        .callback              = io_timer_cb,
+        .arg                   = nullptr,
+        .dispatch_method       = ESP_TIMER_TASK,
+        .name                  = "io_tick",
+        .skip_unhandled_events = true,
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&ta, &s_io_timer));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(s_io_timer, IO_TICK_US));
+    int64_t last_wake_us = 0;
+
     while (true) {
-        vTaskDelay(pdMS_TO_TICKS(10));
+        uint32_t pending = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        /* Sample the crank first, before any work that may block. */
+        float enc2_spd  = encoder2_update(); /* updates EMA; 0 when stopped */
+        bool  enc2_move = encoder2_is_moving();
+        int64_t wake_us = esp_timer_get_time();
+        io_loop_tick(pending, wake_us, &last_wake_us);
         TickType_t now = xTaskGetTickCount();
+        uart_master_batch_begin();     /* this tick's display messages share a frame */
 
         /* Volume potentiometer (tempo poti removed from speed control) */
         {
@@ -1223,22 +1519,44 @@ static void io_task(void *arg)
             }
         }
 
-        /* ── Light-organ FFT analysis (every 50 ms) ─────────────────────────── */
+        /* ── Light-organ analysis runs in its own task; just gate it ─────── */
 #ifdef HAVE_ADF
-        {
-            static uint8_t s_lo_tick = 0;
-            if (g_song_light_organ && g_is_playing) {
-                if (++s_lo_tick >= 5) { s_lo_tick = 0; run_light_organ_fft(); }
-            } else {
-                s_lo_tick = 0;
+        light_organ_set_active(g_song_light_organ && g_is_playing && !g_is_paused);
+        bpm_analysis_set_playing(g_is_playing && !g_is_paused);
+#endif
+
+        /* ── Cue track: lamp / volume / tempo lanes at the audible position ── */
+        cue_out_t cue = { 1.0f, 1.0f, 0.0f };
+        if (g_current_song >= 0) {
+            float cur_pos_s = 0.0f;
+#ifdef HAVE_ADF
+            if (!get_audible_pos_s(&cur_pos_s))
+#endif
+            {
+                xSemaphoreTake(s_state_mutex, portMAX_DELAY);
+                cur_pos_s = get_current_pos_s_locked();
+                xSemaphoreGive(s_state_mutex);
             }
+            cue_track_eval(cur_pos_s, &cue);
+        }
+#ifdef HAVE_ADF
+        if (g_is_playing && !g_is_paused && g_sonic_el) {
+            uint32_t ch = (g_channels > 0) ? (uint32_t)g_channels : 1u;
+            s_out_latency_ms = (float)out_queued_samples() * 1000.0f
+                             / ((float)g_sample_rate * (float)ch);
+        }
+        encoder2_set_output_latency(s_out_latency_ms * 0.001f);   /* α-β look-ahead */
+        if (fabsf(cue.volume - s_cue_volume) > 0.005f) {
+            xSemaphoreTake(s_state_mutex, portMAX_DELAY);
+            s_cue_volume = cue.volume;
+            apply_volume_locked(g_volume);   /* current level, fades included */
+            xSemaphoreGive(s_state_mutex);
         }
 #endif
 
         /* ── Organ encoder 2: speed + auto-pause/resume ─────────────────── */
         {
-            static bool       s_enc2_was_moving  = false;
-            static bool       s_enc2_pause_sent  = false;
+            static crank_gate_t s_gate           = {}; /* pause / resume fades */
             static uint8_t    s_last_tempo_sent  = 255; /* 255 = force first send */
             static uint8_t    s_last_live_sent   = 255; /* 255 = force first send */
             static TickType_t s_last_tempo_tick  = 0;
@@ -1247,99 +1565,47 @@ static void io_task(void *arg)
              * fires even if the crank never stopped between the song switch. */
             if (s_cmd_new_song_loaded) {
                 s_cmd_new_song_loaded = false;
-                s_enc2_was_moving     = false;
+                s_gate.was_moving     = false;
             }
 
-            /* Fade-out: ramp volume to 0 when crank stops, then pause.
-             * Fade-in:  ramp volume from 0 when crank starts, after resume.
-             * Step 1 per 10 ms tick → ~700–1000 ms at full volume.
-             * Mid-transition reversals cross-fade smoothly from current level. */
-            static bool    s_vol_fading  = false; /* fade-out active */
-            static bool    s_vol_fadein  = false; /* fade-in  active */
-            static int16_t s_fade_vol    = 0;     /* fade-out level (vol → 0) */
-            static int16_t s_fadein_vol  = 0;     /* fade-in  level (0 → vol) */
-
-            float enc2_spd  = encoder2_update(); /* updates EMA; 0 when stopped */
-            bool  enc2_move = encoder2_is_moving();
-
-            /* ── Dimmer: off during holdoff, optional fade-in, ramp with crank ── */
+            /* ── Dimmer: cue-track lamp lane (holdoff, fade-in, cues), ramp with crank ── */
             {
                 static uint8_t  s_last_dimmer_pct    = 255u;
                 static int16_t  s_dimmer_song_id     = -2;   /* -2 = uninitialized */
-                static bool     s_holdoff_was_active = false;
-                static bool     s_dimmer_fadein_on   = false;
-                static uint32_t s_dimmer_fadein_ms   = 0u;
                 static float    s_playing_pf         = 0.0f; /* lamp level at last playing tick */
                 uint8_t dpct;
 
-                /* Reset fade-in state when the active song changes */
                 if (s_dimmer_song_id != g_current_song) {
-                    s_dimmer_song_id     = g_current_song;
-                    s_holdoff_was_active = (g_song_dimmer_holdoff_s > 0.0f);
-                    s_dimmer_fadein_on   = false;
-                    s_dimmer_fadein_ms   = 0u;
-                    s_playing_pf         = 0.0f;
-                }
-
-                /* compare audio position against holdoff timestamp */
-                float cur_pos_s = 0.0f;
-                xSemaphoreTake(s_state_mutex, portMAX_DELAY);
-                cur_pos_s = get_current_pos_s_locked();
-                xSemaphoreGive(s_state_mutex);
-
-                bool holdoff_active = (g_song_dimmer_holdoff_s > 0.0f
-                                       && cur_pos_s < g_song_dimmer_holdoff_s);
-
-                /* trigger fade-in when holdoff expires */
-                if (s_holdoff_was_active && !holdoff_active
-                    && g_song_dimmer_fadein_s > 0.0f) {
-                    s_dimmer_fadein_on = true;
-                    s_dimmer_fadein_ms = 0u;
-                }
-                s_holdoff_was_active = holdoff_active;
-
-                /* Advance fade-in timer */
-                if (s_dimmer_fadein_on) {
-                    s_dimmer_fadein_ms += 10u;
-                    uint32_t total_ms = (uint32_t)(g_song_dimmer_fadein_s * 1000.0f);
-                    if (total_ms == 0u || s_dimmer_fadein_ms >= total_ms) {
-                        s_dimmer_fadein_on = false;
-                    }
+                    s_dimmer_song_id = g_current_song;
+                    s_playing_pf     = 0.0f;
                 }
 
                 /* Per-song dimmer params; defaults are 100/0/1.4 */
                 float dmax = (float)g_song_dimmer_max;
 
-                if (holdoff_active) {
+                if (cue.lamp <= 0.0f) {
                     dpct = 0u;
-                    s_playing_pf = 0.0f; /* stale brightness must not flash when holdoff expires */
-                } else if (s_vol_fading && vol > 0) {
+                    s_playing_pf = 0.0f; /* stale brightness must not flash when the lamp cue opens */
+                } else if (s_gate.fading && vol > 0) {
                     /* Fade from the last actual playing brightness, not from dmax.
                      * Avoids a jarring jump to full brightness when crank was slow. */
-                    float fade_scale = (float)s_fade_vol / (float)vol;
+                    float fade_scale = (float)s_gate.fade_vol / (float)vol;
                     dpct = (uint8_t)(s_playing_pf * fade_scale + 0.5f);
-                } else if ((g_is_playing || s_vol_fadein) && !s_enc2_pause_sent) {
+                } else if ((g_is_playing || s_gate.fadein) && !s_gate.pause_sent) {
                     /* Dimmer is independent from the audio volume ramp.
-                     * s_vol_fadein included so lamp doesn't flash off during the
+                     * s_gate.fadein included so lamp doesn't flash off during the
                      * brief window before audio_task sets g_is_playing. */
                     float dmin = (float)g_song_dimmer_min;
                     float t;
                     if (g_song_light_organ) {
                         /* Light-organ mode: brightness from FFT audio energy */
-                        t = (float)g_fft_dimmer_pct / 100.0f;
+                        t = (float)light_organ_get_level() / 100.0f;
                     } else {
                         float ref = g_song_dimmer_rps_ref;
                         t = (ref > 0.0f) ? (encoder2_get_instant_rps() / ref) : 0.0f;
                         if (t > 1.0f) t = 1.0f;
                     }
-                    float pf   = dmin + (dmax - dmin) * t;
-                    if (s_dimmer_fadein_on) {
-                        float total_ms = g_song_dimmer_fadein_s * 1000.0f;
-                        float scale    = (total_ms > 0.0f)
-                                       ? ((float)s_dimmer_fadein_ms / total_ms) : 1.0f;
-                        if (scale > 1.0f) scale = 1.0f;
-                        pf *= scale;
-                    }
+                    float pf   = (dmin + (dmax - dmin) * t) * cue.lamp;
                     s_playing_pf = pf; /* remember for smooth fade-out start */
                     dpct = (uint8_t)(pf + 0.5f);
                 } else {
@@ -1352,96 +1618,66 @@ static void io_task(void *arg)
                 }
             }
 
-            if (enc2_move) {
-                /* Cancel any in-progress fade-out; continue fading in from that level */
-                if (s_vol_fading) {
-                    s_vol_fading = false;
-                    s_vol_fadein = true;
-                    s_fadein_vol = s_fade_vol;
-                }
-                s_enc2_pause_sent = false; /* re-arm for next stop */
-                /* Rising edge: encoder started spinning while song is paused */
-                if (!s_enc2_was_moving && g_is_paused && g_current_song >= 0) {
-                    /* Pre-silence output, then resume and ramp up */
-                    s_vol_fadein = true;
-                    s_fadein_vol = 0;
+            /* Pause / resume with volume fades (crank_gate.h).
+             * Step vol_fade_step per 10 ms tick → ~700–1000 ms at full volume. */
 #ifdef HAVE_ADF
-                    xSemaphoreTake(s_state_mutex, portMAX_DELAY);
-                    apply_volume_locked(0);
-                    xSemaphoreGive(s_state_mutex);
+            uint8_t fade_step = g_crank_cfg.vol_fade_step;
+#else
+            uint8_t fade_step = 0;   /* no audio pipeline – pause at once */
 #endif
-                    s_cmd_resume = true;
-                }
-                /* Update speed target while song is active and speed not locked */
-                if ((g_is_playing || g_is_paused) && !g_tempo_locked) {
-                    speed_target = enc2_spd; /* RPS ≈ speed multiplier */
-                    if (speed_target < SPEED_MIN) speed_target = SPEED_MIN;
-                    if (speed_target > SPEED_MAX) speed_target = SPEED_MAX;
-                }
+            bool gate_playing = g_is_playing, gate_paused = g_is_paused;
+            crank_gate_out_t gate;
+            crank_gate_step(&s_gate, enc2_move, gate_playing, gate_paused,
+                            g_current_song >= 0, vol, fade_step, &gate);
 #ifdef HAVE_ADF
-                /* Step fade-in each tick until target volume is reached */
-                if (s_vol_fadein) {
-                    s_fadein_vol += (int16_t)g_crank_cfg.vol_fade_step;
-                    if (s_fadein_vol >= (int16_t)vol) {
-                        s_fadein_vol = (int16_t)vol;
-                        s_vol_fadein = false;
-                        xSemaphoreTake(s_state_mutex, portMAX_DELAY);
-                        apply_volume_locked(vol);
-                        xSemaphoreGive(s_state_mutex);
-                    } else {
-                        xSemaphoreTake(s_state_mutex, portMAX_DELAY);
-                        apply_volume_locked((uint8_t)s_fadein_vol);
-                        xSemaphoreGive(s_state_mutex);
-                    }
-                }
+            if (gate.volume >= 0) {
+                xSemaphoreTake(s_state_mutex, portMAX_DELAY);
+                apply_volume_locked((uint8_t)gate.volume);
+                xSemaphoreGive(s_state_mutex);
+            }
 #endif
-            } else {
-                /* Cancel any in-progress fade-in; start fade-out from that level */
-                if (s_vol_fadein) {
-                    s_vol_fadein = false;
-                    s_vol_fading = true;
-                    s_fade_vol   = s_fadein_vol;
-                }
-                /* Encoder stopped – fade volume to 0 before pausing */
-                if (g_is_playing && !s_enc2_pause_sent) {
-                    if (!s_vol_fading) {
-                        /* Start fade from the current poti volume */
-                        s_vol_fading = true;
-                        s_fade_vol   = (int16_t)vol;
-                    }
+            if (gate.resume) s_cmd_resume = true;
+            if (gate.pause)  s_cmd_pause  = true;
+
+            /* Update speed target while song is active and speed not locked */
+            if (enc2_move && (g_is_playing || g_is_paused) && !g_tempo_locked && cue.tempo <= 0.0f) {
+                speed_target = enc2_spd; /* RPS ≈ speed multiplier */
+                if (speed_target < SPEED_MIN) speed_target = SPEED_MIN;
+                if (speed_target > SPEED_MAX) speed_target = SPEED_MAX;
+            }
+
+            /* Flight recorder: raw input and decisions of this tick */
+            {
+                enc2_tick_t tk;
+                encoder2_get_tick(&tk);
+                crank_trace_rec_t r;
+                r.t_us      = (uint32_t)tk.t_us;
+                r.delta     = (int16_t)(tk.delta >  INT16_MAX ? INT16_MAX :
+                                        tk.delta < -INT16_MAX ? -INT16_MAX : tk.delta);
+                r.flags     = (uint8_t)((tk.window      ? CRANK_TR_WINDOW  : 0) |
+                                        (enc2_move      ? CRANK_TR_MOVING  : 0) |
+                                        (gate_playing   ? CRANK_TR_PLAYING : 0) |
+                                        (gate_paused    ? CRANK_TR_PAUSED  : 0) |
+                                        (g_current_song >= 0 ? CRANK_TR_SONG : 0) |
+                                        (gate.pause     ? CRANK_TR_PAUSE   : 0) |
+                                        (gate.resume    ? CRANK_TR_RESUME  : 0));
+                r.vol       = vol;
+                r.edge_rps  = tk.edge_rps;
+                r.out       = enc2_spd;
 #ifdef HAVE_ADF
-                    /* Step fade down each 10 ms tick */
-                    s_fade_vol -= (int16_t)g_crank_cfg.vol_fade_step;
-                    if (s_fade_vol <= 0) {
-                        s_fade_vol = 0;
-                        s_vol_fading = false;
-                        /* Fade complete – issue pause and restore volume so
-                         * the next resume starts at the correct level */
-                        xSemaphoreTake(s_state_mutex, portMAX_DELAY);
-                        apply_volume_locked(vol);
-                        xSemaphoreGive(s_state_mutex);
-                        s_cmd_pause       = true;
-                        s_enc2_pause_sent = true;
-                    } else {
-                        xSemaphoreTake(s_state_mutex, portMAX_DELAY);
-                        apply_volume_locked((uint8_t)s_fade_vol);
-                        xSemaphoreGive(s_state_mutex);
-                    }
+                r.latency_s = s_out_latency_ms * 0.001f;
 #else
-                    /* No ADF – pause immediately */
-                    s_vol_fading      = false;
-                    s_cmd_pause       = true;
-                    s_enc2_pause_sent = true;
+                r.latency_s = 0.0f;
 #endif
-                }
+                crank_trace_add(&r);
             }
-            s_enc2_was_moving = enc2_move;
 
             /* Push speed to display whenever it changes by ≥1 unit (0–100).
              * send_state() covers playback; send_poti_update() ensures the
              * display's speed bar stays current at all times. */
             float disp_speed = g_song_fixed_speed_en
                 ? g_song_fixed_speed
+                : (cue.tempo > 0.0f) ? cue.tempo
                 : (g_tempo_locked
                     ? (SPEED_MIN + ((float)g_locked_tempo_raw / 100.0f) * (SPEED_MAX - SPEED_MIN))
                     : speed_target);
@@ -1467,10 +1703,12 @@ static void io_task(void *arg)
 
 #ifdef HAVE_ADF
         /* Apply updated speed target to SoundTouch every tick.
-         * When speed is locked the locked value always wins over encoder2. */
+         * When speed is locked (cue track, then switch) the locked value
+         * always wins over encoder2. */
         {
             speed_applied = g_song_fixed_speed_en
                 ? g_song_fixed_speed
+                : (cue.tempo > 0.0f) ? cue.tempo
                 : (g_tempo_locked
                     ? (SPEED_MIN + ((float)g_locked_tempo_raw / 100.0f) * (SPEED_MAX - SPEED_MIN))
                     : speed_target);
@@ -1536,6 +1774,7 @@ static void io_task(void *arg)
             xSemaphoreTake(s_state_mutex, portMAX_DELAY);
             float   pos_s   = get_current_pos_s_locked();
             bool    playing = g_is_playing || g_is_paused;
+            bool    paused  = g_is_paused;
             uint8_t cur_vol = g_volume;
             float   speed   = g_speed;
             int16_t song    = g_current_song;
@@ -1545,19 +1784,17 @@ static void io_task(void *arg)
             uint8_t  bps    = g_bps;
             xSemaphoreGive(s_state_mutex);
 
-            uint8_t  pct   = 0;
-            uint16_t dur_s = 0;
+            /* Position and length in song time; the display scales them by
+             * the rate for its speed-adjusted time label. */
+            um_state_t st = {};
             uint32_t bps_total = sr * ch * bps;
-
+            float eff_speed = g_bypass_active ? 1.0f : speed;
             if (sbytes > 0 && bps_total > 0) {
-                float dur_raw = (float)sbytes / (float)bps_total;
-                float eff_speed = g_bypass_active ? 1.0f : speed;
-                if (pos_s > dur_raw) pos_s = dur_raw;
-                pct = (uint8_t)((pos_s / dur_raw) * 100.0f + 0.5f);
-                if (pct > 100) pct = 100;
-                float adj = (eff_speed > 0.01f) ? (dur_raw / eff_speed) : 0.0f;
-                dur_s = (uint16_t)(adj + 0.5f);
+                st.duration_ms = (uint32_t)((uint64_t)sbytes * 1000u / bps_total);
+                uint32_t pos_ms = (uint32_t)(pos_s * 1000.0f + 0.5f);
+                st.position_ms = (pos_ms < st.duration_ms) ? pos_ms : st.duration_ms;
             }
+            st.rate_x1000 = (uint16_t)(eff_speed * 1000.0f + 0.5f);
 
             uint8_t tempo_byte;
             if (g_bypass_active) {
@@ -1568,16 +1805,30 @@ static void io_task(void *arg)
             }
             if (tempo_byte > 100) tempo_byte = 100;
 
-            const char *name = (song >= 0 && (uint8_t)song < g_song_count)
-                               ? g_song_names[song] : "";
-
-            uint8_t  state_flags = g_tempo_locked ? 0x01u : 0x00u;
-            if (bt_ctrl_is_enabled())      state_flags |= 0x02u;
-            if (web_server_is_running())   state_flags |= 0x04u;
-            uint16_t state_id    = (song >= 0) ? (uint16_t)((uint16_t)song + 1u) : 0u;
-            uart_master_send_state(name, (uint8_t)(playing ? 1 : 0),
-                                   cur_vol, tempo_byte, pct, dur_s, state_flags, state_id);
+            if (song >= 0) library_name((uint16_t)song, st.song_name, sizeof(st.song_name));
+
+            st.flags = g_tempo_locked ? UM_STATE_SPEED_LOCKED : 0u;
+            if (bt_ctrl_is_enabled())      st.flags |= UM_STATE_BT_ON;
+            if (web_server_is_running())   st.flags |= UM_STATE_WIFI_ON;
+            if (paused)                    st.flags |= UM_STATE_PAUSED;
+            st.song_id    = (song >= 0) ? (uint16_t)((uint16_t)song + 1u) : 0u;
+            st.is_playing = playing ? 1u : 0u;
+            st.volume     = cur_vol;
+            st.tempo      = tempo_byte;
+            uart_master_send_state(&st);
+
+            /* Repeat the list version so a display that missed a delta
+             * notices the gap and reloads its window. */
+            if ((now - last_list_tick) >= pdMS_TO_TICKS(LIST_INFO_PERIOD_MS)) {
+                last_list_tick = now;
+                uart_master_send_list_info(library_version(), library_count());
+            }
         }
+
+        uart_master_batch_end();
+
+        uint32_t work_us = (uint32_t)(esp_timer_get_time() - wake_us);
+        if (work_us > s_io_stats.max_work_us) s_io_stats.max_work_us = work_us;
     }
 }
 
@@ -1608,16 +1859,28 @@ extern "C" void app_main(void)
 
     s_state_mutex = xSemaphoreCreateMutex();
     configASSERT(s_state_mutex);
+    cue_track_init();
 
     mount_sd();
-    scan_playlist();
+    /* Songs come from the index file; the directory is walked after the
+     * display and the analysis jobs are up (library_refresh() below). */
+    library_init(MOUNT_POINT, ff_diskio_get_pdrv_card(s_sdcard),
+                 on_library_song, on_library_list);
     crank_config_load();
 
     //delay 2 seconds to allow the display to boot and send its SYNC command
     vTaskDelay(pdMS_TO_TICKS(2000));
 
-    web_server_init(player_rescan);
+    web_server_init(library_refresh);   /* web file operations rescan the card */
     web_server_set_song_settings_callback(on_web_song_settings_saved);
+#ifdef HAVE_ADF
+    web_server_add_json_endpoint("/api/st_bench", on_st_bench);
+    web_server_add_json_endpoint("/api/light_organ", on_light_organ_stats);
+    web_server_add_json_endpoint("/api/bpm", on_bpm_stats);
+#endif
+    web_server_add_json_endpoint("/api/dimmer", on_dimmer_stats);
+    web_server_add_json_endpoint("/api/io_loop", on_io_loop_stats);
+    web_server_add_json_endpoint("/api/uart_link", on_uart_link_stats);
 
 #ifdef HAVE_ADF
     create_pipeline();
@@ -1634,9 +1897,10 @@ extern "C" void app_main(void)
         gpio_config(&sw_cfg);
     }
 
-    potis_init();    /* must come before encoder_init() – shares ADC1 handle */
+    potis_init();    /* must come before encoder_init() – samples the button ladder */
     encoder_init();
     encoder2_init();
+    crank_trace_init();
     crank_config_apply();
     bt_ctrl_init();
 
@@ -1648,8 +1912,9 @@ extern "C" void app_main(void)
     uart_master_set_bt_ctrl_callback(on_bt_ctrl);
     uart_master_set_song_settings_req_callback(on_song_settings_req);
     uart_master_set_set_song_settings_callback(on_set_song_settings);
+    uart_master_set_list_page_req_callback(on_list_page_req);
 
-    uart_master_send_song_list(g_song_names, g_song_count);
+    uart_master_send_list_info(library_version(), library_count());
 
     if (!uart_master_sync(500)) {
         /* Display did not respond – auto-enable WiFi so the user can flash it
@@ -1665,9 +1930,16 @@ extern "C" void app_main(void)
     configASSERT(audio_ok == pdPASS);
 #endif
 
+#ifdef HAVE_ADF
+    light_organ_start(lo_fetch, lo_pos);   /* low-priority analysis task, core 0 */
+    lo_envelope_init();                    /* envelope job, uses the FFT set up above */
+    bpm_analysis_init(on_bpm_done);        /* idle-priority, pauses during playback */
+#endif
+    library_refresh();   /* first walk: picks up card changes, queues analysis */
+
     BaseType_t io_ok = xTaskCreatePinnedToCore(
         io_task, "io_task", 4096, nullptr,
-        configMAX_PRIORITIES - 3, nullptr, 0);
+        configMAX_PRIORITIES - 3, &s_io_task, 0);
     configASSERT(io_ok == pdPASS);
 
     ESP_LOGI(TAG, "All tasks launched");
@@ -1,6 +1,7 @@
 /**
  * @file potis.cpp
- * @brief Rheostat reader using the ESP32-S3 ADC oneshot driver (IDF 5.x).
+ * @brief Rheostat and button-ladder reader using the ESP32-S3 ADC continuous
+ *        (DMA) driver (IDF 5.x).
  *
  * Circuit: 3.3 V ── [Rheostat] ──┬── [1.5 kΩ series] ── GND
  *                                 └── ADC pin
@@ -9,29 +10,36 @@
  * ADC values measured at the physical min / centre / max knob positions).
  * Defaults match the circuit model; the web calibration wizard overwrites them.
  *
- * Uses the IDF high-level "ADC Oneshot" driver (esp_adc/adc_oneshot.h).
+ * Uses the IDF "ADC Continuous" driver (esp_adc/adc_continuous.h): the
+ * digital controller alternates between the pot and the button channel at
+ * POT_SAMPLE_HZ and DMAs the results in POT_FRAME_BYTES frames.  The
+ * conversion-done callback (ISR context) averages each frame per channel
+ * (32 samples each), runs the pot mean through a 1/8 IIR and publishes both
+ * values; nothing reads the driver's pool, which flushes itself.
+ *
  * Attenuation: ADC_ATTEN_DB_12 → 0–3.3 V input range.
  */
 
 #include "potis.h"
 
-#include "esp_adc/adc_oneshot.h"
+#include "esp_adc/adc_continuous.h"
 #include "esp_log.h"
-
-#include <string.h>
-#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
 static const char *TAG = "potis";
 
 /* ── Internal state ─────────────────────────────────────────────────────── */
 
-static adc_oneshot_unit_handle_t s_adc_handle = nullptr;
+static adc_continuous_handle_t s_adc_handle = nullptr;
 
 static adc_channel_t s_vol_ch = ADC_CHANNEL_0;
+static adc_channel_t s_btn_ch = ADC_CHANNEL_2;
 
-static uint16_t s_vol_buf[POT_AVG_SAMPLES];
-static uint8_t  s_buf_idx  = 0;
-static bool     s_buf_full = false;
+/* Written by the conversion-done callback, read with __atomic loads. */
+static uint32_t s_vol_q8  = 0;    /* pot IIR state, raw << 8          */
+static uint32_t s_btn_raw = 0;    /* button ladder mean of last frame  */
+static uint32_t s_frames  = 0;    /* frames processed                  */
 
 static uint8_t s_last_volume = 0xFF;
 
@@ -65,17 +73,45 @@ static uint8_t raw_to_pct(uint32_t avg_raw)
     return (uint8_t)(pct + 0.5f);
 }
 
-static uint32_t buf_raw_avg(void)
+/* Decimate one DMA frame: mean per channel, then the pot IIR. */
+static bool on_conv_done(adc_continuous_handle_t handle,
+                         const adc_continuous_evt_data_t *edata, void *user_data)
+{
+    (void)handle;
+    (void)user_data;
+    uint32_t vol_sum = 0, vol_n = 0, btn_sum = 0, btn_n = 0;
+    for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= edata->size;
+         i += SOC_ADC_DIGI_RESULT_BYTES) {
+        const adc_digi_output_data_t *p =
+            (const adc_digi_output_data_t *)&edata->conv_frame_buffer[i];
+        if (p->type2.channel == (uint32_t)s_vol_ch) {
+            vol_sum += p->type2.data;
+            vol_n++;
+        } else if (p->type2.channel == (uint32_t)s_btn_ch) {
+            btn_sum += p->type2.data;
+            btn_n++;
+        }
+    }
+    uint32_t frames = s_frames;
+    if (vol_n > 0) {
+        uint32_t x = (vol_sum << 8) / vol_n;
+        uint32_t y = (frames == 0) ? x : s_vol_q8;
+        y = (uint32_t)((int32_t)y + (((int32_t)x - (int32_t)y) >> POT_IIR_SHIFT));
+        __atomic_store_n(&s_vol_q8, y, __ATOMIC_RELAXED);
+    }
+    if (btn_n > 0) __atomic_store_n(&s_btn_raw, btn_sum / btn_n, __ATOMIC_RELAXED);
+    __atomic_store_n(&s_frames, frames + 1, __ATOMIC_RELEASE);
+    return false;   /* no task woken */
+}
+
+static uint32_t vol_raw(void)
 {
-    uint8_t n = s_buf_full ? POT_AVG_SAMPLES : (s_buf_idx == 0 ? 1u : s_buf_idx);
-    uint32_t sum = 0;
-    for (uint8_t i = 0; i < n; i++) sum += s_vol_buf[i];
-    return (n > 0) ? (sum / n) : 0u;
+    return (__atomic_load_n(&s_vol_q8, __ATOMIC_RELAXED) + 128u) >> 8;
 }
 
-static uint8_t buf_average(void)
+static uint8_t vol_average(void)
 {
-    return raw_to_pct(buf_raw_avg());
+    return raw_to_pct(vol_raw());
 }
 
 /* ══════════════════════════════════════════════════════════════════════════════
@@ -84,43 +120,63 @@ static uint8_t buf_average(void)
 
 void potis_init(void)
 {
-    adc_unit_t vol_unit;
-    ESP_ERROR_CHECK(adc_oneshot_io_to_channel(POT_PIN_VOLUME, &vol_unit, &s_vol_ch));
+    adc_unit_t vol_unit, btn_unit;
+    ESP_ERROR_CHECK(adc_continuous_io_to_channel(POT_PIN_VOLUME, &vol_unit, &s_vol_ch));
+    ESP_ERROR_CHECK(adc_continuous_io_to_channel(BTN_ADC_PIN, &btn_unit, &s_btn_ch));
 
     if (vol_unit != ADC_UNIT_1) {
         ESP_LOGE(TAG, "Volume GPIO must belong to ADC1 – check pins.h");
     }
+    if (btn_unit != ADC_UNIT_1) {
+        ESP_LOGE(TAG, "BTN_ADC_PIN (GPIO%d) is not on ADC1 – check pins.h", BTN_ADC_PIN);
+    }
 
-    ESP_LOGI(TAG, "GPIO%d → ADC1_CH%d (volume)", POT_PIN_VOLUME, s_vol_ch);
-
-    /* Initialise ADC1 in oneshot mode */
-    adc_oneshot_unit_init_cfg_t unit_cfg = {
-        .unit_id  = ADC_UNIT_1,
-        .ulp_mode = ADC_ULP_MODE_DISABLE,
-    };
-    ESP_ERROR_CHECK(adc_oneshot_new_unit(&unit_cfg, &s_adc_handle));
-
-    adc_oneshot_chan_cfg_t chan_cfg = {
-        .atten    = ADC_ATTEN_DB_12,
-        .bitwidth = ADC_BITWIDTH_12,
-    };
-    ESP_ERROR_CHECK(adc_oneshot_config_channel(s_adc_handle, s_vol_ch, &chan_cfg));
-
-    memset(s_vol_buf, 0, sizeof(s_vol_buf));
+    ESP_LOGI(TAG, "GPIO%d → ADC1_CH%d (volume), GPIO%d → ADC1_CH%d (buttons)",
+             POT_PIN_VOLUME, s_vol_ch, BTN_ADC_PIN, s_btn_ch);
+
+    /* Pool of one frame, flushed by the driver: results are consumed in
+     * the callback only. */
+    adc_continuous_handle_cfg_t handle_cfg = {};
+    handle_cfg.max_store_buf_size = POT_FRAME_BYTES;
+    handle_cfg.conv_frame_size    = POT_FRAME_BYTES;
+    handle_cfg.flags.flush_pool   = 1;
+    ESP_ERROR_CHECK(adc_continuous_new_handle(&handle_cfg, &s_adc_handle));
+
+    adc_digi_pattern_config_t pattern[2] = {};
+    const adc_channel_t chans[2] = { s_vol_ch, s_btn_ch };
+    for (int i = 0; i < 2; i++) {
+        pattern[i].atten     = ADC_ATTEN_DB_12;
+        pattern[i].channel   = (uint8_t)chans[i];
+        pattern[i].unit      = ADC_UNIT_1;
+        pattern[i].bit_width = ADC_BITWIDTH_12;
+    }
+    adc_continuous_config_t dig_cfg = {};
+    dig_cfg.pattern_num    = 2;
+    dig_cfg.adc_pattern    = pattern;
+    dig_cfg.sample_freq_hz = POT_SAMPLE_HZ;
+    dig_cfg.conv_mode      = ADC_CONV_SINGLE_UNIT_1;
+    dig_cfg.format         = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+    ESP_ERROR_CHECK(adc_continuous_config(s_adc_handle, &dig_cfg));
+
+    adc_continuous_evt_cbs_t cbs = {};
+    cbs.on_conv_done = on_conv_done;
+    ESP_ERROR_CHECK(adc_continuous_register_event_callbacks(s_adc_handle, &cbs, nullptr));
+    ESP_ERROR_CHECK(adc_continuous_start(s_adc_handle));
+
+    /* First frame arrives after 3.2 ms; callers read the volume right away. */
+    for (int i = 0; i < 20 && __atomic_load_n(&s_frames, __ATOMIC_ACQUIRE) == 0; i++) {
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    if (__atomic_load_n(&s_frames, __ATOMIC_ACQUIRE) == 0) {
+        ESP_LOGE(TAG, "ADC continuous mode delivers no data");
+    }
 
-    ESP_LOGI(TAG, "Potis ready");
+    ESP_LOGI(TAG, "Potis ready (%d Hz, %d-byte frames)", POT_SAMPLE_HZ, POT_FRAME_BYTES);
 }
 
 bool potis_read(uint8_t *out_volume)
 {
-    int raw_vol = 0;
-    adc_oneshot_read(s_adc_handle, s_vol_ch, &raw_vol);
-
-    s_vol_buf[s_buf_idx] = (uint16_t)raw_vol;
-    s_buf_idx = (uint8_t)((s_buf_idx + 1) % POT_AVG_SAMPLES);
-    if (s_buf_idx == 0) s_buf_full = true;
-
-    uint8_t vol = buf_average();
+    uint8_t vol = vol_average();
 
     if (out_volume) *out_volume = vol;
 
@@ -131,9 +187,9 @@ bool potis_read(uint8_t *out_volume)
     return changed;
 }
 
-adc_oneshot_unit_handle_t potis_get_adc_handle(void)
+uint16_t potis_read_btn_raw(void)
 {
-    return s_adc_handle;
+    return (uint16_t)__atomic_load_n(&s_btn_raw, __ATOMIC_RELAXED);
 }
 
 void potis_set_cal(uint16_t raw_lo, uint16_t raw_mid, uint16_t raw_hi)
@@ -145,5 +201,5 @@ void potis_set_cal(uint16_t raw_lo, uint16_t raw_mid, uint16_t raw_hi)
 
 uint16_t potis_read_raw_avg(void)
 {
-    return (uint16_t)buf_raw_avg();
+    return (uint16_t)vol_raw();
 }
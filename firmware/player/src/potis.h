@@ -1,11 +1,15 @@
 /**
  * @file potis.h
- * @brief Potentiometer reader with moving-average filter.
+ * @brief ADC1 inputs: volume potentiometer and button ladder.
  *
- * Reads one analog potentiometer:
+ * Both channels are sampled continuously by the ADC's DMA engine:
  *   Pot 1 (POT_PIN_VOLUME)  → Master volume  (0–100)
+ *   BTN_ADC_PIN             → raw ladder voltage for encoder_btn_read()
  *
- * Filtering: simple N-sample moving average reduces ADC noise.
+ * Filtering: every DMA frame is decimated to one mean per channel in the
+ * conversion-done callback; the pot mean additionally runs through a short
+ * IIR.  Readers only fetch the latest filtered values – no ADC conversion
+ * happens in the caller's task.
  */
 #pragma once
 
@@ -14,14 +18,18 @@
 
 #include "pins.h"
 
-#include "esp_adc/adc_oneshot.h"
-
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-/* Moving-average window size (power of 2 recommended for cheap division) */
-#define POT_AVG_SAMPLES  32
+/* Conversions per second, both channels together (pattern pot, button). */
+#define POT_SAMPLE_HZ      20000
+
+/* DMA frame: 64 conversions of 4 bytes = 32 per channel, one every 3.2 ms. */
+#define POT_FRAME_BYTES    256
+
+/* Pot IIR per frame: y += (x − y) >> POT_IIR_SHIFT.  3 → τ ≈ 8 frames ≈ 26 ms. */
+#define POT_IIR_SHIFT      3
 
 /* Minimum change (0–100 scale) before a new value is considered "changed" */
 #define POT_CHANGE_THRESHOLD  2
@@ -29,13 +37,14 @@ extern "C" {
 /* ── API ──────────────────────────────────────────────────────────────────── */
 
 /**
- * @brief Initialise ADC channels and internal filter buffers.
- *        Must be called once before potis_read().
+ * @brief Configure ADC1 continuous mode for both channels and start it.
+ *        Returns after the first frame, so potis_read() is valid at once.
+ *        Must be called once before potis_read() and encoder_init().
  */
 void potis_init(void);
 
 /**
- * @brief Sample the volume potentiometer and update the moving-average filter.
+ * @brief Fetch the filtered volume.
  *        Call this periodically (e.g. every 10 ms from Core 0 task).
  *
  * @param[out] volume  Filtered volume value 0–100 (or NULL to ignore).
@@ -45,12 +54,10 @@ void potis_init(void);
 bool potis_read(uint8_t *volume);
 
 /**
- * @brief Return the ADC1 oneshot handle.
- *        Other modules (e.g. encoder button ADC) may add channels to the
- *        same ADC unit by calling adc_oneshot_config_channel() on this handle.
- *        Call only after potis_init().
+ * @brief Mean raw value (12-bit) of the button ladder over the last DMA
+ *        frame (3.2 ms).  Call only after potis_init().
  */
-adc_oneshot_unit_handle_t potis_get_adc_handle(void);
+uint16_t potis_read_btn_raw(void);
 
 /**
  * @brief Update the 3-point calibration used by raw_to_pct().
@@ -60,7 +67,7 @@ adc_oneshot_unit_handle_t potis_get_adc_handle(void);
 void     potis_set_cal(uint16_t raw_lo, uint16_t raw_mid, uint16_t raw_hi);
 
 /**
- * @brief Return the current moving-average raw ADC value (12-bit, 0–4095).
+ * @brief Return the current filtered raw pot value (12-bit, 0–4095).
  *        Used by the calibration wizard to capture a stable sample.
  */
 uint16_t potis_read_raw_avg(void);
@@ -6,6 +6,7 @@
  */
 
 #include "song_settings.h"
+#include "library.h"
 
 #include "cJSON.h"
 #include "esp_log.h"
@@ -20,52 +21,41 @@ static const char *TAG = "song_cfg";
 /* Maximum settings file size accepted (avoids heap exhaustion on corrupt SD). */
 #define SETTINGS_MAX_BYTES  4096
 
-void song_settings_load(const char *wav_path, song_settings_t *out)
+/* Build JSON path: swap the trailing ".wav" for ".json". */
+static bool json_path_of(const char *wav_path, char *out, size_t bufsz)
 {
-    /* Safe defaults: no loop, follow crank speed, time-stretch mode, system dimmer. */
-    out->loop             = false;
-    out->autoplay_next    = false;
-    out->fixed_speed      = 0.0f;
-    out->pitch_influence  = 0u;
-    out->dimmer_max       = 100u;
-    out->dimmer_min       = 0u;
-    out->dimmer_rps_ref   = 1.4f;
-    out->dimmer_holdoff_s = 0u;
-    out->dimmer_fadein_s  = 3u; /* 3-second default lamp fade-in */
-    out->light_organ      = false;
-
-    if (!wav_path) return;
-
-    /* Build JSON path: swap the trailing ".wav" for ".json". */
     size_t wav_len = strlen(wav_path);
-    if (wav_len < 4 || strcasecmp(wav_path + wav_len - 4, ".wav") != 0) return;
-
-    char json_path[256];
-    if (wav_len >= sizeof(json_path)) return; /* path too long */
-    memcpy(json_path, wav_path, wav_len - 4);
-    memcpy(json_path + wav_len - 4, ".json", 6); /* includes NUL */
+    if (wav_len < 4 || strcasecmp(wav_path + wav_len - 4, ".wav") != 0) return false;
+    if (wav_len + 1 >= bufsz) return false; /* path too long */
+    memcpy(out, wav_path, wav_len - 4);
+    memcpy(out + wav_len - 4, ".json", 6); /* includes NUL */
+    return true;
+}
 
+/* Parse @p json_path; nullptr if absent, too large or invalid. */
+static cJSON *read_json(const char *json_path)
+{
     /* Check existence and size before allocating a heap buffer. */
     struct stat st;
-    if (stat(json_path, &st) != 0) return; /* no settings file – that's fine */
+    if (stat(json_path, &st) != 0) return nullptr; /* no settings file – that's fine */
 
     if (st.st_size > SETTINGS_MAX_BYTES) {
         ESP_LOGW(TAG, "Settings file too large (%ld B), skipping: %s",
                  (long)st.st_size, json_path);
-        return;
+        return nullptr;
     }
 
     FILE *f = fopen(json_path, "r");
     if (!f) {
         ESP_LOGW(TAG, "Cannot open %s", json_path);
-        return;
+        return nullptr;
     }
 
     char *buf = (char *)malloc((size_t)st.st_size + 1);
     if (!buf) {
         ESP_LOGE(TAG, "OOM reading %s", json_path);
         fclose(f);
-        return;
+        return nullptr;
     }
 
     size_t n = fread(buf, 1, (size_t)st.st_size, f);
@@ -77,8 +67,35 @@ void song_settings_load(const char *wav_path, song_settings_t *out)
 
     if (!root) {
         ESP_LOGW(TAG, "JSON parse error in %s", json_path);
-        return;
     }
+    return root;
+}
+
+void song_settings_load(const char *wav_path, song_settings_t *out)
+{
+    /* Safe defaults: no loop, follow crank speed, time-stretch mode, system dimmer. */
+    out->loop             = false;
+    out->autoplay_next    = false;
+    out->fixed_speed      = 0.0f;
+    out->pitch_influence  = 0u;
+    out->dimmer_max       = 100u;
+    out->dimmer_min       = 0u;
+    out->dimmer_rps_ref   = 1.4f;
+    out->dimmer_holdoff_s = 0u;
+    out->dimmer_fadein_s  = 3u; /* 3-second default lamp fade-in */
+    out->light_organ      = false;
+    out->st_profile       = -1;  /* follow the global profile */
+    out->bpm              = 0.0f;
+    out->beat_offset_s    = 0.0f;
+    out->bpm_wav_bytes    = 0u;
+
+    if (!wav_path) return;
+
+    char json_path[256];
+    if (!json_path_of(wav_path, json_path, sizeof(json_path))) return;
+
+    cJSON *root = read_json(json_path);
+    if (!root) return;
 
     bool have_end_action = false;
 
@@ -173,10 +190,30 @@ void song_settings_load(const char *wav_path, song_settings_t *out)
         out->light_organ = cJSON_IsTrue(lo_item);
     }
 
+    /* "st_profile": integer 0-2 – time-stretch quality override */
+    const cJSON *stp_item = cJSON_GetObjectItemCaseSensitive(root, "st_profile");
+    if (cJSON_IsNumber(stp_item) && stp_item->valueint >= 0 && stp_item->valueint <= 2) {
+        out->st_profile = (int8_t)stp_item->valueint;
+    }
+
+    /* "bpm" / "beat_offset_s": BPM analysis, valid for the WAV size it was
+     * made from (a replaced upload keeps its settings but not its tempo). */
+    const cJSON *bpm_item = cJSON_GetObjectItemCaseSensitive(root, "bpm");
+    const cJSON *bof_item = cJSON_GetObjectItemCaseSensitive(root, "beat_offset_s");
+    const cJSON *bwb_item = cJSON_GetObjectItemCaseSensitive(root, "bpm_wav_bytes");
+    struct stat wst;
+    if (cJSON_IsNumber(bpm_item) && bpm_item->valuedouble >= 0.0
+        && cJSON_IsNumber(bwb_item) && stat(wav_path, &wst) == 0
+        && (uint32_t)bwb_item->valuedouble == (uint32_t)wst.st_size) {
+        out->bpm           = (float)bpm_item->valuedouble;
+        out->beat_offset_s = cJSON_IsNumber(bof_item) ? (float)bof_item->valuedouble : 0.0f;
+        out->bpm_wav_bytes = (uint32_t)bwb_item->valuedouble;
+    }
+
     cJSON_Delete(root);
 
     ESP_LOGI(TAG, "Settings for '%s': loop=%s autoplay_next=%s fixed_speed=%s(%.2f) pitch_influence=%u%% "
-             "max=%u min=%u rps_ref=%.1f holdoff=%us fadein=%us",
+             "max=%u min=%u rps_ref=%.1f holdoff=%us fadein=%us st_profile=%d bpm=%.1f",
              json_path,
              out->loop ? "yes" : "no",
              out->autoplay_next ? "yes" : "no",
@@ -186,5 +223,44 @@ void song_settings_load(const char *wav_path, song_settings_t *out)
              out->dimmer_max, out->dimmer_min,
              (double)out->dimmer_rps_ref,
              out->dimmer_holdoff_s,
-             out->dimmer_fadein_s);
+             out->dimmer_fadein_s,
+             (int)out->st_profile,
+             (double)out->bpm);
+}
+
+bool song_settings_set_bpm(const char *wav_path, float bpm, float beat_offset_s,
+                           uint32_t wav_bytes)
+{
+    char json_path[256];
+    if (!wav_path || !json_path_of(wav_path, json_path, sizeof(json_path))) return false;
+
+    cJSON *root = read_json(json_path);
+    if (!root) root = cJSON_CreateObject();
+    if (!root) return false;
+
+    cJSON_DeleteItemFromObjectCaseSensitive(root, "bpm");
+    cJSON_DeleteItemFromObjectCaseSensitive(root, "beat_offset_s");
+    cJSON_DeleteItemFromObjectCaseSensitive(root, "bpm_wav_bytes");
+    cJSON_AddNumberToObject(root, "bpm",           (double)bpm);
+    cJSON_AddNumberToObject(root, "beat_offset_s", (double)beat_offset_s);
+    cJSON_AddNumberToObject(root, "bpm_wav_bytes", (double)wav_bytes);
+
+    char *js = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!js) return false;
+
+    FILE *f = fopen(json_path, "w");
+    if (f) { fputs(js, f); fclose(f); }
+    cJSON_free(js);
+    if (!f) ESP_LOGE(TAG, "Cannot write %s", json_path);
+    else    library_note_sidecar(wav_path, LIB_SIDE_JSON, true);
+    return f != nullptr;
+}
+
+void song_settings_keep_analysis(const song_settings_t *prev, cJSON *root)
+{
+    if (!prev || !root || prev->bpm_wav_bytes == 0u) return;
+    cJSON_AddNumberToObject(root, "bpm",           (double)prev->bpm);
+    cJSON_AddNumberToObject(root, "beat_offset_s", (double)prev->beat_offset_s);
+    cJSON_AddNumberToObject(root, "bpm_wav_bytes", (double)prev->bpm_wav_bytes);
 }
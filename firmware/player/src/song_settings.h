@@ -26,6 +26,13 @@ extern "C" {
  *   "dimmer_holdoff_s"  : number  – song-position timestamp (s) before which dimmer is suppressed (default 0).
  *   "dimmer_fadein_s"   : number  – seconds to fade from 0 to full brightness when holdoff expires (default 0).
  *   "light_organ"       : boolean – drive dimmer brightness from audio FFT energy instead of crank speed.
+ *   "st_profile"        : number  – time-stretch quality 0=eco, 1=balanced, 2=hifi (default: global crank_config).
+ *
+ * Written by the background BPM analysis (bpm_analysis.h), kept by the
+ * settings editors:
+ *   "bpm"               : number  – detected tempo at 1x (0 = no steady beat found).
+ *   "beat_offset_s"     : number  – song position of a beat-grid line (0 ≤ offset < 60/bpm).
+ *   "bpm_wav_bytes"     : number  – size of the WAV analysed; the result is ignored if it differs.
  */
 
 typedef struct {
@@ -39,6 +46,10 @@ typedef struct {
     uint8_t dimmer_holdoff_s;/**< song-position timestamp (s) before which dimmer is suppressed */
     uint8_t dimmer_fadein_s; /**< seconds to fade from 0→full brightness after holdoff expires  */
     bool    light_organ;     /**< true: dimmer driven by FFT audio energy instead of crank speed */
+    int8_t  st_profile;      /**< time-stretch quality 0-2, -1 = use crank_config st_profile     */
+    float   bpm;             /**< detected tempo at 1x, 0 = none / not analysed                  */
+    float   beat_offset_s;   /**< beat grid: beats at beat_offset_s + n·60/bpm                   */
+    uint32_t bpm_wav_bytes;  /**< WAV size the analysis belongs to, 0 = not analysed             */
 } song_settings_t;
 
 /**
@@ -53,6 +64,24 @@ typedef struct {
  */
 void song_settings_load(const char *wav_path, song_settings_t *out);
 
+/**
+ * Store a BPM analysis result in the song's JSON sidecar, keeping all other
+ * keys (the file is created if absent).
+ *
+ * @return false if the sidecar cannot be written.
+ */
+bool song_settings_set_bpm(const char *wav_path, float bpm, float beat_offset_s,
+                           uint32_t wav_bytes);
+
+struct cJSON;
+
+/**
+ * Copy the analysis keys of @p prev into @p root – for the settings
+ * editors, which rebuild the sidecar from scratch.  No-op if @p prev was
+ * not analysed.
+ */
+void song_settings_keep_analysis(const song_settings_t *prev, struct cJSON *root);
+
 #ifdef __cplusplus
 }
 #endif
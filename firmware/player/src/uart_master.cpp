@@ -2,18 +2,22 @@
  * @file uart_master.cpp
  * @brief UART master protocol implementation for the player (Host) side.
  *
- * Runs a non-blocking state-machine parser on Core 0.
- * Transmit helpers are safe to call from any core / task.
+ * Runs the shared link_codec parser (v1 and v2 frames) on Core 0.
+ * Transmit helpers are safe to call from any core / task; on a v2 link
+ * they append to the open frame, which is sent when the outermost batch
+ * closes (or at once outside a batch).
  */
 
 #include "uart_master.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
 #include "freertos/semphr.h"
 #include "driver/uart.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 
 #include <string.h>
 #include <stdio.h>
@@ -37,6 +41,7 @@ static um_on_wifi_ctrl_cb_t      s_on_wifi_ctrl     = nullptr;
 static um_on_bt_ctrl_cb_t        s_on_bt_ctrl       = nullptr;
 static um_on_song_settings_req_cb_t  s_on_song_settings_req  = nullptr;
 static um_on_set_song_settings_cb_t  s_on_set_song_settings  = nullptr;
+static um_on_list_page_req_cb_t      s_on_list_page_req      = nullptr;
 
 /** Semaphore posted by the rx task when CMD_ACK arrives (for uart_master_sync). */
 static SemaphoreHandle_t s_ack_sem  = nullptr;
@@ -50,21 +55,97 @@ static volatile bool     s_paused    = false;
 /** Binary semaphore: rx_task gives this once it has stopped calling uart_read_bytes. */
 static SemaphoreHandle_t s_pause_ack = nullptr;
 
-/* ── Parser state machine ──────────────────────────────────────────────────── */
-
-typedef enum {
-    PS_MAGIC = 0,
-    PS_CMD,
-    PS_LEN,
-    PS_PAYLOAD,
-    PS_CHECKSUM,
-} parser_state_t;
+/* ── Link state ────────────────────────────────────────────────────────────── */
+
+static volatile uint8_t s_link_ver  = 1;     /* framing used for sending          */
+static uint8_t       s_tx_seq       = 0;
+static volatile uint8_t s_rx_seq    = 0;     /* last SEQ from the display (our ACK) */
+static volatile TickType_t s_last_rx = 0;    /* last good frame from the display  */
+static TickType_t    s_last_hello   = 0;
+
+/* Open v2 frame and batch nesting; both under s_tx_mutex. */
+static link_frame_t  s_frame;
+static uint8_t       s_batch_depth  = 0;
+static bool          s_frame_wants_reply = false;
+
+/* A sent frame that asks for CMD_ACK (a state update or SYNC) and has not had it. */
+static volatile bool s_reply_due    = false;
+
+static link_stats_t  s_stats        = {};
+
+/* State stream (link v3): what the display holds, see uart_master_send_state() */
+static volatile uint8_t s_peer_ver  = 1;     /* display's CMD_LINK_HELLO version */
+static volatile bool s_state_full_due = true;
+static TickType_t    s_last_full    = 0;
+static um_state_t    s_sent_state   = {};
+static uint32_t      s_sent_stamp_ms = 0;
+
+/* Link rate (link v4), see uart_master.h.  link_upkeep() runs the phases on
+ * the state tick; the rx task takes PROPOSED to SWITCHED (under s_tx_mutex)
+ * and collects the test echoes. */
+enum : uint8_t { BAUD_IDLE, BAUD_PROPOSED, BAUD_SWITCHED, BAUD_TESTING };
+static const uint32_t k_baud_steps[UM_BAUD_STEP_MAX] = UM_BAUD_STEPS;
+static volatile uint8_t s_baud_phase = BAUD_IDLE;
+static uint8_t       s_baud_idx     = 0;     /* committed step            */
+static uint8_t       s_baud_try     = 0;     /* step proposed / on test   */
+static uint8_t       s_baud_ceiling = UM_BAUD_STEP_MAX - 1;
+static TickType_t    s_baud_since   = 0;     /* phase or error window start */
+static uint32_t      s_baud_errs    = UINT32_MAX;  /* errors at window start; MAX = rebase */
+static int64_t       s_test_start_us = 0;
+static volatile int64_t  s_test_last_us = 0;
+static volatile uint32_t s_test_seen    = 0;  /* bit per echoed test seq */
+static volatile uint8_t  s_test_corrupt = 0;
+static uint32_t      s_test_bad0    = 0;
+static um_baud_step_t s_baud_steps[UM_BAUD_STEP_MAX] = {};
+
+/* Receive side: rx_task sleeps on the driver's event queue. */
+static QueueHandle_t s_rx_events    = nullptr;
+static link_parser_t s_parser       = LINK_PARSER_INIT;
 
 /* ── Forward declarations ──────────────────────────────────────────────────── */
 static void rx_task(void *arg);
 static void handle_packet(uint8_t cmd, const uint8_t *payload, uint8_t len);
 
-/* ── Generic framing helper ────────────────────────────────────────────────── */
+/* ── Framing ───────────────────────────────────────────────────────────────── */
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* The display answers state updates and SYNC; note that one is outstanding. */
+static void expect_reply_locked(void)
+{
+    if (s_reply_due) s_stats.no_reply++;
+    s_reply_due = true;
+}
+
+static void write_locked(const uint8_t *buf, uint16_t n, uint16_t payload)
+{
+    uart_write_bytes(UART_PORT, buf, n);
+    s_stats.tx_frames++;
+    s_stats.tx_bytes   += n;
+    s_stats.tx_payload += payload;
+}
+
+/* Send the open v2 frame, if it holds anything. */
+static void flush_locked(void)
+{
+    if (s_frame.subs == 0) return;
+    uint16_t n = link_frame_finish(&s_frame, s_tx_seq++, s_rx_seq);
+    if (s_frame_wants_reply) expect_reply_locked();
+    write_locked(s_frame.buf, n, s_frame.payload);
+    link_frame_begin(&s_frame);
+    s_frame_wants_reply = false;
+}
 
 static void send_packet(uint8_t cmd, const uint8_t *payload, uint8_t payload_len)
 {
@@ -75,34 +156,303 @@ static void send_packet(uint8_t cmd, const uint8_t *payload, uint8_t payload_len
         ESP_LOGW(TAG, "send_packet: payload too large (%u), clamping", payload_len);
         payload_len = UM_MAX_PAYLOAD;
     }
+    const bool wants_reply = (cmd == CMD_SET_STATE || cmd == CMD_STATE_DELTA || cmd == CMD_SYNC);
 
-    /* Compute checksum: CMD ^ LEN ^ payload bytes */
-    uint8_t checksum = cmd ^ payload_len;
-    for (uint8_t i = 0; i < payload_len; i++) {
-        checksum ^= payload[i];
+    xSemaphoreTake(s_tx_mutex, portMAX_DELAY);
+    /* Double-check inside the mutex: pause may have been set just after the
+     * pre-check above but before we acquired the lock.                     */
+    if (!s_paused) {
+        if (s_link_ver >= 2) {
+            if (!link_frame_add(&s_frame, cmd, payload, payload_len)) {
+                flush_locked();                       /* frame full */
+                link_frame_add(&s_frame, cmd, payload, payload_len);
+            }
+            s_frame_wants_reply |= wants_reply;
+            if (s_batch_depth == 0) flush_locked();
+        } else {
+            uint8_t buf[LINK_V1_MAGIC_LEN + 3 + UM_MAX_PAYLOAD];
+            write_locked(buf, link_v1_encode(buf, cmd, payload, payload_len), payload_len);
+            if (wants_reply) expect_reply_locked();
+        }
     }
+    xSemaphoreGive(s_tx_mutex);
+}
+
+/* Switch the sending side to framing @p ver; anything batched goes out first. */
+static void set_link_version(uint8_t ver)
+{
+    xSemaphoreTake(s_tx_mutex, portMAX_DELAY);
+    flush_locked();
+    s_link_ver  = ver;
+    s_reply_due = false;
+    s_last_rx   = xTaskGetTickCount();
+    if (ver < 2) s_peer_ver = 1;
+    s_state_full_due = true;
+    xSemaphoreGive(s_tx_mutex);
+    ESP_LOGI(TAG, "UART link now v%u", ver);
+}
+
+static void send_hello(void)
+{
+    uint8_t ver = LINK_VERSION;
+    s_last_hello = xTaskGetTickCount();
+    send_packet(CMD_LINK_HELLO, &ver, 1);
+}
+
+/* ── Link rate ─────────────────────────────────────────────────────────────── */
+
+/* Switch our end to @p baud once what is written has left; caller holds
+ * s_tx_mutex.  Deltas sent around a switch may be lost, so resend all.
+ * During display OTA the port belongs to disp_ota. */
+static void set_baud_locked(uint32_t baud)
+{
+    if (s_paused) return;
+    uart_wait_tx_done(UART_PORT, pdMS_TO_TICKS(20));
+    uart_set_baudrate(UART_PORT, baud);
+    s_state_full_due = true;
+}
 
-    /* Frame: [MAGIC 8B][CMD 1B][LEN 1B][PAYLOAD][CHECKSUM 1B] */
-    uint8_t buf[sizeof(UM_MAGIC) + 2 + UM_MAX_PAYLOAD + 1];
-    memcpy(&buf[0], UM_MAGIC, sizeof(UM_MAGIC));
-    buf[8] = cmd;
-    buf[9] = payload_len;
-    if (payload_len > 0) {
-        memcpy(&buf[10], payload, payload_len);
+/* Errors that point at the line: CRC, layout, lost frames, missing replies. */
+static uint32_t link_errors(void)
+{
+    return s_stats.rx_bad + s_stats.rx_malformed + s_stats.rx_lost +
+           s_stats.rx_overflow + s_stats.no_reply;
+}
+
+static void send_baud_op(uint8_t op, uint32_t baud)
+{
+    uint8_t buf[5];
+    buf[0] = op;
+    put_u32(&buf[1], baud);
+    send_packet(CMD_LINK_BAUD, buf, sizeof(buf));
+}
+
+/* Test frame @p seq: the seq, then a byte sequence that differs per frame
+ * and passes through every value, sync and SLIP bytes included. */
+static void test_pattern(uint8_t *buf, uint8_t seq)
+{
+    uint8_t x = (uint8_t)(seq * 37u + 1u);
+    buf[0] = seq;
+    for (uint8_t i = 1; i < UM_BAUD_TEST_LEN; i++) {
+        x = (uint8_t)(x * 5u + 17u);
+        buf[i] = x;
     }
-    buf[10 + payload_len] = checksum;
+}
 
-    const uint8_t total = (uint8_t)(sizeof(UM_MAGIC) + 2u + payload_len + 1u);
+static void baud_propose(uint8_t idx)
+{
+    s_baud_try   = idx;
+    s_baud_since = xTaskGetTickCount();
+    s_baud_phase = BAUD_PROPOSED;
+    ESP_LOGI(TAG, "Link rate: proposing %u baud", (unsigned)k_baud_steps[idx]);
+    send_baud_op(UM_BAUD_OP_PROPOSE, k_baud_steps[idx]);
+}
 
+/* Back to IDLE at the committed rate; the next error window starts afresh. */
+static void baud_idle(TickType_t now)
+{
+    s_baud_phase = BAUD_IDLE;
+    s_baud_since = now;
+    s_baud_errs  = UINT32_MAX;
+}
+
+/* Send the whole test burst at once, timed from the first write. */
+static void send_test_burst(void)
+{
+    uint8_t buf[UM_BAUD_TEST_LEN];
     xSemaphoreTake(s_tx_mutex, portMAX_DELAY);
-    /* Double-check inside the mutex: pause may have been set just after the
-     * pre-check above but before we acquired the lock.                     */
     if (!s_paused) {
-        uart_write_bytes(UART_PORT, buf, total);
+        flush_locked();
+        s_test_seen     = 0;
+        s_test_corrupt  = 0;
+        s_test_last_us  = 0;
+        s_test_bad0     = s_stats.rx_bad + s_stats.rx_malformed;
+        s_test_start_us = esp_timer_get_time();
+        for (uint8_t seq = 0; seq < UM_BAUD_TEST_FRAMES; seq++) {
+            test_pattern(buf, seq);
+            if (!link_frame_add(&s_frame, CMD_LINK_TEST, buf, sizeof(buf))) {
+                flush_locked();
+                link_frame_add(&s_frame, CMD_LINK_TEST, buf, sizeof(buf));
+            }
+        }
+        flush_locked();
     }
     xSemaphoreGive(s_tx_mutex);
 }
 
+/* The test window is over: commit the step, or put our end back. */
+static void baud_test_done(TickType_t now)
+{
+    uint32_t baud   = k_baud_steps[s_baud_try];
+    uint8_t  echoed = (uint8_t)__builtin_popcount(s_test_seen);
+    uint32_t bad    = s_stats.rx_bad + s_stats.rx_malformed;
+    bad = (bad >= s_test_bad0) ? bad - s_test_bad0 : 0;       /* counters reset */
+    bool     ok     = (echoed == UM_BAUD_TEST_FRAMES && s_test_corrupt == 0 && bad == 0);
+
+    um_baud_step_t *r = &s_baud_steps[s_baud_try];
+    r->baud        = baud;
+    r->tested      = 1;
+    r->ok          = ok;
+    r->rtt_us      = echoed ? (uint32_t)(s_test_last_us - s_test_start_us) : 0;
+    r->bytes_per_s = r->rtt_us ? (uint32_t)((uint64_t)echoed * UM_BAUD_TEST_LEN * 1000000u / r->rtt_us) : 0;
+
+    if (ok) {
+        send_baud_op(UM_BAUD_OP_COMMIT, baud);
+        s_baud_idx = s_baud_try;
+        ESP_LOGI(TAG, "Link rate %u baud: %u B each way in %u us = %u B/s (%u%% of the line)",
+                 (unsigned)baud, (unsigned)(echoed * UM_BAUD_TEST_LEN), (unsigned)r->rtt_us,
+                 (unsigned)r->bytes_per_s, (unsigned)((uint64_t)r->bytes_per_s * 1000u / baud));
+        baud_idle(now);
+        s_baud_errs = link_errors();    /* the step was clean: may climb on */
+        return;
+    }
+
+    /* The display has no COMMIT and returns to the committed rate itself. */
+    ESP_LOGW(TAG, "Link rate %u baud failed: %u/%u echoes, %u corrupt, %u bad frames – staying at %u",
+             (unsigned)baud, echoed, UM_BAUD_TEST_FRAMES, s_test_corrupt, (unsigned)bad,
+             (unsigned)k_baud_steps[s_baud_idx]);
+    xSemaphoreTake(s_tx_mutex, portMAX_DELAY);
+    set_baud_locked(k_baud_steps[s_baud_idx]);
+    xSemaphoreGive(s_tx_mutex);
+    if (s_baud_try > s_baud_idx) s_baud_ceiling = s_baud_idx;
+    baud_idle(now);
+}
+
+/* Our end back to UM_BAUD_RATE, where the display goes when it hears
+ * nothing; the climb stops below the rate that was in use. */
+static void baud_lost(void)
+{
+    uint8_t top = (s_baud_phase != BAUD_IDLE && s_baud_try > s_baud_idx) ? s_baud_try : s_baud_idx;
+    if (top == 0) return;
+    xSemaphoreTake(s_tx_mutex, portMAX_DELAY);
+    set_baud_locked(UM_BAUD_RATE);
+    xSemaphoreGive(s_tx_mutex);
+    s_baud_idx     = 0;
+    s_baud_ceiling = (uint8_t)(top - 1);
+    baud_idle(xTaskGetTickCount());
+    ESP_LOGW(TAG, "Link rate back to %d baud", UM_BAUD_RATE);
+}
+
+/* One step of the rate handshake per state tick (v2 link, display v4).  At
+ * a committed rate, a clean error window climbs one step and a bad one
+ * steps down; a window lasts UM_BAUD_CHECK_MS. */
+static void baud_upkeep(TickType_t now)
+{
+    switch (s_baud_phase) {
+
+    case BAUD_IDLE: {
+        if ((now - s_baud_since) < pdMS_TO_TICKS(UM_BAUD_CHECK_MS)) break;
+        uint32_t errs = link_errors();
+        uint32_t d    = (s_baud_errs != UINT32_MAX && errs >= s_baud_errs) ? errs - s_baud_errs : 0;
+        bool     base = (s_baud_errs == UINT32_MAX || errs < s_baud_errs);  /* counters reset */
+        s_baud_errs  = errs;
+        s_baud_since = now;
+        if (base) break;
+        if (d > UM_BAUD_MAX_ERRORS && s_baud_idx > 0) {
+            ESP_LOGW(TAG, "%u link errors in %d ms at %u baud – stepping down",
+                     (unsigned)d, UM_BAUD_CHECK_MS, (unsigned)k_baud_steps[s_baud_idx]);
+            s_baud_ceiling = (uint8_t)(s_baud_idx - 1);
+        }
+        if (s_baud_idx > s_baud_ceiling) {
+            baud_propose((uint8_t)(s_baud_idx - 1));
+        } else if (s_baud_idx < s_baud_ceiling && d == 0) {
+            baud_propose((uint8_t)(s_baud_idx + 1));
+        }
+        break;
+    }
+
+    case BAUD_PROPOSED: {
+        if ((now - s_baud_since) < pdMS_TO_TICKS(UM_BAUD_REPLY_MS)) break;
+        xSemaphoreTake(s_tx_mutex, portMAX_DELAY);
+        bool expired = (s_baud_phase == BAUD_PROPOSED);    /* not accepted meanwhile */
+        if (expired) {
+            if (s_baud_try > s_baud_idx) s_baud_ceiling = s_baud_idx;
+            baud_idle(now);
+        }
+        xSemaphoreGive(s_tx_mutex);
+        if (expired) {
+            ESP_LOGW(TAG, "Link rate: %u baud not accepted", (unsigned)k_baud_steps[s_baud_try]);
+        }
+        break;
+    }
+
+    case BAUD_SWITCHED:
+        s_baud_since = now;
+        s_baud_phase = BAUD_TESTING;
+        send_test_burst();
+        break;
+
+    case BAUD_TESTING:
+        if (__builtin_popcount(s_test_seen) >= UM_BAUD_TEST_FRAMES ||
+            (now - s_baud_since) >= pdMS_TO_TICKS(UM_BAUD_TEST_MS)) {
+            baud_test_done(now);
+        }
+        break;
+    }
+}
+
+/* The display accepted a proposal: switch our end (rx task). */
+static void baud_accepted(uint32_t baud)
+{
+    xSemaphoreTake(s_tx_mutex, portMAX_DELAY);
+    bool go = (s_baud_phase == BAUD_PROPOSED && baud == k_baud_steps[s_baud_try]);
+    if (go) {
+        set_baud_locked(baud);
+        s_baud_phase = BAUD_SWITCHED;
+    }
+    xSemaphoreGive(s_tx_mutex);
+    if (!go) {
+        ESP_LOGW(TAG, "Link rate: unexpected accept of %u baud", (unsigned)baud);
+        return;
+    }
+    /* Whatever is buffered arrived at the old rate. */
+    uart_flush_input(UART_PORT);
+    link_parser_reset(&s_parser);
+    ESP_LOGI(TAG, "Link rate: display at %u baud, testing", (unsigned)baud);
+}
+
+/* A CMD_LINK_TEST echo (rx task). */
+static void baud_test_echo(const uint8_t *payload, uint8_t len)
+{
+    if (s_baud_phase != BAUD_TESTING) return;      /* late echo of an older test */
+    uint8_t expect[UM_BAUD_TEST_LEN];
+    if (len != UM_BAUD_TEST_LEN || payload[0] >= UM_BAUD_TEST_FRAMES) {
+        s_test_corrupt++;
+        return;
+    }
+    test_pattern(expect, payload[0]);
+    if (memcmp(payload, expect, len) != 0) {
+        s_test_corrupt++;
+        return;
+    }
+    s_test_seen    |= 1u << payload[0];
+    s_test_last_us  = esp_timer_get_time();
+}
+
+/* Once per state update: offer v2 while on v1, drop back to v1 when the
+ * display has stopped answering v2 frames, and run the rate handshake. */
+static void link_upkeep(void)
+{
+#if UM_LINK_V2
+    if (s_paused) return;
+    TickType_t now = xTaskGetTickCount();
+    if (s_link_ver >= 2) {
+        if ((now - s_last_rx) > pdMS_TO_TICKS(UM_LINK_TIMEOUT_MS)) {
+            ESP_LOGW(TAG, "No reply for %d ms – link back to v1", UM_LINK_TIMEOUT_MS);
+            baud_lost();
+            set_link_version(1);
+        }
+#if UM_LINK_BAUD
+        else if (s_peer_ver >= 4) {
+            baud_upkeep(now);
+        }
+#endif
+    } else if ((now - s_last_hello) >= pdMS_TO_TICKS(1000)) {
+        send_hello();
+    }
+#endif
+}
+
 /* ══════════════════════════════════════════════════════════════════════════════
  * Public API
  * ══════════════════════════════════════════════════════════════════════════════ */
@@ -119,6 +469,8 @@ void uart_master_init(um_on_play_song_cb_t     on_play_song,
     s_on_resume        = on_resume;
     s_on_display_ready = on_display_ready;
 
+    link_frame_begin(&s_frame);
+
     s_ack_sem   = xSemaphoreCreateBinary();
     s_tx_mutex  = xSemaphoreCreateMutex();
     s_pause_ack = xSemaphoreCreateBinary();
@@ -136,11 +488,16 @@ void uart_master_init(um_on_play_song_cb_t     on_play_song,
         .source_clk          = UART_SCLK_DEFAULT,
     };
 
-    ESP_ERROR_CHECK(uart_driver_install(UART_PORT, UM_RX_BUF_SIZE, 0, 0, nullptr, 0));
+    ESP_ERROR_CHECK(uart_driver_install(UART_PORT, UM_RX_BUF_SIZE, 0,
+                                        UM_RX_EVENT_QUEUE, &s_rx_events, 0));
     ESP_ERROR_CHECK(uart_param_config(UART_PORT, &cfg));
     ESP_ERROR_CHECK(uart_set_pin(UART_PORT,
                                  UM_TX_PIN, UM_RX_PIN,
                                  UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE));
+    /* Wake the reader per FIFO block or when the line goes idle after a
+     * frame, not per byte. */
+    ESP_ERROR_CHECK(uart_set_rx_full_threshold(UART_PORT, UM_RX_FULL_THRESH));
+    ESP_ERROR_CHECK(uart_set_rx_timeout(UART_PORT, UM_RX_IDLE_SYMBOLS));
 
     ESP_LOGI(TAG, "UART%d ready at %d baud (TX=%d, RX=%d)",
              UM_UART_NUM, UM_BAUD_RATE, UM_TX_PIN, UM_RX_PIN);
@@ -190,6 +547,11 @@ void uart_master_set_set_song_settings_callback(um_on_set_song_settings_cb_t cb)
     s_on_set_song_settings = cb;
 }
 
+void uart_master_set_list_page_req_callback(um_on_list_page_req_cb_t cb)
+{
+    s_on_list_page_req = cb;
+}
+
 /* ── CMD_SONG_SETTINGS ───────────────────────────────────────────────────────────────────── */
 
 void uart_master_send_song_settings(uint16_t song_id,
@@ -218,72 +580,224 @@ void uart_master_send_song_settings(uint16_t song_id,
              song_id, flags, fixed_speed_x100, dimmer_max, dimmer_min, dimmer_rps_ref_x10, dimmer_holdoff_s, dimmer_fadein_s, pitch_influence_pct);
 }
 
-/* ── CMD_SONG_LIST ─────────────────────────────────────────────────────────── */
+/* ── Song list: CMD_LIST_INFO / CMD_LIST_PAGE / CMD_LIST_DELTA ─────────────── */
 
-void uart_master_send_song_list(const char names[][UM_MAX_SONG_NAME], uint8_t count)
+void uart_master_send_list_info(uint32_t version, uint16_t count)
 {
-    uint8_t buf[UM_MAX_PAYLOAD];
-    uint8_t buf_pos = 0;
+    uint8_t payload[6];
+    put_u32(payload, version);
+    payload[4] = (uint8_t)(count & 0xFF);
+    payload[5] = (uint8_t)(count >> 8);
+    send_packet(CMD_LIST_INFO, payload, sizeof(payload));
+    ESP_LOGI(TAG, "TX CMD_LIST_INFO v%u, %u songs", (unsigned)version, count);
+}
 
-    for (uint8_t i = 0; i < count; i++) {
-        uint16_t    song_id  = (uint16_t)(i + 1);   /* 1-based */
-        const char *name     = names[i];
-        uint8_t     name_len = (uint8_t)strnlen(name, UM_MAX_SONG_NAME - 1);
-        uint8_t     entry_sz = 2u + name_len + 1u;  /* id(2) + name + '\0' */
+#define LIST_PAGE_HDR  9u
 
-        if (buf_pos + entry_sz > UM_MAX_PAYLOAD) {
-            send_packet(CMD_SONG_LIST, buf, buf_pos);
-            buf_pos = 0;
-        }
+/* Fill one CMD_LIST_PAGE payload from position @p pos on; returns the
+ * entries packed (0 at the end of the list). */
+static uint16_t fill_list_page(const um_list_src_t *src, uint8_t *buf, uint8_t *len,
+                               uint16_t pos, uint16_t end)
+{
+    uint16_t n = 0;
+    *len = LIST_PAGE_HDR;
+    for (; pos < end; pos++, n++) {
+        uint16_t idx;
+        char     name[UM_MAX_SONG_NAME];
+        if (!src->listing(pos, &idx, name, sizeof(name))) break;
+        uint8_t name_len = (uint8_t)strnlen(name, UM_MAX_SONG_NAME - 1);
+        if (*len + 2u + name_len + 1u > UM_MAX_PAYLOAD) break;
+        uint16_t song_id = (uint16_t)(idx + 1);        /* 1-based */
+        buf[(*len)++] = (uint8_t)(song_id & 0xFF);
+        buf[(*len)++] = (uint8_t)(song_id >> 8);
+        memcpy(&buf[*len], name, name_len);
+        *len += name_len;
+        buf[(*len)++] = '\0';
+    }
+    return n;
+}
 
-        buf[buf_pos++] = (uint8_t)(song_id & 0xFF);
-        buf[buf_pos++] = (uint8_t)(song_id >> 8);
-        /* Copy name, replacing '_' with ' ' for readability on the display. */
-        for (uint8_t c = 0; c < name_len; c++) {
-            buf[buf_pos++] = (name[c] == '_') ? ' ' : (uint8_t)name[c];
-        }
-        buf[buf_pos++] = '\0';
+void uart_master_send_list_page(const um_list_src_t *src, uint16_t start, uint8_t count)
+{
+    uint8_t  buf[UM_MAX_PAYLOAD];
+    uint16_t pos = start;
+    uint16_t end = (uint16_t)(start + count);
+    do {
+        uint32_t version, again;
+        uint16_t total, n;
+        uint8_t  len;
+        int      tries = 0;
+        do {                                  /* a walk swapped the list: refill */
+            version = src->version();
+            total   = src->count();
+            n       = fill_list_page(src, buf, &len, pos, (end < total) ? end : total);
+            again   = src->version();
+        } while (again != version && ++tries < 3);
+
+        bool last = (n == 0) || (pos + n >= end) || (pos + n >= total);
+        put_u32(buf, version);
+        buf[4] = (uint8_t)(total & 0xFF);
+        buf[5] = (uint8_t)(total >> 8);
+        buf[6] = (uint8_t)(pos & 0xFF);
+        buf[7] = (uint8_t)(pos >> 8);
+        buf[8] = last ? 0x01u : 0x00u;
+        send_packet(CMD_LIST_PAGE, buf, len);
+        if (last) break;
+        pos = (uint16_t)(pos + n);
+    } while (true);
+    ESP_LOGI(TAG, "TX CMD_LIST_PAGE %u..%u", start, pos);
+}
+
+void uart_master_send_list_delta(uint32_t version, uint8_t op, uint16_t id,
+                                 const char *name, const char *old_name)
+{
+    uint8_t buf[UM_MAX_PAYLOAD];
+    put_u32(buf, version);
+    buf[4] = op;
+    buf[5] = (uint8_t)(id & 0xFF);
+    buf[6] = (uint8_t)(id >> 8);
+    uint8_t len      = 7;
+    uint8_t name_len = (uint8_t)strnlen(name, UM_MAX_SONG_NAME - 1);
+    memcpy(&buf[len], name, name_len);
+    len += name_len;
+    buf[len++] = '\0';
+    if (op == UM_LIST_OP_RENAME && old_name) {
+        /* The old name only places a song outside the display's window. */
+        uint8_t room    = (uint8_t)(UM_MAX_PAYLOAD - len - 1u);
+        uint8_t old_len = (uint8_t)strnlen(old_name, room);
+        memcpy(&buf[len], old_name, old_len);
+        len += old_len;
+        buf[len++] = '\0';
     }
+    send_packet(CMD_LIST_DELTA, buf, len);
+    ESP_LOGI(TAG, "TX CMD_LIST_DELTA v%u op=%u id=%u '%s'", (unsigned)version, op, id, name);
+}
+
+/* ── CMD_SET_STATE / CMD_STATE_DELTA ──────────────────────────────────────── */
 
-    /* Append end-of-list terminator [0x00][0x00] */
-    if (buf_pos + 2 > UM_MAX_PAYLOAD) {
-        send_packet(CMD_SONG_LIST, buf, buf_pos);
-        buf_pos = 0;
+/* Full state for displays before link v3. */
+static void send_full_state_v1(const um_state_t *st)
+{
+    uint8_t  pct   = 0;
+    uint16_t dur_s = 0;
+    if (st->duration_ms > 0) {
+        uint32_t pos = st->position_ms < st->duration_ms ? st->position_ms : st->duration_ms;
+        pct = (uint8_t)(((uint64_t)pos * 100u + st->duration_ms / 2u) / st->duration_ms);
+        if (st->rate_x1000 >= 10) {
+            dur_s = (uint16_t)((st->duration_ms + st->rate_x1000 / 2u) / st->rate_x1000);
+        }
     }
-    buf[buf_pos++] = 0x00;
-    buf[buf_pos++] = 0x00;
 
-    send_packet(CMD_SONG_LIST, buf, buf_pos);
-    ESP_LOGI(TAG, "Sent song list (%u tracks)", count);
+    uint8_t buf[UM_MAX_PAYLOAD];
+    buf[0] = st->is_playing;
+    buf[1] = st->volume;
+    buf[2] = st->tempo;
+    buf[3] = pct;
+    buf[4] = (uint8_t)(dur_s & 0xFF);
+    buf[5] = (uint8_t)(dur_s >> 8);
+    buf[6] = st->flags;
+    buf[7] = (uint8_t)(st->song_id & 0xFFu);
+    buf[8] = (uint8_t)(st->song_id >> 8);
+
+    uint8_t name_len = (uint8_t)strnlen(st->song_name, UM_MAX_PAYLOAD - 9 - 1);
+    memcpy(&buf[9], st->song_name, name_len);
+    send_packet(CMD_SET_STATE, buf, 9u + name_len);
 }
 
-/* ── CMD_SET_STATE ─────────────────────────────────────────────────────────── */
+static bool state_advancing(const um_state_t *st)
+{
+    return st->is_playing && !(st->flags & UM_STATE_PAUSED);
+}
 
-void uart_master_send_state(const char *song_name,
-                            uint8_t     is_playing,
-                            uint8_t     volume,
-                            uint8_t     tempo,
-                            uint8_t     position_pct,
-                            uint16_t    duration_s,
-                            uint8_t     flags,
-                            uint16_t    song_id)
+/* Fields of @p st the display does not hold; the position only once the
+ * display's extrapolation of the last one sent is off. */
+static uint16_t state_changes(const um_state_t *st, uint32_t now_ms)
 {
-    uint8_t buf[UM_MAX_PAYLOAD];
-    buf[0] = is_playing;
-    buf[1] = volume;
-    buf[2] = tempo;
-    buf[3] = position_pct;
-    buf[4] = (uint8_t)(duration_s & 0xFF);
-    buf[5] = (uint8_t)(duration_s >> 8);
-    buf[6] = flags;
-    buf[7] = (uint8_t)(song_id & 0xFFu);
-    buf[8] = (uint8_t)(song_id >> 8);
+    const um_state_t *o = &s_sent_state;
+    uint16_t m = 0;
+    if (st->is_playing  != o->is_playing)  m |= UM_ST_PLAYING;
+    if (st->volume      != o->volume)      m |= UM_ST_VOLUME;
+    if (st->tempo       != o->tempo)       m |= UM_ST_TEMPO;
+    if (st->flags       != o->flags)       m |= UM_ST_FLAGS;
+    if (st->duration_ms != o->duration_ms) m |= UM_ST_DURATION;
+    if (st->song_id != o->song_id || strcmp(st->song_name, o->song_name) != 0) m |= UM_ST_SONG;
+
+    uint32_t predicted = o->position_ms;
+    if (state_advancing(o)) {
+        predicted += (uint32_t)((uint64_t)o->rate_x1000 * (now_ms - s_sent_stamp_ms) / 1000u);
+        if (o->duration_ms > 0 && predicted > o->duration_ms) predicted = o->duration_ms;
+    }
+    int32_t err  = (int32_t)(st->position_ms - predicted);
+    int32_t drat = (int32_t)st->rate_x1000 - (int32_t)o->rate_x1000;
+    if (err > UM_POS_TOLERANCE_MS || err < -UM_POS_TOLERANCE_MS ||
+        drat * 50 > (int32_t)o->rate_x1000 || -drat * 50 > (int32_t)o->rate_x1000 ||
+        state_advancing(st) != state_advancing(o)) {
+        m |= UM_ST_POSITION;
+    }
+    return m;
+}
 
-    uint8_t name_len = (uint8_t)strnlen(song_name, UM_MAX_PAYLOAD - 9 - 1);
-    memcpy(&buf[9], song_name, name_len);
-    uint8_t total = 9u + name_len;
+void uart_master_send_state(const um_state_t *st)
+{
+    link_upkeep();
+    if (s_link_ver < 2 || s_peer_ver < 3) {
+        send_full_state_v1(st);
+        return;
+    }
 
-    send_packet(CMD_SET_STATE, buf, total);
+    uint32_t   now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    TickType_t now    = xTaskGetTickCount();
+    uint16_t   mask;
+    if (s_state_full_due || (now - s_last_full) >= pdMS_TO_TICKS(UM_STATE_REFRESH_MS)) {
+        s_state_full_due = false;
+        s_last_full      = now;
+        mask = UM_ST_ALL;
+    } else {
+        mask = state_changes(st, now_ms);
+    }
+    if (mask == 0) {
+        send_packet(CMD_SYNC, nullptr, 0);     /* keeps the poll response */
+        return;
+    }
+
+    uint8_t buf[UM_MAX_PAYLOAD];
+    uint8_t len = 0;
+    buf[len++] = (uint8_t)(mask & 0xFFu);
+    buf[len++] = (uint8_t)(mask >> 8);
+    if (mask & UM_ST_PLAYING) buf[len++] = st->is_playing;
+    if (mask & UM_ST_VOLUME)  buf[len++] = st->volume;
+    if (mask & UM_ST_TEMPO)   buf[len++] = st->tempo;
+    if (mask & UM_ST_FLAGS)   buf[len++] = st->flags;
+    if (mask & UM_ST_DURATION) {
+        put_u32(&buf[len], st->duration_ms);
+        len += 4;
+    }
+    if (mask & UM_ST_POSITION) {
+        put_u32(&buf[len], now_ms);
+        put_u32(&buf[len + 4], st->position_ms);
+        buf[len + 8] = (uint8_t)(st->rate_x1000 & 0xFFu);
+        buf[len + 9] = (uint8_t)(st->rate_x1000 >> 8);
+        len += 10;
+        s_sent_stamp_ms = now_ms;
+    }
+    if (mask & UM_ST_SONG) {
+        buf[len++] = (uint8_t)(st->song_id & 0xFFu);
+        buf[len++] = (uint8_t)(st->song_id >> 8);
+        uint8_t name_len = (uint8_t)strnlen(st->song_name, UM_MAX_PAYLOAD - len);
+        memcpy(&buf[len], st->song_name, name_len);
+        len += name_len;
+    }
+
+    /* The display now holds st, position included when it was sent. */
+    uint32_t pos  = s_sent_state.position_ms;
+    uint16_t rate = s_sent_state.rate_x1000;
+    s_sent_state = *st;
+    if (!(mask & UM_ST_POSITION)) {
+        /* Keep the extrapolation the display runs: same anchor and rate. */
+        s_sent_state.position_ms = pos;
+        s_sent_state.rate_x1000  = rate;
+    }
+    send_packet(CMD_STATE_DELTA, buf, len);
 }
 
 /* ── CMD_POTI_UPDATE ───────────────────────────────────────────────────────── */
@@ -322,6 +836,9 @@ bool uart_master_sync(uint32_t timeout_ms)
     xSemaphoreTake(s_ack_sem, 0);
 
     ESP_LOGI(TAG, "TX CMD_SYNC (timeout %u ms)", (unsigned)timeout_ms);
+#if UM_LINK_V2
+    if (s_link_ver < 2) send_hello();   /* the ACK carries the display's answer */
+#endif
     send_packet(CMD_SYNC, nullptr, 0);
 
     bool got_ack = (xSemaphoreTake(s_ack_sem, pdMS_TO_TICKS(timeout_ms)) == pdTRUE);
@@ -333,20 +850,94 @@ bool uart_master_sync(uint32_t timeout_ms)
     return got_ack;
 }
 
+/* ── Batching and link counters ────────────────────────────────────────────── */
+
+void uart_master_batch_begin(void)
+{
+    xSemaphoreTake(s_tx_mutex, portMAX_DELAY);
+    s_batch_depth++;
+    xSemaphoreGive(s_tx_mutex);
+}
+
+void uart_master_batch_end(void)
+{
+    xSemaphoreTake(s_tx_mutex, portMAX_DELAY);
+    if (s_batch_depth > 0 && --s_batch_depth == 0 && !s_paused) flush_locked();
+    xSemaphoreGive(s_tx_mutex);
+}
+
+uint8_t uart_master_get_link_stats(link_stats_t *out, bool reset)
+{
+    xSemaphoreTake(s_tx_mutex, portMAX_DELAY);
+    *out = s_stats;
+    if (reset) memset(&s_stats, 0, sizeof(s_stats));
+    xSemaphoreGive(s_tx_mutex);
+    return s_link_ver;
+}
+
+uint32_t uart_master_link_baud(void)
+{
+    return k_baud_steps[s_baud_idx];
+}
+
+uint8_t uart_master_get_baud_steps(um_baud_step_t *out, uint8_t max)
+{
+    uint8_t n = (max < UM_BAUD_STEP_MAX) ? max : UM_BAUD_STEP_MAX;
+    for (uint8_t i = 0; i < n; i++) {
+        out[i]      = s_baud_steps[i];
+        out[i].baud = k_baud_steps[i];
+    }
+    return n;
+}
+
 /* ══════════════════════════════════════════════════════════════════════════════
  * Receive task & parser (Core 0)
  * ══════════════════════════════════════════════════════════════════════════════ */
 
+/** Handle one byte-stream chunk: run the parser, dispatch every frame. */
+static void rx_chunk(const uint8_t *buf, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        uint32_t bad = s_stats.rx_bad;
+        switch (link_parser_feed(&s_parser, buf[i], &s_stats)) {
+
+        case LINK_RX_V1:
+            s_last_rx = xTaskGetTickCount();
+            handle_packet(s_parser.cmd, s_parser.buf, s_parser.len);
+            break;
+
+        case LINK_RX_V2: {
+            s_last_rx = xTaskGetTickCount();
+            s_rx_seq  = s_parser.seq;
+            /* The reply is its CMD_ACK, not the ACK field: urgent frames
+             * from the display repeat an old ACK without answering. */
+            uint16_t       pos = 0;
+            uint8_t        cmd, len;
+            const uint8_t *payload;
+            while (link_next_sub(&s_parser, &pos, &s_stats, &cmd, &payload, &len)) {
+                handle_packet(cmd, payload, len);
+            }
+            break;
+        }
+
+        default:
+            if (s_stats.rx_bad != bad) {
+                ESP_LOGW(TAG, "Frame check failed (%u so far)", (unsigned)s_stats.rx_bad);
+            }
+            break;
+        }
+    }
+}
+
+/**
+ * Sleeps on the driver's event queue.  UART_DATA arrives when the RX FIFO
+ * reaches UM_RX_FULL_THRESH or the line has been idle UM_RX_IDLE_SYMBOLS
+ * byte times, so a whole frame is normally read and parsed in one go.
+ */
 static void rx_task(void *arg)
 {
-    parser_state_t state       = PS_MAGIC;
-    uint8_t        magic_idx   = 0;
-    uint8_t        cmd         = 0;
-    uint8_t        payload_len = 0;
-    uint8_t        payload[UM_MAX_PAYLOAD];
-    uint8_t        payload_idx = 0;
-    uint8_t        checksum    = 0;
-    uint8_t        byte;
+    static uint8_t chunk[UM_RX_CHUNK];
+    uart_event_t   ev;
 
     ESP_LOGI(TAG, "RX task running on core %d", xPortGetCoreID());
 
@@ -358,63 +949,45 @@ static void rx_task(void *arg)
             continue;
         }
 
-        if (uart_read_bytes(UART_PORT, &byte, 1, pdMS_TO_TICKS(50)) != 1) {
+        if (xQueueReceive(s_rx_events, &ev, pdMS_TO_TICKS(50)) != pdTRUE) {
             continue;
         }
 
-        switch (state) {
-
-        case PS_MAGIC:
-            if (byte == UM_MAGIC[magic_idx]) {
-                magic_idx++;
-                if (magic_idx == sizeof(UM_MAGIC)) {
-                    magic_idx = 0;
-                    state = PS_CMD;
-                }
-            } else {
-                magic_idx = (byte == UM_MAGIC[0]) ? 1 : 0;
-            }
-            break;
-
-        case PS_CMD:
-            cmd      = byte;
-            checksum = byte;
-            state    = PS_LEN;
-            break;
-
-        case PS_LEN:
-            payload_len  = byte;
-            checksum    ^= byte;
-            payload_idx  = 0;
-            if (payload_len == 0) {
-                state = PS_CHECKSUM;
-            } else if (payload_len <= UM_MAX_PAYLOAD) {
-                state = PS_PAYLOAD;
-            } else {
-                ESP_LOGW(TAG, "Payload length %u > %u, discarding", payload_len, UM_MAX_PAYLOAD);
-                state = PS_MAGIC;
+        switch (ev.type) {
+
+        case UART_DATA: {
+            /* Take everything buffered; later UART_DATA events for bytes
+             * already read find nothing and cost one queue receive. */
+            size_t avail = 0;
+            uart_get_buffered_data_len(UART_PORT, &avail);
+            while (avail > 0 && !s_paused) {
+                int n = uart_read_bytes(UART_PORT, chunk,
+                                        avail < sizeof(chunk) ? avail : sizeof(chunk), 0);
+                if (n <= 0) break;
+                s_stats.rx_reads++;
+                rx_chunk(chunk, (size_t)n);
+                avail -= (size_t)n;
             }
             break;
+        }
 
-        case PS_PAYLOAD:
-            payload[payload_idx++] = byte;
-            checksum ^= byte;
-            if (payload_idx >= payload_len) {
-                state = PS_CHECKSUM;
-            }
+        case UART_FIFO_OVF:
+        case UART_BUFFER_FULL:
+            /* Bytes were dropped: whatever is buffered is mid-frame. */
+            s_stats.rx_overflow++;
+            ESP_LOGW(TAG, "RX overflow (%u so far) – input flushed",
+                     (unsigned)s_stats.rx_overflow);
+            uart_flush_input(UART_PORT);
+            xQueueReset(s_rx_events);
+            link_parser_reset(&s_parser);
             break;
 
-        case PS_CHECKSUM:
-            if (byte == checksum) {
-                handle_packet(cmd, payload, payload_len);
-            } else {
-                ESP_LOGW(TAG, "Checksum fail: expected 0x%02X got 0x%02X", checksum, byte);
-            }
-            state = PS_MAGIC;
+        case UART_FRAME_ERR:
+        case UART_PARITY_ERR:
+            s_stats.rx_bad++;
             break;
 
         default:
-            state = PS_MAGIC;
             break;
         }
     }
@@ -455,6 +1028,11 @@ static void handle_packet(uint8_t cmd, const uint8_t *payload, uint8_t len)
 
     case CMD_DISPLAY_READY:
         ESP_LOGI(TAG, "CMD_DISPLAY_READY received – display was reset");
+        s_state_full_due = true;
+        s_baud_ceiling   = UM_BAUD_STEP_MAX - 1;   /* it starts at UM_BAUD_RATE */
+#if UM_LINK_V2
+        send_hello();      /* new firmware may speak a higher version */
+#endif
         if (s_on_display_ready) s_on_display_ready();
         break;
 
@@ -533,6 +1111,20 @@ static void handle_packet(uint8_t cmd, const uint8_t *payload, uint8_t len)
         }
         break;
 
+    case CMD_LIST_PAGE_REQ:
+        if (len < 3) {
+            ESP_LOGW(TAG, "CMD_LIST_PAGE_REQ: payload too short (%u)", len);
+            break;
+        }
+        {
+            uint16_t start = (uint16_t)payload[0] | ((uint16_t)payload[1] << 8);
+            uint8_t  count = payload[2];
+            if (count > UM_LIST_PAGE_MAX) count = UM_LIST_PAGE_MAX;
+            ESP_LOGD(TAG, "CMD_LIST_PAGE_REQ: %u +%u", start, count);
+            if (s_on_list_page_req) s_on_list_page_req(start, count);
+        }
+        break;
+
     case CMD_SET_SONG_SETTINGS:
         if (len < 4) {
             ESP_LOGW(TAG, "CMD_SET_SONG_SETTINGS: payload too short (%u)", len);
@@ -556,8 +1148,34 @@ static void handle_packet(uint8_t cmd, const uint8_t *payload, uint8_t len)
         }
         break;
 
+    case CMD_LINK_HELLO:
+        if (len < 1) {
+            ESP_LOGW(TAG, "CMD_LINK_HELLO: missing payload");
+            break;
+        }
+        ESP_LOGI(TAG, "CMD_LINK_HELLO: display speaks v%u", payload[0]);
+#if UM_LINK_V2
+        s_peer_ver       = payload[0];
+        s_state_full_due = true;
+        if (payload[0] >= 2 && s_link_ver < 2) set_link_version(2);
+#endif
+        break;
+
+    case CMD_LINK_BAUD:
+        if (len < 5) {
+            ESP_LOGW(TAG, "CMD_LINK_BAUD: payload too short (%u)", len);
+            break;
+        }
+        if (payload[0] == UM_BAUD_OP_ACCEPT) baud_accepted(get_u32(&payload[1]));
+        break;
+
+    case CMD_LINK_TEST:
+        baud_test_echo(payload, len);
+        break;
+
     case CMD_ACK:
         ESP_LOGD(TAG, "CMD_ACK received (len=%u)", len);
+        s_reply_due = false;
         xSemaphoreGive(s_ack_sem);
         /* Dispatch any Display->Host sub-commands embedded in the response.
          * Extended payload (after the base 5 touch bytes):
@@ -602,10 +1220,13 @@ void uart_master_pause(void)
     /* 2. Drain any in-flight transmission: wait to acquire (and immediately
      *    release) the TX mutex.  After s_paused=true, no new send will enter
      *    the mutex; any ongoing send will finish and release it. */
-    xSemaphoreTake(s_tx_mutex, pdMS_TO_TICKS(500));
-    xSemaphoreGive(s_tx_mutex);
+    if (xSemaphoreTake(s_tx_mutex, pdMS_TO_TICKS(500)) == pdTRUE) {
+        link_frame_begin(&s_frame);     /* batched messages are dropped */
+        s_frame_wants_reply = false;
+        xSemaphoreGive(s_tx_mutex);
+    }
 
-    /* 3. Wait for the rx_task to leave uart_read_bytes and acknowledge. */
+    /* 3. Wait for the rx_task to stop reading and acknowledge. */
     xSemaphoreTake(s_pause_ack, pdMS_TO_TICKS(300));
 
     /* 4. Switch to ROM-bootloader baud rate in-place.
@@ -625,6 +1246,17 @@ void uart_master_resume(void)
      * released so no reinstall or pin reconfiguration is needed.        */
     uart_flush_input(UART_PORT);
     uart_set_baudrate(UART_PORT, UM_BAUD_RATE);
+    /* Events and parser state from the OTA traffic are stale. */
+    xQueueReset(s_rx_events);
+    link_parser_reset(&s_parser);
+    /* The display may run other firmware now: start over in v1, at
+     * UM_BAUD_RATE, with the rate ladder open again. */
+    s_link_ver  = 1;
+    s_peer_ver  = 1;
+    s_reply_due = false;
+    s_baud_idx     = 0;
+    s_baud_ceiling = UM_BAUD_STEP_MAX - 1;
+    baud_idle(xTaskGetTickCount());
     s_paused = false;
     ESP_LOGI(TAG, "UART master resumed after display OTA");
 }
@@ -2,22 +2,66 @@
  * @file uart_master.h
  * @brief UART master protocol layer for the music-player (Host/Player side).
  *
- * Packet format – identical to the display firmware's uart_comm.h:
- *   [MAGIC: 8 bytes "ROGEL202"][CMD: 1 byte][LEN: 1 byte][PAYLOAD: LEN bytes][CHECKSUM: 1 byte]
+ * Framing is shared with the display firmware (firmware/common/link_codec.h):
+ *   v1  [MAGIC "ROGEL202"][CMD][LEN][PAYLOAD][XOR checksum] – one command
+ *   v2  [A5 5A][LEN][SEQ][ACK]{[CMD][LEN][PAYLOAD]}…[CRC16] – several commands
  *
- * Checksum = XOR of CMD ^ LEN ^ payload[0] ^ ... ^ payload[LEN-1]
+ * The link starts in v1.  The host offers v2 with CMD_LINK_HELLO until the
+ * display answers with its own CMD_LINK_HELLO; from then on the host sends
+ * v2 frames and the display answers each frame in the framing it arrived
+ * in.  When the display stops answering (re-flashed with older firmware,
+ * display OTA) the host drops back to v1 and offers v2 again.
+ *
+ * The display answers SET_STATE and SYNC with CMD_ACK, which carries its
+ * queued commands.  On a v2 link it also sends urgent commands (play, stop,
+ * pause, resume, seek) at once in frames without CMD_ACK, so only CMD_ACK
+ * counts as the reply.
+ *
+ * Player state: to a display that speaks link v3 the host sends only the
+ * state fields that changed (CMD_STATE_DELTA), and CMD_SYNC on ticks with
+ * no change, so the display's poll response keeps its 100 ms rhythm.  The
+ * position travels as (time stamp, song ms, rate); the display extrapolates
+ * it at its frame rate and the host resends it only when the extrapolation
+ * is off by more than UM_POS_TOLERANCE_MS.  Older displays get the full
+ * CMD_SET_STATE every tick.
+ *
+ * Link rate: both ends start at UM_BAUD_RATE.  With a link v4 display the
+ * host then climbs the UM_BAUD_STEPS ladder one step at a time: it proposes
+ * a rate (CMD_LINK_BAUD), both ends switch once the display has accepted,
+ * and a burst of CMD_LINK_TEST frames that the display echoes must come
+ * back whole before the host commits the rate.  A step that fails puts both
+ * ends back on the last committed rate and ends the climb.  Frame errors at
+ * a committed rate step the link back down; a display that hears nothing for
+ * a while, and a host that gets no reply, return to UM_BAUD_RATE on their
+ * own, from where HELLO starts again.
+ *
+ * Sends between uart_master_batch_begin() and uart_master_batch_end() share
+ * v2 frames, so the state, poti and list messages of one control tick go
+ * out as one frame.
  *
  * Command direction reference:
- *   Host → Display : CMD_SET_STATE, CMD_SYNC, CMD_SONG_LIST,
- *                    CMD_ENCODER_MOVE, CMD_ENCODER_BTN, CMD_POTI_UPDATE
- *   Display → Host : CMD_PLAY_SONG, CMD_STOP_SONG, CMD_PAUSE, CMD_RESUME, CMD_ACK
+ *   Host → Display : CMD_SET_STATE, CMD_STATE_DELTA, CMD_SYNC, CMD_ENCODER_MOVE, CMD_ENCODER_BTN,
+ *                    CMD_POTI_UPDATE, CMD_LIST_INFO, CMD_LIST_PAGE, CMD_LIST_DELTA
+ *   Display → Host : CMD_PLAY_SONG, CMD_STOP_SONG, CMD_PAUSE, CMD_RESUME,
+ *                    CMD_LIST_PAGE_REQ, CMD_ACK
+ *   Both ways      : CMD_LINK_HELLO, CMD_LINK_BAUD, CMD_LINK_TEST
+ *
+ * Song list: the display holds only the window of the (name-ordered) list
+ * it shows.  The host announces the list version and length (CMD_LIST_INFO);
+ * a display whose version differs asks for its window (CMD_LIST_PAGE_REQ)
+ * and gets it as CMD_LIST_PAGE packets.  Each later change arrives as one
+ * CMD_LIST_DELTA carrying the version it produces, so an upload costs one
+ * short packet instead of the whole list; a gap in the versions makes the
+ * display ask for its window again.
  */
 #pragma once
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "pins.h"
+#include "link_codec.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -26,21 +70,36 @@ extern "C" {
 /* ── Hardware configuration ───────────────────────────────────────────────── */
 #define UM_BAUD_RATE        921600
 #define UM_RX_BUF_SIZE      2048
+#define UM_RX_EVENT_QUEUE   16      /* driver events (UART_DATA, overflow) */
+#define UM_RX_FULL_THRESH   64      /* RX FIFO bytes that wake the reader  */
+#define UM_RX_IDLE_SYMBOLS  3       /* idle byte times that wake it early  */
+#define UM_RX_CHUNK         256     /* bytes parsed per read               */
 
 /* ── Protocol constants ───────────────────────────────────────────────────── */
 
-/* 8-byte magic "ROGEL202" */
-static const uint8_t UM_MAGIC[8] = {
-    0x52, 0x4F, 0x47, 0x45, 0x4C, 0x32, 0x30, 0x32
-};
-
-#define UM_MAX_PAYLOAD      128
+#define UM_LINK_V2          1       /* offer v2 framing; 0 stays on v1 (A/B) */
+#define UM_LINK_TIMEOUT_MS  3000    /* no reply this long: back to v1 */
+#define UM_STATE_REFRESH_MS 5000    /* full CMD_STATE_DELTA at least this often */
+#define UM_POS_TOLERANCE_MS 40      /* resend position when extrapolation is off */
+
+#define UM_LINK_BAUD        1       /* climb the rate ladder; 0 stays at UM_BAUD_RATE */
+#define UM_BAUD_STEPS       { UM_BAUD_RATE, 1500000, 2000000, 3000000, 4000000, 5000000 }
+#define UM_BAUD_STEP_MAX    6       /* entries in UM_BAUD_STEPS */
+#define UM_BAUD_REPLY_MS    500     /* proposal not accepted this long: give up */
+#define UM_BAUD_TEST_FRAMES 8       /* CMD_LINK_TEST echoes per step */
+#define UM_BAUD_TEST_LEN    120     /* bytes per CMD_LINK_TEST */
+#define UM_BAUD_TEST_MS     200     /* all echoes back within this */
+#define UM_BAUD_CHECK_MS    2000    /* error window at a committed rate */
+#define UM_BAUD_MAX_ERRORS  3       /* errors per window that step the rate down */
+
+#define UM_MAX_PAYLOAD      LINK_MAX_PAYLOAD
 #define UM_MAX_SONG_NAME    64
+#define UM_LIST_PAGE_MAX    64      /* positions per CMD_LIST_PAGE_REQ */
 
 /* Command IDs – kept in sync with display firmware uart_comm.h */
 #define CMD_SET_STATE       0x01  /* Host → Display: player state update       */
 #define CMD_SYNC            0x02  /* Host → Display: heartbeat / ACK request   */
-#define CMD_SONG_LIST       0x03  /* Host → Display: full playlist             */
+/*      0x03 was CMD_SONG_LIST (whole list push), replaced by CMD_LIST_*    */
 #define CMD_ENCODER_MOVE    0x04  /* Host → Display: encoder delta             */
 #define CMD_ENCODER_BTN     0x05  /* Host → Display: encoder button            */
 #define CMD_PLAY_SONG       0x06  /* Display → Host: user chose a song (id)    */
@@ -57,8 +116,43 @@ static const uint8_t UM_MAGIC[8] = {
 #define CMD_SONG_SETTINGS       0x11  /* Host → Display: current settings for a song        */
 #define CMD_SET_SONG_SETTINGS   0x12  /* Display → Host: write new settings for a song      */
 #define CMD_BT_CTRL             0x13  /* Display → Host: enable (1) / disable (0) BLE module */
+#define CMD_LIST_INFO           0x14  /* Host → Display: song list version + length    */
+#define CMD_LIST_PAGE_REQ       0x15  /* Display → Host: names for a window of the list */
+#define CMD_LIST_PAGE           0x16  /* Host → Display: part of that window           */
+#define CMD_LIST_DELTA          0x17  /* Host → Display: one song added/removed/renamed */
+#define CMD_LINK_HELLO          0x18  /* Both: highest link version spoken (1 byte)   */
+#define CMD_STATE_DELTA         0x19  /* Host → Display: changed state fields (link v3) */
+#define CMD_LINK_BAUD           0x1A  /* Both: link rate handshake (link v4)        */
+#define CMD_LINK_TEST           0x1B  /* Both: rate test pattern, echoed by the display */
+
+/* CMD_LIST_DELTA op (values of library.h LIB_CHANGE_*) */
+#define UM_LIST_OP_ADD          1
+#define UM_LIST_OP_REMOVE       2
+#define UM_LIST_OP_RENAME       3
 #define CMD_ACK                 0xFF  /* Display → Host: ACK with optional touch            */
 
+/* CMD_LINK_BAUD payload: [op:u8][baud:u32 LE] */
+#define UM_BAUD_OP_PROPOSE      1     /* Host → Display: switch to baud       */
+#define UM_BAUD_OP_ACCEPT       2     /* Display → Host: switching after this */
+#define UM_BAUD_OP_COMMIT       3     /* Host → Display: test passed, keep it */
+
+/* CMD_STATE_DELTA field mask; present fields follow the mask in bit order */
+#define UM_ST_PLAYING           0x0001u  /* u8  is_playing                      */
+#define UM_ST_VOLUME            0x0002u  /* u8  volume 0–100                    */
+#define UM_ST_TEMPO             0x0004u  /* u8  tempo 0–100                     */
+#define UM_ST_FLAGS             0x0008u  /* u8  UM_STATE_* flags                */
+#define UM_ST_DURATION          0x0010u  /* u32 song length [ms] at 1.0×        */
+#define UM_ST_POSITION          0x0020u  /* u32 stamp [ms], u32 song ms, u16 rate ×1000 */
+#define UM_ST_SONG              0x0040u  /* u16 song id, then the name to the end */
+#define UM_ST_FULL              0x8000u  /* all fields: replaces the whole state */
+#define UM_ST_ALL               (0x007Fu | UM_ST_FULL)
+
+/* Player state flags (CMD_SET_STATE [6], CMD_STATE_DELTA UM_ST_FLAGS) */
+#define UM_STATE_SPEED_LOCKED   0x01u
+#define UM_STATE_BT_ON          0x02u
+#define UM_STATE_WIFI_ON        0x04u
+#define UM_STATE_PAUSED         0x08u    /* position is not advancing */
+
 /* ── Callbacks invoked from the UART receive task (Core 0) ───────────────── */
 
 /** @brief Called when the display requests a specific song by 16-bit ID (1-based). */
@@ -117,6 +211,14 @@ typedef void (*um_on_bt_ctrl_cb_t)(bool enable);
  */
 typedef void (*um_on_song_settings_req_cb_t)(uint16_t song_id);
 
+/**
+ * @brief Called when the display asks for list positions
+ *        [@p start, @p start + @p count) (CMD_LIST_PAGE_REQ).
+ *
+ * The handler should answer with uart_master_send_list_page().
+ */
+typedef void (*um_on_list_page_req_cb_t)(uint16_t start, uint8_t count);
+
 /**
  * @brief Called when the display writes new settings for a song (CMD_SET_SONG_SETTINGS).
  *
@@ -193,6 +295,11 @@ void uart_master_set_song_settings_req_callback(um_on_song_settings_req_cb_t cb)
  */
 void uart_master_set_set_song_settings_callback(um_on_set_song_settings_cb_t cb);
 
+/**
+ * @brief Register the callback for CMD_LIST_PAGE_REQ.
+ */
+void uart_master_set_list_page_req_callback(um_on_list_page_req_cb_t cb);
+
 /**
  * @brief Send CMD_SONG_SETTINGS to the display.
  *
@@ -219,35 +326,88 @@ void uart_master_send_song_settings(uint16_t song_id,
 
 /* ── Outgoing packet helpers ──────────────────────────────────────────────── */
 
+/** The song list as seen by the protocol (the library, in name order). */
+typedef struct {
+    uint32_t (*version)(void);
+    uint16_t (*count)(void);
+    /** Song at list position @p pos: 0-based index into @p idx, name into
+     *  @p buf; false past the end of the list. */
+    bool     (*listing)(uint16_t pos, uint16_t *idx, char *buf, size_t len);
+} um_list_src_t;
+
+/**
+ * @brief Send CMD_LIST_INFO: the current list version and length.
+ *
+ * Payload (6 bytes): [0..3] version : uint32_t LE, [4..5] count : uint16_t LE
+ */
+void uart_master_send_list_info(uint32_t version, uint16_t count);
+
 /**
- * @brief Send CMD_SONG_LIST to the display.
+ * @brief Answer a CMD_LIST_PAGE_REQ with CMD_LIST_PAGE packets covering
+ *        positions [@p start, @p start + @p count) (clamped to the list).
  *
- * Wire format per entry: [id_lo:u8][id_hi:u8][name:char…]['\0']
- * Terminator            : [0x00][0x00]
+ * Payload: [0..3] version : uint32_t LE   list version of these names
+ *          [4..5] total   : uint16_t LE   list length
+ *          [6..7] start   : uint16_t LE   position of the first entry
+ *          [8]    flags   : bit0 = last packet of the reply
+ *          then per entry [id:u16 LE][name:char…]['\0']  (id 1-based)
+ *
+ * A packet whose names straddle a library change is rebuilt, so every
+ * packet matches its version.
+ */
+void uart_master_send_list_page(const um_list_src_t *src, uint16_t start, uint8_t count);
+
+/**
+ * @brief Send CMD_LIST_DELTA for one list change.
+ *
+ * Payload: [0..3] version : uint32_t LE   list version after this change
+ *          [4]    op      : UM_LIST_OP_*
+ *          [5..6] id      : uint16_t LE   1-based; REMOVE moves higher ids down
+ *          [7..]  name    : char…, '\0'   ADD/RENAME: new name, REMOVE: old
+ *          then   old     : char…, '\0'   RENAME only, cut to fit the packet
  */
-void uart_master_send_song_list(const char names[][UM_MAX_SONG_NAME], uint8_t count);
+void uart_master_send_list_delta(uint32_t version, uint8_t op, uint16_t id,
+                                 const char *name, const char *old_name);
+
+/** Player state as the display shows it; see uart_master_send_state(). */
+typedef struct {
+    uint16_t song_id;                     /**< 1-based; 0 if no song          */
+    char     song_name[UM_MAX_SONG_NAME];
+    uint8_t  is_playing;                  /**< 1 = playing or paused          */
+    uint8_t  volume;                      /**< 0–100                          */
+    uint8_t  tempo;                       /**< 0–100, 50 = 1.0× speed         */
+    uint8_t  flags;                       /**< UM_STATE_*                     */
+    uint32_t duration_ms;                 /**< song length at 1.0×            */
+    uint32_t position_ms;                 /**< song time played               */
+    uint16_t rate_x1000;                  /**< effective speed × 1000         */
+} um_state_t;
 
 /**
- * @brief Send CMD_SET_STATE to update the display with the current player state.
+ * @brief Publish the player state; call once per state tick (100 ms).
  *
- * Payload layout (little-endian):
+ * Link v3 display: CMD_STATE_DELTA with the fields that differ from what
+ * the display holds, the position only when the display's extrapolation is
+ * off by more than UM_POS_TOLERANCE_MS, and every field at least each
+ * UM_STATE_REFRESH_MS and after CMD_DISPLAY_READY; CMD_SYNC when nothing
+ * changed.
+ *
+ * CMD_STATE_DELTA payload (little-endian):
+ *   [0..1]  mask : uint16_t  UM_ST_*; the fields follow in bit order
+ *   position = [stamp_ms:u32][position_ms:u32][rate_x1000:u16], where
+ *   stamp_ms is the host's millisecond clock when position_ms was sampled.
+ *   The song name runs to the end of the payload (no terminator).
+ *
+ * Older display: CMD_SET_STATE, payload layout (little-endian):
  *   [0]       is_playing   : uint8_t   (1 = playing, 0 = stopped)
  *   [1]       volume       : uint8_t   (0–100)
  *   [2]       tempo        : uint8_t   (0–100, 50 = 1.0× speed)
  *   [3]       position_pct : uint8_t   (0–100, playback progress)
  *   [4..5]    duration_s   : uint16_t  (speed-adjusted song length in seconds)
- *   [6]       flags        : uint8_t   (bit 0 = speed_locked)
+ *   [6]       flags        : uint8_t   (UM_STATE_*)
  *   [7..8]    song_id      : uint16_t  (1-based song index; 0 if no song)
  *   [9..N-1]  song_name    : char[]    (no null terminator; length = LEN - 9)
  */
-void uart_master_send_state(const char *song_name,
-                            uint8_t     is_playing,
-                            uint8_t     volume,
-                            uint8_t     tempo,
-                            uint8_t     position_pct,
-                            uint16_t    duration_s,
-                            uint8_t     flags,
-                            uint16_t    song_id);
+void uart_master_send_state(const um_state_t *st);
 
 /**
  * @brief Send CMD_POTI_UPDATE so the display can refresh its visual bars.
@@ -274,6 +434,39 @@ void uart_master_send_encoder_btn(void);
  */
 bool uart_master_sync(uint32_t timeout_ms);
 
+/**
+ * @brief Collect the following sends into shared v2 frames until
+ *        uart_master_batch_end().  Nests; a no-op on a v1 link.
+ */
+void uart_master_batch_begin(void);
+
+/** @brief Close a batch and send what it collected. */
+void uart_master_batch_end(void);
+
+/**
+ * @brief Copy the link counters (both framings, since boot or the last
+ *        reset) and return the framing version in use.
+ */
+uint8_t uart_master_get_link_stats(link_stats_t *out, bool reset);
+
+/** Outcome of the last rate test at one UM_BAUD_STEPS rate. */
+typedef struct {
+    uint32_t baud;
+    uint8_t  tested;                      /**< 0 = not tried since the reset  */
+    uint8_t  ok;                          /**< every echo came back whole     */
+    uint32_t rtt_us;                      /**< first test sent → last echo    */
+    uint32_t bytes_per_s;                 /**< test payload each way / rtt    */
+} um_baud_step_t;
+
+/** @brief The committed link rate (UM_BAUD_RATE until a step is committed). */
+uint32_t uart_master_link_baud(void);
+
+/**
+ * @brief Copy the rate test results, one per UM_BAUD_STEPS entry.
+ * @return Entries written (at most @p max).
+ */
+uint8_t uart_master_get_baud_steps(um_baud_step_t *out, uint8_t max);
+
 /* ── OTA support ──────────────────────────────────────────────────────────── */
 
 /**
@@ -293,6 +486,7 @@ void uart_master_pause(void);
  *
  * Re-installs the UART1 driver with the original configuration and clears
  * the "paused" flag so the receive task and send functions resume normally.
+ * The link restarts at UM_BAUD_RATE and climbs the rate ladder again.
  */
 void uart_master_resume(void);
 
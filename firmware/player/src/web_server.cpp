@@ -10,6 +10,9 @@
  *   POST /upload?name   → receive raw file body, save to SD card
  *   POST /rename        → JSON body {old, new}
  *   DELETE /delete?name → remove file
+ *   GET/POST /api/cues?name → per-song cue track (cue_track.h) as JSON
+ *   GET  /api/crank_trace  → crank flight recorder (crank_trace.h) as binary;
+ *                            ?clear=1 empties it
  *
  * Security
  * --------
@@ -43,8 +46,11 @@
 
 #include "disp_ota.h"
 #include "crank_config.h"
+#include "crank_trace.h"
 #include "potis.h"
 #include "song_settings.h"
+#include "cue_track.h"
+#include "library.h"
 #include "cJSON.h"
 #include "esp_ota_ops.h"
 #include "esp_partition.h"
@@ -64,6 +70,14 @@ static const char *TAG = "web_server";
 /* ── State ─────────────────────────────────────────────────────────── */
 static rescan_cb_t           s_rescan_cb         = nullptr;
 static web_song_settings_cb_t s_song_settings_cb  = nullptr;
+
+/* Application-provided GET endpoints returning JSON (see web_server_add_json_endpoint) */
+struct json_endpoint_t {
+    const char    *uri;
+    web_json_cb_t  cb;
+};
+static json_endpoint_t s_json_endpoints[WEB_MAX_JSON_ENDPOINTS];
+static int             s_json_endpoint_count = 0;
 static httpd_handle_t s_server    = nullptr;
 static bool           s_running   = false;
 
@@ -122,16 +136,23 @@ static void build_path(char *buf, size_t bufsz, const char *name)
 }
 
 /**
- * Derive the sidecar JSON settings path from a WAV path.
- * Replaces the trailing ".wav" extension with ".json".
+ * Derive a sidecar path from a WAV path by replacing the trailing ".wav"
+ * with @p ext (".json" settings, ".env" light-organ envelope, ".cue" cues).
  * Writes an empty string on error (path too short or buffer too small).
  */
-static void wav_to_json_path(const char *wav_path, char *out, size_t bufsz)
+static void wav_to_sidecar_path(const char *wav_path, const char *ext,
+                                char *out, size_t bufsz)
 {
-    size_t len = strlen(wav_path);
-    if (len < 4 || len + 2 >= bufsz) { out[0] = '\0'; return; }
+    size_t len  = strlen(wav_path);
+    size_t elen = strlen(ext);
+    if (len < 4 || len - 4 + elen >= bufsz) { out[0] = '\0'; return; }
     memcpy(out, wav_path, len - 4);
-    memcpy(out + len - 4, ".json", 6); /* 5 chars + NUL */
+    memcpy(out + len - 4, ext, elen + 1);
+}
+
+static void wav_to_json_path(const char *wav_path, char *out, size_t bufsz)
+{
+    wav_to_sidecar_path(wav_path, ".json", out, bufsz);
 }
 
 /**
@@ -367,6 +388,11 @@ static esp_err_t upload_post_handler(httpd_req_t *req)
         return ESP_FAIL;
     }
 
+    /* A replaced song needs a new light-organ envelope. */
+    char env_path[sizeof(MOUNT_POINT) + MAX_FNAME_LEN + 6];
+    wav_to_sidecar_path(path, ".env", env_path, sizeof(env_path));
+    if (env_path[0] != '\0') remove(env_path);
+
     ESP_LOGI(TAG, "Uploaded: %s (%d bytes)", fname, written);
     if (s_rescan_cb) s_rescan_cb();
     httpd_resp_sendstr(req, "OK");
@@ -463,6 +489,31 @@ static esp_err_t rename_post_handler(httpd_req_t *req)
         }
     }
 
+    /* The cue track is user data like the settings: move it, keep it on failure. */
+    char old_cue[sizeof(MOUNT_POINT) + MAX_FNAME_LEN + 6];
+    char new_cue[sizeof(MOUNT_POINT) + MAX_FNAME_LEN + 6];
+    wav_to_sidecar_path(old_path, ".cue", old_cue, sizeof(old_cue));
+    wav_to_sidecar_path(new_path, ".cue", new_cue, sizeof(new_cue));
+    if (old_cue[0] != '\0' && new_cue[0] != '\0') {
+        struct stat cst = {};
+        if (stat(old_cue, &cst) == 0 && rename(old_cue, new_cue) != 0) {
+            ESP_LOGW(TAG, "Cue track rename failed (%d) – WAV renamed OK", errno);
+        }
+    }
+
+    /* The light-organ envelope follows the song; if the rename fails the
+     * player simply recomputes it. */
+    char old_env[sizeof(MOUNT_POINT) + MAX_FNAME_LEN + 6];
+    char new_env[sizeof(MOUNT_POINT) + MAX_FNAME_LEN + 6];
+    wav_to_sidecar_path(old_path, ".env", old_env, sizeof(old_env));
+    wav_to_sidecar_path(new_path, ".env", new_env, sizeof(new_env));
+    if (old_env[0] != '\0' && new_env[0] != '\0') {
+        struct stat est = {};
+        if (stat(old_env, &est) == 0 && rename(old_env, new_env) != 0) {
+            remove(old_env);
+        }
+    }
+
     ESP_LOGI(TAG, "Renamed: %s -> %s", old_name, new_name);
     if (s_rescan_cb) s_rescan_cb();
     httpd_resp_sendstr(req, "OK");
@@ -502,6 +553,14 @@ static esp_err_t delete_handler(httpd_req_t *req)
         }
     }
 
+    char env_path[sizeof(MOUNT_POINT) + MAX_FNAME_LEN + 6];
+    wav_to_sidecar_path(path, ".env", env_path, sizeof(env_path));
+    if (env_path[0] != '\0') remove(env_path);   /* light-organ envelope, if any */
+
+    char cue_path[sizeof(MOUNT_POINT) + MAX_FNAME_LEN + 6];
+    wav_to_sidecar_path(path, ".cue", cue_path, sizeof(cue_path));
+    if (cue_path[0] != '\0') remove(cue_path);   /* cue track, if any */
+
     ESP_LOGI(TAG, "Deleted: %s", fname);
     if (s_rescan_cb) s_rescan_cb();
     httpd_resp_sendstr(req, "OK");
@@ -511,14 +570,18 @@ static esp_err_t delete_handler(httpd_req_t *req)
 
 static esp_err_t crank_config_get_handler(httpd_req_t *req)
 {
-    char buf[450];
+    char buf[512];
     snprintf(buf, sizeof(buf),
              "{\"ema_attack\":%.3f,\"ema_release\":%.3f,"
              "\"stop_thresh\":%.3f,\"start_thresh\":%.3f,"
              "\"release_ticks\":%u,\"vol_fade_step\":%u,\"crank_dir\":%d,"
+             "\"speed_mode\":%u,\"estimator\":%u,\"ab_alpha\":%.2f,"
+             "\"ab_beta\":%.3f,\"ab_lead\":%.2f,"
              "\"lo_bass_weight\":%.1f,\"lo_mid_weight\":%.1f,"
-             "\"lo_decay_rate\":%.4f,\"lo_lookahead_s\":%.3f,"
-             "\"pot_cal_lo\":%u,\"pot_cal_mid\":%u,\"pot_cal_hi\":%u}",
+             "\"lo_decay_rate\":%.4f,\"lo_lookahead_s\":%.3f,\"lo_rate_hz\":%u,"
+             "\"lo_onset_gain\":%.2f,"
+             "\"pot_cal_lo\":%u,\"pot_cal_mid\":%u,\"pot_cal_hi\":%u,"
+             "\"st_profile\":%u,\"st_dual_core\":%u}",
              (double)g_crank_cfg.ema_attack,
              (double)g_crank_cfg.ema_release,
              (double)g_crank_cfg.stop_thresh,
@@ -526,13 +589,22 @@ static esp_err_t crank_config_get_handler(httpd_req_t *req)
              (unsigned)g_crank_cfg.release_ticks,
              (unsigned)g_crank_cfg.vol_fade_step,
              (int)g_crank_cfg.crank_dir,
+             (unsigned)g_crank_cfg.speed_mode,
+             (unsigned)g_crank_cfg.estimator,
+             (double)g_crank_cfg.ab_alpha,
+             (double)g_crank_cfg.ab_beta,
+             (double)g_crank_cfg.ab_lead,
              (double)g_crank_cfg.lo_bass_weight,
              (double)g_crank_cfg.lo_mid_weight,
              (double)g_crank_cfg.lo_decay_rate,
              (double)g_crank_cfg.lo_lookahead_s,
+             (unsigned)g_crank_cfg.lo_rate_hz,
+             (double)g_crank_cfg.lo_onset_gain,
              (unsigned)g_crank_cfg.pot_cal_lo,
              (unsigned)g_crank_cfg.pot_cal_mid,
-             (unsigned)g_crank_cfg.pot_cal_hi);
+             (unsigned)g_crank_cfg.pot_cal_hi,
+             (unsigned)g_crank_cfg.st_profile,
+             (unsigned)g_crank_cfg.st_dual_core);
     httpd_resp_set_type(req, "application/json");
     httpd_resp_set_hdr(req, "Cache-Control", "no-cache, no-store");
     return httpd_resp_sendstr(req, buf);
@@ -591,10 +663,19 @@ static esp_err_t crank_config_post_handler(httpd_req_t *req)
             if (v >= -1 && v <= 1) nc.crank_dir = (int8_t)v;
         }
     }
+    read_u8(root, "speed_mode",     0, 1, &nc.speed_mode);
+    read_u8(root, "estimator",      0, 1, &nc.estimator);
+    read_f (root, "ab_alpha",       0.01f,  1.0f, &nc.ab_alpha);
+    read_f (root, "ab_beta",        0.001f, 0.5f, &nc.ab_beta);
+    read_f (root, "ab_lead",        0.0f,   2.0f, &nc.ab_lead);
     read_f (root, "lo_bass_weight", 1.0f, 200.0f, &nc.lo_bass_weight);
     read_f (root, "lo_mid_weight",  0.0f,  50.0f, &nc.lo_mid_weight);
     read_f (root, "lo_decay_rate",  0.990f, 0.999f, &nc.lo_decay_rate);
     read_f (root, "lo_lookahead_s", -1.0f,  1.0f,   &nc.lo_lookahead_s);
+    read_u8(root, "lo_rate_hz",     10, 100, &nc.lo_rate_hz);
+    read_f (root, "lo_onset_gain",  0.0f, 1.0f, &nc.lo_onset_gain);
+    read_u8(root, "st_profile",     0, 2, &nc.st_profile);
+    read_u8(root, "st_dual_core",   0, 1, &nc.st_dual_core);
     cJSON_Delete(root);
 
     if (nc.start_thresh <= nc.stop_thresh) {
@@ -612,6 +693,42 @@ static esp_err_t crank_config_post_handler(httpd_req_t *req)
     return httpd_resp_sendstr(req, "OK");
 }
 
+/* ── GET /api/crank_trace[?clear=1] ─────────────────────────────────── */
+
+static esp_err_t crank_trace_get_handler(httpd_req_t *req)
+{
+    char clear[4] = {};
+    if (get_query_param(req, "clear", clear, sizeof(clear)) && clear[0] == '1') {
+        crank_trace_clear();
+        httpd_resp_set_hdr(req, "Cache-Control", "no-cache, no-store");
+        return httpd_resp_sendstr(req, "OK");
+    }
+
+    crank_trace_hdr_t hdr;
+    size_t count = crank_trace_read_begin(&hdr);
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"crank_trace.bin\"");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache, no-store");
+    char cl[24];
+    snprintf(cl, sizeof(cl), "%lu",
+             (unsigned long)(sizeof(hdr) + count * sizeof(crank_trace_rec_t)));
+    httpd_resp_set_hdr(req, "Content-Length", cl);
+
+    esp_err_t ret = httpd_resp_send_chunk(req, (const char *)&hdr, sizeof(hdr));
+    const size_t per_chunk = sizeof(s_xfer_buf) / sizeof(crank_trace_rec_t);
+    for (size_t i = 0; ret == ESP_OK && i < count; i += per_chunk) {
+        size_t n = crank_trace_read(i, s_xfer_buf, per_chunk);
+        ret = httpd_resp_send_chunk(req, s_xfer_buf, (ssize_t)(n * sizeof(crank_trace_rec_t)));
+    }
+    crank_trace_read_end();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Crank trace download aborted: client disconnected");
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Crank trace downloaded (%u records)", (unsigned)count);
+    return httpd_resp_send_chunk(req, nullptr, 0);
+}
+
 /* ── POST /api/pot_cal ─────────────────────────────────────────────────
  * Guided 3-step calibration wizard.
  * Body: {"step":0|1|2}
@@ -936,13 +1053,13 @@ static esp_err_t song_settings_get_handler(httpd_req_t *req)
 
     const char *end_action = s.loop ? "loop" : (s.autoplay_next ? "next" : "none");
 
-    char buf[384];
+    char buf[416];
     snprintf(buf, sizeof(buf),
              "{\"end_action\":\"%s\",\"loop\":%s,\"autoplay_next\":%s,\"fixed_speed_en\":%s,\"fixed_speed\":%.2f,"
              "\"pitch_influence\":%u,"
              "\"dimmer_max\":%u,\"dimmer_min\":%u,"
              "\"dimmer_rps_ref\":%.2f,\"dimmer_holdoff_s\":%u,\"dimmer_fadein_s\":%u,"
-             "\"light_organ\":%s}",
+             "\"light_organ\":%s,\"st_profile\":%d,\"bpm\":%.1f}",
              end_action,
              s.loop ? "true" : "false",
              s.autoplay_next ? "true" : "false",
@@ -954,7 +1071,9 @@ static esp_err_t song_settings_get_handler(httpd_req_t *req)
              (double)s.dimmer_rps_ref,
              (unsigned)s.dimmer_holdoff_s,
              (unsigned)s.dimmer_fadein_s,
-             s.light_organ ? "true" : "false");
+             s.light_organ ? "true" : "false",
+             (int)s.st_profile,
+             (double)s.bpm);
 
     httpd_resp_set_type(req, "application/json");
     httpd_resp_set_hdr(req, "Cache-Control", "no-cache, no-store");
@@ -1037,6 +1156,9 @@ static esp_err_t song_settings_post_handler(httpd_req_t *req)
     bool light_organ = false;
     it = cJSON_GetObjectItemCaseSensitive(root, "light_organ");
     if (cJSON_IsBool(it)) light_organ = cJSON_IsTrue(it);
+    int st_profile = -1;   /* -1 = follow the global crank_config profile */
+    it = cJSON_GetObjectItemCaseSensitive(root, "st_profile");
+    if (cJSON_IsNumber(it) && it->valueint >= -1 && it->valueint <= 2) st_profile = it->valueint;
     cJSON_Delete(root);
 
     char wav_path[sizeof(MOUNT_POINT) + MAX_FNAME_LEN + 2];
@@ -1044,9 +1166,15 @@ static esp_err_t song_settings_post_handler(httpd_req_t *req)
     char json_path[sizeof(MOUNT_POINT) + MAX_FNAME_LEN + 6];
     wav_to_json_path(wav_path, json_path, sizeof(json_path));
 
+    /* The BPM analysis is not edited here; keep it in the rewritten sidecar. */
+    song_settings_t prev;
+    song_settings_load(wav_path, &prev);
+
     bool dimmer_default = (d_max == 100 && d_min == 0 && fabsf(d_rps - 1.4f) <= 0.05f);
-    if (!loop && !autoplay_next && !fixed_en && pitch == 0 && dimmer_default && d_hoff == 0 && d_fadein == 0 && !light_organ) {
+    if (!loop && !autoplay_next && !fixed_en && pitch == 0 && dimmer_default && d_hoff == 0 && d_fadein == 0 && !light_organ
+        && st_profile < 0 && prev.bpm_wav_bytes == 0u) {
         remove(json_path);
+        library_note_sidecar(wav_path, LIB_SIDE_JSON, false);
         ESP_LOGI(TAG, "Song settings cleared via web for %s", fname);
         httpd_resp_sendstr(req, "OK");
         return ESP_OK;
@@ -1068,6 +1196,8 @@ static esp_err_t song_settings_post_handler(httpd_req_t *req)
     if (d_hoff > 0) cJSON_AddNumberToObject(out, "dimmer_holdoff_s", d_hoff);
     if (d_fadein > 0) cJSON_AddNumberToObject(out, "dimmer_fadein_s", d_fadein);
     if (light_organ) cJSON_AddBoolToObject(out, "light_organ", true);
+    if (st_profile >= 0) cJSON_AddNumberToObject(out, "st_profile", st_profile);
+    song_settings_keep_analysis(&prev, out);
 
     char *js = cJSON_PrintUnformatted(out);
     cJSON_Delete(out);
@@ -1084,6 +1214,7 @@ static esp_err_t song_settings_post_handler(httpd_req_t *req)
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Cannot write settings file");
         return ESP_FAIL;
     }
+    library_note_sidecar(wav_path, LIB_SIDE_JSON, true);
 
     ESP_LOGI(TAG, "Song settings saved via web for %s", fname);
 
@@ -1100,13 +1231,178 @@ static esp_err_t song_settings_post_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+/* ── GET/POST /api/cues?name=<file.wav> ─────────────────────────────── */
+/* [{"t":12.5,"type":"lamp_ramp","value":40,"dur":2}, …]
+ *   type  "lamp" | "lamp_ramp" | "volume_ramp" | "tempo_lock"
+ *   value percent (lamp, volume) or speed multiplier (tempo_lock, 0 = release)
+ *   dur   ramp length in seconds (ramps only) */
+
+static const char *const CUE_TYPE_NAMES[] = {
+    nullptr, "lamp", "lamp_ramp", "volume_ramp", "tempo_lock"
+};
+
+static esp_err_t cues_get_handler(httpd_req_t *req)
+{
+    char fname[MAX_FNAME_LEN + 1] = {};
+    if (!get_query_param(req, "name", fname, sizeof(fname)) || !fname_valid(fname)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid or missing filename");
+        return ESP_FAIL;
+    }
+    char wav_path[sizeof(MOUNT_POINT) + MAX_FNAME_LEN + 2];
+    build_path(wav_path, sizeof(wav_path), fname);
+
+    cue_t *cues = (cue_t *)malloc(sizeof(cue_t) * CUE_TRACK_MAX);
+    cJSON *arr  = cJSON_CreateArray();
+    if (!cues || !arr) {
+        free(cues);
+        cJSON_Delete(arr);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "OOM");
+        return ESP_FAIL;
+    }
+    int n = cue_track_read(wav_path, cues, CUE_TRACK_MAX);
+    for (int i = 0; i < n; i++) {
+        cJSON *o = cJSON_CreateObject();
+        if (!o) break;
+        cJSON_AddNumberToObject(o, "t", (double)cues[i].t_ms / 1000.0);
+        cJSON_AddStringToObject(o, "type", CUE_TYPE_NAMES[cues[i].type]);
+        if (cues[i].type == CUE_TEMPO_LOCK) {
+            cJSON_AddNumberToObject(o, "value", (double)cues[i].value / 100.0);
+        } else {
+            cJSON_AddNumberToObject(o, "value", cues[i].value);
+        }
+        if (cues[i].type == CUE_LAMP_RAMP || cues[i].type == CUE_VOLUME_RAMP) {
+            cJSON_AddNumberToObject(o, "dur", (double)cues[i].dur_ms / 1000.0);
+        }
+        cJSON_AddItemToArray(arr, o);
+    }
+    free(cues);
+
+    char *js = cJSON_PrintUnformatted(arr);
+    cJSON_Delete(arr);
+    if (!js) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "OOM");
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache, no-store");
+    esp_err_t ret = httpd_resp_sendstr(req, js);
+    cJSON_free(js);
+    return ret;
+}
+
+static esp_err_t cues_post_handler(httpd_req_t *req)
+{
+    char fname[MAX_FNAME_LEN + 1] = {};
+    if (!get_query_param(req, "name", fname, sizeof(fname)) || !fname_valid(fname)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid or missing filename");
+        return ESP_FAIL;
+    }
+    int total = (int)req->content_len;
+    if (total <= 0 || total >= (int)sizeof(s_xfer_buf)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Body missing or too large");
+        return ESP_FAIL;
+    }
+    /* s_xfer_buf is free here: the HTTP server handles one request at a time. */
+    int got = 0;
+    while (got < total) {
+        int r = httpd_req_recv(req, s_xfer_buf + got, (size_t)(total - got));
+        if (r == HTTPD_SOCK_ERR_TIMEOUT) continue;
+        if (r <= 0) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Receive failed");
+            return ESP_FAIL;
+        }
+        got += r;
+    }
+    s_xfer_buf[got] = '\0';
+
+    cJSON *root = cJSON_Parse(s_xfer_buf);
+    if (!cJSON_IsArray(root) || cJSON_GetArraySize(root) > CUE_TRACK_MAX) {
+        cJSON_Delete(root);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Expected a JSON array of cues");
+        return ESP_FAIL;
+    }
+    int    n    = cJSON_GetArraySize(root);
+    cue_t *cues = (cue_t *)malloc(sizeof(cue_t) * (size_t)(n > 0 ? n : 1));
+    if (!cues) {
+        cJSON_Delete(root);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "OOM");
+        return ESP_FAIL;
+    }
+
+    bool ok = true;
+    int  i  = 0;
+    const cJSON *o;
+    cJSON_ArrayForEach(o, root) {
+        const cJSON *t  = cJSON_GetObjectItemCaseSensitive(o, "t");
+        const cJSON *ty = cJSON_GetObjectItemCaseSensitive(o, "type");
+        const cJSON *v  = cJSON_GetObjectItemCaseSensitive(o, "value");
+        const cJSON *d  = cJSON_GetObjectItemCaseSensitive(o, "dur");
+        uint8_t type = 0;
+        if (cJSON_IsString(ty) && ty->valuestring) {
+            for (uint8_t k = CUE_LAMP_LEVEL; k <= CUE_TEMPO_LOCK; k++) {
+                if (strcmp(ty->valuestring, CUE_TYPE_NAMES[k]) == 0) type = k;
+            }
+        }
+        if (type == 0 || !cJSON_IsNumber(t) || t->valuedouble < 0.0 || t->valuedouble > 4.0e6
+            || !cJSON_IsNumber(v)) {
+            ok = false;
+            break;
+        }
+        double val = (type == CUE_TEMPO_LOCK) ? v->valuedouble * 100.0 : v->valuedouble;
+        double dur = cJSON_IsNumber(d) ? d->valuedouble * 1000.0 : 0.0;
+        if (val < 0.0 || val > 255.0 || dur < 0.0 || dur > 65535.0) {
+            ok = false;
+            break;
+        }
+        cues[i].t_ms   = (uint32_t)(t->valuedouble * 1000.0 + 0.5);
+        cues[i].type   = type;
+        cues[i].value  = (uint8_t)(val + 0.5);
+        cues[i].dur_ms = (uint16_t)(dur + 0.5);
+        i++;
+    }
+    cJSON_Delete(root);
+
+    char wav_path[sizeof(MOUNT_POINT) + MAX_FNAME_LEN + 2];
+    build_path(wav_path, sizeof(wav_path), fname);
+    if (ok) ok = cue_track_write(wav_path, cues, n);
+    free(cues);
+    if (!ok) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid cue or write failed");
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Cue track saved via web for %s (%d cues)", fname, n);
+    httpd_resp_sendstr(req, "OK");
+    return ESP_OK;
+}
+
+/* ── GET <application JSON endpoint> ─────────────────────────────────── */
+
+static esp_err_t json_endpoint_get_handler(httpd_req_t *req)
+{
+    const json_endpoint_t *ep = static_cast<const json_endpoint_t *>(req->user_ctx);
+
+    char query[96] = {};
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK) query[0] = '\0';
+
+    /* s_xfer_buf is free here: the HTTP server handles one request at a time. */
+    int n = ep->cb(query, s_xfer_buf, sizeof(s_xfer_buf));
+    if (n < 0) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Not available");
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache, no-store");
+    return httpd_resp_send(req, s_xfer_buf, (ssize_t)n);
+}
+
 /* ── HTTP server ────────────────────────────────────────────────────── */
 
 static httpd_handle_t start_webserver(void)
 {
     httpd_config_t cfg = HTTPD_DEFAULT_CONFIG();
     cfg.stack_size        = 16384; /* OTA end/SHA256 verification needs more than default 4K */
-    cfg.max_uri_handlers  = 14;
+    cfg.max_uri_handlers  = 17 + WEB_MAX_JSON_ENDPOINTS;
     cfg.recv_wait_timeout = 60;    /* seconds – generous for large OTA uploads */
     cfg.send_wait_timeout = 60;
     cfg.lru_purge_enable  = true;
@@ -1124,6 +1420,7 @@ static httpd_handle_t start_webserver(void)
         { "/api/crank_config",   HTTP_GET,    crank_config_get_handler,      nullptr },
         { "/api/crank_config",   HTTP_POST,   crank_config_post_handler,     nullptr },
         { "/api/pot_cal",        HTTP_POST,   pot_cal_post_handler,          nullptr },
+        { "/api/crank_trace",    HTTP_GET,    crank_trace_get_handler,       nullptr },
         { "/download",           HTTP_GET,    download_get_handler,          nullptr },
         { "/upload",             HTTP_POST,   upload_post_handler,           nullptr },
         { "/rename",             HTTP_POST,   rename_post_handler,           nullptr },
@@ -1132,10 +1429,20 @@ static httpd_handle_t start_webserver(void)
         { "/player_update",      HTTP_POST,   player_update_post_handler,    nullptr },
         { "/api/song_settings",  HTTP_GET,    song_settings_get_handler,     nullptr },
         { "/api/song_settings",  HTTP_POST,   song_settings_post_handler,    nullptr },
+        { "/api/cues",           HTTP_GET,    cues_get_handler,              nullptr },
+        { "/api/cues",           HTTP_POST,   cues_post_handler,             nullptr },
     };
     for (size_t i = 0; i < sizeof(handlers) / sizeof(handlers[0]); i++) {
         httpd_register_uri_handler(server, &handlers[i]);
     }
+    for (int i = 0; i < s_json_endpoint_count; i++) {
+        httpd_uri_t u = {};
+        u.uri      = s_json_endpoints[i].uri;
+        u.method   = HTTP_GET;
+        u.handler  = json_endpoint_get_handler;
+        u.user_ctx = &s_json_endpoints[i];
+        httpd_register_uri_handler(server, &u);
+    }
 
     ESP_LOGI(TAG, "HTTP server started on port 80");
     return server;
@@ -1193,6 +1500,18 @@ void web_server_set_song_settings_callback(web_song_settings_cb_t cb)
     s_song_settings_cb = cb;
 }
 
+void web_server_add_json_endpoint(const char *uri, web_json_cb_t cb)
+{
+    if (!uri || !cb) return;
+    if (s_json_endpoint_count >= WEB_MAX_JSON_ENDPOINTS) {
+        ESP_LOGE(TAG, "No free JSON endpoint slot for %s", uri);
+        return;
+    }
+    s_json_endpoints[s_json_endpoint_count].uri = uri;
+    s_json_endpoints[s_json_endpoint_count].cb  = cb;
+    s_json_endpoint_count++;
+}
+
 void web_server_enable(void)
 {
     if (s_running) {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -30,6 +31,16 @@ typedef void (*web_song_settings_cb_t)(const char *wav_path,
                                        uint8_t     dimmer_holdoff_s,
                                        uint8_t     dimmer_fadein_s);
 
+/**
+ * Callback that renders a read-only JSON document for a diagnostics endpoint.
+ * Called from the HTTP-server task.
+ * @param query  URL query string (without '?'), or "" if none.
+ * @param buf    Output buffer for the JSON text (NUL-terminated by the callee).
+ * @param len    Size of @p buf in bytes.
+ * @return Number of bytes written (excluding NUL), or -1 on error.
+ */
+typedef int (*web_json_cb_t)(const char *query, char *buf, size_t len);
+
 /**
  * Initialise the WiFi stack (netif, event loop, esp_wifi_init) and store the
  * rescan callback.  Does NOT start the AP or HTTP server.
@@ -47,6 +58,14 @@ void web_server_init(rescan_cb_t on_files_changed);
  */
 void web_server_set_song_settings_callback(web_song_settings_cb_t cb);
 
+/**
+ * Register a GET endpoint (e.g. "/api/st_bench") served by @p cb.
+ * @p uri must point to storage that outlives the server (a string literal).
+ * Call from app_main before web_server_enable(); at most WEB_MAX_JSON_ENDPOINTS.
+ */
+#define WEB_MAX_JSON_ENDPOINTS  6
+void web_server_add_json_endpoint(const char *uri, web_json_cb_t cb);
+
 /**
  * Start the WiFi soft-AP and the HTTP file-manager server.
  * Safe to call from any task.  No-op if already running.
@@ -0,0 +1,509 @@
+"""Replay crank traces through the firmware speed and pause/resume logic.
+
+Builds the firmware modules for the host with a small driver and runs every
+io_task tick of a trace through them as the player does: crank_window_add()
+forms the 50 ms windows (encoder2_update()), crank_filter_push() estimates
+the speed and crank_gate_step() makes the pause / resume / fade decisions
+(io_task).  A simulated audio_task acts on the gate's commands one tick
+later.
+
+Per trace and estimator the report gives:
+  lag     shift of the reference speed that best matches the output, from
+          1 s after each start on, up to 3 s (ms)
+  rms     RMS difference to the reference speed, shifted by the look-ahead
+          the output is meant to have (RPS)
+  steady  RMS window-to-window change of the output while moving (RPS);
+          what crank unevenness turns into audible tempo wobble
+  rise    time from a speed step to 90 % of the new speed (synthetic only)
+  resume  mean / max time from the first count after >= 0.5 s of standstill
+          to the resume command (ms)
+  pause   mean / max time from the last count before such a standstill to
+          the pause command, fade-out included (ms)
+  extra   pause / resume commands that answer no standstill or start
+
+The reference is the true crank speed for the built-in synthetic traces and
+a centred 0.5 s average of the raw window speed for recorded ones.
+
+Recorded traces come from the player's flight recorder (crank_trace.h):
+    curl -o crank.bin http://192.168.4.1/api/crank_trace
+    curl http://192.168.4.1/api/crank_trace?clear=1       # start afresh
+They carry the crank config the player ran with; options given on the
+command line replace it for the replay.  Each recorded trace is first
+replayed under its own config with the logged audio_task state, from the
+first standstill on, and compared with what the player logged; a mismatch
+means this tool and the firmware have drifted apart.
+
+Usage:
+    python crank_replay.py                          # built-in synthetic traces
+    python crank_replay.py --trace crank.bin [--trace ...]
+    python crank_replay.py --trace crank.bin --estimator ab --ab-alpha 0.15
+    python crank_replay.py --trace crank.bin --stop 0.3 --start 0.8
+    python crank_replay.py --write-trace DIR        # synthetic traces as text
+
+Text traces: one io_task tick per line, "t_us counts", where counts is the
+PCNT delta of that tick (signed).  Lines starting with '#' are ignored.
+"""
+
+import argparse
+import math
+import os
+import random
+import struct
+import subprocess
+import sys
+import tempfile
+
+REPO = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SRC = os.path.join(REPO, "firmware", "player", "src")
+
+COUNTS_PER_REV = 1440     # CRANK_COUNTS_PER_REV
+TICK_US = 10000           # IO_TICK_US
+WINDOW_TICKS = 5          # CRANK_WINDOW_TICKS
+WINDOW_S = TICK_US * WINDOW_TICKS / 1e6
+LAG_MAX_S = 3.0           # below the 6 s period of the stop_go trace
+SETTLE_S = 1.0            # lag is measured this long after playback starts
+STILL_TICKS = 50          # 0.5 s without counts is a standstill
+
+# crank_trace.h
+TRACE_MAGIC = 0x31525443
+TRACE_HDR = struct.Struct("<IHHIIII7f5B7x")
+TRACE_REC = struct.Struct("<IhBBfff")
+TR_WINDOW, TR_MOVING, TR_PLAYING, TR_PAUSED, TR_SONG, TR_PAUSE, TR_RESUME = (
+    0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40)
+
+# crank_config_defaults(); keys match the command line options
+DEFAULTS = dict(attack=0.025, release=1.5, stop=0.25, start=0.70, release_windows=2,
+                dir=0, estimator=0, speed_mode=0, ab_alpha=0.10, ab_beta=0.005,
+                ab_lead=1.0, fade_step=1)
+
+DRIVER = r"""
+#include "crank_filter.h"
+#include "crank_gate.h"
+#include <cstdio>
+#include <cstdlib>
+
+/* argv: ticks.bin estimator attack release stop start release_windows
+ *       crank_dir ab_alpha ab_beta ab_lead speed_mode fade_step sim
+ * ticks.bin, per io_task tick: int64 t_us, int32 delta, float edge_rps,
+ *   float latency_s, uint16 flags (CRANK_TR_*), uint16 vol.
+ *   The first tick only primes the window clock.
+ * sim = 1: audio_task acts on the gate's commands one tick later;
+ * sim = 0: the recorded CRANK_TR_PLAYING / PAUSED / SONG flags are used.
+ * Prints "out moving instant window pause resume" per tick. */
+int main(int argc, char **argv)
+{
+    if (argc < 15) return 2;
+    crank_filter_cfg_t c;
+    crank_filter_defaults(&c);
+    c.estimator       = (uint8_t)atoi(argv[2]);
+    c.ema_attack      = (float)atof(argv[3]);
+    c.ema_release     = (float)atof(argv[4]);
+    c.stop_thresh     = (float)atof(argv[5]);
+    c.start_thresh    = (float)atof(argv[6]);
+    c.release_windows = (uint8_t)atoi(argv[7]);
+    c.crank_dir       = (int8_t)atoi(argv[8]);
+    c.ab_alpha        = (float)atof(argv[9]);
+    c.ab_beta         = (float)atof(argv[10]);
+    float   ab_lead    = (float)atof(argv[11]);
+    int     speed_mode = atoi(argv[12]);
+    uint8_t fade_step  = (uint8_t)atoi(argv[13]);
+    bool    sim        = atoi(argv[14]) != 0;
+
+    FILE *f = fopen(argv[1], "rb");
+    if (!f) return 2;
+    crank_window_t   w = {};
+    crank_filter_t   s;
+    crank_gate_t     g;
+    crank_gate_out_t go = {};
+    crank_filter_reset(&s);
+    crank_gate_reset(&g);
+
+    bool  playing = false, paused = true, song = true;   /* crank at rest */
+    float latency = 0.0f;
+    bool  first   = true;
+    struct { int64_t t_us; int32_t delta; float edge, latency; uint16_t flags, vol; } t;
+    static_assert(sizeof(t) == 24, "tick record");
+    while (fread(&t, sizeof(t), 1, f) == 1) {
+        if (first) {
+            first     = false;
+            w.last_us = t.t_us;
+            latency   = t.latency;
+            continue;
+        }
+        if (sim) {
+            if (go.pause)  { playing = false; paused = true;  }
+            if (go.resume) { playing = true;  paused = false; }
+        } else {
+            playing = (t.flags & 0x04) != 0;
+            paused  = (t.flags & 0x08) != 0;
+            song    = (t.flags & 0x10) != 0;
+        }
+
+        /* encoder2_update(); io_task set the look-ahead on the previous tick */
+        int   delta;
+        float dt;
+        bool  win = crank_window_add(&w, (int)t.delta, t.t_us, &delta, &dt);
+        if (win) {
+            c.lead_s = ab_lead * latency;
+            crank_filter_push(&s, &c, delta, dt, speed_mode == 1 ? t.edge : -1.0f);
+        }
+        latency = t.latency;
+
+        crank_gate_step(&g, s.moving, playing, paused, song, (uint8_t)t.vol, fade_step, &go);
+        printf("%.6f %d %.5f %d %d %d\n", s.out, s.moving ? 1 : 0, s.instant,
+               win ? 1 : 0, go.pause ? 1 : 0, go.resume ? 1 : 0);
+    }
+    fclose(f);
+    return 0;
+}
+"""
+
+
+def build_driver(workdir):
+    drv = os.path.join(workdir, "driver.cpp")
+    exe = os.path.join(workdir, "crank_replay_driver")
+    with open(drv, "w") as f:
+        f.write(DRIVER)
+    cxx = os.environ.get("CXX", "c++")
+    subprocess.check_call([cxx, "-O2", "-std=c++17", "-I", SRC,
+                           os.path.join(SRC, "crank_filter.cpp"),
+                           os.path.join(SRC, "crank_gate.cpp"), drv, "-o", exe])
+    return exe
+
+
+# ── Traces ─────────────────────────────────────────────────────────────────
+# A trace is a dict with "ticks", a list of
+# (t_us, delta, edge_rps, latency_s, flags, vol, logged_out), and "cfg", a
+# dict like DEFAULTS.
+
+def read_text_trace(path, vol):
+    ticks = []
+    with open(path) as f:
+        for line in f:
+            parts = line.split()
+            if not parts or parts[0].startswith("#"):
+                continue
+            ticks.append((int(parts[0]), int(parts[1]), -1.0, 0.0, 0, vol, 0.0))
+    return {"ticks": ticks, "cfg": dict(DEFAULTS)}
+
+
+def read_bin_trace(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    (magic, version, rec_size, count, lost, cfg_since, _tick_us, attack, release, stop,
+     start, ab_alpha, ab_beta, ab_lead, release_ticks, crank_dir, estimator, speed_mode,
+     fade_step) = TRACE_HDR.unpack_from(data, 0)
+    if magic != TRACE_MAGIC or rec_size != TRACE_REC.size:
+        raise SystemExit(f"{path}: not a crank trace this tool can read (version {version})")
+    count = min(count, (len(data) - TRACE_HDR.size) // rec_size)
+    ticks, base, prev = [], 1 << 32, None
+    for i in range(count):
+        t, delta, flags, vol, edge, out, lat = TRACE_REC.unpack_from(
+            data, TRACE_HDR.size + i * rec_size)
+        if prev is not None and t < prev:
+            base += 1 << 32                       # esp_timer low word wrapped
+        prev = t
+        ticks.append((base + t, delta, edge, lat, flags, vol, out))
+    cfg = dict(attack=attack, release=release, stop=stop, start=start,
+               release_windows=release_ticks, dir=crank_dir - 256 if crank_dir > 127 else crank_dir,
+               estimator=estimator, speed_mode=speed_mode, ab_alpha=ab_alpha,
+               ab_beta=ab_beta, ab_lead=ab_lead, fade_step=fade_step)
+    if lost:
+        print(f"{os.path.basename(path)}: {lost} ticks dropped during downloads")
+    return {"ticks": ticks, "cfg": cfg, "cfg_since": cfg_since, "recorded": True}
+
+
+def read_trace(path, vol):
+    with open(path, "rb") as f:
+        head = f.read(4)
+    if len(head) == 4 and struct.unpack("<I", head)[0] == TRACE_MAGIC:
+        return read_bin_trace(path)
+    return read_text_trace(path, vol)
+
+
+def synth(kind, vol, seconds=20.0, seed=1):
+    """Hand-crank trace with a known speed: 1 ms integration, 10 ms ticks
+    with +-300 us scheduling jitter, per-revolution unevenness of the hand.
+    "truth" holds the true speed at each tick."""
+    rnd = random.Random(seed)
+
+    def base(t):
+        if kind == "steps":
+            return 0.0 if t < 2.0 else 1.0 if t < 8.0 else 1.5 if t < 14.0 else 0.8
+        if kind == "ramp":
+            return 0.0 if t < 1.0 else min(2.0, 0.2 + 0.15 * (t - 1.0))
+        if kind == "stop_go":
+            return 0.0 if (t % 6.0) < 1.5 else 1.1
+        return 1.0
+
+    def speed(t):
+        v = base(t)
+        return v * (1.0 + 0.15 * math.sin(2 * math.pi * pos_rev[0]))  # uneven hand
+
+    pos_rev = [0.0]
+    ticks, truth, counted = [], [], 0
+    t_next = TICK_US / 1e6
+    dt = 0.001
+    t = 0.0
+    while t < seconds:
+        pos_rev[0] += speed(t) * dt
+        t += dt
+        if t >= t_next:
+            jitter = rnd.uniform(-300e-6, 300e-6)
+            t_us = int((t_next + jitter) * 1e6)
+            c = int(pos_rev[0] * COUNTS_PER_REV)
+            ticks.append((t_us, -(c - counted), -1.0, 0.0, 0, vol, 0.0))  # negative counts
+            truth.append(base(t))
+            counted = c
+            t_next += TICK_US / 1e6
+    steps = [8.0, 14.0] if kind == "steps" else []
+    return {"ticks": ticks, "cfg": dict(DEFAULTS), "truth": truth, "steps": steps}
+
+
+SYNTH = ["steady", "steps", "ramp", "stop_go"]
+
+
+def write_traces(outdir, vol):
+    os.makedirs(outdir, exist_ok=True)
+    for kind in SYNTH:
+        ticks = synth(kind, vol)["ticks"]
+        path = os.path.join(outdir, kind + ".txt")
+        with open(path, "w") as f:
+            f.write("# t_us counts\n")
+            f.writelines(f"{t[0]} {t[1]}\n" for t in ticks)
+        print(f"wrote {path} ({len(ticks)} ticks)")
+
+
+# ── Replay ─────────────────────────────────────────────────────────────────
+
+def replay(exe, ticks, cfg, sim, workdir):
+    """(out, moving, instant, window, pause, resume) for each of ticks[1:]."""
+    path = os.path.join(workdir, "ticks.bin")
+    with open(path, "wb") as f:
+        for t in ticks:
+            f.write(struct.pack("<qiffHH", t[0], t[1], t[2], t[3], t[4], t[5]))
+    cmd = [exe, path] + [str(cfg[k]) for k in (
+        "estimator", "attack", "release", "stop", "start", "release_windows", "dir",
+        "ab_alpha", "ab_beta", "ab_lead", "speed_mode", "fade_step")] + ["1" if sim else "0"]
+    rows = []
+    for line in subprocess.check_output(cmd, text=True).splitlines():
+        r = line.split()
+        rows.append((float(r[0]), r[1] == "1", float(r[2]), r[3] == "1",
+                     r[4] == "1", r[5] == "1"))
+    return rows
+
+
+def window_aligned(ticks):
+    """Drop the ticks before the first logged window end, which then primes
+    the replay's window clock: replay windows end where the player's did."""
+    for i, t in enumerate(ticks):
+        if t[4] & TR_WINDOW:
+            return ticks[i:]
+    return ticks
+
+
+def verify(exe, trace, workdir):
+    """Replay a recorded trace under its own config and the logged
+    audio_task state, from the first standstill after the last config change
+    on (filter and gate at rest there), and compare with the log."""
+    ticks = trace["ticks"]
+    still, start = 0, None
+    for i in range(trace["cfg_since"], len(ticks)):
+        t = ticks[i]
+        still = still + 1 if t[1] == 0 and not t[4] & TR_MOVING else 0
+        if still >= 2 * STILL_TICKS and t[4] & TR_WINDOW:
+            start = i
+            break
+    if start is None:
+        return "skipped, no standstill to start from"
+    seg = ticks[start:]
+    rows = replay(exe, seg, trace["cfg"], False, workdir)
+    worst, decisions, matched = 0.0, 0, 0
+    for t, r in zip(seg[1:], rows):
+        worst = max(worst, abs(r[0] - t[6]))
+        logged = (bool(t[4] & TR_MOVING), bool(t[4] & TR_PAUSE), bool(t[4] & TR_RESUME))
+        mine = (r[1], r[4], r[5])
+        if any(logged) or any(mine):
+            decisions += 1
+            matched += logged == mine
+    ok = worst < 1e-3 and matched == decisions
+    return (f"{'ok' if ok else 'MISMATCH'} - {len(rows)} ticks from tick {start}, "
+            f"speed within {worst:.1e} RPS, {matched}/{decisions} moving/pause/resume ticks agree")
+
+
+# ── Metrics ────────────────────────────────────────────────────────────────
+
+def centred_average(x, n):
+    half = n // 2
+    out = []
+    for i in range(len(x)):
+        seg = x[max(0, i - half):i + half + 1]
+        out.append(sum(seg) / len(seg))
+    return out
+
+
+def speed_metrics(out, moving, ref, steps, lead_windows):
+    """Per-window speed metrics; None if the crank never moved."""
+    idx = [i for i, m in enumerate(moving) if m]
+    if len(idx) < 10:
+        return None
+    # Lag: shift of the reference that best matches the output, over windows
+    # at least SETTLE_S into a moving stretch (startup is its own phase);
+    # undefined for a constant reference.
+    lag = None
+    settle = int(SETTLE_S / WINDOW_S)
+    run, idx_lag = 0, []
+    for i, m in enumerate(moving):
+        run = run + 1 if m else 0
+        if run > settle:
+            idx_lag.append(i)
+    rm = [ref[i] for i in idx_lag]
+    if len(rm) >= 10 and max(rm) - min(rm) > 0.05:
+        best = None
+        for k in range(0, int(LAG_MAX_S / WINDOW_S) + 1):
+            err = sum((out[i] - ref[max(0, i - k)]) ** 2 for i in idx_lag)
+            if best is None or err < best:
+                best, lag = err, k
+    # RMS against the reference the output should show (lead included).
+    pairs = [(out[i], ref[min(len(ref) - 1, i + lead_windows)]) for i in idx]
+    rms = math.sqrt(sum((a - b) ** 2 for a, b in pairs) / len(pairs))
+    diffs = [out[i] - out[i - 1] for i in idx if i > 0 and moving[i - 1]]
+    steady = math.sqrt(sum(d * d for d in diffs) / len(diffs)) if diffs else 0.0
+    rises = []
+    for t0 in steps:
+        i0 = int(t0 / WINDOW_S)
+        if i0 + 1 >= len(ref):
+            continue
+        before, after = out[i0 - 1] if i0 > 0 else 0.0, ref[i0 + 1]
+        for i in range(i0, len(out)):
+            if abs(out[i] - before) >= 0.9 * abs(after - before):
+                rises.append((i - i0) * WINDOW_S)
+                break
+    return (lag * WINDOW_S * 1000.0 if lag is not None else None), rms, steady, rises
+
+
+def gate_metrics(deltas, pauses, resumes):
+    """Latency of each crank start -> resume and stop -> pause [ms], and the
+    number of commands that answer neither."""
+    events, still, last = [], STILL_TICKS, None
+    for i, d in enumerate(deltas):
+        if d != 0:
+            if still >= STILL_TICKS:
+                events.append((i, "start"))
+            still, last = 0, i
+        else:
+            still += 1
+            if still == STILL_TICKS and last is not None:
+                events.append((last, "stop"))
+
+    def match(kind, cmds):
+        lat, used = [], 0
+        for k, (i, what) in enumerate(events):
+            if what != kind:
+                continue
+            end = events[k + 1][0] if k + 1 < len(events) else len(deltas)
+            hit = next((c for c in cmds if i <= c < end), None)
+            if hit is not None:
+                used += 1
+                lat.append((hit - i) * TICK_US / 1000.0)
+        return lat, len(cmds) - used
+
+    resume_lat, extra_r = match("start", resumes)
+    pause_lat, extra_p = match("stop", pauses)
+    return resume_lat, pause_lat, extra_r + extra_p
+
+
+def fmt_lat(lat):
+    if not lat:
+        return f"{'-':>9}"
+    return f"{sum(lat) / len(lat):4.0f}/{max(lat):<4.0f}"
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    ap.add_argument("--trace", action="append", metavar="FILE",
+                    help="crank trace from /api/crank_trace, or a text trace")
+    ap.add_argument("--estimator", choices=["ema", "ab", "both", "trace"], default="both",
+                    help="'trace': the one in the trace's config")
+    ap.add_argument("--attack", type=float, help="ema_attack")
+    ap.add_argument("--release", type=float, help="ema_release")
+    ap.add_argument("--stop", type=float, help="stop_thresh")
+    ap.add_argument("--start", type=float, help="start_thresh")
+    ap.add_argument("--release-windows", type=int, help="release_ticks")
+    ap.add_argument("--dir", type=int, help="crank_dir")
+    ap.add_argument("--speed-mode", type=int, choices=[0, 1],
+                    help="1 = edge timing (recorded traces only)")
+    ap.add_argument("--ab-alpha", type=float)
+    ap.add_argument("--ab-beta", type=float)
+    ap.add_argument("--ab-lead", type=float)
+    ap.add_argument("--fade-step", type=int, help="vol_fade_step")
+    ap.add_argument("--latency-ms", type=float, default=100.0,
+                    help="output latency of text and synthetic traces "
+                         "(out_latency_ms of /api/light_organ)")
+    ap.add_argument("--vol", type=int, default=70, help="volume of text and synthetic traces")
+    ap.add_argument("--write-trace", metavar="DIR", help="write the synthetic traces and exit")
+    args = ap.parse_args()
+
+    if args.write_trace:
+        write_traces(args.write_trace, args.vol)
+        return 0
+
+    names = {0: "ema", 1: "alpha-beta"}
+    with tempfile.TemporaryDirectory() as workdir:
+        exe = build_driver(workdir)
+        traces = []
+        if args.trace:
+            for path in args.trace:
+                traces.append((os.path.basename(path), read_trace(path, args.vol)))
+        else:
+            for kind in SYNTH:
+                traces.append((kind, synth(kind, args.vol)))
+
+        for name, tr in traces:
+            if tr.get("recorded"):
+                print(f"{name}: replay of the logged config {verify(exe, tr, workdir)}")
+
+        print(f"{'trace':>10} {'estimator':>10} {'lag ms':>7} {'rms':>7} {'steady':>7} "
+              f"{'rise s':>7} {'resume ms':>9} {'pause ms':>9} {'extra':>5}")
+        for name, tr in traces:
+            if tr.get("recorded"):
+                ticks = window_aligned(tr["ticks"])
+            else:
+                lat = args.latency_ms / 1000.0
+                ticks = [t[:3] + (lat,) + t[4:] for t in tr["ticks"]]
+            cfg = dict(tr["cfg"])
+            for key in DEFAULTS:
+                if key != "estimator" and getattr(args, key, None) is not None:
+                    cfg[key] = getattr(args, key)
+            ests = {"ema": [0], "ab": [1], "both": [0, 1],
+                    "trace": [cfg["estimator"]]}[args.estimator]
+            deltas = [t[1] for t in ticks[1:]]
+            lat_s = sum(t[3] for t in ticks) / len(ticks)
+            for est in ests:
+                cfg["estimator"] = est
+                rows = replay(exe, ticks, cfg, True, workdir)
+                win = [i for i, r in enumerate(rows) if r[3]]
+                out = [rows[i][0] for i in win]
+                moving = [rows[i][1] for i in win]
+                if "truth" in tr:
+                    ref = [tr["truth"][i + 1] for i in win]
+                else:
+                    ref = centred_average([rows[i][2] for i in win], int(0.5 / WINDOW_S))
+                lead = int(round(cfg["ab_lead"] * lat_s / WINDOW_S)) if est else 0
+                m = speed_metrics(out, moving, ref, tr.get("steps", []), lead)
+                if m is None:
+                    print(f"{name:>10} {names[est]:>10}   never moving")
+                    continue
+                resume_lat, pause_lat, extra = gate_metrics(
+                    deltas, [i for i, r in enumerate(rows) if r[4]],
+                    [i for i, r in enumerate(rows) if r[5]])
+                lag, rms, steady, rises = m
+                rise = f"{max(rises):7.2f}" if rises else f"{'-':>7}"
+                lag = f"{lag:7.0f}" if lag is not None else f"{'-':>7}"
+                print(f"{name:>10} {names[est]:>10} {lag} {rms:7.3f} {steady:7.4f} {rise} "
+                      f"{fmt_lat(resume_lat)} {fmt_lat(pause_lat)} {extra:5d}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,284 @@
+"""Score the light-organ onset detector on labelled clips.
+
+Builds the firmware detector (firmware/player/src/lo_onset.cpp) for the host
+with a small driver, computes the same spectra the player feeds it (256-sample
+Hann window centred on each hop, bins 1-15, 0.5*log10(energy + 1), see
+light_organ_bands()) and compares the detected onsets with the labels.
+
+A detection within --tol ms of a label is a hit (one-to-one, greedy in time
+order); the report gives precision, recall and F-measure per clip, and the
+detector's CPU time per frame on this host.  On the device, /api/light_organ
+reports the whole analysis frame (FFT + detector) in avg_us.
+
+Usage:
+    python lo_onset_score.py                       # built-in synthetic clips
+    python lo_onset_score.py --clip song.wav song.txt [--clip ...]
+    python lo_onset_score.py --hop-ms 50           # live analysis at 20 Hz
+    python lo_onset_score.py --write-wav DIR       # synthetic clips + labels
+
+Label files: one onset per line, time in seconds in the first column
+(Audacity label tracks export this format).  WAVs must be 16-bit PCM; the
+first channel is analysed, as on the player.
+
+Exit status 1 if the overall F-measure is below --min-f.
+"""
+
+import argparse
+import math
+import os
+import random
+import struct
+import subprocess
+import sys
+import tempfile
+import wave
+
+REPO = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SRC = os.path.join(REPO, "firmware", "player", "src")
+
+FFT_SIZE = 256   # LIGHT_ORGAN_FFT_SIZE
+BINS = 15        # LO_ONSET_BINS: bins 1..15
+
+DRIVER = r"""
+#include "lo_onset.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) return 2;
+    float hop_ms = (float)atof(argv[2]);
+    FILE *f = fopen(argv[1], "rb");
+    if (!f) return 2;
+    std::vector<float> bins;
+    float v;
+    while (fread(&v, sizeof(v), 1, f) == 1) bins.push_back(v);
+    fclose(f);
+    size_t frames = bins.size() / LO_ONSET_BINS;
+
+    lo_onset_t d;
+    lo_onset_init(&d, hop_ms);
+    for (size_t i = 0; i < frames; i++) {
+        float s = lo_onset_push(&d, &bins[i * LO_ONSET_BINS]);
+        if (s > 0.0f) printf("%zu %.3f\n", i, s);
+    }
+
+    /* Timing: repeat the clip until ~0.2 s have elapsed. */
+    size_t n = 0;
+    volatile float sink = 0.0f;
+    auto t0 = std::chrono::steady_clock::now();
+    double el = 0.0;
+    do {
+        lo_onset_init(&d, hop_ms);
+        for (size_t i = 0; i < frames; i++) sink += lo_onset_push(&d, &bins[i * LO_ONSET_BINS]);
+        n += frames;
+        el = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    } while (el < 0.2 && frames > 0);
+    printf("ns %.1f\n", n ? el * 1e9 / (double)n : 0.0);
+    return 0;
+}
+"""
+
+
+def build_detector(workdir):
+    drv = os.path.join(workdir, "driver.cpp")
+    exe = os.path.join(workdir, "lo_onset_driver")
+    with open(drv, "w") as f:
+        f.write(DRIVER)
+    cxx = os.environ.get("CXX", "c++")
+    subprocess.check_call([cxx, "-O2", "-std=c++17", "-I", SRC,
+                           os.path.join(SRC, "lo_onset.cpp"), drv, "-o", exe])
+    return exe
+
+
+# ── Spectra ────────────────────────────────────────────────────────────────
+
+WIN = [0.5 - 0.5 * math.cos(2.0 * math.pi * i / (FFT_SIZE - 1)) for i in range(FFT_SIZE)]
+COS = [[math.cos(2.0 * math.pi * k * i / FFT_SIZE) * WIN[i] for i in range(FFT_SIZE)]
+       for k in range(1, BINS + 1)]
+SIN = [[math.sin(2.0 * math.pi * k * i / FFT_SIZE) * WIN[i] for i in range(FFT_SIZE)]
+       for k in range(1, BINS + 1)]
+
+
+def spectra(samples, sr, hop_ms):
+    """Log bin magnitudes per hop; frame k is centred on sample k*hop."""
+    hop = sr * hop_ms / 1000.0
+    frames = int(len(samples) / hop) + 1
+    half = FFT_SIZE // 2
+    pad = [0.0] * half
+    x = pad + [s / 32768.0 for s in samples] + pad + pad
+    out = []
+    for k in range(frames):
+        seg = x[int(k * hop):int(k * hop) + FFT_SIZE]
+        for c, s in zip(COS, SIN):
+            re = sum(map(float.__mul__, seg, c))
+            im = sum(map(float.__mul__, seg, s))
+            out.append(0.5 * math.log10(re * re + im * im + 1.0))
+    return out, frames
+
+
+# ── Clips ──────────────────────────────────────────────────────────────────
+
+def read_wav(path):
+    with wave.open(path) as w:
+        if w.getsampwidth() != 2:
+            raise SystemExit(f"{path}: only 16-bit PCM is supported")
+        ch, sr = w.getnchannels(), w.getframerate()
+        raw = w.readframes(w.getnframes())
+    data = struct.unpack(f"<{len(raw) // 2}h", raw)
+    return list(data[::ch]), sr
+
+
+def read_labels(path):
+    out = []
+    with open(path) as f:
+        for line in f:
+            parts = line.split()
+            if parts:
+                try:
+                    out.append(float(parts[0]))
+                except ValueError:
+                    pass
+    return sorted(out)
+
+
+def synth(kind, sr=48000, seconds=12.0, seed=1):
+    """Synthetic clip with known onsets: a sustained, swelling pad (what
+    makes the energy level breathe) plus percussive hits."""
+    rnd = random.Random(seed)
+    n = int(seconds * sr)
+    y = [0.0] * n
+    for i in range(n):
+        t = i / sr
+        swell = 0.5 + 0.5 * math.sin(2 * math.pi * t / 4.0)
+        y[i] = 0.12 * swell * (math.sin(2 * math.pi * 110 * t) + 0.5 * math.sin(2 * math.pi * 220 * t))
+
+    onsets = []
+    if kind == "kick120":
+        onsets = [0.25 + 0.5 * i for i in range(int((seconds - 0.5) / 0.5))]
+    elif kind == "pattern":
+        t = 0.3
+        while t < seconds - 0.3:
+            onsets.append(t)
+            t += rnd.choice([0.125, 0.25, 0.25, 0.375, 0.5])
+    elif kind == "dynamics":
+        onsets = [0.3 + 0.4 * i for i in range(int((seconds - 0.6) / 0.4))]
+    for j, t0 in enumerate(onsets):
+        i0 = int(t0 * sr)
+        snare = kind == "pattern" and rnd.random() < 0.4
+        gain = 0.7
+        if kind == "dynamics":
+            gain = 0.7 if (j // 6) % 2 == 0 else 0.12   # loud and quiet bars
+        for i in range(i0, min(n, i0 + int(0.25 * sr))):
+            t = (i - i0) / sr
+            if snare:
+                v = rnd.uniform(-1.0, 1.0) * math.exp(-t / 0.05) \
+                    + 0.5 * math.sin(2 * math.pi * 400 * t) * math.exp(-t / 0.04)
+            else:
+                f = 60 + 90 * math.exp(-t / 0.03)            # pitch-dropping kick
+                v = math.sin(2 * math.pi * f * t) * math.exp(-t / 0.12)
+            y[i] += gain * v
+    samples = [max(-32768, min(32767, int(v * 32767 * 0.8))) for v in y]
+    return samples, sr, onsets
+
+
+SYNTH = ["kick120", "pattern", "dynamics"]
+
+
+def write_synth(outdir):
+    os.makedirs(outdir, exist_ok=True)
+    for kind in SYNTH:
+        samples, sr, onsets = synth(kind)
+        path = os.path.join(outdir, kind + ".wav")
+        with wave.open(path, "w") as w:
+            w.setparams((1, 2, sr, 0, "NONE", "not compressed"))
+            w.writeframes(struct.pack(f"<{len(samples)}h", *samples))
+        with open(os.path.join(outdir, kind + ".txt"), "w") as f:
+            f.writelines(f"{t:.4f}\t{t:.4f}\tonset\n" for t in onsets)
+        print(f"wrote {path} ({len(onsets)} onsets)")
+
+
+# ── Scoring ────────────────────────────────────────────────────────────────
+
+def match(det, ref, tol):
+    hits, used = 0, set()
+    for r in ref:
+        best = None
+        for i, d in enumerate(det):
+            if i in used or abs(d - r) > tol:
+                continue
+            if best is None or abs(d - r) < abs(det[best] - r):
+                best = i
+        if best is not None:
+            used.add(best)
+            hits += 1
+    return hits
+
+
+def run_clip(exe, name, samples, sr, ref, hop_ms, tol, workdir):
+    bins, frames = spectra(samples, sr, hop_ms)
+    path = os.path.join(workdir, "bins.f32")
+    with open(path, "wb") as f:
+        f.write(struct.pack(f"<{len(bins)}f", *bins))
+    out = subprocess.check_output([exe, path, str(hop_ms)], text=True)
+    det, ns = [], 0.0
+    for line in out.splitlines():
+        a, b = line.split()
+        if a == "ns":
+            ns = float(b)
+        else:
+            det.append(int(a) * hop_ms / 1000.0)
+    hits = match(det, ref, tol)
+    p = hits / len(det) if det else 0.0
+    r = hits / len(ref) if ref else 0.0
+    fm = 2 * p * r / (p + r) if p + r else 0.0
+    print(f"{name:>12}: {len(ref):3d} labels, {len(det):3d} detected, "
+          f"P {p:.2f}  R {r:.2f}  F {fm:.2f}   ({frames} frames, {ns:.0f} ns/frame)")
+    return hits, len(det), len(ref), ns
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    ap.add_argument("--clip", nargs=2, action="append", metavar=("WAV", "LABELS"))
+    ap.add_argument("--hop-ms", type=float, default=10.0,
+                    help="analysis hop (10 = envelope, 1000/lo_rate_hz = live)")
+    ap.add_argument("--tol", type=float, default=50.0, help="hit tolerance, ms")
+    ap.add_argument("--min-f", type=float, default=0.85)
+    ap.add_argument("--write-wav", metavar="DIR", help="write the synthetic clips and exit")
+    args = ap.parse_args()
+
+    if args.write_wav:
+        write_synth(args.write_wav)
+        return 0
+
+    # A frame can only be as exact as the hop it lands in.
+    tol = max(args.tol, args.hop_ms) / 1000.0
+    with tempfile.TemporaryDirectory() as workdir:
+        exe = build_detector(workdir)
+        clips = []
+        if args.clip:
+            for wav_path, lab_path in args.clip:
+                s, sr = read_wav(wav_path)
+                clips.append((os.path.basename(wav_path), s, sr, read_labels(lab_path)))
+        else:
+            for kind in SYNTH:
+                clips.append((kind,) + synth(kind))
+        tot_hits = tot_det = tot_ref = 0
+        ns = []
+        print(f"hop {args.hop_ms:g} ms, tolerance {tol * 1000:.0f} ms")
+        for name, s, sr, ref in clips:
+            h, d, r, t = run_clip(exe, name, s, sr, ref, args.hop_ms, tol, workdir)
+            tot_hits, tot_det, tot_ref = tot_hits + h, tot_det + d, tot_ref + r
+            ns.append(t)
+    p = tot_hits / tot_det if tot_det else 0.0
+    r = tot_hits / tot_ref if tot_ref else 0.0
+    fm = 2 * p * r / (p + r) if p + r else 0.0
+    print(f"{'overall':>12}: P {p:.2f}  R {r:.2f}  F {fm:.2f}   "
+          f"detector {max(ns):.0f} ns/frame on this host")
+    return 0 if fm >= args.min_f else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,241 @@
+"""Offline check of the light-organ latency compensation with a click track.
+
+Simulates the player's output path sample by sample:
+
+    tap -> SoundTouch element -> 16 KB rb -> ALC -> 16 KB rb -> i2s_stream
+        (3600 B write buffer) -> 4 x 256 frame DMA ring -> DAC
+
+The element emits output in 256-frame writes and records an output->source
+mark for each, like soundtouch_el_tap_out_src().  At every analysis frame
+the firmware's estimate (main.cpp: audible_tap_index) is formed from the
+ring-buffer fill levels and compared with the source sample actually at the
+DAC.  A click track is pushed through the same path; the lamp "lights" when
+the analysis window around the estimated position holds a click, and every
+click must light the lamp within one analysis frame of the frame an exact
+position would have lit it in.
+
+Usage:
+    python lo_sync_check.py                      # default speed profiles
+    python lo_sync_check.py --rate 50 --speeds 0.6 1.0 2.0
+    python lo_sync_check.py --write-wav click.wav   # click track for the device
+
+Exit status 1 if any click is outside one analysis frame.
+"""
+
+import argparse
+import math
+import struct
+import sys
+import wave
+
+SAMPLE_RATE = 48000          # uploads are normalised to 48 kHz mono
+CLICK_PERIOD_S = 0.5
+CLICK_LEN_S = 0.15          # long enough to span a frame at 2x and 10 Hz
+CLICK_FREQ_HZ = 250.0        # lands in the bass bins
+
+ST_CHUNK = 16384             # soundtouch_el.cpp ST_CHUNK_FRAMES
+ST_OUT_FRAMES = 256          # soundtouch_el.cpp ST_OUT_FRAMES
+ST_LATENCY = 4000            # SoundTouch look-ahead kept back, source samples
+ST_LOAD = 0.35               # processing time per chunk / chunk duration at 1x
+RB_SONIC = 16 * 1024 // 2    # samples
+RB_ALC = 16 * 1024 // 2
+ALC_BLOCK = 512
+I2S_BUFFER = 3600 // 2
+DMA_DESC = 4
+DMA_FRAMES = 256
+FFT_SIZE = 256
+
+
+def click_at(src):
+    """True if source sample index src lies inside a click."""
+    t = src / SAMPLE_RATE
+    return (t % CLICK_PERIOD_S) < CLICK_LEN_S
+
+
+def click_sample(i):
+    t = i / SAMPLE_RATE
+    if (t % CLICK_PERIOD_S) >= CLICK_LEN_S:
+        return 0
+    return int(0.8 * 32767 * math.sin(2.0 * math.pi * CLICK_FREQ_HZ * t))
+
+
+def write_wav(path, seconds):
+    with wave.open(path, "w") as w:
+        w.setparams((1, 2, SAMPLE_RATE, 0, "NONE", "not compressed"))
+        n = int(seconds * SAMPLE_RATE)
+        w.writeframes(b"".join(struct.pack("<h", click_sample(i)) for i in range(n)))
+    print(f"wrote {path}: {seconds:.0f} s, click every {CLICK_PERIOD_S * 1000:.0f} ms")
+
+
+class Fifo:
+    """Sample FIFO that only tracks counts; order is preserved end to end."""
+
+    def __init__(self, cap):
+        self.cap = cap
+        self.fill = 0
+
+    def space(self):
+        return self.cap - self.fill
+
+
+def simulate(speed_at, seconds, rate_hz):
+    sonic_rb, alc_rb = Fifo(RB_SONIC), Fifo(RB_ALC)
+    dma = Fifo(DMA_DESC * DMA_FRAMES)
+
+    # Element state
+    head = 0                  # source samples read into SoundTouch
+    out_src = 0.0             # source index of the next output sample
+    out_written = 0           # samples written to sonic_rb (published)
+    marks = []                # (out, src, src_per_out)
+    pending = 0               # output samples of the current piece not yet in rb
+    piece_left = 0
+    busy = 0                  # processing countdown, samples
+    tempo = 1.0
+    out_src_of = []           # source position of each output sample, by index
+    out_tempo_of = []         # tempo each output sample was stretched at
+
+    alc_hold = 0              # ALC block waiting to be written to alc_rb
+    i2s_hold = 0              # i2s_stream buffer waiting for DMA space
+    dac_idx = 0               # output samples played so far
+    truth = None              # source position at the DAC
+    truth_tempo = 1.0
+
+    period = int(SAMPLE_RATE / rate_hz)
+    naive = 0.0               # previous method: speed integrated over wall time
+    naive_errors = []
+    errors = []
+    lamp_on = []              # analysis times (s) where the lamp turns on
+    ideal_on = []             # same, had the estimate been exact
+    lit = ideal_lit = False
+
+    total = int(seconds * SAMPLE_RATE)
+    for t in range(total):
+        now_s = t / SAMPLE_RATE
+        naive += speed_at(now_s)
+
+        # DAC: one sample per tick
+        if dma.fill > 0:
+            src = out_src_of[dac_idx]
+            truth = src
+            truth_tempo = out_tempo_of[dac_idx]
+            dma.fill -= 1
+            dac_idx += 1
+        # i2s_stream: fill freed descriptors from its buffer, refill buffer
+        if i2s_hold == 0 and alc_rb.fill >= I2S_BUFFER:
+            alc_rb.fill -= I2S_BUFFER
+            i2s_hold = I2S_BUFFER
+        if i2s_hold and dma.space() > 0:
+            n = min(i2s_hold, dma.space())
+            dma.fill += n
+            i2s_hold -= n
+        # ALC: move blocks sonic_rb -> alc_rb
+        if alc_hold == 0 and sonic_rb.fill >= ALC_BLOCK:
+            sonic_rb.fill -= ALC_BLOCK
+            alc_hold = ALC_BLOCK
+        if alc_hold and alc_rb.space() > 0:
+            n = min(alc_hold, alc_rb.space())
+            alc_rb.fill += n
+            alc_hold -= n
+        # Element
+        if busy > 0:
+            busy -= 1
+        elif piece_left > 0 or pending > 0:
+            if piece_left == 0:
+                piece_left = min(ST_OUT_FRAMES, pending)
+                pending -= piece_left
+                marks.append((out_written, out_src, tempo))
+                piece_left_total = piece_left
+            n = min(piece_left, sonic_rb.space())
+            for _ in range(n):
+                out_src_of.append(out_src)
+                out_tempo_of.append(tempo)
+                out_src += tempo
+            sonic_rb.fill += n
+            piece_left -= n
+            if piece_left == 0:
+                out_written += piece_left_total
+        else:
+            tempo = speed_at(now_s)
+            head += ST_CHUNK
+            avail = int((head - ST_LATENCY - out_src) / tempo)
+            pending = max(avail, 0)
+            busy = int(ST_CHUNK * ST_LOAD / tempo)
+
+        # Analysis frame
+        if t % period == 0 and truth is not None:
+            queued = sonic_rb.fill + alc_rb.fill + I2S_BUFFER // 2 + DMA_DESC * DMA_FRAMES
+            target = out_written - queued
+            est = None
+            for m_out, m_src, m_spo in reversed(marks[-256:]):
+                if target >= m_out:
+                    est = m_src + (target - m_out) * m_spo
+                    break
+            if est is None:
+                continue
+            # Timing error as heard: source samples / speed of that audio.
+            errors.append((est - truth) / SAMPLE_RATE / truth_tempo)
+            naive_errors.append((naive - truth) / SAMPLE_RATE / truth_tempo)
+            now_lit = window_has_click(int(est))
+            if now_lit and not lit:
+                lamp_on.append(now_s)
+            lit = now_lit
+            now_ideal = window_has_click(int(truth))
+            if now_ideal and not ideal_lit:
+                ideal_on.append(now_s)
+            ideal_lit = now_ideal
+
+    return errors, naive_errors, ideal_on, lamp_on
+
+
+def window_has_click(centre):
+    first = centre - FFT_SIZE // 2
+    return any(click_at(s) for s in range(first, first + FFT_SIZE, 16))
+
+
+def click_lags(ideal_on, lamp_on, frame_s):
+    """Lamp switch-on time minus the frame an exact position would have lit
+    the lamp in, per click (multiples of the frame period)."""
+    lags = []
+    for h in ideal_on:
+        near = [x - h for x in lamp_on if -2 * frame_s <= x - h <= 2 * frame_s]
+        lags.append(min(near, key=abs) if near else None)
+    return lags
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    ap.add_argument("--rate", type=float, default=20.0, help="analysis rate, Hz (lo_rate_hz)")
+    ap.add_argument("--seconds", type=float, default=12.0)
+    ap.add_argument("--speeds", type=float, nargs="*", default=[0.5, 1.0, 1.4, 2.0])
+    ap.add_argument("--write-wav", metavar="PATH", help="write the click track and exit")
+    args = ap.parse_args()
+
+    if args.write_wav:
+        write_wav(args.write_wav, 60.0)
+        return 0
+
+    frame_s = 1.0 / args.rate
+    cases = [(f"{s:.1f}x", (lambda s: lambda t: s)(s)) for s in args.speeds]
+    cases.append(("ramp 0.5x->2.0x", lambda t: 0.5 + 1.5 * min(t / args.seconds, 1.0)))
+    cases.append(("steps 1x/2x", lambda t: 2.0 if int(t / 2.0) % 2 else 1.0))
+
+    ok = True
+    for name, speed_at in cases:
+        errors, naive_errors, ideal_on, lamp_on = simulate(speed_at, args.seconds, args.rate)
+        lags = click_lags(ideal_on[1:], lamp_on, frame_s)   # first click hits the pre-roll
+        missed = sum(1 for x in lags if x is None)
+        bad = [x for x in lags if x is not None and abs(x) > frame_s * 1.001]
+        worst = max((abs(x) for x in lags if x is not None), default=0.0)
+        max_err = max((abs(e) for e in errors), default=0.0)
+        max_naive = max((abs(e) for e in naive_errors), default=0.0)
+        status = "ok" if not bad and not missed else "FAIL"
+        ok &= status == "ok"
+        print(f"{name:>16}: timing error max {max_err * 1000:5.1f} ms, "
+              f"{len(lags)} clicks, worst lag {worst * 1000:5.1f} ms "
+              f"(frame {frame_s * 1000:.0f} ms), missed {missed}  {status}  "
+              f"[wall-clock position: {max_naive * 1000:.0f} ms]")
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())